@@ -71,6 +71,7 @@
 #include "backend_commit.h"
 #include "backend_client.h"
 #include "backend_handle.h"
+#include "backend_worker.h"
 
 /*! Find client by session-id 
  * @param[in] ce_list   List of clients
@@ -88,20 +89,86 @@ ce_find_byid(struct client_entry *ce_list,
     return NULL;
 }
 
+static int to_client(int s, void *arg);
+
+/*! Check if client entry is still in client list, ie it has not been removed
+ * @param[in]  h   Clicon handle
+ * @param[in]  ce  Client entry
+ */
+static int
+ce_exists(clicon_handle        h,
+	  struct client_entry *ce)
+{
+    struct client_entry *c;
+
+    for (c = backend_client_list(h); c; c = c->ce_next)
+	if (c == ce)
+	    return 1;
+    return 0;
+}
+
+/*! Wait for client socket to be writable if data to client is pending after a send
+ * Stop reading requests from the client until the pending data has been written.
+ * @param[in]  ce       Client entry
+ * @param[in]  pending0 Number of bytes pending before the send
+ * @see to_client
+ */
+static int
+ce_output_pending(struct client_entry *ce,
+		  size_t               pending0)
+{
+    if (pending0 != 0 || clicon_msg_buf_pending(&ce->ce_wbuf) == 0)
+	return 0;
+    clicon_debug(1, "%s client %d: %zu bytes pending", __FUNCTION__,
+		 ce->ce_nr, clicon_msg_buf_pending(&ce->ce_wbuf));
+    clixon_event_unreg_fd(ce->ce_s, from_client);
+    return clixon_event_reg_fd_out(ce->ce_s, to_client, (void*)ce, "local netconf client output");
+}
+
+/*! Timeout callback closing clients whose pending output exceeded its max
+ * @param[in]  s     Not used
+ * @param[in]  arg   Clicon handle
+ * @see ce_event_cb
+ */
+static int
+ce_overflow_cb(int   s,
+	       void *arg)
+{
+    clicon_handle        h = (clicon_handle)arg;
+    struct client_entry *ce;
+    struct client_entry *ce_next;
+
+    for (ce = backend_client_list(h); ce; ce = ce_next){
+	ce_next = ce->ce_next;
+	if (ce->ce_overflow && ce->ce_s)
+	    backend_client_rm(h, ce);
+    }
+    return 0;
+}
+
 /*! Stream callback for netconf stream notification (RFC 5277)
+ * If the output pending to the client exceeds CLICON_BACKEND_OUTPUT_MAX, eg the client
+ * does not read its notifications, the notification is dropped and the client is closed.
+ * The client is not removed here since the callback is called when looping over
+ * subscriptions, but in a timeout.
  * @param[in]  h     Clicon handle
  * @param[in]  op    0:event, 1:rm
  * @param[in]  event Event as XML
+ * @param[in]  se    Shared event with serialized text, or NULL
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
  */
 int
-ce_event_cb(clicon_handle h,
-	    int           op,
-	    cxobj        *event,
-	    void         *arg)
+ce_event_cb(clicon_handle        h,
+	    int                  op,
+	    cxobj               *event,
+	    struct stream_event *se,
+	    void                *arg)
 {
     struct client_entry *ce = (struct client_entry *)arg;
+    size_t               pending;
+    int                  max;
+    struct timeval       tnull = {0,};
     
     clicon_debug(1, "%s op:%d", __FUNCTION__, op);
     switch (op){
@@ -111,12 +178,29 @@ ce_event_cb(clicon_handle h,
 	    backend_client_rm(h, ce);
 	break;
     default:
-	if (send_msg_notify_xml(h, ce->ce_s, event) < 0){
+	if (ce->ce_overflow)
+	    break;
+	pending = clicon_msg_buf_pending(&ce->ce_wbuf);
+	max = clicon_option_int(h, "CLICON_BACKEND_OUTPUT_MAX");
+	if (max > 0 && pending >= (size_t)max){
+	    clicon_log(LOG_WARNING, "client %d: %zu bytes of output pending exceeds CLICON_BACKEND_OUTPUT_MAX, dropping notifications and closing client",
+		       ce->ce_nr, pending);
+	    ce->ce_overflow = 1;
+	    if (clixon_event_reg_timeout(tnull, ce_overflow_cb, h,
+					 "backend client output overflow") < 0)
+		return -1;
+	    break;
+	}
+	/* Text of event is shared by all clients */
+	if (send_msg_notify_xml_nb(h, ce->ce_s, &ce->ce_wbuf, event,
+				   stream_event_cbuf(se)) < 0){
 	    if (errno == ECONNRESET || errno == EPIPE){
 		clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
 	    }
 	    break;
 	}
+	if (ce_output_pending(ce, pending) < 0)
+	    return -1;
     }
     return 0;
 }
@@ -139,12 +223,16 @@ backend_client_rm(clicon_handle        h,
     clicon_debug(1, "%s", __FUNCTION__);
     /* for all streams: XXX better to do it top-level? */
     stream_ss_delete_all(h, ce_event_cb, (void*)ce);
+    /* Reply in progress by worker thread is dropped */
+    if (ce->ce_job)
+	backend_worker_client_rm(ce);
     c0 = backend_client_list(h);
     ce_prev = &c0; /* this points to stack and is not real backpointer */
     for (c = *ce_prev; c; c = c->ce_next){
 	if (c == ce){
 	    if (ce->ce_s){
 		clixon_event_unreg_fd(ce->ce_s, from_client);
+		clixon_event_unreg_fd_out(ce->ce_s, to_client);
 		close(ce->ce_s);
 		ce->ce_s = 0;
 		xmldb_unlock_all(h, ce->ce_id);
@@ -400,20 +488,23 @@ client_statedata(clicon_handle h,
  * @param[in]  username
  * @param[in]  content
  * @param[in]  depth
+ * @param[in]  ce      Client entry, if set the reply may be serialized by a worker thread
  * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
+ *                     Empty if the reply is built by a worker thread, see ce_job
  * @retval     0       OK
  * @retval    -1       Error
  * @see from_client_get
  */
 static int
-client_get_config_only(clicon_handle h,
-		       cvec         *nsc,
-		       yang_stmt    *yspec,
-		       char         *db,
-		       char         *xpath,
-		       char         *username,
-		       int32_t       depth,
-		       cbuf         *cbret)
+client_get_config_only(clicon_handle        h,
+		       cvec                *nsc,
+		       yang_stmt           *yspec,
+		       char                *db,
+		       char                *xpath,
+		       char                *username,
+		       int32_t              depth,
+		       struct client_entry *ce,
+		       cbuf                *cbret)
 {
     int     retval = -1;
     cxobj  *xret = NULL;
@@ -426,8 +517,9 @@ client_get_config_only(clicon_handle h,
     /* Note xret can be pruned by nacm below (and change name),
      * so zero-copy cant be used
      * Also, must use external namespace context here due to <filter stmt
+     * The reply copy is allocated in an arena and released as a whole below
      */
-    if ((ret = xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, &xret, NULL, &xerr)) < 0) {
+    if ((ret = xmldb_get0_arena(h, db, YB_MODULE, nsc, xpath, &xret, &xerr)) < 0) {
 	if (netconf_operation_failed(cbret, "application", "read registry")< 0)
 	    goto done;
 	goto ok;
@@ -446,6 +538,15 @@ client_get_config_only(clicon_handle h,
 	if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
 	    goto done;
     }
+    /* The reply tree is private, serialize it in a worker thread */
+    if (ce && xret && backend_worker_nr() > 0){
+	if (xml_name_set(xret, NETCONF_OUTPUT_DATA) < 0)
+	    goto done;
+	if (backend_worker_reply(ce, xret, depth) < 0)
+	    goto done;
+	xret = NULL; /* Freed by worker */
+	goto ok;
+    }
     cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
     if (xret==NULL)
 	cprintf(cbret, "<data/>");
@@ -550,7 +651,8 @@ from_client_get_config(clicon_handle h,
 	    goto ok;
 	}
     }
-    if ((ret = client_get_config_only(h, nsc, yspec, db, xpath, username, -1, cbret)) < 0)
+    if ((ret = client_get_config_only(h, nsc, yspec, db, xpath, username, -1,
+				      (struct client_entry *)arg, cbret)) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -1119,7 +1221,8 @@ from_client_get(clicon_handle h,
 	}
     }
     if (content == CONTENT_CONFIG){ /* config only, no state */
-	if (client_get_config_only(h, nsc, yspec, "running", xpath, username, depth, cbret) < 0)
+	if (client_get_config_only(h, nsc, yspec, "running", xpath, username, depth,
+				   (struct client_entry *)arg, cbret) < 0)
 	    goto done;
 	goto ok;
     }
@@ -1127,16 +1230,17 @@ from_client_get(clicon_handle h,
      * Note xret can be pruned by nacm below and change name and
      * merged with state data, so zero-copy cant be used
      * Also, must use external namespace context here due to <filter> stmt
+     * The reply copy is allocated in an arena and released as a whole below
      */
     if (clicon_option_bool(h, "CLICON_VALIDATE_STATE_XML")){
-	if (xmldb_get0(h, "running", YB_MODULE, nsc, NULL, 1, &xret, NULL, NULL) < 0) {
+	if (xmldb_get0_arena(h, "running", YB_MODULE, nsc, NULL, &xret, NULL) < 0) {
 	    if (netconf_operation_failed(cbret, "application", "read registry")< 0)
 		goto done;
 	    goto ok;
 	}
     }
     else{
-	if (xmldb_get0(h, "running", YB_MODULE, nsc, xpath, 1, &xret, NULL, NULL) < 0) {
+	if (xmldb_get0_arena(h, "running", YB_MODULE, nsc, xpath, &xret, NULL) < 0) {
 	    if (netconf_operation_failed(cbret, "application", "read registry")< 0)
 		goto done;
 	    goto ok;
@@ -1509,11 +1613,21 @@ from_client_stats(clicon_handle h,
 {
     int      retval = -1;
     uint64_t nr;
+    uint64_t sz;
+    uint64_t hits;
+    uint64_t misses;
     
     cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
     nr=0;
-    xml_stats_global(&nr);
-    cprintf(cbret, "<global><xmlnr>%" PRIu64 "</xmlnr></global>", nr);
+    sz=0;
+    xml_stats_global(&nr, &sz);
+    hits = misses = 0;
+    xpath_cache_stats(&hits, &misses, NULL);
+    cprintf(cbret, "<global><xmlnr>%" PRIu64 "</xmlnr>"
+	    "<xmlsize>%" PRIu64 "</xmlsize>"
+	    "<xpathcachehits>%" PRIu64 "</xpathcachehits>"
+	    "<xpathcachemisses>%" PRIu64 "</xpathcachemisses></global>",
+	    nr, sz, hits, misses);
     if (clixon_stats_get_db(h, "running", cbret) < 0)
 	goto done;
     if (clixon_stats_get_db(h, "candidate", cbret) < 0)
@@ -1648,13 +1762,53 @@ from_client_hello(clicon_handle       h,
     return retval;
 }
 
+/*! Send reply of an rpc to client
+ * @param[in]  ce     Client entry
+ * @param[in]  cbret  Reply, eg <rpc-reply>..., <rpc-error..
+ * @retval     0      OK, or client closed its socket
+ * @retval    -1      Error
+ */
+static int
+ce_reply(struct client_entry *ce,
+	 cbuf                *cbret)
+{
+    size_t pending;
+
+    clicon_debug(1, "%s cbret:%s", __FUNCTION__, cbuf_get(cbret));
+    /* XXX problem here is that cbret has not been parsed so may contain 
+       parse errors */
+    pending = clicon_msg_buf_pending(&ce->ce_wbuf);
+    if (send_msg_reply_nb(ce->ce_s, &ce->ce_wbuf, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
+	switch (errno){
+	case EPIPE:
+	    /* man (2) write: 
+	     * EPIPE  fd is connected to a pipe or socket whose reading end is 
+	     * closed.  When this happens the writing process will also receive 
+	     * a SIGPIPE signal. 
+	     * In Clixon this means a client, eg restconf, netconf or cli closes
+	     * the (UNIX domain) socket.
+	     */
+	case ECONNRESET:
+	    clicon_log(LOG_WARNING, "client rpc reset");
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    else if (ce_output_pending(ce, pending) < 0)
+	return -1;
+    return 0;
+}
+
 /*! An internal clicon message has arrived from a client. Receive and dispatch.
  * @param[in]   h    Clicon handle
- * @param[in]   s    Socket where message arrived. read from this.
- * @param[in]   arg  Client entry (from).
+ * @param[in]   ce   Client entry (from).
+ * @param[in]   msg  Message, points into receive buffer of ce
  * @retval      0    OK
  * @retval      -1   Error Terminates backend and is never called). Instead errors are
  *                   propagated back to client.
+ * @note msg is only used when decoded first, since the rpc callback may remove ce and its
+ * receive buffer, eg kill-session of its own session. Neither is used after that.
  */
 static int
 from_client_msg(clicon_handle        h,
@@ -1813,6 +1967,8 @@ from_client_msg(clicon_handle        h,
 	    clicon_log(LOG_NOTICE, "%s Error in rpc_callback_call:%s", __FUNCTION__, xml_name(xe));
 	    goto reply; /* Dont quit here on user callbacks */
 	}
+	if (!ce_exists(h, ce)) /* Client removed by callback, no reply */
+	    goto ok;
 	if (ret == 0){ /* not handled by callback */
 	    if (netconf_operation_not_supported(cbret, "application", "RPC operation not supported")< 0)
 		goto done;
@@ -1826,30 +1982,15 @@ from_client_msg(clicon_handle        h,
 	}
     } /* while */
  reply:
+    /* Reply is sent when the worker thread is done, see backend_client_resume */
+    if (ce->ce_job && cbuf_len(cbret) == 0)
+	goto ok;
     if (cbuf_len(cbret) == 0)
 	if (netconf_operation_failed(cbret, "application", clicon_errno?clicon_err_reason:"unknown")< 0)
 	    goto done;
-    clicon_debug(1, "%s cbret:%s", __FUNCTION__, cbuf_get(cbret));
-    /* XXX problem here is that cbret has not been parsed so may contain 
-       parse errors */
-    if (send_msg_reply(ce->ce_s, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
-	switch (errno){
-	case EPIPE:
-	    /* man (2) write: 
-	     * EPIPE  fd is connected to a pipe or socket whose reading end is 
-	     * closed.  When this happens the writing process will also receive 
-	     * a SIGPIPE signal. 
-	     * In Clixon this means a client, eg restconf, netconf or cli closes
-	     * the (UNIX domain) socket.
-	     */
-	case ECONNRESET:
-	    clicon_log(LOG_WARNING, "client rpc reset");
-	    break;
-	default:
-	    goto done;
-	}
-    }
-    // ok:
+    if (ce_reply(ce, cbret) < 0)
+	goto done;
+ ok:
     retval = 0;
   done:  
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
@@ -1872,7 +2013,42 @@ from_client_msg(clicon_handle        h,
     return retval;// -1 here terminates backend
 }
 
+/*! Dispatch complete messages received from a client
+ * Stop if a reply to the client could not be written completely, or if a reply is built
+ * by a worker thread. The remaining messages are dispatched when it has been written, see
+ * to_client, or when the worker is done, see backend_client_resume
+ * @param[in]   h    Clicon handle
+ * @param[in]   ce   Client entry
+ * @retval      0    OK
+ * @retval      -1   Error
+ */
+static int
+from_client_dispatch(clicon_handle        h,
+		     struct client_entry *ce)
+{
+    int                retval = -1;
+    struct clicon_msg *msg = NULL;
+    int                ret;
+
+    while (clicon_msg_buf_pending(&ce->ce_wbuf) == 0 && ce->ce_job == NULL){
+	if ((ret = clicon_msg_buf_get(&ce->ce_rbuf, &msg)) < 0)
+	    goto done;
+	if (ret == 0)
+	    break;
+	ce->ce_stat_in++;
+	if (from_client_msg(h, ce, msg) < 0) /* msg points into receive buffer */
+	    goto done;
+	if (!ce_exists(h, ce)) /* eg kill-session */
+	    break;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! An internal clicon message has arrived from a client. Receive and dispatch.
+ * The client socket is non-blocking: data is read into the receive buffer of the client
+ * and complete messages are dispatched. 
  * @param[in]   s    Socket where message arrived. read from this.
  * @param[in]   arg  Client entry (from).
  * @retval      0    OK
@@ -1884,28 +2060,94 @@ from_client(int   s,
 	    void* arg)
 {
     int                  retval = -1;
-    struct clicon_msg   *msg = NULL;
     struct client_entry *ce = (struct client_entry *)arg;
     clicon_handle        h = ce->ce_handle;
     int                  eof = 0;
 
     clicon_debug(1, "%s", __FUNCTION__);
     // assert(s == ce->ce_s);
-    if (clicon_msg_rcv(ce->ce_s, &msg, &eof) < 0)
+    if (clicon_msg_rcv_nb(ce->ce_s, &ce->ce_rbuf, &eof) < 0)
 	goto done;
-    if (eof)
+    if (from_client_dispatch(h, ce) < 0)
+	goto done;
+    if (eof && ce_exists(h, ce))
 	backend_client_rm(h, ce); 
-    else
-	if (from_client_msg(h, ce, msg) < 0)
-	    goto done;
     retval = 0;
   done:
     clicon_debug(1, "%s retval=%d", __FUNCTION__, retval);
-    if (msg)
-	free(msg);
     return retval; /* -1 here terminates backend */
 }
 
+/*! Client socket is writable: write pending data to client
+ * When all pending data is written, continue reading and dispatching requests from client
+ * @param[in]   s    Client socket
+ * @param[in]   arg  Client entry
+ * @retval      0    OK
+ * @retval      -1   Error Terminates backend
+ * @see ce_output_pending
+ */
+static int
+to_client(int   s, 
+	  void* arg)
+{
+    struct client_entry *ce = (struct client_entry *)arg;
+    clicon_handle        h = ce->ce_handle;
+
+    if (clicon_msg_flush_nb(s, &ce->ce_wbuf) < 0){
+	if (errno == ECONNRESET || errno == EPIPE){
+	    clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
+	    backend_client_rm(h, ce);
+	    return 0;
+	}
+	return -1;
+    }
+    if (clicon_msg_buf_pending(&ce->ce_wbuf))
+	return 0;
+    clixon_event_unreg_fd_out(s, to_client);
+    if (clixon_event_reg_fd(s, from_client, (void*)ce, "local netconf client socket") < 0)
+	return -1;
+    /* Requests received before output was pending */
+    return from_client_dispatch(h, ce);
+}
+
+/*! Send reply built by a worker thread and continue with requests from client
+ * @param[in]   h      Clicon handle
+ * @param[in]   ce     Client entry
+ * @param[in]   cbret  Reply, or NULL on error in worker
+ * @retval      0      OK
+ * @retval      -1     Error Terminates backend
+ * @see backend_worker_reply
+ */
+int
+backend_client_resume(clicon_handle        h,
+		      struct client_entry *ce,
+		      cbuf                *cbret)
+{
+    int   retval = -1;
+    cbuf *cberr = NULL;
+
+    ce->ce_job = NULL;
+    if (cbret == NULL){
+	if ((cberr = cbuf_new()) == NULL){
+	    clicon_err(OE_XML, errno, "cbuf_new");
+	    goto done;
+	}
+	if (netconf_operation_failed(cberr, "application", "Reply serialization failed") < 0)
+	    goto done;
+	cbret = cberr;
+    }
+    if (ce_reply(ce, cbret) < 0)
+	goto done;
+    /* Requests received while reply was built */
+    if (from_client_dispatch(h, ce) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (cberr)
+	cbuf_free(cberr);
+    return retval;
+}
+
 /*! Init backend rpc: Set up standard netconf rpc callbacks
  * @param[in]  h     Clicon handle
  * @retval       -1       Error (fatal)
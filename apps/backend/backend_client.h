@@ -54,6 +54,10 @@ struct client_entry{
     int                   ce_id;      /* Session id */
     char                 *ce_username;/* Translated from peer user cred */
     clicon_handle         ce_handle;  /* clicon config handle (all clients have same?) */
+    struct clicon_msg_buf ce_rbuf;    /* Received data of incomplete messages */
+    struct clicon_msg_buf ce_wbuf;    /* Data of replies and notifications not yet sent */
+    struct backend_job   *ce_job;     /* Reply built by worker thread, see backend_worker.c */
+    int                   ce_overflow;/* Output exceeded, client is closed, see ce_event_cb */
 };
 
 /*
@@ -61,6 +65,7 @@ struct client_entry{
  */ 
 int backend_client_rm(clicon_handle h, struct client_entry *ce);
 int from_client(int fd, void *arg);
+int backend_client_resume(clicon_handle h, struct client_entry *ce, cbuf *cbret);
 int backend_rpc_init(clicon_handle h);
 
 #endif  /* _BACKEND_CLIENT_H_ */
@@ -102,8 +102,12 @@ generic_validate(clicon_handle       h,
     cbuf      *cb = NULL;
     yang_stmt *yp;
 
-    /* All entries */
-    if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0) 
+    /* All entries, or only changed entries and their dependents */
+    if (clicon_option_bool(h, "CLICON_VALIDATE_INCREMENTAL"))
+	ret = xml_yang_validate_changed_top(h, td->td_src, td->td_target, xret);
+    else
+	ret = xml_yang_validate_all_top(h, td->td_target, xret);
+    if (ret < 0) 
 	goto done;
     if (ret == 0)
 	goto fail;
@@ -505,30 +509,51 @@ from_validate_common(clicon_handle       h,
 	goto done;
     }	
     /* This is the state we are going to */
-    if (xmldb_get0(h, candidate, YB_MODULE, NULL, "/", 0, &td->td_target, NULL, NULL) < 0)
+    if ((ret = xmldb_get0(h, candidate, YB_MODULE, NULL, "/", 0, &td->td_target, NULL, xret)) < 0)
 	goto done;
+    if (ret == 0)
+	goto fail;
 
     /* Clear flags xpath for get */
     xml_apply0(td->td_target, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
 	       (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
     /* 2. Parse xml trees 
      * This is the state we are going from */
-    if (xmldb_get0(h, "running", YB_MODULE, NULL, "/", 0, &td->td_src, NULL, NULL) < 0)
+    if ((ret = xmldb_get0(h, "running", YB_MODULE, NULL, "/", 0, &td->td_src, NULL, xret)) < 0)
 	goto done;
+    if (ret == 0)
+	goto fail;
     /* Clear flags xpath for get */
     xml_apply0(td->td_src, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
 	       (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
-    /* 3. Compute differences */
-    if (xml_diff(yspec, 
-		 td->td_src,
-		 td->td_target,
-		 &td->td_dvec,      /* removed: only in running */
-		 &td->td_dlen,
-		 &td->td_avec,      /* added: only in candidate */
-		 &td->td_alen,
-		 &td->td_scvec,     /* changed: original values */
-		 &td->td_tcvec,     /* changed: wanted values */
-		 &td->td_clen) < 0)
+    /* 3. Compute differences 
+     * If candidate is running modified by edits, only modified subtrees are compared.
+     * Not if a default value depends on a when condition, which may select a modified
+     * node from an unmodified subtree */
+    if (xmldb_dirty_tracked(h, "running", candidate) == 1 &&
+	yang_flag_get(yspec, YANG_FLAG_DEFAULT_WHEN) == 0){
+	if (xml_diff_dirty(yspec, 
+			   td->td_src,
+			   td->td_target,
+			   &td->td_dvec,      /* removed: only in running */
+			   &td->td_dlen,
+			   &td->td_avec,      /* added: only in candidate */
+			   &td->td_alen,
+			   &td->td_scvec,     /* changed: original values */
+			   &td->td_tcvec,     /* changed: wanted values */
+			   &td->td_clen) < 0)
+	    goto done;
+    }
+    else if (xml_diff(yspec, 
+		      td->td_src,
+		      td->td_target,
+		      &td->td_dvec,      /* removed: only in running */
+		      &td->td_dlen,
+		      &td->td_avec,      /* added: only in candidate */
+		      &td->td_alen,
+		      &td->td_scvec,     /* changed: original values */
+		      &td->td_tcvec,     /* changed: wanted values */
+		      &td->td_clen) < 0)
 	goto done;
     if (clicon_debug_get()>1)
 	transaction_print(stderr, td);
@@ -905,9 +930,10 @@ from_client_restart_one(clicon_handle h,
     if ((td = transaction_new()) == NULL)
 	goto done;
     /* This is the state we are going to */
-    if (xmldb_get0(h, "running", YB_MODULE, NULL, "/", 0, &td->td_target, NULL, NULL) < 0)
+    if ((ret = xmldb_get0(h, "running", YB_MODULE, NULL, "/", 0, &td->td_target, NULL, &xerr)) < 0)
 	goto done;
-    if ((ret = xml_yang_validate_all_top(h, td->td_target, &xerr)) < 0)
+    if (ret == 1 &&
+	(ret = xml_yang_validate_all_top(h, td->td_target, &xerr)) < 0)
 	goto done;
     if (ret == 0){
 	if (clicon_xml2cbuf(cbret, xerr, 0, 0, -1) < 0)
@@ -915,8 +941,13 @@ from_client_restart_one(clicon_handle h,
 	goto fail;
     }
     /* This is the state we are going from */
-    if (xmldb_get0(h, db, YB_MODULE, NULL, "/", 0, &td->td_src, NULL, NULL) < 0)
+    if ((ret = xmldb_get0(h, db, YB_MODULE, NULL, "/", 0, &td->td_src, NULL, &xerr)) < 0)
 	goto done;
+    if (ret == 0){
+	if (clicon_xml2cbuf(cbret, xerr, 0, 0, -1) < 0)
+	    goto done;
+	goto fail;
+    }
 
     /* 3. Compute differences */
     if (xml_diff(yspec, 
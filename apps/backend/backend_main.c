@@ -76,6 +76,7 @@
 #include "backend_commit.h"
 #include "backend_handle.h"
 #include "backend_startup.h"
+#include "backend_worker.h"
 #include "backend_plugin_restconf.h"
 
 /* Command line options to be passed to getopt(3) */
@@ -102,6 +103,8 @@ backend_terminate(clicon_handle h)
     clicon_debug(1, "%s", __FUNCTION__);
     if ((ss = clicon_socket_get(h)) != -1)
 	close(ss);
+    /* Stop worker threads before the state they use is freed */
+    backend_worker_exit(h);
     /* Disconnect datastore */
     xmldb_disconnect(h);
     /* Clear module state caches */
@@ -131,6 +134,7 @@ backend_terminate(clicon_handle h)
     clixon_process_delete_all(h); 
 
     xpath_optimize_exit();
+    xpath_cache_exit();
 
     if (pidfile)
 	unlink(pidfile);   
@@ -250,6 +254,7 @@ xmldb_drop_priv(clicon_handle h,
 {
     int         retval = -1;
     char       *filename = NULL;
+    char       *journal = NULL;
 
     if (xmldb_db2file(h, db, &filename) < 0)
 	goto done;
@@ -257,10 +262,19 @@ xmldb_drop_priv(clicon_handle h,
 	clicon_err(OE_UNIX, errno, "chown");
 	goto done;
     }
+    /* Journal of datastore, if any, see CLICON_XMLDB_JOURNAL */
+    if (xmldb_db2journal(h, db, &journal) < 0)
+	goto done;
+    if (chown(journal, uid, gid) < 0 && errno != ENOENT){
+	clicon_err(OE_UNIX, errno, "chown");
+	goto done;
+    }
     retval = 0;
  done:
     if (filename)
 	free(filename);
+    if (journal)
+	free(journal);
     return retval;
 }
 
@@ -768,6 +782,13 @@ main(int    argc,
 
     /* Set default namespace according to CLICON_NAMESPACE_NETCONF_DEFAULT */
     xml_nsctx_namespace_netconf_default(h);
+
+    /* Set number of threads for parallel XML processing according to CLICON_XML_THREADS */
+    if (xml_parallel_init(h) < 0)
+	goto done;
+
+    /* Set size of xpath cache according to CLICON_XPATH_CACHE_SIZE */
+    xpath_cache_init(h);
     
     /* Add (hardcoded) netconf features in case ietf-netconf loaded here
      * Otherwise it is loaded in netconf_module_load below
@@ -1025,6 +1046,9 @@ main(int    argc,
 
     /* Start session-id for clients */
     clicon_session_id_set(h, 0);
+    /* Start worker threads according to CLICON_BACKEND_WORKERS, after daemonization */
+    if (backend_worker_init(h) < 0)
+	goto done;
 #if 0 /* debug */
     /* Enable this to get prints of datastore and session status */
     if (0 && clicon_debug_get() && 
@@ -246,6 +246,12 @@ backend_accept_client(int   fd,
 	clicon_err(OE_UNIX, errno, "accept");
 	goto done;
     }
+    /* Client messages are received and replies sent without blocking, see from_client */
+    if (fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) < 0){
+	clicon_err(OE_UNIX, errno, "fcntl");
+	close(s);
+	goto done;
+    }
     if ((ce = backend_client_add(h, &from)) == NULL)
 	goto done;
     ce->ce_handle = h;
@@ -84,14 +84,24 @@ db_merge(clicon_handle h,
 {
     int    retval = -1;
     cxobj *xt = NULL;
+    cxobj *xerr = NULL;
+    int    ret;
     
     /* Get data as xml from db1 */
-    if (xmldb_get0(h, (char*)db1, YB_MODULE, NULL, NULL, 0, &xt, NULL, NULL) < 0)
+    if ((ret = xmldb_get0(h, (char*)db1, YB_MODULE, NULL, NULL, 0, &xt, NULL, &xerr)) < 0)
+	goto done;
+    if (ret == 0){
+	if (clicon_xml2cbuf(cbret, xerr, 0, 0, -1) < 0)
+	    goto done;
+	retval = 0;
 	goto done;
+    }
     xml_name_set(xt, NETCONF_INPUT_CONFIG);
     /* Merge xml into db2. Without commit */
     retval = xmldb_put(h, (char*)db2, OP_MERGE, xt, clicon_username_get(h), cbret);
  done:
+    if (xerr)
+	xml_free(xerr);
     xmldb_get0_free(h, &xt);
     return retval;
 }
@@ -0,0 +1,379 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+
+ * Worker threads serializing replies of get-config, see CLICON_BACKEND_WORKERS
+ * Only serialization is done by a worker. The main loop reads the datastore, makes a
+ * private copy of the reply data, applies NACM and then hands
+ * it over to a worker thread which serializes it to a reply message and frees it. 
+ * Only the private copy is accessed by the worker, all other state is accessed by the 
+ * main thread only. 
+ * While a job is pending, no further messages are read from that client, so replies
+ * are sent in the same order as the requests.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "backend_client.h"
+#include "backend_worker.h"
+
+/* A reply job handed over from the main loop to a worker thread */
+struct backend_job{
+    qelem_t              bj_qelem;  /* List header */
+    struct client_entry *bj_ce;     /* Client, or NULL if client removed before job is done */
+    cxobj               *bj_xdata;  /* Private reply data tree, freed by worker */
+    int32_t              bj_depth;  /* Levels of data to serialize, -1 is all */
+    cbuf                *bj_cb;     /* Serialized reply, or NULL on error */
+};
+
+/* Number of worker threads, 0 if replies are serialized by main loop */
+static int            _worker_nr = 0;
+static clicon_handle  _worker_h = NULL;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_t          *_worker_tids = NULL;
+static pthread_mutex_t     _worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t      _worker_cond = PTHREAD_COND_INITIALIZER;
+static struct backend_job *_worker_todo = NULL; /* Jobs not yet started (protected by lock) */
+static struct backend_job *_worker_done = NULL; /* Jobs done, reply not sent (protected by lock) */
+static int                 _worker_stop = 0;    /* Terminate workers (protected by lock) */
+static int                 _worker_pipe[2] = {-1, -1}; /* Worker wakes up main loop */
+static int                 _worker_jobs = 0;    /* Jobs handed over and not done (main thread) */
+
+/*! A job is handed over to a worker, XML is multi-threaded while jobs are in flight
+ */
+static void
+backend_jobs_inc(void)
+{
+    if (_worker_jobs++ == 0)
+	xml_mt_set(1);
+}
+
+/*! A job is done, or freed before it was started
+ */
+static void
+backend_jobs_dec(void)
+{
+    if (--_worker_jobs == 0)
+	xml_mt_set(0);
+}
+
+static void
+backend_job_free(struct backend_job *bj)
+{
+    if (bj->bj_xdata)
+	xml_free(bj->bj_xdata);
+    if (bj->bj_cb)
+	cbuf_free(bj->bj_cb);
+    free(bj);
+}
+
+/*! Serialize a reply, called in worker thread
+ * @param[in]  bj   Job, only its private reply tree is accessed
+ * @retval     cb   Reply message, free with cbuf_free
+ * @retval     NULL Error
+ * @note Error is not logged with clicon_err since it is not thread-safe
+ */
+static cbuf *
+backend_job_serialize(struct backend_job *bj)
+{
+    cbuf   *cb;
+    int32_t depth = bj->bj_depth;
+
+    if ((cb = cbuf_new()) == NULL)
+	return NULL;
+    cprintf(cb, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
+    /* Top-level <data> element is one extra level */
+    if (clicon_xml2cbuf(cb, bj->bj_xdata, 0, 0, depth>0?depth+1:depth) < 0){
+	cbuf_free(cb);
+	return NULL;
+    }
+    cprintf(cb, "</rpc-reply>");
+    return cb;
+}
+
+/*! Worker thread: serialize replies until stopped
+ */
+static void *
+backend_worker_thread(void *arg)
+{
+    struct backend_job *bj;
+    char                c = 0;
+
+    pthread_mutex_lock(&_worker_lock);
+    while (!_worker_stop){
+	if ((bj = _worker_todo) == NULL){
+	    pthread_cond_wait(&_worker_cond, &_worker_lock);
+	    continue;
+	}
+	DELQ(bj, _worker_todo, struct backend_job *);
+	pthread_mutex_unlock(&_worker_lock);
+	bj->bj_cb = backend_job_serialize(bj);
+	xml_free(bj->bj_xdata);
+	bj->bj_xdata = NULL;
+	pthread_mutex_lock(&_worker_lock);
+	ADDQ(bj, _worker_done);
+	/* Wake up main loop. If the pipe is full, main loop is already woken up */
+	if (write(_worker_pipe[1], &c, 1) < 0)
+	    continue;
+    }
+    pthread_mutex_unlock(&_worker_lock);
+    return NULL;
+}
+
+/*! Main loop callback when jobs are done: send replies and resume clients
+ * @param[in]  fd   Read end of worker pipe
+ * @param[in]  arg  Not used
+ */
+static int
+backend_worker_done(int   fd,
+		    void *arg)
+{
+    int                  retval = -1;
+    char                 buf[64];
+    struct backend_job  *bj;
+    struct client_entry *ce;
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+	;
+    while (1){
+	pthread_mutex_lock(&_worker_lock);
+	if ((bj = _worker_done) != NULL)
+	    DELQ(bj, _worker_done, struct backend_job *);
+	pthread_mutex_unlock(&_worker_lock);
+	if (bj == NULL)
+	    break;
+	backend_jobs_dec();
+	/* bj_ce is only accessed by main thread */
+	if ((ce = bj->bj_ce) != NULL &&
+	    backend_client_resume(_worker_h, ce, bj->bj_cb) < 0){
+	    backend_job_free(bj);
+	    goto done;
+	}
+	backend_job_free(bj);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+#endif /* HAVE_LIBPTHREAD */
+
+/*! Start backend worker threads according to CLICON_BACKEND_WORKERS
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+backend_worker_init(clicon_handle h)
+{
+    int retval = -1;
+    int nr;
+#ifdef HAVE_LIBPTHREAD
+    int      i;
+    int      ret = 0;
+    sigset_t sigset;
+    sigset_t oldset;
+#endif
+
+    _worker_h = h;
+    if ((nr = clicon_option_int(h, "CLICON_BACKEND_WORKERS")) < 1)
+	goto ok;
+#ifndef HAVE_LIBPTHREAD
+    clicon_log(LOG_WARNING, "CLICON_BACKEND_WORKERS is %d but clixon is built without pthreads", nr);
+#else
+    if (pipe(_worker_pipe) < 0){
+	clicon_err(OE_UNIX, errno, "pipe");
+	goto done;
+    }
+    if (fcntl(_worker_pipe[0], F_SETFL, O_NONBLOCK) < 0 ||
+	fcntl(_worker_pipe[1], F_SETFL, O_NONBLOCK) < 0){
+	clicon_err(OE_UNIX, errno, "fcntl");
+	goto done;
+    }
+    if (clixon_event_reg_fd(_worker_pipe[0], backend_worker_done, NULL, "backend worker") < 0)
+	goto done;
+    if ((_worker_tids = calloc(nr, sizeof(pthread_t))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    /* Signals are handled by main thread only */
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_BLOCK, &sigset, &oldset);
+    for (i=0; i<nr; i++){
+	if ((ret = pthread_create(&_worker_tids[i], NULL, backend_worker_thread, NULL)) != 0)
+	    break;
+	_worker_nr++;
+    }
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    if (ret != 0){
+	clicon_err(OE_UNIX, ret, "pthread_create");
+	goto done;
+    }
+    clicon_debug(1, "%s %d worker threads", __FUNCTION__, _worker_nr);
+#endif
+ ok:
+    retval = 0;
+#ifdef HAVE_LIBPTHREAD
+ done:
+#endif
+    return retval;
+}
+
+/*! Stop backend worker threads and free pending jobs
+ * @param[in]  h   Clicon handle
+ */
+int
+backend_worker_exit(clicon_handle h)
+{
+#ifdef HAVE_LIBPTHREAD
+    struct backend_job *bj;
+    int                 i;
+
+    if (_worker_tids == NULL)
+	return 0;
+    pthread_mutex_lock(&_worker_lock);
+    _worker_stop = 1;
+    pthread_cond_broadcast(&_worker_cond);
+    pthread_mutex_unlock(&_worker_lock);
+    for (i=0; i<_worker_nr; i++)
+	pthread_join(_worker_tids[i], NULL);
+    free(_worker_tids);
+    _worker_tids = NULL;
+    _worker_nr = 0;
+    while ((bj = _worker_todo) != NULL){
+	DELQ(bj, _worker_todo, struct backend_job *);
+	backend_job_free(bj);
+	backend_jobs_dec();
+    }
+    while ((bj = _worker_done) != NULL){
+	DELQ(bj, _worker_done, struct backend_job *);
+	backend_job_free(bj);
+	backend_jobs_dec();
+    }
+    clixon_event_unreg_fd(_worker_pipe[0], backend_worker_done);
+    close(_worker_pipe[0]);
+    close(_worker_pipe[1]);
+    _worker_pipe[0] = _worker_pipe[1] = -1;
+#endif
+    return 0;
+}
+
+/*! Get number of worker threads
+ * @retval  nr   Number of worker threads, 0 if replies are serialized by main loop
+ */
+int
+backend_worker_nr(void)
+{
+    return _worker_nr;
+}
+
+/*! Hand over a reply to a worker thread
+ * The reply is sent and the client is resumed with backend_client_resume when done.
+ * @param[in]  ce     Client entry, no further messages are read from it until resumed
+ * @param[in]  xdata  Private reply data tree, consumed (also on error)
+ * @param[in]  depth  Levels of data to serialize, -1 is all
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+backend_worker_reply(struct client_entry *ce,
+		     cxobj               *xdata,
+		     int32_t              depth)
+{
+    int                 retval = -1;
+#ifdef HAVE_LIBPTHREAD
+    struct backend_job *bj;
+
+    if ((bj = malloc(sizeof(*bj))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(bj, 0, sizeof(*bj));
+    bj->bj_ce = ce;
+    bj->bj_xdata = xdata;
+    bj->bj_depth = depth;
+    xdata = NULL;
+    ce->ce_job = bj;
+    backend_jobs_inc();
+    pthread_mutex_lock(&_worker_lock);
+    ADDQ(bj, _worker_todo);
+    pthread_cond_signal(&_worker_cond);
+    pthread_mutex_unlock(&_worker_lock);
+    retval = 0;
+ done:
+#else
+    clicon_err(OE_UNIX, 0, "No worker threads");
+#endif
+    if (xdata)
+	xml_free(xdata);
+    return retval;
+}
+
+/*! Client is removed: detach it from its pending job, if any
+ * The job is freed when done, without sending the reply
+ * @param[in]  ce     Client entry
+ */
+int
+backend_worker_client_rm(struct client_entry *ce)
+{
+    struct backend_job *bj;
+
+    if ((bj = ce->ce_job) != NULL){
+	bj->bj_ce = NULL;
+	ce->ce_job = NULL;
+    }
+    return 0;
+}
@@ -180,6 +180,8 @@ backend_client_delete(clicon_handle        h,
 	    *ce_prev = c->ce_next;
 	    if (ce->ce_username)
 		free(ce->ce_username);
+	    clicon_msg_buf_reset(&ce->ce_rbuf);
+	    clicon_msg_buf_reset(&ce->ce_wbuf);
 	    free(ce);
 	    break;
 	}
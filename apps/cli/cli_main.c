@@ -178,6 +178,7 @@ cli_terminate(clicon_handle h)
 	xml_free(x);
     clicon_data_cvec_del(h, "cli-edit-cvv");;
     xpath_optimize_exit();
+    xpath_cache_exit();
     /* Delete all plugins, and RPC callbacks */
     clixon_plugin_module_exit(h);
     /* Delete CLI syntax et al */
@@ -635,6 +636,9 @@ main(int    argc,
 	goto done;
     /* Set default namespace according to CLICON_NAMESPACE_NETCONF_DEFAULT */
     xml_nsctx_namespace_netconf_default(h);
+
+    /* Set size of xpath cache according to CLICON_XPATH_CACHE_SIZE */
+    xpath_cache_init(h);
     
     /* Treat unknwon XML as anydata */
     if (clicon_option_bool(h, "CLICON_YANG_UNKNOWN_ANYDATA") == 1)
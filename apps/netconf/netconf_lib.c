@@ -70,6 +70,21 @@
  * Exported variables
  */
 enum transport_type    transport = NETCONF_SSH; /* XXX Remove SOAP support */
+enum framing_type      netconf_framing = NETCONF_SSH_EOM; /* Set after hello */
+
+/* Output waiting for the reply of an earlier pipelined request, see netconf_output_defer
+ */
+struct netconf_output {
+    qelem_t no_qelem;  /* List header */
+    cbuf   *no_cb;     /* Encapsulated message, or NULL if waiting for reply */
+    cxobj  *no_xrpc;   /* Pipelined request if waiting for reply */
+};
+
+/* Ordered list of deferred output */
+static struct netconf_output *_output_list = NULL;
+
+/* Number of outputs waiting for replies */
+static int _output_deferred = 0;
 int cc_closed = 0; /* XXX Please remove (or at least hide in handle) this global variable */
 
 /*! Add netconf xml postamble of message. I.e, xml after the body of the message.
@@ -87,7 +102,7 @@ add_preamble(cbuf *cb)
 }
 
 /*! Add netconf xml postamble of message. I.e, xml after the body of the message.
- * for soap this is the envelope stuff, for ssh this is ]]>]]>
+ * for soap this is the envelope stuff, for ssh this is ]]>]]>, or end-of-chunks if chunked
  * @param[in]  cb  Netconf packet (cligen buffer)
  */
 int
@@ -95,7 +110,10 @@ add_postamble(cbuf *cb)
 {
     switch (transport){
     case NETCONF_SSH:
-	cprintf(cb, "]]>]]>");     /* Add RFC4742 end-of-message marker */
+	if (netconf_framing == NETCONF_SSH_CHUNKED)
+	    cprintf(cb, "\n##\n");   /* Add RFC6242 end-of-chunks */
+	else
+	    cprintf(cb, "]]>]]>");     /* Add RFC4742 end-of-message marker */
 	break;
 #ifdef NOTUSED
     case NETCONF_SOAP:
@@ -198,6 +216,29 @@ netconf_output(int   s,
 }
 
 	    
+/*! Append output to deferred output list
+ * @param[in]  cb    Encapsulated message, or NULL
+ * @param[in]  xrpc  Request waiting for reply if cb is NULL
+ */
+static int
+netconf_output_add(cbuf  *cb,
+		   cxobj *xrpc)
+{
+    struct netconf_output *no;
+
+    if ((no = malloc(sizeof(*no))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return -1;
+    }
+    memset(no, 0, sizeof(*no));
+    no->no_cb = cb;
+    no->no_xrpc = xrpc;
+    ADDQ(no, _output_list);
+    if (cb == NULL)
+	_output_deferred++;
+    return 0;
+}
+
 /*! Encapsulate and send outgoing netconf packet as cbuf on socket
  * @param[in]   s    
  * @param[in]   cb   Cligen buffer that contains the XML message
@@ -220,11 +261,94 @@ netconf_output_encap(int   s,
 	goto done;
     }
     add_preamble(cb1);
-    cprintf(cb1, "%s", cbuf_get(cb));
+    if (netconf_framing == NETCONF_SSH_CHUNKED && cbuf_len(cb)) /* Sent as a single chunk */
+	cprintf(cb1, "\n#%lu\n", (unsigned long)cbuf_len(cb));
+    cbuf_append_buf(cb1, cbuf_get(cb), cbuf_len(cb));
     add_postamble(cb1);
-    retval = netconf_output(s, cb1, msg);
+    if (_output_list != NULL){ /* Wait for replies of earlier requests to preserve order */
+	if (netconf_output_add(cb1, NULL) < 0)
+	    goto done;
+	cb1 = NULL;
+	retval = 0;
+    }
+    else
+	retval = netconf_output(s, cb1, msg);
  done:
     if (cb1)
 	cbuf_free(cb1);
     return retval;
 }
+
+/*! Reserve output of the reply of a pipelined request
+ *
+ * Output after this, eg replies of later requests, is deferred until the reply is given
+ * with netconf_output_resolve
+ * @param[in]  xrpc  Request, freed by netconf_output_resolve
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+int
+netconf_output_defer(cxobj *xrpc)
+{
+    return netconf_output_add(NULL, xrpc);
+}
+
+/*! Number of pipelined requests waiting for reply
+ */
+int
+netconf_output_deferred(void)
+{
+    return _output_deferred;
+}
+
+/*! Request of the first pipelined request waiting for reply, or NULL
+ */
+cxobj *
+netconf_output_deferred_rpc(void)
+{
+    return _output_list ? _output_list->no_xrpc : NULL;
+}
+
+/*! Encapsulate and send reply of the first pipelined request, and following deferred output
+ *
+ * Output is sent up to the next pipelined request waiting for reply
+ * @param[in]   s    
+ * @param[in]   cb   Cligen buffer that contains the XML reply
+ * @param[in]   msg  Only for debug
+ * @retval      0    OK
+ * @retval     -1    Error
+ * @see netconf_output_defer
+ */
+int 
+netconf_output_resolve(int   s, 
+		       cbuf *cb, 
+		       char *msg)
+{
+    int                    retval = -1;
+    struct netconf_output *no;
+
+    if ((no = _output_list) == NULL || no->no_cb != NULL){
+	clicon_err(OE_NETCONF, EFAULT, "No deferred output");
+	goto done;
+    }
+    DELQ(no, _output_list, struct netconf_output *);
+    _output_deferred--;
+    if (no->no_xrpc)
+	xml_free(no->no_xrpc);
+    free(no);
+    if (netconf_output_encap(s, cb, msg) < 0) /* Sent directly if first */
+	goto done;
+    while ((no = _output_list) != NULL && no->no_cb != NULL){
+	DELQ(no, _output_list, struct netconf_output *);
+	if (netconf_output(s, no->no_cb, "deferred") < 0){
+	    cbuf_free(no->no_cb);
+	    free(no);
+	    goto done;
+	}
+	cbuf_free(no->no_cb);
+	free(no);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
@@ -53,6 +53,12 @@ enum transport_type{
 #endif
 };
 
+/* Message framing of netconf over SSH, RFC 6242 Sec 4 */
+enum framing_type{ 
+    NETCONF_SSH_EOM = 0, /* End-of-message, ie ]]>]]>, RFC 4742 */
+    NETCONF_SSH_CHUNKED, /* Chunked framing, RFC 6242 Sec 4.2 */
+};
+
 enum test_option{ /* edit-config */
     SET,
     TEST_THEN_SET,
@@ -68,6 +74,7 @@ enum error_option{ /* edit-config */
  * Variables
  */ 
 extern enum transport_type transport;
+extern enum framing_type netconf_framing;
 extern int cc_closed;
 
 /*
@@ -79,5 +86,9 @@ int add_error_preamble(cbuf *xf, char *reason);
 int add_error_postamble(cbuf *xf);
 int netconf_output(int s, cbuf *xf, char *msg);
 int netconf_output_encap(int s, cbuf *cb, char *msg);
+int netconf_output_defer(cxobj *xrpc);
+int netconf_output_deferred(void);
+cxobj *netconf_output_deferred_rpc(void);
+int netconf_output_resolve(int s, cbuf *cb, char *msg);
 
 #endif  /* _NETCONF_LIB_H_ */
@@ -39,8 +39,10 @@
 #include "clixon_config.h" /* generated by config & autoconf */
 #endif
 
+#define _GNU_SOURCE /* for memmem */
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdarg.h>
@@ -75,11 +77,28 @@
 
 #define NETCONF_LOGFILE "/tmp/clixon_netconf.log"
 
-/* clixon-data value to save buffer between invocations.
+/* Chunked framing states, RFC 6242 Sec 4.2 */
+enum chunk_state{
+    CHUNK_LF = 0,   /* Expect LF of chunk header or end-of-chunks */
+    CHUNK_HASH,     /* Expect HASH */
+    CHUNK_SIZE1,    /* Expect first digit of chunk-size, or HASH of end-of-chunks */
+    CHUNK_SIZE,     /* Expect digits of chunk-size or LF */
+    CHUNK_DATA,     /* Chunk data */
+    CHUNK_END,      /* Expect LF of end-of-chunks */
+};
+
+/* Input framing state saved between invocations of netconf_input_cb.
  * Saving data may be necessary if socket buffer contains partial netconf messages, such as:
  * <foo/> ..wait 1min  ]]>]]>
  */
-#define NETCONF_HASH_BUF "netconf_input_cbuf"
+struct netconf_input {
+    cbuf            *ni_cb;     /* Frame received so far */
+    size_t           ni_scan;   /* End-of-message: ni_cb is searched for ]]>]]> up to here */
+    enum chunk_state ni_state;  /* Chunked: parse state */
+    uint64_t         ni_clen;   /* Chunked: chunk-size, or remaining chunk-data */
+};
+
+static struct netconf_input _netconf_input = {NULL, 0, CHUNK_LF, 0};
 
 /*! Ignore errors on packet errors: continue */
 static int ignore_packet_errors = 1;
@@ -119,6 +138,193 @@ netconf_add_request_attr(cxobj *xrpc,
     return retval;
 }
 
+static int netconf_pipeline_cb(int s, void *arg);
+
+/*! Receive reply of the first pipelined netconf rpc from backend and send it to client
+ *
+ * The backend replies to requests in order, so the reply is matched with the first
+ * request waiting for reply.
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see netconf_pipeline_send
+ */
+static int
+netconf_pipeline_recv(clicon_handle h)
+{
+    int                retval = -1;
+    int                s;
+    struct clicon_msg *msg = NULL;
+    int                eof = 0;
+    cxobj             *xrpc;
+    cxobj             *xret = NULL;
+    cxobj             *xreply;
+    cxobj             *xerr = NULL;
+    cxobj             *xc;
+    cbuf              *cbret = NULL;
+    int                ret;
+
+    if ((xrpc = netconf_output_deferred_rpc()) == NULL)
+	goto ok;
+    s = clicon_client_socket_get(h);
+    if (clicon_msg_rcv(s, &msg, &eof) < 0)
+	goto done;
+    if (eof){
+	clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
+	goto done;
+    }
+    if (clixon_xml_parse_string(msg->op_body, YB_NONE, NULL, &xret, NULL) < 0)
+	goto done;
+    /* Bind reply to yang as in clicon_rpc_netconf_xml */
+    if ((xreply = xml_find_type(xret, NULL, "rpc-reply", CX_ELMNT)) != NULL &&
+	xml_find_type(xreply, NULL, "rpc-error", CX_ELMNT) == NULL &&
+	(xc = xml_child_i_type(xrpc, 0, CX_ELMNT)) != NULL){
+	if ((ret = xml_bind_yang_rpc_reply(xreply, xml_name(xc), clicon_dbspec_yang(h), &xerr)) < 0) 
+	    goto done;
+	if (ret == 0){ /* Replace reply with error */
+	    xml_purge(xreply);
+	    if (xml_addsub(xret, xerr) < 0)
+		goto done;
+	    xerr = NULL;
+	}
+    }
+    if ((cbret = cbuf_new()) == NULL){ 
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    if ((xc = xml_child_i(xret, 0)) == NULL){
+	xml_free(xret);
+	xret = NULL;
+	if (netconf_operation_failed_xml(&xret, "rpc", "Internal error: no xml return")< 0)
+	    goto done;
+	xc = xret;
+    }
+    /* Copy attributes from incoming request to reply. Skip already present (dont overwrite) */
+    if (netconf_add_request_attr(xrpc, xc) < 0)
+	goto done;
+    clicon_xml2cbuf(cbret, xc, 0, 0, -1);
+    if (netconf_output_resolve(1, cbret, "rpc-reply") < 0)
+	goto done;
+    if (netconf_output_deferred() == 0)
+	clixon_event_unreg_fd(s, netconf_pipeline_cb);
+ ok:
+    retval = 0;
+ done:
+    if (msg)
+	free(msg);
+    if (xret)
+	xml_free(xret);
+    if (xerr)
+	xml_free(xerr);
+    if (cbret)
+	cbuf_free(cbret);
+    return retval;
+}
+
+/*! Reply of pipelined netconf rpc has arrived from backend
+ * @param[in]  s    Socket to backend
+ * @param[in]  arg  Clicon handle
+ */
+static int
+netconf_pipeline_cb(int   s,
+		    void *arg)
+{
+    clicon_handle h = arg;
+
+    return netconf_pipeline_recv(h);
+}
+
+/*! Receive replies of all pipelined netconf rpcs
+ * Must be called before a synchronous rpc to the backend, since it uses the same socket
+ * @param[in]  h   Clicon handle
+ */
+static int
+netconf_pipeline_drain(clicon_handle h)
+{
+    while (netconf_output_deferred() > 0)
+	if (netconf_pipeline_recv(h) < 0)
+	    return -1;
+    return 0;
+}
+
+/*! Send netconf rpc to backend without waiting for reply
+ *
+ * At most CLICON_NETCONF_PIPELINE rpcs are waiting for reply. The reply is received when
+ * it arrives, or when the window is full, and is sent to the client in request order.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xrpc  Netconf rpc, see netconf_rpc_forwarded
+ * @retval     1     OK, rpc sent
+ * @retval     0     Not sent, no session yet
+ * @retval    -1     Error
+ */
+static int
+netconf_pipeline_send(clicon_handle h,
+		      cxobj        *xrpc)
+{
+    int       retval = -1;
+    uint32_t  id;
+    int       s;
+    int       window;
+    int       ret;
+    cbuf     *cb = NULL;
+    char     *username;
+    cxobj    *xa;
+    cxobj    *xdup = NULL;
+
+    if (clicon_session_id_get(h, &id) < 0)
+	return 0;
+    if ((s = clicon_client_socket_get(h)) < 0){
+	if (clicon_rpc_connect(h, &s) < 0)
+	    goto done;
+	clicon_client_socket_set(h, s);
+    }
+    /* Receive replies that have arrived, and wait for reply if window is full */
+    window = clicon_option_int(h, "CLICON_NETCONF_PIPELINE");
+    while (netconf_output_deferred() > 0){
+	if (netconf_output_deferred() < window &&
+	    (ret = clixon_event_poll(s)) <= 0){
+	    if (ret < 0)
+		goto done;
+	    break;
+	}
+	if (netconf_pipeline_recv(h) < 0)
+	    goto done;
+    }
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    /* Tag username as netconf_rpc_dispatch */
+    if ((username = clicon_username_get(h)) != NULL){
+	if ((xa = xml_new("username", xrpc, CX_ATTR)) == NULL)
+	    goto done;
+	if (xml_value_set(xa, username) < 0)
+	    goto done;
+    }
+    ret = clicon_xml2cbuf(cb, xrpc, 0, 0, -1);
+    if ((xa = xml_find(xrpc, "username")) != NULL)
+	xml_purge(xa);
+    if (ret < 0)
+	goto done;
+    if ((xdup = xml_dup(xrpc)) == NULL)
+	goto done;
+    if (clicon_msg_send_cbuf(s, id, cb) < 0)
+	goto done;
+    if (netconf_output_defer(xdup) < 0)
+	goto done;
+    xdup = NULL;
+    if (netconf_output_deferred() == 1 &&
+	clixon_event_reg_fd(s, netconf_pipeline_cb, h, "netconf backend") < 0)
+	goto done;
+    retval = 1;
+ done:
+    if (xdup)
+	xml_free(xdup);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
 /*
  * A server receiving a <hello> message with a <session-id> element MUST
  * terminate the NETCONF session. 
@@ -134,6 +340,7 @@ netconf_hello_msg(clicon_handle h,
     cxobj  *x;
     cxobj  *xcap;
     int     foundbase;
+    int     found11 = 0;
     char   *body;
 
     _netconf_hello_nr++;
@@ -157,8 +364,10 @@ netconf_hello_msg(clicon_handle h,
 	     * event any parameters are encoded at the end of the URI string. */
 	    if (strncmp(body, NETCONF_BASE_CAPABILITY_1_0, strlen(NETCONF_BASE_CAPABILITY_1_0)) == 0) /* RFC 4741 */
 		foundbase++;
-	    else if (strncmp(body, NETCONF_BASE_CAPABILITY_1_1, strlen(NETCONF_BASE_CAPABILITY_1_1)) == 0) /* RFC 6241 */
+	    else if (strncmp(body, NETCONF_BASE_CAPABILITY_1_1, strlen(NETCONF_BASE_CAPABILITY_1_1)) == 0){ /* RFC 6241 */
 		foundbase++;
+		found11++;
+	    }
 	}
     }
     if (foundbase == 0){
@@ -167,6 +376,9 @@ netconf_hello_msg(clicon_handle h,
 	cc_closed++;
 	goto done;
     }
+    /* RFC 6242 Sec 4.1: If both peers advertise base:1.1, chunked framing is used after hello */
+    if (found11 && clicon_option_bool(h, "CLICON_NETCONF_CHUNKED"))
+	netconf_framing = NETCONF_SSH_CHUNKED;
     retval = 0;
  done:
     if (vec)
@@ -225,6 +437,17 @@ netconf_rpc_message(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    /* Pipelining: forward rpc without waiting for reply */
+    if (clicon_option_int(h, "CLICON_NETCONF_PIPELINE") > 1 &&
+	netconf_rpc_forwarded(h, xrpc)){
+	if ((ret = netconf_pipeline_send(h, xrpc)) < 0)
+	    goto done;
+	if (ret == 1)
+	    goto ok;
+    }
+    /* Synchronous rpc:s use the same socket as pipelined rpc:s */
+    if (netconf_pipeline_drain(h) < 0)
+	goto done;
     if (netconf_rpc_dispatch(h, xrpc, &xret) < 0){
 	goto done;
     }
@@ -357,7 +580,7 @@ netconf_input_frame(clicon_handle h,
 		    cbuf         *cb)
 {
     int        retval = -1;
-    char      *str = NULL;
+    char      *str;
     cxobj     *xtop = NULL; /* Request (in) */
     cxobj     *xreq = NULL;
     cxobj     *xret = NULL; /* Return (out) */
@@ -368,10 +591,7 @@ netconf_input_frame(clicon_handle h,
     clicon_debug(1, "%s", __FUNCTION__);
     clicon_debug(2, "%s: \"%s\"", __FUNCTION__, cbuf_get(cb));
     yspec = clicon_dbspec_yang(h);
-    if ((str = strdup(cbuf_get(cb))) == NULL){
-	clicon_err(OE_UNIX, errno, "strdup");
-	goto done;
-    }
+    str = cbuf_get(cb);
     /* Special case:  */
     if (strlen(str) == 0){
 	if ((cbret = cbuf_new()) == NULL){ 
@@ -436,8 +656,6 @@ netconf_input_frame(clicon_handle h,
  ok:
     retval = 0;
  done:
-    if (str)
-	free(str);
     if (xtop)
 	xml_free(xtop);
     if (xret)
@@ -447,13 +665,150 @@ netconf_input_frame(clicon_handle h,
     return retval;
 }
 
+/*! Frame input data with end-of-message framing, ie ]]>]]>
+ *
+ * Data is appended to the frame buffer in bulk and the buffer is searched for the
+ * end-of-message marker from where the previous search ended.
+ * @param[in]   h    Clicon handle
+ * @param[in]   ni   Input framing state
+ * @param[in]   buf  Input data
+ * @param[in]   len  Length of input data
+ * @retval      n    Number of bytes of buf consumed, rest belongs to next frame
+ * @retval     -1    Error
+ */
+static ssize_t
+netconf_input_eom(clicon_handle         h,
+		  struct netconf_input *ni,
+		  char                 *buf,
+		  size_t                len)
+{
+    cbuf   *cb = ni->ni_cb;
+    char   *nul;
+    char   *eom;
+    size_t  n;
+    size_t  start;
+    size_t  rest;
+    
+    /* Skip NULL chars (eg from terminals) */
+    if ((nul = memchr(buf, '\0', len)) != NULL)
+	n = nul - buf;
+    else
+	n = len;
+    if (n && cbuf_append_buf(cb, buf, n) < 0){
+	clicon_err(OE_XML, errno, "cbuf_append_buf");
+	return -1;
+    }
+    /* Trailer may have started in previous data */
+    start = ni->ni_scan > strlen("]]>]]>") - 1 ? ni->ni_scan - (strlen("]]>]]>") - 1) : 0;
+    if ((eom = memmem(cbuf_get(cb) + start, cbuf_len(cb) - start,
+		      "]]>]]>", strlen("]]>]]>"))) == NULL){
+	ni->ni_scan = cbuf_len(cb);
+	return nul ? n + 1 : n;
+    }
+    /* OK, we have an xml string from a client */
+    rest = cbuf_get(cb) + cbuf_len(cb) - (eom + strlen("]]>]]>")); /* Data after trailer */
+    *eom = '\0'; /* Remove trailer */
+    ni->ni_scan = 0;
+    if (netconf_input_frame(h, cb) < 0 &&
+	!ignore_packet_errors) // default is to ignore errors
+	return -1;
+    cbuf_reset(cb);
+    return n - rest;
+}
+
+/*! Frame input data with chunked framing, RFC 6242 Sec 4.2
+ *
+ * Chunk headers are parsed per character while chunk-data is appended to the frame buffer
+ * in bulk without being searched.
+ * @param[in]   h    Clicon handle
+ * @param[in]   ni   Input framing state
+ * @param[in]   buf  Input data
+ * @param[in]   len  Length of input data
+ * @retval      n    Number of bytes of buf consumed
+ * @retval     -1    Error
+ */
+static ssize_t
+netconf_input_chunked(clicon_handle         h,
+		      struct netconf_input *ni,
+		      char                 *buf,
+		      size_t                len)
+{
+    cbuf   *cb = ni->ni_cb;
+    size_t  i = 0;
+    size_t  n;
+    int     c;
+    
+    while (i < len){
+	if (ni->ni_state == CHUNK_DATA){
+	    n = len - i < ni->ni_clen ? len - i : ni->ni_clen;
+	    if (cbuf_append_buf(cb, buf + i, n) < 0){
+		clicon_err(OE_XML, errno, "cbuf_append_buf");
+		return -1;
+	    }
+	    i += n;
+	    if ((ni->ni_clen -= n) == 0)
+		ni->ni_state = CHUNK_LF;
+	    continue;
+	}
+	c = (unsigned char)buf[i++];
+	switch (ni->ni_state){
+	case CHUNK_LF:
+	    if (c == '\n')
+		ni->ni_state = CHUNK_HASH;
+	    else if (!isspace(c) || cbuf_len(cb))
+		goto fail;
+	    break;
+	case CHUNK_HASH:
+	    if (c != '#')
+		goto fail;
+	    ni->ni_state = CHUNK_SIZE1;
+	    break;
+	case CHUNK_SIZE1:
+	    if (c == '#')
+		ni->ni_state = CHUNK_END;
+	    else if (c >= '1' && c <= '9'){
+		ni->ni_clen = c - '0';
+		ni->ni_state = CHUNK_SIZE;
+	    }
+	    else
+		goto fail;
+	    break;
+	case CHUNK_SIZE:
+	    if (c == '\n')
+		ni->ni_state = CHUNK_DATA;
+	    else if (isdigit(c) && (ni->ni_clen = ni->ni_clen*10 + c - '0') <= UINT32_MAX)
+		;
+	    else
+		goto fail;
+	    break;
+	case CHUNK_END:
+	    if (c != '\n')
+		goto fail;
+	    ni->ni_state = CHUNK_LF;
+	    /* OK, we have an xml string from a client */
+	    if (netconf_input_frame(h, cb) < 0 &&
+		!ignore_packet_errors) // default is to ignore errors
+		return -1;
+	    cbuf_reset(cb);
+	    return i;
+	case CHUNK_DATA:
+	    break;
+	}
+    }
+    return i;
+ fail:
+    clicon_err(OE_PROTO, EBADMSG, "Invalid chunked framing of netconf message");
+    cc_closed++;
+    return -1;
+}
+
 /*! Get netconf message: detect end-of-msg 
  * @param[in]   s    Socket where input arrived. read from this.
  * @param[in]   arg  Clicon handle.
  * This routine continuously reads until no more data on s. There could
  * be risk of starvation, but the netconf client does little else than
  * read data so I do not see a danger of true starvation here.
- * @note data is saved in clicon-handle at NETCONF_HASH_BUF since there is a potential issue if data
+ * @note data is saved in a static framing state since there is a potential issue if data
  * is not completely present on the s, ie if eg:
  *   <a>foo ..pause.. </a>]]>]]>
  * then only "</a>" would be delivered to netconf_input_frame().
@@ -464,32 +819,18 @@ netconf_input_cb(int   s,
 {
     int           retval = -1;
     clicon_handle h = arg;
-    unsigned char buf[BUFSIZ]; /* from stdio.h, typically 8K */
-    int           i;
-    int           len;
-    cbuf         *cb=NULL;
-    int           xml_state = 0;
+    char          buf[BUFSIZ]; /* from stdio.h, typically 8K */
+    size_t        i;
+    ssize_t       len;
+    ssize_t       n;
     int           poll;
-    clicon_hash_t *cdat = clicon_data(h); /* Save cbuf between calls if not done */
-    size_t         cdatlen = 0;
-    void          *ptr;
+    struct netconf_input *ni = &_netconf_input;
 
-    if ((ptr = clicon_hash_value(cdat, NETCONF_HASH_BUF, &cdatlen)) != NULL){
-	if (cdatlen != sizeof(cb)){
-	    clicon_err(OE_XML, errno, "size mismatch %lu %lu",
-		       (unsigned long)cdatlen, (unsigned long)sizeof(cb));
-	    goto done;
-	}
-	cb = *(cbuf**)ptr;
-	clicon_hash_del(cdat, NETCONF_HASH_BUF);
-    }
-    else{
-	if ((cb = cbuf_new()) == NULL){
-	    clicon_err(OE_XML, errno, "cbuf_new");
-	    goto done;
-	}
+    if (ni->ni_cb == NULL &&
+	(ni->ni_cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
     }
-    memset(buf, 0, sizeof(buf));
     while (1){
 	if ((len = read(s, buf, sizeof(buf))) < 0){
 	    if (errno == ECONNRESET)
@@ -500,47 +841,34 @@ netconf_input_cb(int   s,
 	    }
 	} /* read */
 	if (len == 0){ 	/* EOF */
+	    if (netconf_pipeline_drain(h) < 0)
+		goto done;
 	    cc_closed++;
 	    close(s);
 	    retval = 0;
 	    goto done;
 	}
-	for (i=0; i<len; i++){
-	    if (buf[i] == 0)
-		continue; /* Skip NULL chars (eg from terminals) */
-	    cprintf(cb, "%c", buf[i]);
-	    if (detect_endtag("]]>]]>",
-			      buf[i],
-			      &xml_state)) {
-		/* OK, we have an xml string from a client */
-		/* Remove trailer */
-		*(((char*)cbuf_get(cb)) + cbuf_len(cb) - strlen("]]>]]>")) = '\0';
-		if (netconf_input_frame(h, cb) < 0 &&
-		    !ignore_packet_errors) // default is to ignore errors
-		    goto done; 
-		if (cc_closed){
-		    break;
-		}
-		cbuf_reset(cb);
-	    }
+	for (i=0; i<len; i+=n){
+	    /* Framing may change after hello */
+	    if (netconf_framing == NETCONF_SSH_CHUNKED)
+		n = netconf_input_chunked(h, ni, buf+i, len-i);
+	    else
+		n = netconf_input_eom(h, ni, buf+i, len-i);
+	    if (n < 0)
+		goto done;
+	    if (cc_closed)
+		break;
 	}
+	if (cc_closed)
+	    break;
 	/* poll==1 if more, poll==0 if none */
 	if ((poll = clixon_event_poll(s)) < 0)
 	    goto done;
-	if (poll == 0){
-	    /* No data to read, save data and continue on next round */
-	    if (cbuf_len(cb) != 0){
-		if (clicon_hash_add(cdat, NETCONF_HASH_BUF, &cb, sizeof(cb)) == NULL)
-		    return -1;
-		cb = NULL;
-	    }
-	    break; 
-	}
+	if (poll == 0)
+	    break; /* No data to read, save data and continue on next round */
     } /* while */
     retval = 0;
   done:
-    if (cb)
-	cbuf_free(cb);
     if (cc_closed) 
 	retval = -1;
     return retval;
@@ -586,6 +914,10 @@ netconf_terminate(clicon_handle h)
     
     /* Delete all plugins, and RPC callbacks */
     clixon_plugin_module_exit(h);
+    if (_netconf_input.ni_cb){
+	cbuf_free(_netconf_input.ni_cb);
+	_netconf_input.ni_cb = NULL;
+    }
 
     clicon_rpc_close_session(h);
     if ((yspec = clicon_dbspec_yang(h)) != NULL)
@@ -597,6 +929,7 @@ netconf_terminate(clicon_handle h)
     if ((x = clicon_conf_xml(h)) != NULL)
 	xml_free(x);
     xpath_optimize_exit();
+    xpath_cache_exit();
     clixon_event_exit();
     clicon_handle_exit(h);
     clixon_err_exit();
@@ -791,6 +1124,9 @@ main(int    argc,
     /* Set default namespace according to CLICON_NAMESPACE_NETCONF_DEFAULT */
     xml_nsctx_namespace_netconf_default(h);
 
+    /* Set size of xpath cache according to CLICON_XPATH_CACHE_SIZE */
+    xpath_cache_init(h);
+
     /* Add (hardcoded) netconf features in case ietf-netconf loaded here
      * Otherwise it is loaded in netconf_module_load below
      */
@@ -672,6 +672,60 @@ netconf_application_rpc(clicon_handle h,
     return retval;
 }
 
+/*! Check if a netconf rpc is forwarded unmodified to the backend by netconf_rpc_dispatch
+ *
+ * Such an rpc can be pipelined, ie sent to the backend before replies of earlier rpcs have
+ * been received, since its reply is returned to the client as is.
+ * @param[in]  h       clicon handle
+ * @param[in]  xn      Sub-tree (under xorig) at <rpc>...</rpc> level.
+ * @retval     1       Yes, rpc is forwarded
+ * @retval     0       No, rpc is handled (partly) locally, or has side-effects on the session
+ * @see netconf_rpc_dispatch
+ */
+int
+netconf_rpc_forwarded(clicon_handle h,
+		      cxobj        *xn)
+{
+    cxobj *xe;
+    cxobj *x;
+    char  *name;
+    char  *ftype;
+
+    if (xml_child_nr_type(xn, CX_ELMNT) != 1 ||
+	(xe = xml_child_i_type(xn, 0, CX_ELMNT)) == NULL)
+	return 0;
+    name = xml_name(xe);
+    if (strcmp(name, "copy-config") == 0 ||
+	strcmp(name, "delete-config") == 0 ||
+	strcmp(name, "lock") == 0 ||
+	strcmp(name, "unlock") == 0 ||
+	strcmp(name, "validate") == 0 ||
+	strcmp(name, "commit") == 0 ||
+	strcmp(name, "cancel-commit") == 0 ||
+	strcmp(name, "discard-changes") == 0)
+	return 1;
+    x = NULL;
+    if (strcmp(name, "edit-config") == 0){
+	/* Options are checked locally */
+	while ((x = xml_child_each(xe, x, CX_ELMNT)) != NULL)
+	    if (strcmp(xml_name(x), "test-option") == 0 ||
+		strcmp(xml_name(x), "error-option") == 0)
+		return 0;
+	return 1;
+    }
+    if (strcmp(name, "get-config") == 0 ||
+	strcmp(name, "get") == 0){
+	/* Subtree filters are applied locally */
+	while ((x = xml_child_each(xe, x, CX_ELMNT)) != NULL)
+	    if (strcmp(xml_name(x), "filter") == 0 &&
+		(ftype = xml_find_value(x, "type")) != NULL &&
+		strcmp(ftype, "xpath") != 0)
+		return 0;
+	return 1;
+    }
+    return 0;
+}
+
 /*! The central netconf rpc dispatcher. Look at first tag and dispach to sub-functions.
  * Call plugin handler if tag not found. If not handled by any handler, return
  * error.
@@ -43,6 +43,9 @@
  * Prototypes
  */ 
 int 
+netconf_rpc_forwarded(clicon_handle h,
+		      cxobj        *xn);
+int 
 netconf_rpc_dispatch(clicon_handle h,
 		     cxobj        *xn, 
 		     cxobj       **xret);
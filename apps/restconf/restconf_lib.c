@@ -300,7 +300,7 @@ restconf_terminate(clicon_handle h)
     /* Delete all plugins, and RPC callbacks */
     clixon_plugin_module_exit(h);
 
-    clicon_rpc_close_session(h);
+    restconf_backend_pool_exit(h);
     if ((yspec = clicon_dbspec_yang(h)) != NULL)
 	ys_free(yspec);
     if ((yspec = clicon_config_yang(h)) != NULL)
@@ -310,6 +310,7 @@ restconf_terminate(clicon_handle h)
     if ((x = clicon_conf_xml(h)) != NULL)
 	xml_free(x);
     xpath_optimize_exit();
+    xpath_cache_exit();
     restconf_handle_exit(h);
     clixon_err_exit();
     clicon_debug(1, "%s done", __FUNCTION__);
@@ -554,6 +555,168 @@ restconf_drop_privileges(clicon_handle h,
     return retval;
 }
 
+/* Pooled backend session of a restconf user, see CLICON_RESTCONF_BACKEND_POOL
+ */
+struct restconf_backend {
+    qelem_t   rb_qelem;     /* List header */
+    char     *rb_username;  /* User of session */
+    int       rb_s;         /* Socket to backend, or -1 if closed */
+    uint32_t  rb_id;        /* Backend session id */
+};
+
+/* Pooled backend sessions, most recently used first */
+static struct restconf_backend *_backend_pool = NULL;
+
+/* Backend session of current request */
+static struct restconf_backend *_backend_active = NULL;
+
+/*! Close a pooled backend session and free it
+ * The session is closed as its own user, not as the user of the current request.
+ * If close-session fails, eg the backend has already closed the session, it is logged
+ * and the socket is closed anyway.
+ * @param[in]  h   Clicon handle
+ * @param[in]  rb  Pooled backend session, removed from pool
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+restconf_backend_close(clicon_handle            h,
+		       struct restconf_backend *rb)
+{
+    int   retval = -1;
+    char *username0 = NULL;
+    int   s;
+
+    DELQ(rb, _backend_pool, struct restconf_backend *);
+    if (rb == _backend_active)
+	_backend_active = NULL;
+    if (rb->rb_s != -1){
+	if (clicon_username_get(h) &&
+	    (username0 = strdup(clicon_username_get(h))) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    goto done;
+	}
+	if (clicon_username_set(h, rb->rb_username) < 0)
+	    goto done;
+	clicon_client_socket_set(h, rb->rb_s);
+	clicon_session_id_set(h, rb->rb_id);
+	if (clicon_rpc_close_session(h) < 0){
+	    clicon_log(LOG_WARNING, "%s: close-session of user %s: %s",
+		       __FUNCTION__, rb->rb_username, clicon_err_reason);
+	    clicon_err_reset();
+	    if ((s = clicon_client_socket_get(h)) != -1)
+		close(s);
+	}
+	if (clicon_username_set(h, username0) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    clicon_client_socket_set(h, -1);
+    if (username0)
+	free(username0);
+    if (rb->rb_username)
+	free(rb->rb_username);
+    free(rb);
+    return retval;
+}
+
+/*! Use a persistent backend session of a user for the current request
+ *
+ * Each user has its own backend session, opened with a hello as that user and reused by
+ * later requests of the user. At most CLICON_RESTCONF_BACKEND_POOL sessions are kept, the
+ * least recently used session is closed if the pool is full.
+ * If CLICON_RESTCONF_BACKEND_POOL is 0, all requests share the session opened at startup.
+ * @param[in]  h         Clicon handle
+ * @param[in]  username  Authenticated user of request
+ * @retval     0         OK, socket and session id of handle are set
+ * @retval    -1         Error
+ */
+static int
+restconf_backend_select(clicon_handle h,
+			char         *username)
+{
+    int                      retval = -1;
+    int                      size;
+    int                      nr = 0;
+    struct restconf_backend *rb;
+    struct restconf_backend *rb1 = NULL;
+    uint32_t                 id;
+
+    if ((size = clicon_option_int(h, "CLICON_RESTCONF_BACKEND_POOL")) <= 0 ||
+	username == NULL)
+	goto ok;
+    if (_backend_active != NULL) /* Save socket of previous request, it may have been closed */
+	_backend_active->rb_s = clicon_client_socket_get(h);
+    else if (_backend_pool == NULL && clicon_client_socket_get(h) != -1){
+	/* Pool not used before: close shared session opened at startup */
+	if (clicon_rpc_close_session(h) < 0)
+	    goto done;
+    }
+    _backend_active = NULL;
+    if ((rb = _backend_pool) != NULL){
+	do {
+	    nr++;
+	    if (strcmp(rb->rb_username, username) == 0){
+		rb1 = rb;
+		break;
+	    }
+	    rb = NEXTQ(struct restconf_backend *, rb);
+	} while (rb && rb != _backend_pool);
+    }
+    if (rb1 == NULL){
+	if (nr >= size && _backend_pool){ /* Close least recently used */
+	    if (restconf_backend_close(h, PREVQ(struct restconf_backend *, _backend_pool)) < 0)
+		goto done;
+	}
+	if ((rb1 = malloc(sizeof(*rb1))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	memset(rb1, 0, sizeof(*rb1));
+	rb1->rb_s = -1;
+	if ((rb1->rb_username = strdup(username)) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    free(rb1);
+	    goto done;
+	}
+    }
+    else
+	DELQ(rb1, _backend_pool, struct restconf_backend *);
+    INSQ(rb1, _backend_pool); /* First */
+    _backend_active = rb1;
+    clicon_client_socket_set(h, rb1->rb_s);
+    if (rb1->rb_s == -1){ /* Open session as user */
+	if (clicon_hello_req(h, &id) < 0)
+	    goto done;
+	rb1->rb_id = id;
+	rb1->rb_s = clicon_client_socket_get(h);
+    }
+    clicon_session_id_set(h, rb1->rb_id);
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Close backend sessions, pooled or shared
+ * @param[in]  h   Clicon handle
+ */
+int
+restconf_backend_pool_exit(clicon_handle h)
+{
+    int retval = 0;
+
+    if (_backend_pool == NULL)
+	return clicon_rpc_close_session(h);
+    if (_backend_active != NULL)
+	_backend_active->rb_s = clicon_client_socket_get(h);
+    while (_backend_pool != NULL)
+	if (restconf_backend_close(h, _backend_pool) < 0)
+	    retval = -1;
+    return retval;
+}
+
 /*!
  * @param[in]  h         Clicon handle
  * @param[in]  req       Generic Www handle (can be part of clixon handle)
@@ -628,6 +791,9 @@ restconf_authentication_cb(clicon_handle  h,
 	retval = 0;
 	goto notauth;
     }
+    /* Use backend session of user */
+    if (restconf_backend_select(h, clicon_username_get(h)) < 0)
+	goto done;
     /* If set but no user, set a dummy user */
     retval = 1;
  done:
@@ -356,6 +356,9 @@ main(int    argc,
 
     /* Set default namespace according to CLICON_NAMESPACE_NETCONF_DEFAULT */
     xml_nsctx_namespace_netconf_default(h);
+
+    /* Set size of xpath cache according to CLICON_XPATH_CACHE_SIZE */
+    xpath_cache_init(h);
     
     /* Add (hardcoded) netconf features in case ietf-netconf loaded here
      * Otherwise it is loaded in netconf_module_load below
@@ -1721,6 +1721,9 @@ restconf_clixon_init(clicon_handle h,
     /* Set default namespace according to CLICON_NAMESPACE_NETCONF_DEFAULT */
     xml_nsctx_namespace_netconf_default(h);
 
+    /* Set size of xpath cache according to CLICON_XPATH_CACHE_SIZE */
+    xpath_cache_init(h);
+
     /* Init cligen buffers */
     cligen_buflen = clicon_option_int(h, "CLICON_CLI_BUF_START");
     cligen_bufthreshold = clicon_option_int(h, "CLICON_CLI_BUF_THRESHOLD");
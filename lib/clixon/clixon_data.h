@@ -53,9 +53,12 @@
  */
 typedef struct {
     uint32_t  de_id;       /* session id */
-    cxobj    *de_xml;      /* cache */
+    cxobj    *de_xml;      /* cache, may be shared with other db:s, see xmldb_copy */
     int       de_modified; /* Dirty since loaded/copied/committed/etc XXX:nocache? */
     int       de_empty;    /* Empty on read from file, xmldb_readfile and xmldb_put sets it */
+    uint64_t  de_gen;      /* Generation of cache content, new when modified, 0 if unknown */
+    uint64_t  de_basegen;  /* Cache is equal to content of this generation except in
+			    * XML_FLAG_DIRTY subtrees, 0 if unknown. See xmldb_dirty_tracked */
 } db_elmnt;
 
 /*
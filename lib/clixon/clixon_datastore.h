@@ -44,6 +44,9 @@
  */
 /* Internal functions */
 int xmldb_db2file(clicon_handle h, const char *db, char **filename);
+int xmldb_db2journal(clicon_handle h, const char *db, char **filename);
+int xmldb_journal_remove(clicon_handle h, const char *db);
+uint64_t xmldb_gen_next(void);
 
 /* API */
 int xmldb_validate_db(const char *db);
@@ -54,9 +57,12 @@ int xmldb_get(clicon_handle h, const char *db, cvec *nsc, char *xpath, cxobj **x
 int xmldb_get0(clicon_handle h, const char *db, yang_bind yb,
 	       cvec *nsc, const char *xpath,
 	       int copy, cxobj **xtop, modstate_diff_t *msd, cxobj **xerr); 
+int xmldb_get0_arena(clicon_handle h, const char *db, yang_bind yb,
+		     cvec *nsc, const char *xpath, cxobj **xret, cxobj **xerr);
 int xmldb_get0_clear(clicon_handle h, cxobj *x);
 int xmldb_get0_free(clicon_handle h, cxobj **xp);
 int xmldb_put(clicon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret); /* in clixon_datastore_write.[ch] */
+int xmldb_journal_compact(clicon_handle h, const char *db); /* in clixon_datastore_write.[ch] */
 int xmldb_copy(clicon_handle h, const char *from, const char *to);
 int xmldb_lock(clicon_handle h, const char *db, uint32_t id);
 int xmldb_unlock(clicon_handle h, const char *db);
@@ -70,6 +76,8 @@ int xmldb_create(clicon_handle h, const char *db);
 int xmldb_db_reset(clicon_handle h, const char *db);
 
 cxobj *xmldb_cache_get(clicon_handle h, const char *db);
+int    xmldb_cache_unshare(clicon_handle h, const char *db);
+int    xmldb_dirty_tracked(clicon_handle h, const char *db0, const char *db1);
 
 int xmldb_modified_get(clicon_handle h, const char *db);
 int xmldb_modified_set(clicon_handle h, const char *db, int value);
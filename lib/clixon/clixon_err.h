@@ -109,6 +109,9 @@ int   clicon_err_fn(const char *fn, const int line, int category, int err, const
 char *clicon_strerror(int err);
 void *clicon_err_save(void);
 int   clicon_err_restore(void *handle);
+void *clicon_err_thread_new(void);
+int   clicon_err_thread_set(void *handle);
+int   clicon_err_thread_raise(void *handle);
 int   clixon_err_cat_reg(enum clicon_err category, void *handle, clixon_cat_log_cb logfn);
 int   clixon_err_exit(void);
 
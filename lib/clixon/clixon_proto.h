@@ -58,6 +58,16 @@ struct clicon_msg {
     char        op_body[0]; /* rest of message, actual data */
 };
 
+/* Buffer for non-blocking receive or send of protocol messages on a socket
+ * @see clicon_msg_rcv_nb, clicon_msg_send_nb
+ */
+struct clicon_msg_buf {
+    char       *mb_buf;     /* Data buffer */
+    size_t      mb_size;    /* Allocated size of mb_buf */
+    size_t      mb_start;   /* Start of data not yet consumed or written */
+    size_t      mb_end;     /* End of data */
+};
+
 /*
  * Prototypes
  */ 
@@ -85,20 +95,40 @@ int clicon_rpc_connect_inet(clicon_handle         h,
 
 int clicon_rpc(int sock, struct clicon_msg *msg, char **xret);
 
+int clicon_rpc_cbuf(int sock, uint32_t id, cbuf *cb, char **xret);
+
 int clicon_rpc1(int sock, cbuf *msgin, cbuf *msgret);
 
 int clicon_msg_send(int s, struct clicon_msg *msg);
 
+int clicon_msg_send_cbuf(int s, uint32_t id, cbuf *cb);
+
 int clicon_msg_send1(int s, cbuf *cb);
 
 int clicon_msg_rcv(int s, struct clicon_msg **msg, int *eof);
 
 int clicon_msg_rcv1(int s, cbuf *cb, int *eof);
 
+int clicon_msg_buf_reset(struct clicon_msg_buf *mb);
+
+size_t clicon_msg_buf_pending(struct clicon_msg_buf *mb);
+
+int clicon_msg_rcv_nb(int s, struct clicon_msg_buf *mb, int *eof);
+
+int clicon_msg_buf_get(struct clicon_msg_buf *mb, struct clicon_msg **msg);
+
+int clicon_msg_send_nb(int s, struct clicon_msg_buf *mb, struct clicon_msg *msg);
+
+int clicon_msg_flush_nb(int s, struct clicon_msg_buf *mb);
+
 int send_msg_notify_xml(clicon_handle h, int s, cxobj *xev);
 
+int send_msg_notify_xml_nb(clicon_handle h, int s, struct clicon_msg_buf *mb, cxobj *xev, cbuf *cbev);
+
 int send_msg_reply(int s, char *data, uint32_t datalen);
 
+int send_msg_reply_nb(int s, struct clicon_msg_buf *mb, char *data, uint32_t datalen);
+
 int detect_endtag(char *tag, char  ch, int  *state);
 
 #endif  /* _CLIXON_PROTO_H_ */
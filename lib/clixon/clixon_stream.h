@@ -61,19 +61,38 @@
 /*
  * Types
  */
-/* Subscription callback 
+/* Event distributed to subscribers, with its serialized text shared by all of them
+ * @see stream_event_cbuf
+ */
+struct stream_event;
+
+/* Subscription callback
  * @param[in]  h     Clicon handle
  * @param[in]  op    Operation: 0 OK, 1 Close
  * @param[in]  event Event as XML
+ * @param[in]  se    Shared event, or NULL if the event is replayed or op is close
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
  */
-typedef	int (*stream_fn_t)(clicon_handle h, int op, cxobj *event, void *arg);
+typedef	int (*stream_fn_t)(clicon_handle h, int op, cxobj *event, struct stream_event *se, void *arg);
+
+/* Subscription filter, parsed once and shared by all subscriptions of a stream
+ * with identical xpath filter
+ */
+struct stream_filter{
+    qelem_t                     sf_q;      /* queue header */
+    char                       *sf_xpath;  /* Filter selector as xpath */
+    struct xpath_tree          *sf_xptree; /* Parsed xpath, or NULL if parse failed */
+    char                       *sf_top;    /* Event element name of simple path filter or NULL */
+    int                         sf_refcnt; /* Number of subscriptions using filter */
+    int                         sf_match;  /* Match of current event: -1 unknown, 0 no, 1 yes */
+};
 
 struct stream_subscription{
     qelem_t                     ss_q;   /* queue header */
     char                       *ss_stream; /* Name of associated stream */
     char                       *ss_xpath;  /* Filter selector as xpath */
+    struct stream_filter       *ss_filter; /* Parsed filter or NULL if no filter */
     struct timeval              ss_starttime; /* Replay starttime */
     struct timeval              ss_stoptime; /* Replay stoptime */
     stream_fn_t                 ss_fn;     /* Callback when event occurs */
@@ -94,9 +113,11 @@ struct event_stream{
     char                *es_name; /* name of notification event stream */
     char                *es_description;
     struct stream_subscription *es_subscription;
+    struct stream_filter *es_filters; /* Parsed filters of subscriptions */
     int                  es_replay_enabled; /* set if replay is enables */
     struct timeval       es_retention; /* replay retention - how much to save */
     struct stream_replay *es_replay;
+    struct stream_replay_log *es_replay_log; /* Replay on disk, instead of es_replay */
 
 };
 typedef struct event_stream event_stream_t;
@@ -119,6 +140,9 @@ struct stream_subscription *stream_ss_find(event_stream_t *es,
 int stream_ss_delete_all(clicon_handle h, stream_fn_t fn, void *arg);
 int stream_ss_delete(clicon_handle h, char *name, stream_fn_t fn, void *arg);
 
+cbuf *stream_event_cbuf(struct stream_event *se);
+struct stream_event *stream_event_ref(struct stream_event *se);
+int stream_event_free(struct stream_event *se);
 int stream_notify_xml(clicon_handle h, char *stream, cxobj *xml);
 #if defined(__GNUC__) && __GNUC__ >= 3
 int stream_notify(clicon_handle h, char *stream, const char *event, ...)  __attribute__ ((format (printf, 3, 4)));
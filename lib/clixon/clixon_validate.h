@@ -48,5 +48,7 @@ int xml_yang_validate_add(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_list_key_only(cxobj *xt, cxobj **xret);
 int xml_yang_validate_all(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_all_top(clicon_handle h, cxobj *xt, cxobj **xret);
+int yang_validate_deps(yang_stmt *yspec);
+int xml_yang_validate_changed_top(clicon_handle h, cxobj *x0, cxobj *x1, cxobj **xret);
 
 #endif  /* _CLIXON_VALIDATE_H_ */
@@ -165,12 +165,18 @@ typedef struct clixon_xml_vec clixon_xvec; /* struct defined in clicon_xml_vec.c
 #define XML_FLAG_NONE      0x20 /* Node is added as NONE */
 #define XML_FLAG_DEFAULT   0x40 /* Added when a value is set as default @see xml_default */
 #define XML_FLAG_TOP       0x80 /* Top datastore symbol */
+#define XML_FLAG_LAZY      0x100 /* Element content not materialized @see xml_lazy_set */
+#define XML_FLAG_EXPANDED  0x200 /* Top datastore symbol: tree has default values */
+#define XML_FLAG_ARENA     0x400 /* Object is allocated in an arena @see xml_new_arena */
+#define XML_FLAG_DIRTY     0x800 /* Node or descendant modified in datastore cache
+				  * @see xml_diff_dirty */
 
 /*
  * Prototypes
  */
 char     *xml_type2str(enum cxobj_type type);
-int       xml_stats_global(uint64_t *nr);
+int       xml_stats_global(uint64_t *nr, uint64_t *sz);
+int       xml_mt_set(int on);
 int       xml_stats(cxobj *xt, uint64_t *nrp, size_t *szp);
 char     *xml_name(cxobj *xn);
 int       xml_name_set(cxobj *xn, char *name);
@@ -194,6 +200,9 @@ int       xml_flag_reset(cxobj *xn, uint16_t flag);
 char     *xml_value(cxobj *xn);
 int       xml_value_set(cxobj *xn, char *val);
 int       xml_value_append(cxobj *xn, char *val);
+int       xml_lazy_set(cxobj *xn, void *buf, size_t len);
+char     *xml_lazy_get(cxobj *xn, size_t *len);
+int       xml_lazy_clear(cxobj *xn);
 enum cxobj_type xml_type(cxobj *xn);
 
 int       xml_child_nr(cxobj *xn);
@@ -210,6 +219,7 @@ int       xml_childvec_set(cxobj *x, int len);
 cxobj   **xml_childvec_get(cxobj *x);
 cxobj    *xml_new(char *name, cxobj *xn_parent, enum cxobj_type type);
 cxobj    *xml_new_body(char *name, cxobj *parent, char *val);
+cxobj    *xml_new_arena(char *name);
 yang_stmt *xml_spec(cxobj *x);
 int       xml_spec_set(cxobj *x, yang_stmt *spec);
 cg_var   *xml_cv(cxobj *x);
@@ -266,6 +276,10 @@ int       xml_search_index_p(cxobj *x);
 int       xml_search_vector_get(cxobj *x, char *name, clixon_xvec **xvec);
 int       xml_search_child_insert(cxobj *xp, cxobj *x);
 int       xml_search_child_rm(cxobj *xp, cxobj *x);
+int       xml_search_list_insert(cxobj *xe);
+int       xml_search_list_rm(cxobj *xe);
+int       xml_search_index_has(cxobj *xp, char *name);
+int       xml_search_hash_get(cxobj *xp, char *name, char *value, clixon_xvec *xvec);
 cxobj    *xml_child_index_each(cxobj *xparent, char *name, cxobj *xprev, enum cxobj_type type);
 
 
@@ -0,0 +1,69 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+
+ * Parallel processing of XML trees, see clixon_xml_parallel.c
+ */
+#ifndef _CLIXON_XML_PARALLEL_H
+#define _CLIXON_XML_PARALLEL_H
+
+/*
+ * Constants
+ */
+/* A node with at least this many element children is split: its children are processed
+ * in parallel as separate subtrees, instead of the node as a whole, see xml_parallel_split */
+#define XML_PARALLEL_SPLIT 256
+
+/*
+ * Types
+ */
+/*! Function applied on one XML subtree
+ * @param[in]  x     XML subtree
+ * @param[in]  arg   Argument given to xml_parallel_apply
+ * @param[out] xerr  Error tree if retval is 0
+ * @retval     1     OK
+ * @retval     0     Failed, xerr may be set
+ * @retval    -1     Error
+ */
+typedef int (xml_parallel_fn)(cxobj *x, void *arg, cxobj **xerr);
+
+/*
+ * Prototypes
+ */
+int xml_parallel_init(clicon_handle h);
+int xml_parallel_threads(void);
+int xml_parallel_split(cxobj *xp, cxobj *x);
+int xml_parallel_apply(clixon_xvec *xv, xml_parallel_fn *fn, void *arg, cxobj **xerr);
+
+#endif /* _CLIXON_XML_PARALLEL_H */
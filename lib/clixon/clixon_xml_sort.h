@@ -45,6 +45,7 @@ int xml_cmp(cxobj *x1, cxobj *x2, int same, int skip1, char *expl);
 int xml_sort(cxobj *x0);
 int xml_sort_recurse(cxobj *xn);
 int xml_insert(cxobj *xp, cxobj *xc, enum insert_type ins, char *key_val, cvec *nsckey);
+int xml_insert_bulk(cxobj *xp, clixon_xvec *xvec);
 int xml_sort_verify(cxobj *x, void *arg);
 #ifdef XML_EXPLICIT_INDEX
 int xml_search_indexvar_binary_pos(cxobj *xp, char *indexvar, clixon_xvec *xvec,
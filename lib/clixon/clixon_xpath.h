@@ -120,6 +120,9 @@ struct xpath_tree{
 };
 typedef struct xpath_tree xpath_tree;
 
+/* Parsed xpath shared via the xpath cache, see xpath_compile */
+typedef struct xpath_compiled xpath_compiled;
+
 /*
  * Prototypes
  */
@@ -132,7 +135,14 @@ int   xpath_tree_eq(xpath_tree *xt1, xpath_tree *xt2, xpath_tree ***vec, size_t
 xpath_tree *xpath_tree_traverse(xpath_tree *xt, ...);
 int   xpath_tree_free(xpath_tree *xs);
 int   xpath_parse(const char *xpath, xpath_tree **xptree);
+int   xpath_compile(const char *xpath, xpath_compiled **xpcp);
+int   xpath_compiled_free(xpath_compiled *xpc);
+xpath_tree *xpath_compiled_tree(xpath_compiled *xpc);
+int   xpath_cache_init(clicon_handle h);
+void  xpath_cache_exit(void);
+int   xpath_cache_stats(uint64_t *hits, uint64_t *misses, uint64_t *nr);
 int   xpath_vec_ctx(cxobj *xcur, cvec *nsc, const char *xpath, int localonly, xp_ctx  **xrp);
+int   xpath_vec_ctx_tree(cxobj *xcur, cvec *nsc, xpath_tree *xptree, int localonly, xp_ctx **xrp);
 
 #if defined(__GNUC__) && __GNUC__ >= 3
 int    xpath_vec_bool(cxobj *xcur, cvec *nsc, const char *xpformat, ...) __attribute__ ((format (printf, 3, 4)));
@@ -159,6 +169,8 @@ cxobj *xpath_first(cxobj *xcur, cvec *nsc, const char *xpformat, ...);
 cxobj *xpath_first_localonly(cxobj *xcur, const char *xpformat, ...);
 int    xpath_vec(cxobj *xcur, cvec *nsc, const char *xpformat, cxobj  ***vec, size_t *veclen, ...);
 #endif
+int    xpath_vec_compiled(cxobj *xcur, cvec *nsc, xpath_compiled *xpc, cxobj ***vec, size_t *veclen);
+int    xpath_vec_bool_compiled(cxobj *xcur, cvec *nsc, xpath_compiled *xpc);
 
 int xpath2canonical(const char *xpath0, cvec *nsc0, yang_stmt *yspec, char **xpath1, cvec **nsc1);
 
@@ -53,9 +53,16 @@
  */
 #define YANG_FLAG_MARK  0x01  /* (Dynamic) marker for dynamic algorithms, eg expand and DAG */
 #define YANG_FLAG_TMP   0x02  /* (Dynamic) marker for dynamic algorithms, eg DAG detection */
+#define YANG_FLAG_VALIDATE      0x10 /* (Dynamic) constraints may depend on changed nodes,
+				       * see xml_yang_validate_changed_top */
+#define YANG_FLAG_VALIDATE_DESC 0x20 /* (Dynamic) a descendant has YANG_FLAG_VALIDATE */
+#define YANG_FLAG_DEFAULT_WHEN  0x40 /* Yang spec: a default value may depend on a when
+				       * condition, see yang_default_when */
 #ifdef XML_EXPLICIT_INDEX
 #define YANG_FLAG_INDEX 0x04  /* This yang node under list is (extra) index. --> you can access
 			       * list elements using this index with binary search */
+#define YANG_FLAG_INDEX_HASH 0x08 /* Index (YANG_FLAG_INDEX) is a hash index for equality 
+				   * lookups, see search_index_hash extension */
 #endif
 
 /*
@@ -154,6 +161,7 @@ enum yang_class{
 typedef enum yang_class yang_class;
 
 struct xml;
+struct xpath_compiled;
 
 /* This is the external handle type exposed in the API.
  * The internal struct is defined in clixon_yang_internal.h */
@@ -207,6 +215,9 @@ char      *yang_when_xpath_get(yang_stmt *ys);
 int        yang_when_xpath_set(yang_stmt *ys, char *xpath);
 cvec      *yang_when_nsc_get(yang_stmt *ys);
 int        yang_when_nsc_set(yang_stmt *ys, cvec *nsc);
+int        yang_xpath_get(yang_stmt *ys, struct xpath_compiled **xpcp, cvec **nscp);
+clicon_hash_t *yang_deps_get(yang_stmt *yspec);
+int        yang_deps_set(yang_stmt *yspec, clicon_hash_t *deps);
 
 /* Other functions */
 yang_stmt *yspec_new(void);
@@ -250,6 +261,7 @@ int        yang_desc_schema_nodeid(yang_stmt *yn, char *schema_nodeid, yang_stmt
 int        yang_mandatory(yang_stmt *ys);
 int        yang_config(yang_stmt *ys);
 int        yang_config_ancestor(yang_stmt *ys);
+int        yang_default_when(yang_stmt *yn, int when);
 int        yang_features(clicon_handle h, yang_stmt *yt);
 cvec      *yang_arg2cvec(yang_stmt *ys, char *delimi);
 int        yang_container_cli_hide(yang_stmt *ys, int gt);
@@ -79,6 +79,8 @@
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
 
+/* Last datastore cache generation, see xmldb_gen_next */
+static uint64_t _xmldb_gen = 0;
 
 /*! Translate from symbolic database name to actual filename in file-system
  * @param[in]   th       text handle handle
@@ -120,6 +122,80 @@ xmldb_db2file(clicon_handle  h,
     return retval;
 }
 
+/*! Translate from symbolic database name to journal filename in file-system
+ * @param[in]   h        Clicon handle
+ * @param[in]   db       Symbolic database name, eg "candidate", "running"
+ * @param[out]  filename Filename. Unallocate after use with free()
+ * @retval      0        OK
+ * @retval     -1        Error
+ * The journal contains incremental edits of the datastore file, see CLICON_XMLDB_JOURNAL
+ * @see xmldb_db2file
+ */
+int
+xmldb_db2journal(clicon_handle  h,
+		 const char    *db,
+		 char         **filename)
+{
+    int   retval = -1;
+    cbuf *cb = NULL;
+    char *dir;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    if ((dir = clicon_xmldb_dir(h)) == NULL){
+	clicon_err(OE_XML, errno, "dbdir not set");
+	goto done;
+    }
+    cprintf(cb, "%s/%s_db.journal", dir, db);
+    if ((*filename = strdup4(cbuf_get(cb))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Remove journal file of a database if it exists
+ * @param[in]  h   Clicon handle
+ * @param[in]  db  Symbolic database name, eg "candidate", "running"
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+xmldb_journal_remove(clicon_handle h,
+		     const char   *db)
+{
+    int   retval = -1;
+    char *journal = NULL;
+
+    if (xmldb_db2journal(h, db, &journal) < 0)
+	goto done;
+    if (unlink(journal) < 0 && errno != ENOENT){
+	clicon_err(OE_UNIX, errno, "unlink(%s)", journal);
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (journal)
+	free(journal);
+    return retval;
+}
+
+/*! Get a new datastore cache generation, set whenever the content of a cache changes
+ * @retval  gen  New generation, never 0 
+ * @see xmldb_dirty_tracked
+ */
+uint64_t
+xmldb_gen_next(void)
+{
+    return ++_xmldb_gen;
+}
+
 /*! Ensure database name is correct
  * @param[in]   db    Name of database 
  * @retval  0   OK
@@ -137,6 +213,138 @@ xmldb_validate_db(const char *db)
     return 0;
 }
 
+/*! Check if the cached tree of a datastore is also the cache of another datastore
+ * @param[in]  h   Clicon handle
+ * @param[in]  db  Database
+ * @param[in]  xt  Cached XML tree of db
+ * @retval     1   Shared, another datastore has the same tree as cache
+ * @retval     0   Not shared
+ * @retval    -1   Error
+ * @see xmldb_copy where caches become shared
+ */
+static int
+xmldb_cache_shared(clicon_handle h,
+		   const char   *db,
+		   cxobj        *xt)
+{
+    int       retval = -1;
+    char    **keys = NULL;
+    size_t    klen;
+    int       i;
+    db_elmnt *de;
+
+    if (clicon_hash_keys(clicon_db_elmnt(h), &keys, &klen) < 0)
+	goto done;
+    retval = 0;
+    for (i = 0; i < klen; i++){
+	if (strcmp(keys[i], db) == 0)
+	    continue;
+	if ((de = clicon_db_elmnt_get(h, keys[i])) != NULL &&
+	    de->de_xml == xt){
+	    retval = 1;
+	    break;
+	}
+    }
+ done:
+    if (keys)
+	free(keys);
+    return retval;
+}
+
+/*! Remove cached tree of a datastore, free it unless shared with another datastore
+ * @param[in]  h   Clicon handle
+ * @param[in]  db  Database
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+xmldb_cache_free(clicon_handle h,
+		 const char   *db)
+{
+    int       retval = -1;
+    db_elmnt *de;
+    cxobj    *xt;
+    int       ret;
+
+    if ((de = clicon_db_elmnt_get(h, db)) != NULL &&
+	(xt = de->de_xml) != NULL){
+	if ((ret = xmldb_cache_shared(h, db, xt)) < 0)
+	    goto done;
+	de->de_xml = NULL;
+	de->de_gen = 0;
+	de->de_basegen = 0;
+	if (ret == 0)
+	    xml_free(xt);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Reset dirty flag in a cached tree, only dirty subtrees are traversed
+ * @param[in]  x   XML node
+ */
+static void
+xmldb_dirty_reset(cxobj *x)
+{
+    cxobj *xc = NULL;
+
+    if (xml_flag(x, XML_FLAG_DIRTY) == 0)
+	return;
+    xml_flag_reset(x, XML_FLAG_DIRTY);
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+	xmldb_dirty_reset(xc);
+}
+
+/*! Ensure the cached tree of a datastore is not shared before it is modified
+ *
+ * After xmldb_copy, the source and destination datastores share the same cached
+ * tree (copy-on-write). Before one of them is modified, it gets a private copy
+ * while the other datastore(s) keep the original tree.
+ * Subsequent edits of the private copy are tracked relative to the current generation,
+ * see xmldb_dirty_tracked.
+ * @param[in]  h   Clicon handle
+ * @param[in]  db  Database to be modified
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see xmldb_copy
+ */
+int
+xmldb_cache_unshare(clicon_handle h,
+		    const char   *db)
+{
+    int       retval = -1;
+    db_elmnt *de;
+    cxobj    *x1;
+    cxobj    *x2 = NULL;
+    int       ret;
+
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL ||
+	(x1 = de->de_xml) == NULL)
+	goto ok;
+    if ((ret = xmldb_cache_shared(h, db, x1)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    clicon_debug(1, "%s %s", __FUNCTION__, db);
+    if ((x2 = xml_new(xml_name(x1), NULL, CX_ELMNT)) == NULL)
+	goto done;
+    xml_flag_set(x2, XML_FLAG_TOP);
+    if (xml_copy(x1, x2) < 0) 
+	goto done;
+    /* Default values are copied as well */
+    xml_flag_set(x2, xml_flag(x1, XML_FLAG_EXPANDED));
+    de->de_xml = x2;
+    de->de_basegen = de->de_gen;
+    x2 = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (x2)
+	xml_free(x2);
+    return retval;
+}
+
 /*! Connect to a datastore plugin, allocate resources to be used in API calls
  * @param[in]  h    Clicon handle
  * @retval     0    OK
@@ -167,8 +375,11 @@ xmldb_disconnect(clicon_handle h)
     for(i = 0; i < klen; i++) 
 	if ((de = clicon_hash_value(clicon_db_elmnt(h), keys[i], NULL)) != NULL){
 	    if (de->de_xml){
-		xml_free(de->de_xml);
-		de->de_xml = NULL;
+		/* Fold pending journal edits into datastore file before cache is freed */
+		if (xmldb_journal_compact(h, keys[i]) < 0)
+		    goto done;
+		if (xmldb_cache_free(h, keys[i]) < 0)
+		    goto done;
 	    }
 	}
     retval = 0;
@@ -184,7 +395,10 @@ xmldb_disconnect(clicon_handle h)
  * @param[in]  to    Destination database
  * @retval -1  Error
  * @retval  0  OK
-  */
+ * The in-memory cache is not copied, instead both datastores share the same tree until
+ * one of them is modified.
+ * @see xmldb_cache_unshare
+ */
 int 
 xmldb_copy(clicon_handle h, 
 	   const char   *from, 
@@ -198,6 +412,9 @@ xmldb_copy(clicon_handle h,
     db_elmnt            de0 = {0,};
     cxobj              *x1 = NULL;  /* from */
     cxobj              *x2 = NULL;  /* to */
+    char               *fromjournal = NULL;
+    char               *tojournal = NULL;
+    struct stat         sb;
 
     /* XXX lock */
     if (clicon_datastore_cache(h) != DATASTORE_NOCACHE){
@@ -207,34 +424,25 @@ xmldb_copy(clicon_handle h,
 	    x1 = de1->de_xml;
 	if ((de2 = clicon_db_elmnt_get(h, to)) != NULL)
 	    x2 = de2->de_xml;
-	if (x1 == NULL && x2 == NULL){
-	    /* do nothing */
-	}
-	else if (x1 == NULL){  /* free x2 and set to NULL */
-	    xml_free(x2);
-	    x2 = NULL;
-	}
-	else  if (x2 == NULL){ /* create x2 and copy from x1 */
-	    if ((x2 = xml_new(xml_name(x1), NULL, CX_ELMNT)) == NULL)
-		goto done;
-	    xml_flag_set(x2, XML_FLAG_TOP);
-	    if (xml_copy(x1, x2) < 0) 
-		goto done;
-	}
-	else{ /* copy x1 to x2 */
-	    xml_free(x2);
-	    if ((x2 = xml_new(xml_name(x1), NULL, CX_ELMNT)) == NULL)
-		goto done;
-	    xml_flag_set(x2, XML_FLAG_TOP);
-	    if (xml_copy(x1, x2) < 0) 
+	if (x1 != x2){
+	    /* Release x2 (free unless shared) and share x1 */
+	    if (xmldb_cache_free(h, to) < 0)
 		goto done;
+	    x2 = x1;
 	}
-	/* always set cache although not strictly necessary in case 1
-	 * above, but logic gets complicated due to differences with
+	/* always set cache although not strictly necessary if x1 and x2
+	 * are the same, but logic gets complicated due to differences with
 	 * de and de->de_xml */
 	if (de2)
 	    de0 = *de2;
-	de0.de_xml = x2; /* The new tree */
+	de0.de_xml = x2; /* The shared tree */
+	/* Both are equal to the same generation: dirty marks are not needed */
+	if (x2)
+	    xmldb_dirty_reset(x2);
+	if (de1)
+	    de1->de_basegen = de1->de_gen;
+	de0.de_gen = de1?de1->de_gen:0;
+	de0.de_basegen = de0.de_gen;
     }
     clicon_db_elmnt_set(h, to, &de0);
 
@@ -245,12 +453,27 @@ xmldb_copy(clicon_handle h,
 	goto done;
     if (clicon_file_copy(fromfile, tofile) < 0)
 	goto done;
+    /* Copy the journal, if any, as well */
+    if (xmldb_db2journal(h, from, &fromjournal) < 0)
+	goto done;
+    if (lstat(fromjournal, &sb) == 0){
+	if (xmldb_db2journal(h, to, &tojournal) < 0)
+	    goto done;
+	if (clicon_file_copy(fromjournal, tojournal) < 0)
+	    goto done;
+    }
+    else if (xmldb_journal_remove(h, to) < 0)
+	goto done;
     retval = 0;
  done:
     if (fromfile)
 	free(fromfile);
     if (tofile)
 	free(tofile);
+    if (fromjournal)
+	free(fromjournal);
+    if (tojournal)
+	free(tojournal);
     return retval;
 
 }
@@ -384,16 +607,7 @@ int
 xmldb_clear(clicon_handle h, 
 	    const char   *db)
 {
-    cxobj    *xt = NULL;
-    db_elmnt *de = NULL;
-    
-    if ((de = clicon_db_elmnt_get(h, db)) != NULL){
-	if ((xt = de->de_xml) != NULL){
-	    xml_free(xt);
-	    de->de_xml = NULL;
-	}
-    }
-    return 0;
+    return xmldb_cache_free(h, db);
 }
 
 /*! Delete database, clear cache if any. Remove file 
@@ -419,6 +633,8 @@ xmldb_delete(clicon_handle h,
 	    clicon_err(OE_DB, errno, "truncate %s", filename);
 	    goto done;
 	}
+    if (xmldb_journal_remove(h, db) < 0)
+	goto done;
     retval = 0;
  done:
     if (filename)
@@ -439,21 +655,17 @@ xmldb_create(clicon_handle h,
     int                 retval = -1;
     char               *filename = NULL;
     int                 fd = -1;
-    db_elmnt           *de = NULL;
-    cxobj              *xt = NULL;
 
-    if ((de = clicon_db_elmnt_get(h, db)) != NULL){
-	if ((xt = de->de_xml) != NULL){
-	    xml_free(xt);
-	    de->de_xml = NULL;
-	}
-    }
+    if (xmldb_cache_free(h, db) < 0)
+	goto done;
     if (xmldb_db2file(h, db, &filename) < 0)
 	goto done;
     if ((fd = open(filename, O_CREAT|O_WRONLY, S_IRWXU)) == -1) {
 	clicon_err(OE_UNIX, errno, "open(%s)", filename);
 	goto done;
     }
+    if (xmldb_journal_remove(h, db) < 0)
+	goto done;
    retval = 0;
  done:
     if (filename)
@@ -497,6 +709,38 @@ xmldb_cache_get(clicon_handle h,
     return de->de_xml;
 }
 
+/*! Check if dirty marks of a datastore cache are relative to another datastore
+ *
+ * If so, db1 and db0 are equal except in subtrees of db1 marked with 
+ * XML_FLAG_DIRTY, and xml_diff_dirty can be used instead of xml_diff.
+ * @param[in]  h    Clicon handle
+ * @param[in]  db0  Base database, eg "running"
+ * @param[in]  db1  Modified database, eg "candidate"
+ * @retval     1    Yes, db1 is db0 modified in dirty subtrees only
+ * @retval     0    No, or unknown
+ * @see xml_diff_dirty
+ */
+int
+xmldb_dirty_tracked(clicon_handle h,
+		    const char   *db0,
+		    const char   *db1)
+{
+    db_elmnt *de0;
+    db_elmnt *de1;
+
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE)
+	return 0;
+    if ((de0 = clicon_db_elmnt_get(h, db0)) == NULL ||
+	(de1 = clicon_db_elmnt_get(h, db1)) == NULL)
+	return 0;
+    if (de0->de_xml == NULL || de1->de_xml == NULL ||
+	de0->de_gen == 0 || de1->de_gen == 0)
+	return 0;
+    if (de1->de_gen == de0->de_gen || de1->de_basegen == de0->de_gen)
+	return 1;
+    return 0;
+}
+
 /*! Get modified flag from datastore
  * @param[in]  h     Clicon handle
  * @param[in]  db    Database name
@@ -42,6 +42,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <ctype.h>
 #include <limits.h>
 #include <stdint.h>
 #include <sys/types.h>
@@ -72,6 +73,7 @@
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_json.h"
+#include "clixon_xml_binary.h"
 #include "clixon_nacm.h"
 #include "clixon_path.h"
 #include "clixon_netconf_lib.h"
@@ -81,6 +83,7 @@
 #include "clixon_xml_io.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_datastore.h"
+#include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
 
 #define handle(xh) (assert(text_handle_check(xh)==0),(struct text_handle *)(xh))
@@ -413,6 +416,148 @@ disable_nacm_on_empty(cxobj     *xt,
     return retval;
 }
 
+/*! Get the top-level node name of an xpath if that is the only top-level node it accesses
+ *
+ * Conservative: if the xpath may access other top-level nodes, eg in predicates,
+ * unions or with functions, return NULL.
+ * @param[in]  xpath   XPath, eg /a:x/y[z='1']
+ * @param[out] prefix  Prefix of first step, or NULL. Free after use
+ * @param[out] name    Name of first step, or NULL if all top-level nodes. Free after use
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+xpath_first_step(const char *xpath,
+		 char      **prefix,
+		 char      **name)
+{
+    const char *s;
+    const char *p;
+    const char *colon = NULL;
+    int         depth = 0;
+
+    *prefix = NULL;
+    *name = NULL;
+    if (xpath == NULL || strchr(xpath, '|') || strstr(xpath, "deref") || strstr(xpath, "::"))
+	return 0;
+    s = xpath;
+    if (*s == '/')
+	s++;
+    for (p = s; *p && *p != '/' && *p != '['; p++){
+	if (*p == ':' && colon == NULL)
+	    colon = p;
+	else if (!isalnum(*p) && *p != '-' && *p != '_' && *p != '.')
+	    return 0;
+    }
+    if (p == s || colon == s || (colon && colon+1 == p))
+	return 0;
+    /* No path expressions in predicates, they may reach other top-level nodes */
+    for (; *p; p++){
+	if (*p == '[')
+	    depth++;
+	else if (*p == ']')
+	    depth--;
+	else if (depth && *p == '/')
+	    return 0;
+    }
+    if (colon){
+	if ((*prefix = strndup(s, colon-s)) == NULL){
+	    clicon_err(OE_UNIX, errno, "strndup");
+	    return -1;
+	}
+	s = colon+1;
+    }
+    for (p = s; *p && *p != '/' && *p != '['; p++);
+    if ((*name = strndup(s, p-s)) == NULL){
+	clicon_err(OE_UNIX, errno, "strndup");
+	return -1;
+    }
+    return 0;
+}
+
+/*! Materialize lazy top-level nodes of a datastore tree that an xpath may access
+ *
+ * @param[in]  xt     Datastore tree: <config>...
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath, if NULL materialize all lazy nodes
+ * @retval     1      OK, at least one node was materialized
+ * @retval     0      OK, no node was materialized
+ * @retval    -1      Error
+ * @see CLICON_XMLDB_LAZY
+ */
+int
+xmldb_materialize_xpath(cxobj      *xt,
+			cvec       *nsc,
+			const char *xpath)
+{
+    int        retval = -1;
+    cxobj     *x;
+    char      *prefix = NULL;
+    char      *name = NULL;
+    char      *ns = NULL;
+    char      *ns1;
+    int        nr = 0;
+
+    if (xpath_first_step(xpath, &prefix, &name) < 0)
+	goto done;
+    if (name && nsc)
+	ns = xml_nsctx_get(nsc, prefix);
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if (!xml_flag(x, XML_FLAG_LAZY))
+	    continue;
+	if (name){
+	    if (strcmp(name, xml_name(x)) != 0)
+		continue;
+	    if (ns && (ns1 = yang_find_mynamespace(xml_spec(x))) != NULL &&
+		strcmp(ns, ns1) != 0)
+		continue;
+	}
+	if (clixon_binary_materialize(x) < 0)
+	    goto done;
+	nr++;
+    }
+    retval = nr?1:0;
+ done:
+    if (prefix)
+	free(prefix);
+    if (name)
+	free(name);
+    return retval;
+}
+
+/*! Materialize lazy top-level nodes of a datastore tree that an edit modifies
+ *
+ * @param[in]  xt     Datastore tree: <config>...
+ * @param[in]  x1     Bound modification tree: <config>...
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see CLICON_XMLDB_LAZY
+ */
+int
+xmldb_materialize_edit(cxobj *xt,
+		       cxobj *x1)
+{
+    int        retval = -1;
+    cxobj     *x;
+    cxobj     *x1c;
+
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if (!xml_flag(x, XML_FLAG_LAZY))
+	    continue;
+	x1c = NULL;
+	while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL)
+	    if (xml_spec(x1c) == NULL || xml_spec(x1c) == xml_spec(x))
+		break;
+	if (x1c != NULL && clixon_binary_materialize(x) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Common read function that reads an XML tree from file
  * @param[in]  th     Datastore text handle
  * @param[in]  db     Symbolic database name, eg "candidate", "running"
@@ -455,6 +600,8 @@ xmldb_readfile(clicon_handle    h,
     cxobj           *xmodfile = NULL;
     cxobj           *x;
     yang_stmt       *yspec1 = NULL;
+    int              bound = 0;      /* Binary file with yang binding */
+    int              lazy;
 
     if (yb != YB_MODULE && yb != YB_NONE){
 	clicon_err(OE_XML, EINVAL, "yb is %d but should be module or none", yb);
@@ -470,6 +617,10 @@ xmldb_readfile(clicon_handle    h,
 	clicon_err(OE_CFG, ENOENT, "No CLICON_XMLDB_FORMAT");
 	goto done;
     }
+    /* Only cached trees can be lazy since they are accessed via the datastore API */
+    lazy = yb == YB_MODULE &&
+	clicon_datastore_cache(h) != DATASTORE_NOCACHE &&
+	clicon_option_bool(h, "CLICON_XMLDB_LAZY");
     /* Parse file into internal XML tree from different formats */
     if ((fp = fopen(dbfile, "r")) == NULL) {
 	clicon_err(OE_UNIX, errno, "open(%s)", dbfile);
@@ -485,6 +636,12 @@ xmldb_readfile(clicon_handle    h,
 	if (clixon_json_parse_file(fp, YB_NONE, yspec, &x0, xerr) < 0) 
 	    goto done;
     }
+    /* Binary files carry yang binding, use it if yspec matches. Non-binary is XML */
+    else if (strcmp(format, "binary")==0 &&
+	     (ret = clixon_binary_parse_file(fp, yb==YB_MODULE?yspec:NULL, lazy, &x0, &bound)) != 0){
+	if (ret < 0)
+	    goto done;
+    }
     else {
 	if (clixon_xml_parse_file(fp, YB_NONE, yspec, &x0, xerr) < 0){
 	    goto done;
@@ -512,6 +669,9 @@ xmldb_readfile(clicon_handle    h,
     xml_flag_set(x0, XML_FLAG_TOP);
     if (xml_child_nr(x0) == 0 && de)
 	de->de_empty = 1;
+    if (lazy && (x = xml_find_type(x0, NULL, "modules-state", CX_ELMNT)) != NULL)
+	if (clixon_binary_materialize(x) < 0)
+	    goto done;
     /* Check if we support modstate */
     if (clicon_option_bool(h, "CLICON_XMLDB_MODSTATE"))
 	if ((msdiff = modstate_diff_new()) == NULL)
@@ -525,6 +685,11 @@ xmldb_readfile(clicon_handle    h,
      */
     if (text_read_modstate(h, yspec, x0, msdiff) < 0)
 	goto done;
+    /* Binary format: all nodes but top-level are known to be bound, check those */
+    x = NULL;
+    while (bound && (x = xml_child_each(x0, x, CX_ELMNT)) != NULL)
+	if (xml_spec(x) == NULL)
+	    bound = 0;
     if (yb == YB_MODULE){
 	if (msdiff){
 	    /* Check if old/deleted yangs not present in the loaded/running yangspec.
@@ -590,13 +755,22 @@ xmldb_readfile(clicon_handle    h,
 	} /* if msdiff */
 	/* xml looks like: <top><config><x>... actually YB_MODULE_NEXT 
 	 */
-	if ((ret = xml_bind_yang(x0, YB_MODULE, yspec1?yspec1:yspec, xerr)) < 0)
-	    goto done;
-	if (ret == 0)
-	    goto fail;
-	if (xml_sort_recurse(x0) < 0)
+	if (!bound || yspec1){ /* Bound binary files are also sorted */
+	    if ((ret = xml_bind_yang(x0, YB_MODULE, yspec1?yspec1:yspec, xerr)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	    if (xml_sort_recurse(x0) < 0)
+		goto done;
+	}
+	/* Apply incremental edits of journal, if any, on top of file content */
+	if (xmldb_journal_replay(h, db, yspec1?yspec1:yspec, x0, 1) < 0)
 	    goto done;
     }
+    else if (xmldb_journal_replay(h, db, yspec, x0, 0) < 0)
+	goto done;
+    if (de && xml_child_nr(x0)) /* Journal may have added content */
+	de->de_empty = 0;
     if (xp){
 	*xp = x0;
 	x0 = NULL;
@@ -746,6 +920,7 @@ xmldb_get_nocache(clicon_handle    h,
  * @param[in]  yb     How to bind yang to XML top-level when parsing
  * @param[in]  nsc    External XML namespace context, or NULL
  * @param[in]  xpath  String with XPATH syntax. or NULL for all
+ * @param[in]  arena  Allocate returned copy in an arena, see xml_new_arena
  * @param[out] xret   Single return XML tree. Free with xml_free()
  * @param[out] msdiff If set, return modules-state differences
  * @param[out] xerr   XML error if retval is 0
@@ -761,6 +936,7 @@ xmldb_get_cache(clicon_handle    h,
 		yang_bind        yb,
 		cvec            *nsc,
 		const char      *xpath,
+		int              arena,
 		cxobj          **xtop,
 		modstate_diff_t *msdiff,
 		cxobj          **xerr)
@@ -794,24 +970,35 @@ xmldb_get_cache(clicon_handle    h,
 	 * No, argument against: we may want to have a semantically wrong file and wish to edit?
 	 */
 	de0.de_xml = x0t;
+	de0.de_gen = xmldb_gen_next();
 	clicon_db_elmnt_set(h, db, &de0); /* Content is copied */
     } /* x0t == NULL */
     else
 	x0t = de->de_xml;
-
-    if (yb == YB_MODULE && !xml_spec(x0t)){
+    /* Only parse lazy subtrees the xpath may access
+     * This does not change content and is made also if the tree is shared */
+    if ((ret = xmldb_materialize_xpath(x0t, nsc, xpath)) < 0)
+	goto done;
+    if (ret == 1) /* New subtrees do not have default values */
+	xml_flag_reset(x0t, XML_FLAG_EXPANDED);
+    /* Default values are kept in the cache between reads, and removed before the
+     * cache is modified, see xmldb_put */
+    if (yb == YB_MODULE && !xml_flag(x0t, XML_FLAG_EXPANDED)){
+	/* Adding defaults modifies the tree: it must not be shared */
+	if (xmldb_cache_unshare(h, db) < 0)
+	    goto done;
+	x0t = xmldb_cache_get(h, db);
 	if ((ret = xml_bind_yang(x0t, YB_MODULE, yspec, xerr)) < 0)
 	    goto done;
-	if (ret == 0)
-	    ; /* XXX */
-	else {
-	    /* Add default global values (to make xpath below include defaults) */
-	    if (xml_global_defaults(h, x0t, nsc, xpath, yspec, 0) < 0)
-		goto done;
-	    /* Add default recursive values */
-	    if (xml_default_recurse(x0t, 0) < 0)
-		goto done;
-	}
+	if (ret == 0) /* Cache does not match yang, do not return a partly bound tree */
+	    goto fail;
+	/* Add default global values (to make xpath below include defaults) */
+	if (xml_global_defaults(h, x0t, NULL, NULL, yspec, 0) < 0)
+	    goto done;
+	/* Add default recursive values */
+	if (xml_default_recurse(x0t, 0) < 0)
+	    goto done;
+	xml_flag_set(x0t, XML_FLAG_EXPANDED);
     }
     /* Here x0t looks like: <config>...</config> */
     /* Given the xpath, return a vector of matches in xvec 
@@ -826,7 +1013,11 @@ xmldb_get_cache(clicon_handle    h,
 	goto done;
 
     /* Make new tree by copying top-of-tree from x0t to x1t */
-    if ((x1t = xml_new(xml_name(x0t), NULL, CX_ELMNT)) == NULL)
+    if (arena){
+	if ((x1t = xml_new_arena(xml_name(x0t))) == NULL)
+	    goto done;
+    }
+    else if ((x1t = xml_new(xml_name(x0t), NULL, CX_ELMNT)) == NULL)
 	goto done;
     xml_flag_set(x1t, XML_FLAG_TOP);    
     xml_spec_set(x1t, xml_spec(x0t));
@@ -859,16 +1050,15 @@ xmldb_get_cache(clicon_handle    h,
 	if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
 	    goto done;
     }
-    /* Remove global defaults from cache 
-     * Mark non-presence containers */
-    if (xml_apply(x0t, CX_ELMNT, xml_nopresence_default_mark, (void*)XML_FLAG_TRANSIENT) < 0)
-	goto done;
-    /* clear XML tree of defaults */
-    if (xml_tree_prune_flagged(x0t, XML_FLAG_DEFAULT, 1) < 0)
-	goto done;
-    /* Clear XML tree of defaults */
-    if (xml_tree_prune_flagged(x0t, XML_FLAG_TRANSIENT, 1) < 0)
-	goto done;
+    /* Default values in cache were copied, but should not be returned if no yang */
+    if (yb == YB_NONE && xml_flag(x0t, XML_FLAG_EXPANDED)){
+	if (xml_apply(x1t, CX_ELMNT, xml_nopresence_default_mark, (void*)XML_FLAG_TRANSIENT) < 0)
+	    goto done;
+	if (xml_tree_prune_flagged(x1t, XML_FLAG_DEFAULT, 1) < 0)
+	    goto done;
+	if (xml_tree_prune_flagged(x1t, XML_FLAG_TRANSIENT, 1) < 0)
+	    goto done;
+    }
     if (yb != YB_NONE){
 	/* Add default global values */
 	if (xml_global_defaults(h, x1t, nsc, xpath, yspec, 0) < 0)
@@ -943,6 +1133,9 @@ xmldb_get_zerocopy(clicon_handle    h,
 	clicon_err(OE_YANG, ENOENT, "No yang spec");
 	goto done;
     }
+    /* The tree is returned to caller who may modify it: it must not be shared */
+    if (xmldb_cache_unshare(h, db) < 0)
+	goto done;
     de = clicon_db_elmnt_get(h, db);
     if (de == NULL || de->de_xml == NULL){ /* Cache miss, read XML from file */
 	/* If there is no xml x0 tree (in cache), then read it from file */
@@ -955,10 +1148,16 @@ xmldb_get_zerocopy(clicon_handle    h,
 	 * No, argument against: we may want to have a semantically wrong file and wish to edit?
 	 */
 	de0.de_xml = x0t;
+	de0.de_gen = xmldb_gen_next();
 	clicon_db_elmnt_set(h, db, &de0);
     } /* x0t == NULL */
     else
 	x0t = de->de_xml;
+    /* The whole tree is returned, caller may access any part of it */
+    if ((ret = xmldb_materialize_xpath(x0t, NULL, NULL)) < 0)
+	goto done;
+    if (ret == 1)
+	xml_flag_reset(x0t, XML_FLAG_EXPANDED);
 
     /* Here xt looks like: <config>...</config> */
     if (xpath_vec(x0t, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
@@ -971,13 +1170,14 @@ xmldb_get_zerocopy(clicon_handle    h,
 	xml_flag_set(x0, XML_FLAG_MARK);
 	xml_apply_ancestor(x0, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
     }
-    if (yb != YB_NONE){
+    if (yb != YB_NONE && !xml_flag(x0t, XML_FLAG_EXPANDED)){
 	/* Add global defaults. */
-	if (xml_global_defaults(h, x0t, nsc, xpath, yspec, 0) < 0)
+	if (xml_global_defaults(h, x0t, NULL, NULL, yspec, 0) < 0)
 	    goto done;
 	/* Apply default values (removed in clear function) */
 	if (xml_default_recurse(x0t, 0) < 0)
 	    goto done;
+	xml_flag_set(x0t, XML_FLAG_EXPANDED);
     }
     /* If empty NACM config, then disable NACM if loaded
      */
@@ -1112,12 +1312,44 @@ xmldb_get0(clicon_handle    h,
 	 * Add default values in copy, return copy
 	 * Copy deleted by xmldb_free
 	 */
-	retval = xmldb_get_cache(h, db, yb, nsc, xpath, xret, msdiff, xerr);
+	retval = xmldb_get_cache(h, db, yb, nsc, xpath, 0, xret, msdiff, xerr);
 	break;
     }
     return retval;
 }
 
+/*! Get content of datastore as a copy allocated in an arena
+ *
+ * Same as xmldb_get0 with copy set, but the copy is allocated in an arena and is
+ * released as a whole when freed. Suitable for large read-only trees, such as replies.
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Name of datastore, eg "running"
+ * @param[in]  yb     How to bind yang to XML top-level when parsing (if YB_NONE, no defaults)
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xpath  String with XPATH syntax. or NULL for all
+ * @param[out] xret   Single return XML tree. Free with xml_free()
+ * @param[out] xerr   XML error if retval is 0
+ * @retval     -1     General error, check specific clicon_errno, clicon_suberrno
+ * @retval     0      Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval     1      OK
+ * @note Objects of the returned tree cannot be moved to other trees, see xml_new_arena
+ * @note If the datastore is not cached, the copy is not allocated in an arena
+ * @see xmldb_get0
+ */
+int 
+xmldb_get0_arena(clicon_handle    h, 
+		 const char      *db, 
+		 yang_bind        yb,
+		 cvec            *nsc,
+		 const char      *xpath,
+		 cxobj          **xret,
+		 cxobj          **xerr)
+{
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE)
+	return xmldb_get_nocache(h, db, yb, nsc, xpath, xret, NULL, xerr);
+    return xmldb_get_cache(h, db, yb, nsc, xpath, 1, xret, NULL, xerr);
+}
+
 /*! Clear cached xml tree obtained with xmldb_get0, if zerocopy
  *
  * @param[in]  h    Clicon handle
@@ -1144,7 +1376,7 @@ xmldb_get0_clear(clicon_handle    h,
 
     /* clear mark and change */
     xml_apply0(x, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
-	       (void*)(XML_FLAG_MARK|XML_FLAG_ADD|XML_FLAG_CHANGE));
+	       (void*)(XML_FLAG_MARK|XML_FLAG_ADD|XML_FLAG_CHANGE|XML_FLAG_EXPANDED));
  ok:
     retval = 0;
  done:
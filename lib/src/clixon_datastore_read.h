@@ -43,5 +43,7 @@
  */
 int xmldb_readfile(clicon_handle h, const char *db, yang_bind yb, yang_stmt *yspec,
 		   cxobj **xp, db_elmnt *de, modstate_diff_t *msd, cxobj **xerr);
+int xmldb_materialize_xpath(cxobj *xt, cvec *nsc, const char *xpath);
+int xmldb_materialize_edit(cxobj *xt, cxobj *x1);
 
 #endif /* _CLIXON_DATASTORE_READ_H */
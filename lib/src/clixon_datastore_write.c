@@ -65,12 +65,14 @@
 #include "clixon_file.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_xml_vec.h"
 #include "clixon_xml_sort.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_json.h"
+#include "clixon_xml_binary.h"
 #include "clixon_nacm.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_yang_type.h"
@@ -78,6 +80,7 @@
 #include "clixon_xml_nsctx.h"
 #include "clixon_xml_io.h"
 #include "clixon_xml_map.h"
+#include "clixon_xml_bind.h"
 #include "clixon_datastore.h"
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
@@ -214,6 +217,8 @@ check_body_namespace(cxobj     *x0,
  * @param[in]  username User name of requestor for nacm
  * @param[in]  xnacm    NACM XML tree (only if !permit)
  * @param[in]  permit   If set, no NACM tests using xnacm required
+ * @param[in]  xbulk    If set, a new x0 is appended to this vector instead of inserted in x0p,
+ *                      and the caller inserts all of them using xml_insert_bulk
  * @param[out] cbret    Initialized cligen buffer. Contains return XML if retval is 0.
  * @retval    -1        Error
  * @retval     0        Failed (cbret set)
@@ -237,6 +242,7 @@ text_modify(clicon_handle       h,
 	    char               *username,
 	    cxobj              *xnacm,
 	    int                 permit,
+	    clixon_xvec        *xbulk,
 	    cbuf               *cbret)
 {
     int        retval = -1;
@@ -259,11 +265,17 @@ text_modify(clicon_handle       h,
     int        changed = 0; /* Only if x0p's children have changed-> sort necessary */
     cvec      *nscx1 = NULL;
     char      *createstr = NULL;	
+    int        deferred = 0; /* x0 added to xbulk, inserted by caller */
+    clixon_xvec *xcbulk = NULL; /* New children of x0 to insert in bulk */
     
     if (x1 == NULL){
 	clicon_err(OE_XML, EINVAL, "x1 is missing");
 	goto done;
     }
+    /* Mark as possibly modified (before x0 may be purged), see xml_diff_dirty */
+    xml_flag_set(x0p, XML_FLAG_DIRTY);
+    if (x0)
+	xml_flag_set(x0, XML_FLAG_DIRTY);
     /* Check for operations embedded in tree according to netconf */
     if ((ret = attr_ns_value(x1, "operation", NETCONF_BASE_NAMESPACE,
 			     cbret, &opstr)) < 0)
@@ -375,6 +387,7 @@ text_modify(clicon_handle       h,
 		if ((x0 = xml_new(x1name, NULL, CX_ELMNT)) == NULL)
 		    goto done;
 		xml_spec_set(x0, y0);
+		xml_flag_set(x0, XML_FLAG_DIRTY);
 
 		/* Get namespace from x1
 		 * Check if namespace exists in x0 parent
@@ -438,6 +451,18 @@ text_modify(clicon_handle       h,
 			    if (ret == 0)
 				goto fail;
 			}
+#ifdef XML_EXPLICIT_INDEX
+			/* Re-index search index variable with new value */
+			if (xml_search_index_p(x0)){
+			    if (xml_search_child_rm(x0p, x0) < 0)
+				goto done;
+			    if (xml_value_set(x0b, x1bstr) < 0)
+				goto done;
+			    if (xml_search_child_insert(x0p, x0) < 0)
+				goto done;
+			}
+			else
+#endif
 			if (xml_value_set(x0b, x1bstr) < 0)
 			    goto done;
 			/* If a default value ies replaced, then reset default flag */
@@ -447,7 +472,12 @@ text_modify(clicon_handle       h,
 		}
 	    }
 	    if (changed){ 
-		if (xml_insert(x0p, x0, insert, valstr, NULL) < 0) 
+		if (xbulk && insert == INS_LAST){
+		    if (clixon_xvec_append(xbulk, x0) < 0)
+			goto done;
+		    deferred++;
+		}
+		else if (xml_insert(x0p, x0, insert, valstr, NULL) < 0) 
 		    goto done;
 	    }
 	    break;
@@ -575,6 +605,9 @@ text_modify(clicon_handle       h,
 		    goto done;
 		if (xml_copy(x1, x0) < 0)
 		    goto done;
+		if (xml_apply0(x0, CX_ELMNT, (xml_applyfn_t*)xml_flag_set,
+			       (void*)XML_FLAG_DIRTY) < 0)
+		    goto done;
 		break;
 	    } /* anyxml, anydata */
 	    if (x0==NULL){
@@ -592,6 +625,7 @@ text_modify(clicon_handle       h,
 		if ((x0 = xml_new(x1name, NULL, CX_ELMNT)) == NULL)
 		    goto done;
 		xml_spec_set(x0, y0);
+		xml_flag_set(x0, XML_FLAG_DIRTY);
 
 		changed++;
 		/* Get namespace from x1
@@ -657,6 +691,8 @@ text_modify(clicon_handle       h,
 	     * Now potentially modify x0:s children 
 	     * Here x0vec contains one-to-one matching nodes of x1:s children.
 	     */
+	    if (i > 1 && (xcbulk = clixon_xvec_new()) == NULL)
+		goto done;
 	    x1c = NULL;
 	    i = 0;
 	    while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL) {
@@ -665,14 +701,26 @@ text_modify(clicon_handle       h,
 		yc = yang_find_datanode(y0, x1cname);
 		if ((ret = text_modify(h, x0c, x0, x0t, x1c, x1t,
 				       yc, op,
-				       username, xnacm, permit, cbret)) < 0)
+				       username, xnacm, permit, xcbulk, cbret)) < 0)
 		    goto done;
 		/* If xml return - ie netconf error xml tree, then stop and return OK */
 		if (ret == 0)
 		    goto fail;
 	    }
+	    /* New children are inserted at once instead of one by one */
+	    if (xcbulk){
+		if (xml_insert_bulk(x0, xcbulk) < 0)
+		    goto done;
+		clixon_xvec_free(xcbulk);
+		xcbulk = NULL;
+	    }
 	    if (changed){
-		if (xml_insert(x0p, x0, insert, keystr, nscx1) < 0)
+		if (xbulk && insert == INS_LAST){
+		    if (clixon_xvec_append(xbulk, x0) < 0)
+			goto done;
+		    deferred++;
+		}
+		else if (xml_insert(x0p, x0, insert, keystr, nscx1) < 0)
 		    goto done;
 	    }
 	    break;
@@ -703,8 +751,14 @@ text_modify(clicon_handle       h,
     if (nscx1)
 	xml_nsctx_free(nscx1);
     /* Remove dangling added objects */
-    if (changed && x0 && xml_parent(x0)==NULL)
+    if (changed && x0 && xml_parent(x0)==NULL && !deferred)
 	xml_purge(x0);
+    if (xcbulk){ /* Added children not inserted due to error */
+	for (i=0; i<clixon_xvec_len(xcbulk); i++)
+	    if (xml_parent(clixon_xvec_i(xcbulk, i)) == NULL) /* else owned by x0 */
+		xml_free(clixon_xvec_i(xcbulk, i));
+	clixon_xvec_free(xcbulk);
+    }
     if (x0vec)
 	free(x0vec);
     return retval;
@@ -753,6 +807,8 @@ text_modify_top(clicon_handle       h,
     int        ret;
     char      *createstr = NULL;
     
+    /* Mark as possibly modified, see xml_diff_dirty */
+    xml_flag_set(x0, XML_FLAG_DIRTY);
     /* Check for operations embedded in tree according to netconf */
     if ((ret = attr_ns_value(x1,
 			     "operation", NETCONF_BASE_NAMESPACE,
@@ -863,7 +919,7 @@ text_modify_top(clicon_handle       h,
 	}
 	if ((ret = text_modify(h, x0c, x0, x0t, x1c, x1t,
 			       yc, op,
-			       username, xnacm, permit, cbret)) < 0)
+			       username, xnacm, permit, NULL, cbret)) < 0)
 	    goto done;
 	/* If xml return - ie netconf error xml tree, then stop and return OK */
 	if (ret == 0)
@@ -878,6 +934,375 @@ text_modify_top(clicon_handle       h,
     goto done;
 } /* text_modify_top */
 
+/*! Write a datastore XML tree to its file, replacing old content
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Symbolic database name, eg "candidate", "running"
+ * @param[in]  x0     XML tree. Top-level symbol is "config"
+ * @retval     0      OK
+ * @retval    -1      Error
+ * Any journal of the datastore is removed since its content is now in the file
+ */
+static int
+xmldb_write_file(clicon_handle h,
+		 const char   *db,
+		 cxobj        *x0)
+{
+    int    retval = -1;
+    char  *dbfile = NULL;
+    FILE  *f = NULL;
+    cxobj *x;
+    cxobj *xmodst = NULL;
+    char  *format;
+    int    pretty;
+
+    if (xmldb_db2file(h, db, &dbfile) < 0)
+	goto done;
+    if (dbfile==NULL){
+	clicon_err(OE_XML, 0, "dbfile NULL");
+	goto done;
+    }
+    /* Add module revision info before writing to file)
+     * Only if CLICON_XMLDB_MODSTATE is set
+     */
+    if ((x = clicon_modst_cache_get(h, 1)) != NULL){
+	if ((xmodst = xml_dup(x)) == NULL)
+	    goto done;
+	if (xml_addsub(x0, xmodst) < 0)
+	    goto done;
+    }
+    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL){
+	clicon_err(OE_CFG, ENOENT, "No CLICON_XMLDB_FORMAT");
+	goto done;
+    }
+    if ((f = fopen(dbfile, "w")) == NULL){
+	clicon_err(OE_CFG, errno, "Creating file %s", dbfile);
+	goto done;
+    } 
+    pretty = clicon_option_bool(h, "CLICON_XMLDB_PRETTY");
+    if (strcmp(format,"json")==0){
+	if (xml2json(f, x0, pretty) < 0)
+	    goto done;
+    }
+    else if (strcmp(format,"binary")==0){
+	if (xml2binary(f, x0, clicon_dbspec_yang(h)) < 0)
+	    goto done;
+    }
+    else if (clicon_xml2file(f, x0, 0, pretty) < 0)
+	goto done;
+    /* Remove modules state after writing to file
+     */
+    if (xmodst && xml_purge(xmodst) < 0)
+	goto done;
+    if (xmldb_journal_remove(h, db) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (f != NULL)
+	fclose(f);
+    if (dbfile)
+	free(dbfile);
+    return retval;
+}
+
+/*! Serialize a modification tree as a journal delta record
+ *
+ * The record has the form: <delta op="merge" xmlns:..><config>...</config></delta>
+ * All namespace bindings in scope of x1 are declared on the delta element so that the
+ * record can be parsed stand-alone.
+ * @param[in]  x1     Modification tree. Top-level symbol is "config"
+ * @param[in]  op     Top-level operation
+ * @param[out] cb     Record is appended to this buffer
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xmldb_journal_replay
+ */
+static int
+xmldb_journal_record(cxobj              *x1,
+		     enum operation_type op,
+		     cbuf               *cb)
+{
+    int     retval = -1;
+    cvec   *nsc = NULL;
+    cg_var *cv = NULL;
+    char   *prefix;
+
+    if (xml_nsctx_node(x1, &nsc) < 0)
+	goto done;
+    cprintf(cb, "<delta op=\"%s\"", xml_operation2str(op));
+    while ((cv = cvec_each(nsc, cv)) != NULL){
+	if ((prefix = cv_name_get(cv)) == NULL)
+	    cprintf(cb, " xmlns=\"%s\"", cv_string_get(cv));
+	else
+	    cprintf(cb, " xmlns:%s=\"%s\"", prefix, cv_string_get(cv));
+    }
+    cprintf(cb, ">");
+    if (clicon_xml2cbuf(cb, x1, 0, 0, -1) < 0)
+	goto done;
+    cprintf(cb, "</delta>");
+    retval = 0;
+ done:
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+}
+
+/*! Append a delta record to the journal of a datastore
+ *
+ * Each record is framed as: <length>\n<record>\n
+ * If the journal has grown larger than the datastore file, the caller should
+ * instead rewrite the whole file (compaction).
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Symbolic database name, eg "candidate", "running"
+ * @param[in]  cbrec  Serialized delta record
+ * @retval     1      Record appended
+ * @retval     0      Journal is full, rewrite datastore file
+ * @retval    -1      Error
+ * @see xmldb_journal_record
+ */
+static int
+xmldb_journal_append(clicon_handle h,
+		     const char   *db,
+		     cbuf         *cbrec)
+{
+    int         retval = -1;
+    char       *dbfile = NULL;
+    char       *journal = NULL;
+    FILE       *f = NULL;
+    struct stat sb;
+    off_t       dbsize = 0;
+    off_t       jsize = 0;
+
+    if (xmldb_db2file(h, db, &dbfile) < 0)
+	goto done;
+    if (xmldb_db2journal(h, db, &journal) < 0)
+	goto done;
+    if (lstat(dbfile, &sb) == 0)
+	dbsize = sb.st_size;
+    if (lstat(journal, &sb) == 0)
+	jsize = sb.st_size;
+    /* Compact when journal outgrows datastore: amortized cost is linear in edit size */
+    if (jsize + cbuf_len(cbrec) > dbsize)
+	goto full;
+    if ((f = fopen(journal, "a")) == NULL){
+	clicon_err(OE_UNIX, errno, "fopen(%s)", journal);
+	goto done;
+    }
+    /* Record must be on disk before the edit is acknowledged */
+    if (fprintf(f, "%zu\n%s\n", cbuf_len(cbrec), cbuf_get(cbrec)) < 0 ||
+	fflush(f) != 0 ||
+	fsync(fileno(f)) < 0){
+	clicon_err(OE_UNIX, errno, "write(%s)", journal);
+	goto done;
+    }
+    retval = 1;
+ done:
+    if (f)
+	fclose(f);
+    if (dbfile)
+	free(dbfile);
+    if (journal)
+	free(journal);
+    return retval;
+ full:
+    retval = 0;
+    goto done;
+}
+
+/*! Apply function to remove yang binding of an XML node
+ */
+static int
+xml_spec_reset(cxobj *x,
+	       void  *arg)
+{
+    xml_spec_set(x, NULL);
+    return 0;
+}
+
+/*! Replay the journal of a datastore on top of a tree read from datastore file
+ *
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Symbolic database name, eg "candidate", "running"
+ * @param[in]  yspec  Top-level yang spec
+ * @param[in]  x0     XML tree read from file
+ * @param[in]  bound  If set, x0 is bound to yang and sorted, otherwise bind temporarily
+ * @retval     0      OK, all complete records applied
+ * @retval    -1      Error
+ * A truncated last record (eg from a crash during append) is ignored and removed from
+ * the journal, so that records appended later are framed correctly.
+ * @see xmldb_journal_append
+ */
+int
+xmldb_journal_replay(clicon_handle h,
+		     const char   *db,
+		     yang_stmt    *yspec,
+		     cxobj        *x0,
+		     int           bound)
+{
+    int                 retval = -1;
+    char               *journal = NULL;
+    FILE               *f = NULL;
+    char               *line = NULL;
+    size_t              linelen = 0;
+    char               *buf = NULL;
+    size_t              len;
+    cxobj              *xt = NULL;
+    cxobj              *xd;
+    cxobj              *x1;
+    cxobj              *xerr = NULL;
+    cbuf               *cbret = NULL;
+    char               *opstr;
+    enum operation_type op;
+    int                 ret;
+    int                 nr = 0;
+    off_t               off = 0; /* Offset of end of last complete record */
+
+    if (xmldb_db2journal(h, db, &journal) < 0)
+	goto done;
+    if ((f = fopen(journal, "r")) == NULL){
+	if (errno == ENOENT)
+	    goto ok;
+	clicon_err(OE_UNIX, errno, "fopen(%s)", journal);
+	goto done;
+    }
+    if ((cbret = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    /* Edits can only be applied on a yang bound tree */
+    if (!bound){
+	if ((ret = xml_bind_yang(x0, YB_MODULE, yspec, &xerr)) < 0)
+	    goto done;
+	if (ret == 0){
+	    clicon_err(OE_DB, EINVAL, "%s: datastore does not match yang, journal can not be replayed", journal);
+	    goto done;
+	}
+	if (xml_sort_recurse(x0) < 0)
+	    goto done;
+    }
+    while (getline(&line, &linelen, f) > 0){
+	len = strtoul(line, NULL, 10);
+	if ((buf = malloc(len+1)) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	if (fread(buf, 1, len, f) != len || fgetc(f) != '\n'){
+	    clicon_log(LOG_WARNING, "%s: truncated record %d ignored", journal, nr);
+	    if (truncate(journal, off) < 0)
+		clicon_log(LOG_WARNING, "%s: truncate %s: %s", __FUNCTION__,
+			   journal, strerror(errno));
+	    break;
+	}
+	buf[len] = '\0';
+	if (clixon_xml_parse_string(buf, YB_NONE, yspec, &xt, NULL) < 0)
+	    goto done;
+	free(buf);
+	buf = NULL;
+	if ((xd = xml_find_type(xt, NULL, "delta", CX_ELMNT)) == NULL ||
+	    (x1 = xml_find_type(xd, NULL, NETCONF_INPUT_CONFIG, CX_ELMNT)) == NULL){
+	    clicon_err(OE_DB, EINVAL, "%s: malformed record %d", journal, nr);
+	    goto done;
+	}
+	op = OP_MERGE;
+	if ((opstr = xml_find_value(xd, "op")) != NULL &&
+	    xml_operation(opstr, &op) < 0)
+	    goto done;
+	/* Same preparation as an incoming edit-config */
+	if ((ret = xml_bind_yang(x1, YB_MODULE, yspec, &xerr)) < 0)
+	    goto done;
+	if (ret == 0){
+	    clicon_err(OE_DB, EINVAL, "%s: record %d does not match yang", journal, nr);
+	    goto done;
+	}
+	if (xml_sort_recurse(x1) < 0)
+	    goto done;
+	if (xmldb_materialize_edit(x0, x1) < 0)
+	    goto done;
+	/* Record was accepted when written: replay without NACM */
+	if ((ret = text_modify_top(h, x0, x0, x1, x1, yspec, op, NULL, NULL, 1, cbret)) < 0)
+	    goto done;
+	if (ret == 0){
+	    clicon_err(OE_DB, EINVAL, "%s: record %d failed: %s", journal, nr, cbuf_get(cbret));
+	    goto done;
+	}
+	xml_free(xt);
+	xt = NULL;
+	nr++;
+	off = ftello(f);
+    }
+    clicon_data_del(h, "objectexisted");
+    /* Remove NONE nodes if all subs recursively are also NONE */
+    if (xml_tree_prune_flagged_sub(x0, XML_FLAG_NONE, 0, NULL) <0)
+	goto done;
+    if (xml_apply(x0, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, 
+		  (void*)(XML_FLAG_NONE|XML_FLAG_MARK)) < 0)
+	goto done;
+    if (!bound &&
+	xml_apply0(x0, CX_ELMNT, xml_spec_reset, NULL) < 0)
+	goto done;
+    clicon_debug(1, "%s %s: %d records", __FUNCTION__, db, nr);
+ ok:
+    retval = 0;
+ done:
+    if (f)
+	fclose(f);
+    if (journal)
+	free(journal);
+    if (line)
+	free(line);
+    if (buf)
+	free(buf);
+    if (xt)
+	xml_free(xt);
+    if (xerr)
+	xml_free(xerr);
+    if (cbret)
+	cbuf_free(cbret);
+    return retval;
+}
+
+/*! Compact the journal of a cached datastore into its datastore file
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Symbolic database name, eg "candidate", "running"
+ * @retval     0      OK
+ * @retval    -1      Error
+ * Only done if the datastore is cached, otherwise the journal is kept and replayed 
+ * on next read.
+ * Done also if CLICON_XMLDB_JOURNAL is not set, in case a journal remains from an earlier run
+ */
+int
+xmldb_journal_compact(clicon_handle h,
+		      const char   *db)
+{
+    int         retval = -1;
+    char       *journal = NULL;
+    db_elmnt   *de;
+    cxobj      *x0;
+    struct stat sb;
+
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL ||
+	(x0 = de->de_xml) == NULL)
+	goto ok;
+    if (xmldb_db2journal(h, db, &journal) < 0)
+	goto done;
+    if (lstat(journal, &sb) < 0) /* No journal */
+	goto ok;
+    /* Mark non-presence containers */
+    if (xml_apply(x0, CX_ELMNT, xml_nopresence_default_mark, (void*)XML_FLAG_TRANSIENT) < 0)
+	goto done;
+    /* Clear XML tree of defaults */
+    if (xml_tree_prune_flagged(x0, XML_FLAG_TRANSIENT, 1) < 0)
+	goto done;
+    xml_flag_reset(x0, XML_FLAG_EXPANDED);
+    if (xmldb_write_file(h, db, x0) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (journal)
+	free(journal);
+    return retval;
+}
+
 /*! Modify database given an xml tree and an operation
  *
  * @param[in]  h      CLICON handle
@@ -901,6 +1326,7 @@ text_modify_top(clicon_handle       h,
  *     cbret contains netconf error message
  * @endcode
  * @note if xret is non-null, it may contain error message
+ * @note If CLICON_XMLDB_JOURNAL is set, only the modification is appended to the journal
  */
 int
 xmldb_put(clicon_handle       h,
@@ -911,22 +1337,17 @@ xmldb_put(clicon_handle       h,
 	  cbuf               *cbret)
 {
     int         retval = -1;
-    char       *dbfile = NULL;
-    FILE       *f = NULL;
     cbuf       *cb = NULL;
     yang_stmt  *yspec;
     cxobj      *x0 = NULL;
     db_elmnt   *de = NULL;
     int         ret;
     cxobj      *xnacm = NULL;
-    cxobj      *xmodst = NULL;
-    cxobj      *x;
     int         permit = 0; /* nacm permit all */
-    char       *format;
     cvec       *nsc = NULL; /* nacm namespace context */
     int         firsttime = 0;
-    int         pretty;
     cxobj      *xerr = NULL;
+    cbuf       *cbrec = NULL; /* journal record */
 
     if (cbret == NULL){
 	clicon_err(OE_XML, EINVAL, "cbret is NULL");
@@ -941,9 +1362,14 @@ xmldb_put(clicon_handle       h,
 		   xml_name(x1), NETCONF_INPUT_CONFIG);
 	goto done;
     }
+    /* Cache may be shared with other datastores, make a private copy before modifying */
+    if (xmldb_cache_unshare(h, db) < 0)
+	goto done;
     if ((de = clicon_db_elmnt_get(h, db)) != NULL){
 	if (clicon_datastore_cache(h) != DATASTORE_NOCACHE)
 	    x0 = de->de_xml; /* XXX flag is not XML_FLAG_TOP */
+	/* Cache content changes, also if modification below fails half-way */
+	de->de_gen = xmldb_gen_next();
     }
     /* If there is no xml x0 tree (in cache), then read it from file */
     if (x0 == NULL){
@@ -970,6 +1396,21 @@ xmldb_put(clicon_handle       h,
     xnacm = clicon_nacm_cache(h);
     permit = (xnacm==NULL);
 
+    /* Serialize modification before it is applied, in case it is journaled */
+    if (x1 && clicon_option_bool(h, "CLICON_XMLDB_JOURNAL")){
+	if ((cbrec = cbuf_new()) == NULL){
+	    clicon_err(OE_XML, errno, "cbuf_new");
+	    goto done;
+	}
+	if (xmldb_journal_record(x1, op, cbrec) < 0)
+	    goto done;
+    }
+    /* Default values may be kept in cache between reads, remove them before modifying */
+    if (xml_flag(x0, XML_FLAG_EXPANDED) && xmldb_get0_clear(h, x0) < 0)
+	goto done;
+    /* Parse lazy subtrees that are modified */
+    if (x1 && xmldb_materialize_edit(x0, x1) < 0)
+	goto done;
     /* Here assume if xnacm is set and !permit do NACM */
     clicon_data_del(h, "objectexisted");
     /* 
@@ -1013,54 +1454,29 @@ xmldb_put(clicon_handle       h,
 	if (de0.de_xml == NULL)
 	    de0.de_xml = x0;
 	de0.de_empty = (xml_child_nr(de0.de_xml) == 0);
+	de0.de_gen = xmldb_gen_next();
 	clicon_db_elmnt_set(h, db, &de0);
     }
-    if (xmldb_db2file(h, db, &dbfile) < 0)
-	goto done;
-    if (dbfile==NULL){
-	clicon_err(OE_XML, 0, "dbfile NULL");
-	goto done;
-    }
-    /* Add module revision info before writing to file)
-     * Only if CLICON_XMLDB_MODSTATE is set
-     */
-    if ((x = clicon_modst_cache_get(h, 1)) != NULL){
-	if ((xmodst = xml_dup(x)) == NULL)
-	    goto done;
-	if (xml_addsub(x0, xmodst) < 0)
-	    goto done;
-    }
-    if ((format = clicon_option_str(h, "CLICON_XMLDB_FORMAT")) == NULL){
-	clicon_err(OE_CFG, ENOENT, "No CLICON_XMLDB_FORMAT");
-	goto done;
-    }
-    if ((f = fopen(dbfile, "w")) == NULL){
-	clicon_err(OE_CFG, errno, "Creating file %s", dbfile);
-	goto done;
-    } 
-    pretty = clicon_option_bool(h, "CLICON_XMLDB_PRETTY");
-    if (strcmp(format,"json")==0){
-	if (xml2json(f, x0, pretty) < 0)
+    /* Append modification to journal, unless the journal is full */
+    if (cbrec){
+	if ((ret = xmldb_journal_append(h, db, cbrec)) < 0)
 	    goto done;
+	if (ret == 1)
+	    goto ok;
     }
-    else if (clicon_xml2file(f, x0, 0, pretty) < 0)
-	goto done;
-    /* Remove modules state after writing to file
-     */
-    if (xmodst && xml_purge(xmodst) < 0)
+    if (xmldb_write_file(h, db, x0) < 0)
 	goto done;
+ ok:
     retval = 1;
  done:
-    if (f != NULL)
-	fclose(f);
     if (xerr)
 	xml_free(xerr);
     if (nsc)
 	xml_nsctx_free(nsc);
-    if (dbfile)
-	free(dbfile);
     if (cb)
 	cbuf_free(cb);
+    if (cbrec)
+	cbuf_free(cbrec);
     if (x0 && clicon_datastore_cache(h) == DATASTORE_NOCACHE)
 	xml_free(x0);
     return retval;
@@ -1085,6 +1501,7 @@ xmldb_dump(clicon_handle   h,
     /* clear XML tree of defaults */
     if (xml_tree_prune_flagged(xt, XML_FLAG_DEFAULT, 1) < 0)
 	goto done;
+    xml_flag_reset(xt, XML_FLAG_EXPANDED);
     /* Add modstate first */
     if ((x = clicon_modst_cache_get(h, 1)) != NULL){
 	if ((xmodst = xml_dup(x)) == NULL)
@@ -1101,6 +1518,10 @@ xmldb_dump(clicon_handle   h,
 	if (xml2json(f, xt, pretty) < 0)
 	    goto done;
     }
+    else if (strcmp(format,"binary")==0){
+	if (xml2binary(f, xt, clicon_dbspec_yang(h)) < 0)
+	    goto done;
+    }
     else if (clicon_xml2file(f, xt, 0, pretty) < 0)
 	goto done;
     retval = 0;
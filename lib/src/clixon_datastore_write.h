@@ -46,5 +46,7 @@
  * Prototypes
  */
 int xmldb_put(clicon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret);
+int xmldb_journal_replay(clicon_handle h, const char *db, yang_stmt *yspec, cxobj *x0, int bound);
+int xmldb_journal_compact(clicon_handle h, const char *db);
 
 #endif /* _CLIXON_DATASTORE_WRITE_H */
@@ -74,9 +74,11 @@ struct errvec{
 };
 
 struct err_state{
-    int  es_errno;
-    int  es_suberrno;
-    char es_reason[ERR_STRLEN];
+    int         es_errno;
+    int         es_suberrno;
+    char        es_reason[ERR_STRLEN];
+    const char *es_fn;   /* Only for thread error state */
+    int         es_line; /* Only for thread error state */
 };
 
 /* Clixon error category callbacks provides a way to specialize
@@ -101,6 +103,12 @@ int  clicon_errno  = 0;    /* See enum clicon_err XXX: hide this and change to e
 int  clicon_suberrno  = 0; /* Corresponds to errno.h XXX: change to errno */
 char clicon_err_reason[ERR_STRLEN] = {0, };
 
+#ifdef HAVE_LIBPTHREAD
+/* If set, errors of this thread are recorded here instead of in the global variables,
+ * see clicon_err_thread_set */
+static __thread struct err_state *_err_thread = NULL;
+#endif
+
 /*
  * Error descriptions. Must stop with NULL element.
  */
@@ -199,6 +207,18 @@ clicon_err_fn(const char *fn,
     int     retval = -1;
     struct clixon_err_cats *cec;
     
+#ifdef HAVE_LIBPTHREAD
+    if (_err_thread != NULL){ /* Record in thread error state, no logging */
+	_err_thread->es_errno = category;
+	_err_thread->es_suberrno = suberr;
+	_err_thread->es_fn = fn;
+	_err_thread->es_line = line;
+	va_start(args, format);
+	vsnprintf(_err_thread->es_reason, ERR_STRLEN, format, args);
+	va_end(args);
+	return 0;
+    }
+#endif
     /* Set the global variables */
     clicon_errno    = category;
     clicon_suberrno = suberr;
@@ -305,6 +325,59 @@ clicon_err_restore(void* handle)
     return 0;
 }
 
+/*! Create an empty error state for a thread, see clicon_err_thread_set
+ * @retval  handle  Error state, free with free()
+ * @retval  NULL    Error
+ */
+void *
+clicon_err_thread_new(void)
+{
+    struct err_state *es;
+
+    if ((es = calloc(1, sizeof(*es))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	return NULL;
+    }
+    return (void*)es;
+}
+
+/*! Record errors of the calling thread in an error state instead of in the global variables
+ *
+ * The global error variables and the log are not thread-safe. A thread other than the
+ * main thread should record its errors, and the main thread reports them after the 
+ * thread is joined using clicon_err_thread_raise.
+ * @param[in]  handle  Error state from clicon_err_thread_new, or NULL to stop recording
+ * @retval     0       OK
+ * @retval    -1       Error, built without pthreads
+ */
+int
+clicon_err_thread_set(void *handle)
+{
+#ifdef HAVE_LIBPTHREAD
+    _err_thread = (struct err_state *)handle;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*! Report an error recorded by another thread, call from the main thread
+ * @param[in]  handle  Error state from clicon_err_thread_new
+ * @retval     1       An error was recorded and is now reported with clicon_err
+ * @retval     0       No error was recorded
+ */
+int
+clicon_err_thread_raise(void *handle)
+{
+    struct err_state *es = (struct err_state *)handle;
+
+    if (es == NULL || es->es_errno == 0)
+	return 0;
+    clicon_err_fn(es->es_fn?es->es_fn:__FUNCTION__, es->es_line,
+		  es->es_errno, es->es_suberrno, "%s", es->es_reason);
+    return 1;
+}
+
 /*! Register error categories for application-based error handling
  *
  * @param[in]  category  Applies for this category (first arg to clicon_err())
@@ -49,8 +49,12 @@
 #include <errno.h>
 #include <string.h>
 #include <syslog.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#ifdef HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#endif
 
 #include <cligen/cligen.h>
 
@@ -68,15 +72,24 @@
  */
 #define EVENT_STRLEN 32
 
+/* Max number of ready file descriptors returned by one epoll_wait */
+#define EVENT_EPOLL_MAX 64
+
+/* Max epoll_wait timeout in seconds, longer timeouts are waited for in several steps */
+#define EVENT_EPOLL_MAXSEC 86400
+
 /*
  * Types
  */
 struct event_data{
     struct event_data *e_next;     /* next in list */
+    struct event_data *e_fdnext;   /* next with same file descriptor (EVENT_FD) */
     int (*e_fn)(int, void*);            /* function */
-    enum {EVENT_FD, EVENT_TIME} e_type;        /* type of event */
+    enum {EVENT_FD, EVENT_FD_OUT, EVENT_TIME} e_type; /* type of event */
     int e_fd;                      /* File descriptor */
     struct timeval e_time;         /* Timeout */
+    int e_index;                   /* Position in timer heap (EVENT_TIME) */
+    uint64_t e_seq;                /* Registration order of timeouts with same time */
     void *e_arg;                   /* function argument */
     char e_string[EVENT_STRLEN];             /* string for debugging */
 };
@@ -85,8 +98,25 @@ struct event_data{
  * Internal variables
  * XXX consider use handle variables instead of global
  */
+/* All file descriptor events */
 static struct event_data *ee = NULL;
-static struct event_data *ee_timers = NULL;
+
+/* File descriptor events indexed by file descriptor, chained by e_fdnext */
+static struct event_data **ee_fdtab = NULL;
+static int ee_fdtab_len = 0;
+
+/* Timeouts as binary min-heap ordered by time */
+static struct event_data **ee_timers = NULL;
+static int ee_timers_len = 0;
+static int ee_timers_max = 0;
+static uint64_t ee_timers_seq = 0;
+
+/* Epoll file descriptor, or -1 if select is used. Created on first registration */
+static int ee_epfd = -1;
+static int ee_epinit = 0;
+#ifdef HAVE_EPOLL_CREATE1
+static pid_t ee_eppid = 0;  /* Process that created ee_epfd */
+#endif
 
 /* Set if element in ee is deleted (clixon_event_unreg_fd). Check in ee loops */
 static int _ee_unreg = 0;
@@ -155,6 +185,220 @@ clicon_sig_ignore_get(void)
     return _clicon_sig_ignore;
 }
 
+#ifdef HAVE_EPOLL_CREATE1
+/*! Get epoll events of all callbacks registered on a file descriptor
+ */
+static uint32_t
+event_epoll_mask(int fd)
+{
+    struct event_data *e;
+    uint32_t           mask = 0;
+
+    for (e = ee_fdtab[fd]; e; e = e->e_fdnext)
+	mask |= e->e_type == EVENT_FD_OUT ? EPOLLOUT : EPOLLIN;
+    return mask;
+}
+
+/*! Update epoll registration of a file descriptor after its callbacks have changed
+ * @param[in]  fd    File descriptor
+ * @param[in]  mask0 Epoll events before change
+ */
+static int
+event_epoll_update(int      fd,
+		   uint32_t mask0)
+{
+    struct epoll_event ev = {0,};
+
+    ev.events = event_epoll_mask(fd);
+    ev.data.fd = fd;
+    if (ev.events == mask0)
+	return 0;
+    if (ev.events == 0){
+	/* The fd may already be closed, which also removes it from epoll */
+	epoll_ctl(ee_epfd, EPOLL_CTL_DEL, fd, NULL);
+	return 0;
+    }
+    if (epoll_ctl(ee_epfd, mask0?EPOLL_CTL_MOD:EPOLL_CTL_ADD, fd, &ev) < 0){
+	clicon_err(OE_EVENTS, errno, "epoll_ctl");
+	return -1;
+    }
+    return 0;
+}
+#endif /* HAVE_EPOLL_CREATE1 */
+
+/*! Initialize epoll on first file descriptor registration, fall back to select on failure
+ * An epoll instance is shared with child processes after fork, therefore a child creates
+ * its own instance with the registered file descriptors.
+ */
+static void
+event_epoll_init(void)
+{
+#ifdef HAVE_EPOLL_CREATE1
+    struct epoll_event ev = {0,};
+    int                fd;
+    
+    if (ee_epinit && ee_eppid == getpid())
+	return;
+    ee_eppid = getpid();
+    if (ee_epinit && ee_epfd == -1) /* select fallback */
+	return;
+    ee_epinit++;
+    if (ee_epfd != -1)
+	close(ee_epfd);
+    if ((ee_epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+	clicon_debug(1, "%s epoll_create1: %s, using select", __FUNCTION__, strerror(errno));
+	return;
+    }
+    for (fd=0; fd<ee_fdtab_len; fd++){
+	if (ee_fdtab[fd] == NULL)
+	    continue;
+	ev.events = event_epoll_mask(fd);
+	ev.data.fd = fd;
+	if (epoll_ctl(ee_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+	    clicon_debug(1, "%s epoll_ctl: %s", __FUNCTION__, strerror(errno));
+    }
+#endif
+}
+
+/*! Use select instead of epoll in the event loop
+ * Registered file descriptors are kept, but must be less than FD_SETSIZE.
+ * Mainly for testing the select fallback on platforms with epoll.
+ * @retval  0  OK
+ * @retval -1  Error: a registered file descriptor is too large for select
+ */
+int
+clixon_event_select(void)
+{
+    int fd;
+
+    for (fd=FD_SETSIZE; fd<ee_fdtab_len; fd++)
+	if (ee_fdtab[fd] != NULL){
+	    clicon_err(OE_EVENTS, EINVAL, "File descriptor %d too large for select", fd);
+	    return -1;
+	}
+    if (ee_epfd != -1){
+	close(ee_epfd);
+	ee_epfd = -1;
+    }
+    ee_epinit = 1;
+#ifdef HAVE_EPOLL_CREATE1
+    ee_eppid = getpid();
+#endif
+    return 0;
+}
+
+/*! Register a file descriptor callback
+ * @param[in]  fd   File descriptor
+ * @param[in]  type EVENT_FD for input or EVENT_FD_OUT for output
+ * @param[in]  fn   Function to call when fd is ready
+ * @param[in]  arg  Argument to function fn
+ * @param[in]  str  Describing string for logging
+ */
+static int
+event_reg_fd(int   fd,
+	     int   type,
+	     int (*fn)(int, void*), 
+	     void *arg, 
+	     char *str)
+{
+    struct event_data  *e;
+    struct event_data **tab;
+    int                 len;
+#ifdef HAVE_EPOLL_CREATE1
+    uint32_t            mask0;
+#endif
+
+    event_epoll_init();
+    if (fd < 0 || (ee_epfd == -1 && fd >= FD_SETSIZE)){ /* select */
+	clicon_err(OE_EVENTS, EINVAL, "Invalid file descriptor: %d", fd);
+	return -1;
+    }
+    if (fd >= ee_fdtab_len){
+	len = ee_fdtab_len?ee_fdtab_len:64;
+	while (len <= fd)
+	    len *= 2;
+	if ((tab = realloc(ee_fdtab, len*sizeof(struct event_data *))) == NULL){
+	    clicon_err(OE_EVENTS, errno, "realloc");
+	    return -1;
+	}
+	memset(&tab[ee_fdtab_len], 0, (len-ee_fdtab_len)*sizeof(struct event_data *));
+	ee_fdtab = tab;
+	ee_fdtab_len = len;
+    }
+    if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
+	clicon_err(OE_EVENTS, errno, "malloc");
+	return -1;
+    }
+    memset(e, 0, sizeof(struct event_data));
+    strncpy(e->e_string, str, EVENT_STRLEN);
+    e->e_fd = fd;
+    e->e_fn = fn;
+    e->e_arg = arg;
+    e->e_type = type;
+#ifdef HAVE_EPOLL_CREATE1
+    mask0 = event_epoll_mask(fd);
+#endif
+    e->e_fdnext = ee_fdtab[fd];
+    ee_fdtab[fd] = e;
+#ifdef HAVE_EPOLL_CREATE1
+    if (ee_epfd != -1 && event_epoll_update(fd, mask0) < 0){
+	ee_fdtab[fd] = e->e_fdnext;
+	free(e);
+	return -1;
+    }
+#endif
+    e->e_next = ee;
+    ee = e;
+    clicon_debug(2, "%s, registering %s", __FUNCTION__, e->e_string);
+    return 0;
+}
+
+/*! Deregister a file descriptor callback
+ * @param[in]  s    File descriptor
+ * @param[in]  type EVENT_FD for input or EVENT_FD_OUT for output
+ * @param[in]  fn   Function to call when fd is ready
+ */
+static int
+event_unreg_fd(int   s, 
+	       int   type,
+	       int (*fn)(int, void*))
+{
+    struct event_data *e, **e_prev;
+    int found = 0;
+#ifdef HAVE_EPOLL_CREATE1
+    uint32_t           mask0;
+#endif
+
+    if (s < 0 || s >= ee_fdtab_len)
+	return -1;
+    /* A forked child must not modify the epoll instance shared with its parent */
+    event_epoll_init();
+#ifdef HAVE_EPOLL_CREATE1
+    mask0 = event_epoll_mask(s);
+#endif
+    e_prev = &ee_fdtab[s];
+    for (e = ee_fdtab[s]; e; e = e->e_fdnext){
+	if (fn == e->e_fn && type == e->e_type) {
+	    found++;
+	    *e_prev = e->e_fdnext;
+	    break;
+	}
+	e_prev = &e->e_fdnext;
+    }
+    if (!found)
+	return -1;
+#ifdef HAVE_EPOLL_CREATE1
+    if (ee_epfd != -1)
+	event_epoll_update(s, mask0);
+#endif
+    for (e_prev = &ee; *e_prev != e; e_prev = &(*e_prev)->e_next)
+	;
+    *e_prev = e->e_next;
+    _ee_unreg++;
+    free(e);
+    return 0;
+}
+
 /*! Register a callback function to be called on input on a file descriptor.
  *
  * @param[in]  fd  File descriptor
@@ -166,6 +410,8 @@ clicon_sig_ignore_get(void)
  * }
  * clixon_event_reg_fd(fd, fn, (void*)42, "call fn on input on fd");
  * @endcode 
+ * If epoll is available the number of file descriptors is not limited by FD_SETSIZE
+ * @see clixon_event_reg_fd_out
  */
 int
 clixon_event_reg_fd(int   fd, 
@@ -173,22 +419,7 @@ clixon_event_reg_fd(int   fd,
 		    void *arg, 
 		    char *str)
 {
-    struct event_data *e;
-
-    if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
-	clicon_err(OE_EVENTS, errno, "malloc");
-	return -1;
-    }
-    memset(e, 0, sizeof(struct event_data));
-    strncpy(e->e_string, str, EVENT_STRLEN);
-    e->e_fd = fd;
-    e->e_fn = fn;
-    e->e_arg = arg;
-    e->e_type = EVENT_FD;
-    e->e_next = ee;
-    ee = e;
-    clicon_debug(2, "%s, registering %s", __FUNCTION__, e->e_string);
-    return 0;
+    return event_reg_fd(fd, EVENT_FD, fn, arg, str);
 }
 
 /*! Deregister a file descriptor callback
@@ -202,21 +433,96 @@ int
 clixon_event_unreg_fd(int   s, 
 		      int (*fn)(int, void*))
 {
-    struct event_data *e, **e_prev;
-    int found = 0;
+    return event_unreg_fd(s, EVENT_FD, fn);
+}
 
-    e_prev = &ee;
-    for (e = ee; e; e = e->e_next){
-	if (fn == e->e_fn && s == e->e_fd) {
-	    found++;
-	    *e_prev = e->e_next;
-	    _ee_unreg++;
-	    free(e);
+/*! Register a callback function to be called when output is possible on a file descriptor
+ *
+ * Typically registered when a non-blocking write could not write all data, and 
+ * deregistered when the remaining data has been written.
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @see clixon_event_reg_fd
+ */
+int
+clixon_event_reg_fd_out(int   fd, 
+			int (*fn)(int, void*), 
+			void *arg, 
+			char *str)
+{
+    return event_reg_fd(fd, EVENT_FD_OUT, fn, arg, str);
+}
+
+/*! Deregister a file descriptor output callback
+ * @param[in]  s   File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @see clixon_event_reg_fd_out
+ */
+int
+clixon_event_unreg_fd_out(int   s, 
+			  int (*fn)(int, void*))
+{
+    return event_unreg_fd(s, EVENT_FD_OUT, fn);
+}
+
+/*! Timer heap order: earliest time first, and registration order for same time
+ */
+static int
+event_timer_less(struct event_data *e1,
+		 struct event_data *e2)
+{
+    if (timercmp(&e1->e_time, &e2->e_time, !=))
+	return timercmp(&e1->e_time, &e2->e_time, <);
+    return e1->e_seq < e2->e_seq;
+}
+
+/*! Place timer heap element at position i and update its index
+ */
+static void
+event_timer_set(int                i,
+		struct event_data *e)
+{
+    ee_timers[i] = e;
+    e->e_index = i;
+}
+
+/*! Move timer heap element at position i up or down until heap order is restored
+ */
+static void
+event_timer_fix(int i)
+{
+    struct event_data *e = ee_timers[i];
+    int                c;
+
+    while (i > 0 && event_timer_less(e, ee_timers[(i-1)/2])){
+	event_timer_set(i, ee_timers[(i-1)/2]);
+	i = (i-1)/2;
+    }
+    while ((c = 2*i+1) < ee_timers_len){
+	if (c+1 < ee_timers_len && event_timer_less(ee_timers[c+1], ee_timers[c]))
+	    c++;
+	if (!event_timer_less(ee_timers[c], e))
 	    break;
-	}
-	e_prev = &e->e_next;
+	event_timer_set(i, ee_timers[c]);
+	i = c;
     }
-    return found?0:-1;
+    event_timer_set(i, e);
+}
+
+/*! Remove element at position i from timer heap 
+ */
+static struct event_data *
+event_timer_rm(int i)
+{
+    struct event_data *e = ee_timers[i];
+
+    if (--ee_timers_len > i){
+	event_timer_set(i, ee_timers[ee_timers_len]);
+	event_timer_fix(i);
+    }
+    return e;
 }
 
 /*! Call a callback function at an absolute time
@@ -248,8 +554,19 @@ clixon_event_reg_timeout(struct timeval t,
 			 void          *arg, 
 			 char          *str)
 {
-    struct event_data *e, *e1, **e_prev;
-
+    struct event_data  *e;
+    struct event_data **timers;
+    int                 max;
+
+    if (ee_timers_len == ee_timers_max){
+	max = ee_timers_max?2*ee_timers_max:16;
+	if ((timers = realloc(ee_timers, max*sizeof(struct event_data *))) == NULL){
+	    clicon_err(OE_EVENTS, errno, "realloc");
+	    return -1;
+	}
+	ee_timers = timers;
+	ee_timers_max = max;
+    }
     if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
 	clicon_err(OE_EVENTS, errno, "malloc");
 	return -1;
@@ -260,15 +577,10 @@ clixon_event_reg_timeout(struct timeval t,
     e->e_arg = arg;
     e->e_type = EVENT_TIME;
     e->e_time = t;
+    e->e_seq = ee_timers_seq++;
     /* Sort into right place */
-    e_prev = &ee_timers;
-    for (e1=ee_timers; e1; e1=e1->e_next){
-	if (timercmp(&e->e_time, &e1->e_time, <))
-	    break;
-	e_prev = &e1->e_next;
-    }
-    e->e_next = e1;
-    *e_prev = e;
+    ee_timers[ee_timers_len] = e;
+    event_timer_fix(ee_timers_len++);
     clicon_debug(2, "%s: %s", __FUNCTION__, str); 
     return 0;
 }
@@ -286,20 +598,17 @@ int
 clixon_event_unreg_timeout(int (*fn)(int, void*), 
 			   void *arg)
 {
-    struct event_data *e, **e_prev;
-    int found = 0;
+    struct event_data *e = NULL;
+    int                i;
 
-    e_prev = &ee_timers;
-    for (e = ee_timers; e; e = e->e_next){
-	if (fn == e->e_fn && arg == e->e_arg) {
-	    found++;
-	    *e_prev = e->e_next;
+    for (i=0; i<ee_timers_len; i++){
+	if (fn == ee_timers[i]->e_fn && arg == ee_timers[i]->e_arg) {
+	    e = event_timer_rm(i);
 	    free(e);
 	    break;
 	}
-	e_prev = &e->e_next;
     }
-    return found?0:-1;
+    return e?0:-1;
 }
 
 /*! Poll to see if there is any data available on this file descriptor.
@@ -312,19 +621,100 @@ int
 clixon_event_poll(int fd)
 {
     int            retval = -1;
-    fd_set         fdset;
-    struct timeval tnull = {0,};
+    struct pollfd  pfd = {0,};
 
-    FD_ZERO(&fdset);
-    FD_SET(fd, &fdset);
-    if ((retval = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull)) < 0)
-	clicon_err(OE_EVENTS, errno, "select");
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if ((retval = poll(&pfd, 1, 0)) < 0)
+	clicon_err(OE_EVENTS, errno, "poll");
     return retval;
 }
 
+/*! Handle interrupted select or epoll_wait
+ * Signals are checked and are in three classes:
+ * (1) Signals that exit gracefully, the function returns 0
+ *     Must be registered such as by set_signal() of SIGTERM,SIGINT, etc with a handler that calls
+ *     clicon_exit_set().
+ * (2) SIGCHILD Childs that exit(), go through clixon_proc list and cal waitpid
+ *     New select loop is called
+ * (2) Signals are ignored, and the select is rerun, ie handler calls clicon_sig_ignore_get
+ *     New select loop is called
+ * (3) Other signals result in an error and return -1.
+ * @param[in]  h    Clicon handle
+ * @param[in]  op   Name of failed operation for logging
+ * @retval     1    Continue event loop
+ * @retval     0    Exit event loop gracefully
+ * @retval    -1    Error
+ */
+static int
+event_intr(clicon_handle h,
+	   char         *op)
+{
+    if (errno != EINTR){
+	clicon_err(OE_EVENTS, errno, "%s", op);
+	return -1;
+    }
+    clicon_debug(1, "%s %s: %s", __FUNCTION__, op, strerror(errno));
+    if (clicon_exit_get()){
+	clicon_err(OE_EVENTS, errno, "%s", op);
+	return 0;
+    }
+    else if (clicon_sig_child_get()){
+	/* Go through processes and wait for child processes */
+	if (clixon_process_waitpid(h) < 0)
+	    return -1;
+	clicon_sig_child_set(0);
+	return 1;
+    }
+    else if (clicon_sig_ignore_get()){
+	clicon_sig_ignore_set(0);
+	return 1;
+    }
+    clicon_err(OE_EVENTS, errno, "%s", op);
+    return -1;
+}
+
+/*! Call callbacks registered on a ready file descriptor
+ * @param[in]  fd   File descriptor
+ * @param[in]  type EVENT_FD if ready for input or EVENT_FD_OUT if ready for output
+ * @retval     1    OK
+ * @retval     0    A callback deregistered a file descriptor, stop dispatching
+ * @retval    -1    Error in callback
+ */
+static int
+event_dispatch_fd(int fd,
+		  int type)
+{
+    struct event_data *e;
+    struct event_data *e_next;
+
+    if (fd >= ee_fdtab_len)
+	return 1;
+    for (e=ee_fdtab[fd]; e; e=e_next){
+	if (clicon_exit_get())
+	    break;
+	e_next = e->e_fdnext;
+	if (e->e_type != type)
+	    continue;
+	clicon_debug(2, "%s: FD_ISSET: %s", __FUNCTION__, e->e_string);
+	if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
+	    clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
+	    return -1;
+	}
+	if (_ee_unreg){
+	    _ee_unreg = 0;
+	    return 0;
+	}
+    }
+    return 1;
+}
+
 /*! Dispatch file descriptor events (and timeouts) by invoking callbacks.
- * There is an issue with fairness that timeouts may take over all events
- * One could try to poll the file descriptors after a timeout?
+ * Uses epoll if available, otherwise select.
+ * A timeout is called when no file descriptor is ready, or after ready file descriptors
+ * have been dispatched if it has expired, so that timeouts are not starved.
+ * File descriptors that are ready but not dispatched because a callback deregistered a 
+ * file descriptor are reported again in the next iteration.
  * @retval  0  OK
  * @retval -1  Error: eg select, callback, timer, 
  */
@@ -332,98 +722,108 @@ int
 clixon_event_loop(clicon_handle h)
 {
     struct event_data *e;
-    struct event_data *e_next;
     int                n;
+    int                i;
+    int                ret;
     struct timeval     t;
     struct timeval     t0;
     struct timeval     tnull = {0,};
     fd_set             fdset;
+    fd_set             wfdset;
     int                retval = -1;
+#ifdef HAVE_EPOLL_CREATE1
+    struct epoll_event evs[EVENT_EPOLL_MAX];
+    int                ms;
+#endif
 
+    event_epoll_init();
     while (!clicon_exit_get()){
-	FD_ZERO(&fdset);
 	if (clicon_sig_child_get()){
 	    /* Go through processes and wait for child processes */
 	    if (clixon_process_waitpid(h) < 0)
 		goto err;
 	    clicon_sig_child_set(0);
 	}
-	for (e=ee; e; e=e->e_next)
-	    if (e->e_type == EVENT_FD)
-		FD_SET(e->e_fd, &fdset);
-	if (ee_timers != NULL){
+	if (ee_timers_len){
 	    gettimeofday(&t0, NULL);
-	    timersub(&ee_timers->e_time, &t0, &t); 
+	    timersub(&ee_timers[0]->e_time, &t0, &t); 
 	    if (t.tv_sec < 0)
-		n = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull); 
+		t = tnull;
+	}
+#ifdef HAVE_EPOLL_CREATE1
+	if (ee_epfd != -1){
+	    if (ee_timers_len == 0)
+		ms = -1;
+	    else if (t.tv_sec > EVENT_EPOLL_MAXSEC) /* Avoid overflow, wait again after */
+		ms = EVENT_EPOLL_MAXSEC*1000;
 	    else
-		n = select(FD_SETSIZE, &fdset, NULL, NULL, &t); 
+		ms = t.tv_sec*1000 + (t.tv_usec+999)/1000;
+	    n = epoll_wait(ee_epfd, evs, EVENT_EPOLL_MAX, ms);
 	}
 	else
-	    n = select(FD_SETSIZE, &fdset, NULL, NULL, NULL);
+#endif
+	{
+	    FD_ZERO(&fdset);
+	    FD_ZERO(&wfdset);
+	    for (e=ee; e; e=e->e_next)
+		FD_SET(e->e_fd, e->e_type == EVENT_FD_OUT ? &wfdset : &fdset);
+	    n = select(FD_SETSIZE, &fdset, &wfdset, NULL, ee_timers_len?&t:NULL); 
+	}
 	if (clicon_exit_get())
 	    break;
 	if (n == -1) {
-	    if (errno == EINTR){
-		/* Signals are checked and are in three classes:
-		 * (1) Signals that exit gracefully, the function returns 0
-		 *     Must be registered such as by set_signal() of SIGTERM,SIGINT, etc with a handler that calls
-		 *     clicon_exit_set().
-		 * (2) SIGCHILD Childs that exit(), go through clixon_proc list and cal waitpid
-		 *     New select loop is called
-		 * (2) Signals are ignored, and the select is rerun, ie handler calls clicon_sig_ignore_get
-		 *     New select loop is called
-		 * (3) Other signals result in an error and return -1.
-		 */
-		clicon_debug(1, "%s select: %s", __FUNCTION__, strerror(errno));
-		if (clicon_exit_get()){
-		    clicon_err(OE_EVENTS, errno, "select");
-		    retval = 0;
-		}
-		else if (clicon_sig_child_get()){
-		    /* Go through processes and wait for child processes */
-		    if (clixon_process_waitpid(h) < 0)
-			goto err;
-		    clicon_sig_child_set(0);
-		    continue;
-		}
-		else if (clicon_sig_ignore_get()){
-		    clicon_sig_ignore_set(0);
-		    continue;
-		}
-		else
-		    clicon_err(OE_EVENTS, errno, "select");
-	    }
-	    else
-		clicon_err(OE_EVENTS, errno, "select");
-	    goto err;
-	}
-	if (n==0){ /* Timeout */
-	    e = ee_timers;
-	    ee_timers = ee_timers->e_next;
-	    clicon_debug(2, "%s timeout: %s", __FUNCTION__, e->e_string);
-	    if ((*e->e_fn)(0, e->e_arg) < 0){
-		free(e);
+	    if ((ret = event_intr(h, ee_epfd != -1 ? "epoll_wait" : "select")) < 0)
+		goto err;
+	    if (ret == 0){
+		retval = 0;
 		goto err;
 	    }
-	    free(e);
+	    continue;
 	}
 	_ee_unreg = 0;
-	for (e=ee; e; e=e_next){
-	    if (clicon_exit_get())
-		break;
-	    e_next = e->e_next;
-	    if(e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &fdset)){
-		clicon_debug(2, "%s: FD_ISSET: %s", __FUNCTION__, e->e_string);
-		if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
-		    clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
+#ifdef HAVE_EPOLL_CREATE1
+	if (ee_epfd != -1){
+	    for (i=0; i<n; i++){
+		ret = 1;
+		if (evs[i].events & (EPOLLIN|EPOLLHUP|EPOLLERR))
+		    ret = event_dispatch_fd(evs[i].data.fd, EVENT_FD);
+		if (ret == 1 && evs[i].events & (EPOLLOUT|EPOLLHUP|EPOLLERR))
+		    ret = event_dispatch_fd(evs[i].data.fd, EVENT_FD_OUT);
+		if (ret < 0)
 		    goto err;
-
+		if (ret == 0 || clicon_exit_get())
+		    break;
+	    }
+	}
+	else
+#endif
+	{
+	    for (i=0; i<ee_fdtab_len && n > 0; i++){
+		ret = 1;
+		if (FD_ISSET(i, &fdset)){
+		    n--;
+		    ret = event_dispatch_fd(i, EVENT_FD);
 		}
-		if (_ee_unreg){
-		    _ee_unreg = 0;
+		if (ret == 1 && FD_ISSET(i, &wfdset)){
+		    n--;
+		    ret = event_dispatch_fd(i, EVENT_FD_OUT);
+		}
+		if (ret < 0)
+		    goto err;
+		if (ret == 0 || clicon_exit_get())
 		    break;
+	    }
+	}
+	if (ee_timers_len && !clicon_exit_get()){
+	    gettimeofday(&t0, NULL);
+	    if (timercmp(&ee_timers[0]->e_time, &t0, <=)){ /* Timeout */
+		e = event_timer_rm(0);
+		clicon_debug(2, "%s timeout: %s", __FUNCTION__, e->e_string);
+		if ((*e->e_fn)(0, e->e_arg) < 0){
+		    free(e);
+		    goto err;
 		}
+		free(e);
 	    }
 	}
 	continue;
@@ -438,6 +838,7 @@ int
 clixon_event_exit(void)
 {
     struct event_data *e, *e_next;
+    int                i;
     
     e_next = ee;
     while ((e = e_next) != NULL){
@@ -445,11 +846,23 @@ clixon_event_exit(void)
 	free(e);
     }
     ee = NULL;
-    e_next = ee_timers;
-    while ((e = e_next) != NULL){
-	e_next = e->e_next;
-	free(e);
+    if (ee_fdtab){
+	free(ee_fdtab);
+	ee_fdtab = NULL;
+    }
+    ee_fdtab_len = 0;
+    for (i=0; i<ee_timers_len; i++)
+	free(ee_timers[i]);
+    if (ee_timers){
+	free(ee_timers);
+	ee_timers = NULL;
+    }
+    ee_timers_len = 0;
+    ee_timers_max = 0;
+    if (ee_epfd != -1){
+	close(ee_epfd);
+	ee_epfd = -1;
     }
-    ee_timers = NULL;
+    ee_epinit = 0;
     return 0;
 }
@@ -56,6 +56,7 @@
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
@@ -78,6 +79,19 @@
 #include "clixon_options.h"
 #include "clixon_proto.h"
 
+/*
+ * Constants
+ */
+/* Non-blocking message buffers larger than this are freed when empty */
+#define CLICON_MSG_BUF_KEEP (256*1024)
+
+/* Do not raise SIGPIPE when peer has closed socket, get EPIPE instead */
+#ifdef MSG_NOSIGNAL
+#define CLICON_MSG_NOSIGNAL MSG_NOSIGNAL
+#else
+#define CLICON_MSG_NOSIGNAL 0
+#endif
+
 static int _atomicio_sig = 0;
 
 /*! Formats (showas) derived from XML
@@ -134,6 +148,8 @@ format_str2int(char *str)
  * @note if format includes %, they will be expanded according to printf rules.
  *       if this is a problem, use ("%s", xml) instaead of (xml)
  *       Notaly this may an issue of RFC 3896 encoded strings
+ * @note A ("%s", xml) format is copied without printf formatting
+ * @see clicon_msg_send_cbuf  which sends a cbuf without encoding it into a message
  */
 struct clicon_msg *
 clicon_msg_encode(uint32_t      id,
@@ -145,8 +161,15 @@ clicon_msg_encode(uint32_t      id,
     struct clicon_msg *msg = NULL;
     int                hdrlen = sizeof(*msg);
 
+    char              *str = NULL;
+
     va_start(args, format);
-    xmllen = vsnprintf(NULL, 0, format, args) + 1;
+    if (strcmp(format, "%s") == 0){ /* Common case: copy string without formatting */
+	str = va_arg(args, char *);
+	xmllen = strlen(str) + 1;
+    }
+    else
+	xmllen = vsnprintf(NULL, 0, format, args) + 1;
     va_end(args);
 
     len = hdrlen + xmllen;
@@ -154,16 +177,19 @@ clicon_msg_encode(uint32_t      id,
 	clicon_err(OE_PROTO, errno, "malloc");
 	return NULL;
     }
-    memset(msg, 0, len);
+    memset(msg, 0, hdrlen);
     /* hdr */
     msg->op_len = htonl(len);
     msg->op_id = htonl(id);
     
     /* body */
-    va_start(args, format);
-    vsnprintf(msg->op_body, xmllen, format, args);
-    va_end(args);
-
+    if (str)
+	memcpy(msg->op_body, str, xmllen);
+    else{
+	va_start(args, format);
+	vsnprintf(msg->op_body, xmllen, format, args);
+	va_end(args);
+    }
     return msg;
 }
 
@@ -184,13 +210,16 @@ clicon_msg_decode(struct clicon_msg *msg,
 		  cxobj            **xml,
 		  cxobj            **xerr)
 {
-    int    retval = -1;
-    char  *xmlstr;
-    int    ret;
+    int               retval = -1;
+    char             *xmlstr;
+    int               ret;
+    struct clicon_msg hdr;
 
-    /* hdr */
-    if (id)
-	*id = ntohl(msg->op_id);
+    /* hdr, msg may not be aligned, see clicon_msg_buf_get */
+    if (id){
+	memcpy(&hdr, msg, sizeof(hdr));
+	*id = ntohl(hdr.op_id);
+    }
     /* body */
     xmlstr = msg->op_body;
     clicon_debug(1, "%s %s", __FUNCTION__, xmlstr);
@@ -288,6 +317,48 @@ atomicio(ssize_t (*fn) (int, void *, size_t),
     return (pos);
 }
 
+/*! Ensure all of data in an I/O vector is written
+ * @param[in]  fd      File descriptor, eg socket
+ * @param[in]  iov     I/O vector, modified
+ * @param[in]  iovcnt  Number of elements in iov
+ * @retval     n       Number of bytes written
+ * @retval    -1       Error
+ * @see atomicio
+ */
+static ssize_t
+atomicio_writev(int           fd, 
+		struct iovec *iov,
+		int           iovcnt)
+{
+    ssize_t res;
+    ssize_t pos = 0;
+
+    while (iovcnt > 0) {
+	if (iov->iov_len == 0){
+	    iov++;
+	    iovcnt--;
+	    continue;
+	}
+	if ((res = writev(fd, iov, iovcnt)) < 0){
+	    if (errno == EINTR || errno == EAGAIN)
+		continue;
+	    return res;
+	}
+	pos += res;
+	/* Skip what was written */
+	while (iovcnt > 0 && res >= iov->iov_len){
+	    res -= iov->iov_len;
+	    iov++;
+	    iovcnt--;
+	}
+	if (iovcnt > 0){
+	    iov->iov_base = (char*)iov->iov_base + res;
+	    iov->iov_len -= res;
+	}
+    }
+    return pos;
+}
+
 /*! Print message on debug. Log if syslog, stderr if not
  * @param[in]  msg    CLICON msg
  */
@@ -297,13 +368,15 @@ msg_dump(struct clicon_msg *msg)
     int   retval = -1;
     cbuf *cb = NULL;
     int   i;
+    struct clicon_msg hdr;
     
     if ((cb = cbuf_new()) == NULL){
 	clicon_err(OE_CFG, errno, "cbuf_new");
 	goto done;
     }
+    memcpy(&hdr, msg, sizeof(hdr)); /* msg may not be aligned */
     cprintf(cb, "%s:", __FUNCTION__);
-    for (i=0; i<ntohl(msg->op_len); i++){
+    for (i=0; i<ntohl(hdr.op_len); i++){
 	cprintf(cb, "%02x", ((char*)msg)[i]&0xff);
 	if ((i+1)%32==0){
 	    clicon_debug(2, "%s", cbuf_get(cb));
@@ -350,6 +423,117 @@ clicon_msg_send(int                s,
     return retval;
 }
 
+/*! Send header and body of a CLICON message without copying them into a message
+ * @param[in]   s       socket (unix or inet) to communicate with backend
+ * @param[in]   id      Session id
+ * @param[in]   data    Message body
+ * @param[in]   datalen Length of body, including null character if string
+ * @retval      0       OK
+ * @retval     -1       Error
+ */
+static int
+msg_send_data(int      s, 
+	      uint32_t id,
+	      char    *data,
+	      uint32_t datalen)
+{ 
+    int               retval = -1;
+    struct clicon_msg hdr;
+    struct iovec      iov[2];
+    int               e;
+
+    hdr.op_len = htonl(sizeof(hdr) + datalen);
+    hdr.op_id = htonl(id);
+    clicon_debug(2, "%s: send msg len=%d", __FUNCTION__, ntohl(hdr.op_len));
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = data;
+    iov[1].iov_len = datalen;
+    if (atomicio_writev(s, iov, 2) < 0){
+	e = errno;
+	clicon_err(OE_CFG, e, "writev");
+	clicon_log(LOG_WARNING, "%s: write: %s len:%u", __FUNCTION__,
+		   strerror(e), ntohl(hdr.op_len));
+	goto done;
+    }
+    retval = 0;
+  done:
+    return retval;
+}
+
+/*! Send a cbuf as a CLICON message without copying it into a message
+ *
+ * Header and body are written with writev. The body is the string in cb including its
+ * terminating null character.
+ * @param[in]   s      socket (unix or inet) to communicate with backend
+ * @param[in]   id     Session id
+ * @param[in]   cb     Message body
+ * @retval      0      OK
+ * @retval     -1      Error
+ * @see clicon_msg_send
+ */
+int
+clicon_msg_send_cbuf(int      s, 
+		   uint32_t id,
+		   cbuf    *cb)
+{ 
+    return msg_send_data(s, id, cbuf_get(cb), cbuf_len(cb) + 1);
+}
+
+/*! Receive the body of a CLICON message directly into a string
+ *
+ * As clicon_msg_rcv but the body is read directly into a string instead of into a message
+ * @param[in]   s      socket (unix or inet) to communicate with backend
+ * @param[out]  body   Message body as null-terminated string. Free with free()
+ * @param[out]  eof    Set if eof encountered
+ * @retval      0      OK
+ * @retval     -1      Error
+ */
+static int
+clicon_msg_rcv_body(int    s,
+		    char **body,
+		    int   *eof)
+{ 
+    int               retval = -1;
+    struct clicon_msg hdr;
+    int               hlen;
+    uint32_t          blen;
+    char             *b = NULL;
+
+    *eof = 0;
+    if ((hlen = atomicio(read, s, &hdr, sizeof(hdr))) < 0){ 
+	clicon_err(OE_CFG, errno, "atomicio");
+	goto done;
+    }
+    if (hlen == 0){
+	*eof = 1;
+	goto ok;
+    }
+    if (hlen != sizeof(hdr) || ntohl(hdr.op_len) < sizeof(hdr)){
+	clicon_err(OE_CFG, errno, "header too short (%d)", hlen);
+	goto done;
+    }
+    blen = ntohl(hdr.op_len) - sizeof(hdr);
+    clicon_debug(2, "%s: rcv msg len=%d", __FUNCTION__, ntohl(hdr.op_len));
+    if ((b = malloc(blen + 1)) == NULL){
+	clicon_err(OE_CFG, errno, "malloc");
+	goto done;
+    }
+    if (blen && atomicio(read, s, b, blen) != blen){ 
+	clicon_err(OE_CFG, errno, "body too short");
+	goto done;
+    }
+    b[blen] = '\0';
+    *body = b;
+    b = NULL;
+ ok:
+    retval = 0;
+  done:
+    if (b)
+	free(b);
+    return retval;
+}
+
 /*! Receive a CLICON message using IPC message struct
  *
  * XXX: timeout? and signals?
@@ -480,6 +664,310 @@ clicon_msg_rcv1(int   s,
     return retval;
 }
 
+/*! Free data of a non-blocking message buffer
+ * @param[in]  mb   Message buffer, the struct itself is not freed
+ */
+int
+clicon_msg_buf_reset(struct clicon_msg_buf *mb)
+{
+    if (mb->mb_buf)
+	free(mb->mb_buf);
+    memset(mb, 0, sizeof(*mb));
+    return 0;
+}
+
+/*! Number of bytes in a non-blocking message buffer not yet consumed or written
+ * @param[in]  mb   Message buffer
+ * @retval     len  Number of bytes
+ */
+size_t
+clicon_msg_buf_pending(struct clicon_msg_buf *mb)
+{
+    return mb->mb_end - mb->mb_start;
+}
+
+/*! Make room for len more bytes at end of message buffer
+ * Already consumed data at the start of the buffer is reclaimed first
+ */
+static int
+clicon_msg_buf_alloc(struct clicon_msg_buf *mb,
+		     size_t                 len)
+{
+    size_t size;
+    char  *buf;
+    
+    if (mb->mb_start && mb->mb_end + len > mb->mb_size){
+	memmove(mb->mb_buf, mb->mb_buf + mb->mb_start, mb->mb_end - mb->mb_start);
+	mb->mb_end -= mb->mb_start;
+	mb->mb_start = 0;
+    }
+    if (mb->mb_end + len <= mb->mb_size)
+	return 0;
+    size = mb->mb_size?mb->mb_size:BUFSIZ;
+    while (size < mb->mb_end + len)
+	size *= 2;
+    if ((buf = realloc(mb->mb_buf, size)) == NULL){
+	clicon_err(OE_PROTO, errno, "realloc");
+	return -1;
+    }
+    mb->mb_buf = buf;
+    mb->mb_size = size;
+    return 0;
+}
+
+/*! Release memory of an empty message buffer if it has grown large
+ * @param[in]  mb   Message buffer
+ */
+static int
+clicon_msg_buf_shrink(struct clicon_msg_buf *mb)
+{
+    if (mb->mb_start == mb->mb_end){
+	if (mb->mb_size > CLICON_MSG_BUF_KEEP) /* Release memory of large messages */
+	    clicon_msg_buf_reset(mb);
+	else
+	    mb->mb_start = mb->mb_end = 0;
+    }
+    return 0;
+}
+
+/*! Receive available data of CLICON messages on a non-blocking socket
+ *
+ * Reads from the socket into the message buffer until it contains a complete message or
+ * there is no more data to read. Complete messages are then taken from the buffer with
+ * clicon_msg_buf_get. Several messages may be in the buffer.
+ * @param[in]   s      Non-blocking socket
+ * @param[in]   mb     Receive buffer of the socket
+ * @param[out]  eof    Set if eof encountered
+ * @retval      0      OK
+ * @retval     -1      Error
+ * Note: caller must ensure that s is closed if eof is set after call.
+ * @see clicon_msg_rcv  for blocking receive
+ */
+int
+clicon_msg_rcv_nb(int                    s,
+		  struct clicon_msg_buf *mb,
+		  int                   *eof)
+{ 
+    int                retval = -1;
+    struct clicon_msg  hdr;
+    uint32_t           mlen;
+    size_t             avail;
+    size_t             want;
+    ssize_t            n;
+
+    *eof = 0;
+    clicon_msg_buf_shrink(mb); /* Previous message is consumed */
+    while (1){
+	avail = mb->mb_end - mb->mb_start;
+	want = BUFSIZ;
+	if (avail >= sizeof(hdr)){
+	    memcpy(&hdr, mb->mb_buf + mb->mb_start, sizeof(hdr)); /* May not be aligned */
+	    mlen = ntohl(hdr.op_len);
+	    if (mlen < sizeof(hdr)){
+		clicon_err(OE_PROTO, EBADMSG, "Invalid message length: %u", mlen);
+		goto done;
+	    }
+	    if (avail >= mlen)
+		break; /* Complete message */
+	    if (mlen - avail > want)
+		want = mlen - avail;
+	}
+	if (clicon_msg_buf_alloc(mb, want) < 0)
+	    goto done;
+	if ((n = read(s, mb->mb_buf + mb->mb_end, want)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		break;    /* No more data */
+	    if (errno != ECONNRESET){
+		clicon_err(OE_PROTO, errno, "read");
+		goto done;
+	    }
+	    n = 0; /* Connection reset by peer: emulate EOF */
+	}
+	if (n == 0){
+	    *eof = 1;
+	    break;
+	}
+	mb->mb_end += n;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Take a complete CLICON message from a receive buffer
+ *
+ * The message is not copied: msg points into the receive buffer and is valid until the
+ * next call of clicon_msg_buf_get, clicon_msg_rcv_nb or clicon_msg_buf_reset on mb, or
+ * until the buffer itself is freed, eg with its client.
+ * Messages follow each other in the buffer, so msg may not be aligned: read the header
+ * with memcpy, as clicon_msg_decode does, not through msg.
+ * @param[in]   mb     Receive buffer, see clicon_msg_rcv_nb
+ * @param[out]  msg    CLICON msg data structure. Do not free
+ * @retval      1      OK, message in msg
+ * @retval      0      No complete message in buffer
+ * @retval     -1      Error
+ */
+int
+clicon_msg_buf_get(struct clicon_msg_buf *mb,
+		   struct clicon_msg    **msg)
+{ 
+    struct clicon_msg hdr;
+    uint32_t          mlen;
+
+    clicon_msg_buf_shrink(mb); /* Previous message is consumed */
+    if (mb->mb_end - mb->mb_start < sizeof(hdr))
+	return 0;
+    memcpy(&hdr, mb->mb_buf + mb->mb_start, sizeof(hdr));
+    mlen = ntohl(hdr.op_len);
+    if (mlen < sizeof(hdr) || mb->mb_end - mb->mb_start < mlen)
+	return 0;
+    clicon_debug(2, "%s: rcv msg len=%d", __FUNCTION__, mlen);
+    *msg = (struct clicon_msg *)(mb->mb_buf + mb->mb_start);
+    mb->mb_start += mlen;
+    if (clicon_debug_get() > 1)
+	msg_dump(*msg);
+    return 1;
+}
+
+/*! Write data pending in a send buffer to a non-blocking socket
+ * @param[in]  s    Non-blocking socket
+ * @param[in]  mb   Send buffer of the socket
+ * @retval     0    OK, check clicon_msg_buf_pending if all data was written
+ * @retval    -1    Error, errno is set, eg EPIPE if peer closed the socket
+ */
+int
+clicon_msg_flush_nb(int                    s,
+		    struct clicon_msg_buf *mb)
+{
+    ssize_t n;
+    int     e;
+
+    while (mb->mb_start < mb->mb_end){
+	if ((n = send(s, mb->mb_buf + mb->mb_start, mb->mb_end - mb->mb_start,
+		      CLICON_MSG_NOSIGNAL)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		break;
+	    e = errno;
+	    clicon_err(OE_PROTO, e, "send");
+	    errno = e;
+	    return -1;
+	}
+	mb->mb_start += n;
+    }
+    clicon_msg_buf_shrink(mb);
+    return 0;
+}
+
+/*! Send an I/O vector on a non-blocking socket, buffer what cannot be written
+ * @param[in]  s       Non-blocking socket
+ * @param[in]  mb      Send buffer of the socket
+ * @param[in]  iov     I/O vector, modified
+ * @param[in]  iovcnt  Number of elements in iov
+ * @retval     0       OK
+ * @retval    -1       Error, errno is set
+ */
+static int
+msg_send_iov_nb(int                    s,
+		struct clicon_msg_buf *mb,
+		struct iovec          *iov,
+		int                    iovcnt)
+{
+    ssize_t       n = 0;
+    struct msghdr mh = {0,};
+    int           e;
+    int           i;
+
+    if (mb->mb_start == mb->mb_end){
+	mh.msg_iov = iov;
+	mh.msg_iovlen = iovcnt;
+	while ((n = sendmsg(s, &mh, CLICON_MSG_NOSIGNAL)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK){
+		n = 0;
+		break;
+	    }
+	    e = errno;
+	    clicon_err(OE_PROTO, e, "sendmsg");
+	    errno = e;
+	    return -1;
+	}
+    }
+    for (i=0; i<iovcnt; i++){
+	if (n >= iov[i].iov_len){ /* written */
+	    n -= iov[i].iov_len;
+	    continue;
+	}
+	if (clicon_msg_buf_alloc(mb, iov[i].iov_len - n) < 0)
+	    return -1;
+	memcpy(mb->mb_buf + mb->mb_end, (char*)iov[i].iov_base + n, iov[i].iov_len - n);
+	mb->mb_end += iov[i].iov_len - n;
+	n = 0;
+    }
+    return 0;
+}
+
+/*! Send a CLICON message on a non-blocking socket
+ *
+ * As much as possible is written directly to the socket, the rest is appended to the send
+ * buffer. If the send buffer is not empty, the whole message is appended to preserve order.
+ * The caller writes the pending data with clicon_msg_flush_nb when the socket is writable.
+ * @param[in]  s    Non-blocking socket
+ * @param[in]  mb   Send buffer of the socket
+ * @param[in]  msg  CLICON msg data structure
+ * @retval     0    OK, check clicon_msg_buf_pending if all data was written
+ * @retval    -1    Error, errno is set, eg EPIPE if peer closed the socket
+ * @see clicon_msg_send  for blocking send
+ */
+int
+clicon_msg_send_nb(int                    s,
+		   struct clicon_msg_buf *mb,
+		   struct clicon_msg     *msg)
+{
+    struct iovec iov;
+
+    clicon_debug(2, "%s: send msg len=%d", __FUNCTION__, ntohl(msg->op_len));
+    if (clicon_debug_get() > 2)
+	msg_dump(msg);
+    iov.iov_base = msg;
+    iov.iov_len = ntohl(msg->op_len);
+    return msg_send_iov_nb(s, mb, &iov, 1);
+}
+
+/*! Send header and body of a CLICON message on a non-blocking socket without copying
+ * @param[in]  s       Non-blocking socket
+ * @param[in]  mb      Send buffer of the socket
+ * @param[in]  id      Session id
+ * @param[in]  data    Message body
+ * @param[in]  datalen Length of body, including null character if string
+ * @retval     0       OK, check clicon_msg_buf_pending if all data was written
+ * @retval    -1       Error, errno is set, eg EPIPE if peer closed the socket
+ * @see msg_send_data  for blocking send
+ */
+static int
+msg_send_data_nb(int                    s,
+		 struct clicon_msg_buf *mb,
+		 uint32_t               id,
+		 char                  *data,
+		 uint32_t               datalen)
+{
+    struct clicon_msg hdr;
+    struct iovec      iov[2];
+
+    hdr.op_len = htonl(sizeof(hdr) + datalen);
+    hdr.op_id = htonl(id);
+    clicon_debug(2, "%s: send msg len=%d", __FUNCTION__, ntohl(hdr.op_len));
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = data;
+    iov[1].iov_len = datalen;
+    return msg_send_iov_nb(s, mb, iov, 2);
+}
+
 /*! Send a CLICON netconf message plain text
  * @param[in]   s      socket (unix or inet) to communicate with backend
  * @param[out]  msg    CLICON msg data reply structure. Free with free()
@@ -592,6 +1080,39 @@ clicon_rpc_connect_inet(clicon_handle      h,
     return retval;
 }
 
+/*! Receive reply of a clicon rpc
+ * @param[in]  sock    Socket / file descriptor
+ * @param[out] ret     Returned data as string, or NULL
+ * @retval     0       OK
+ * @retval     -1      Error
+ */
+static int
+clicon_rpc_reply(int    sock,
+		 char **ret)
+{
+    int   retval = -1;
+    int   eof;
+    char *data = NULL;
+
+    if (clicon_msg_rcv_body(sock, &data, &eof) < 0)
+	goto done;
+    if (eof){
+	clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
+	close(sock); /* assume socket */
+	errno = ESHUTDOWN;
+	goto done;
+    }
+    if (ret){
+	*ret = data;
+	data = NULL;
+    }
+    retval = 0;
+  done:
+    if (data)
+	free(data);
+    return retval;
+}
+
 /*! Send a clicon_msg message and wait for result.
  *
  * TBD: timeout, interrupt?
@@ -604,6 +1125,7 @@ clicon_rpc_connect_inet(clicon_handle      h,
  * @param[out] xret    Returned data as netconf xml tree.
  * @retval     0       OK
  * @retval     -1      Error
+ * @see clicon_rpc_cbuf
  */
 int
 clicon_rpc(int                sock,
@@ -611,30 +1133,40 @@ clicon_rpc(int                sock,
 	   char             **ret)
 {
     int                retval = -1;
-    struct clicon_msg *reply = NULL;
-    int                eof;
-    char              *data = NULL;
 
     if (clicon_msg_send(sock, msg) < 0)
 	goto done;
-    if (clicon_msg_rcv(sock, &reply, &eof) < 0)
+    if (clicon_rpc_reply(sock, ret) < 0)
 	goto done;
-    if (eof){
-	clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
-	close(sock); /* assume socket */
-	errno = ESHUTDOWN;
+    retval = 0;
+  done:
+    return retval;
+}
+
+/*! Send a cbuf as clicon_msg message and wait for result, without copying the cbuf
+ *
+ * @param[in]  sock    Socket / file descriptor
+ * @param[in]  id      Session id
+ * @param[in]  cb      Message body
+ * @param[out] xret    Returned data as netconf xml tree.
+ * @retval     0       OK
+ * @retval     -1      Error
+ * @see clicon_rpc
+ */
+int
+clicon_rpc_cbuf(int       sock,
+	      uint32_t  id,
+	      cbuf     *cb,
+	      char    **ret)
+{
+    int                retval = -1;
+
+    if (clicon_msg_send_cbuf(sock, id, cb) < 0)
+	goto done;
+    if (clicon_rpc_reply(sock, ret) < 0)
 	goto done;
-    }
-    data = reply->op_body; /* assume string */
-    if (ret && data)
-	if ((*ret = strdup(data)) == NULL){
-	    clicon_err(OE_UNIX, errno, "strdup");
-	    goto done;
-	}
     retval = 0;
   done:
-    if (reply)
-	free(reply);
     return retval;
 }
 
@@ -684,56 +1216,74 @@ clicon_rpc1(int   sock,
  * @param[in]  datalen Length of returned data XXX  may be unecessary if always string?
  * @retval     0       OK
  * @retval     -1      Error
+ * @note Header and data are written without copying them into a message
  */
 int 
 send_msg_reply(int      s, 
 	       char    *data, 
 	       uint32_t datalen)
 {
-    int                retval = -1;
-    struct clicon_msg *reply = NULL;
-    uint32_t           len;
-
-    len = sizeof(*reply) + datalen;
-    if ((reply = (struct clicon_msg *)malloc(len)) == NULL)
-	goto done;
-    memset(reply, 0, len);
-    reply->op_len = htonl(len);
-    if (datalen > 0)
-      memcpy(reply->op_body, data, datalen);
-    if (clicon_msg_send(s, reply) < 0)
-	goto done;
-    retval = 0;
-  done:
-    if (reply)
-	free(reply);
-    return retval;
+    return msg_send_data(s, 0, data, datalen);
 }
 
-/*! Send a clicon_msg NOTIFY message asynchronously to client
+/*! Send a clicon_msg message as reply to a clicon rpc request on a non-blocking socket
  *
- * @param[in]  s       Socket to communicate with client
- * @param[in]  level
- * @param[in]  event
- * @retval     0       OK
+ * @param[in]  s       Non-blocking socket to communicate with client
+ * @param[in]  mb      Send buffer of socket
+ * @param[in]  data    Returned data as byte-string.
+ * @param[in]  datalen Length of returned data
+ * @retval     0       OK, check clicon_msg_buf_pending if all data was written
  * @retval     -1      Error
- * @see send_msg_notify_xml
+ * @note Header and data are written without copying them into a message
+ * @see clicon_msg_send_nb
+ */
+int 
+send_msg_reply_nb(int                    s, 
+		  struct clicon_msg_buf *mb,
+		  char                  *data, 
+		  uint32_t               datalen)
+{
+    return msg_send_data_nb(s, mb, 0, data, datalen);
+}
+
+/*! Send a clicon_msg NOTIFY message given as XML
+ * @param[in]  s       Socket to communicate with client
+ * @param[in]  mb      Send buffer if non-blocking socket, or NULL
+ * @param[in]  xev     Event as XML
+ * @param[in]  cbev    Event as XML text, or NULL to serialize xev
  */
 static int
-send_msg_notify(int           s, 
-		char         *event)
+send_msg_notify_xml1(int                    s,
+		     struct clicon_msg_buf *mb,
+		     cxobj                 *xev,
+		     cbuf                  *cbev)
 {
     int                retval = -1;
-    struct clicon_msg *msg = NULL;
+    cbuf              *cb;
+    cbuf              *cb1 = NULL; /* Local serialization, not shared */
+    int                e;
 
-    if ((msg=clicon_msg_encode(0, "%s", event)) == NULL)
-	goto done;
-    if (clicon_msg_send(s, msg) < 0)
+    if ((cb = cbev) == NULL){
+	if ((cb1 = cbuf_new()) == NULL){
+	    clicon_err(OE_PLUGIN, errno, "cbuf_new");
+	    goto done;
+	}
+	if (clicon_xml2cbuf(cb1, xev, 0, 0, -1) < 0)
+	    goto done;
+	cb = cb1;
+    }
+    if (mb){
+	if (msg_send_data_nb(s, mb, 0, cbuf_get(cb), cbuf_len(cb)+1) < 0)
+	    goto done;
+    }
+    else if (clicon_msg_send_cbuf(s, 0, cb) < 0)
 	goto done;
     retval = 0;
   done:
-    if (msg)
-	free(msg);
+    e = errno;
+    if (cb1)
+	cbuf_free(cb1);
+    errno = e;
     return retval;
 }
 
@@ -744,29 +1294,36 @@ send_msg_notify(int           s,
  * @param[in]  xev     Event as XML
  * @retval     0       OK
  * @retval     -1      Error
- * @see send_msg_notify XXX beauty contest
+ * @see send_msg_notify_xml_nb
  */
 int
 send_msg_notify_xml(clicon_handle h,
 		    int           s, 
 		    cxobj        *xev)
 {
-    int                retval = -1;
-    cbuf              *cb = NULL;
+    return send_msg_notify_xml1(s, NULL, xev, NULL);
+}
 
-    if ((cb = cbuf_new()) == NULL){
-	clicon_err(OE_PLUGIN, errno, "cbuf_new");
-	goto done;
-    }
-    if (clicon_xml2cbuf(cb, xev, 0, 0, -1) < 0)
-	goto done;
-    if (send_msg_notify(s, cbuf_get(cb)) < 0)
-	goto done;
-    retval = 0;
-  done:
-    if (cb)
-	cbuf_free(cb);
-    return retval;
+/*! Send a clicon_msg NOTIFY message asynchronously to client on a non-blocking socket
+ *
+ * @param[in]  h       Clicon handle
+ * @param[in]  s       Non-blocking socket to communicate with client
+ * @param[in]  mb      Send buffer of socket
+ * @param[in]  xev     Event as XML
+ * @param[in]  cbev    Event as XML text, or NULL to serialize xev
+ * @retval     0       OK, check clicon_msg_buf_pending if all data was written
+ * @retval     -1      Error
+ * @note If the event is sent to several clients, serialize it once and give it as cbev
+ * @see clicon_msg_send_nb
+ */
+int
+send_msg_notify_xml_nb(clicon_handle          h,
+		       int                    s,
+		       struct clicon_msg_buf *mb,
+		       cxobj                 *xev,
+		       cbuf                  *cbev)
+{
+    return send_msg_notify_xml1(s, mb, xev, cbev);
 }
 
 /*! Look for a text pattern in an input string, one char at a time
@@ -127,36 +127,44 @@ clicon_rpc_connect(clicon_handle h,
     return retval;
 }
     
-/*! Send internal netconf rpc from client to backend
+/*! Send internal netconf rpc from client to backend, given as message or as cbuf
  * @param[in]    h      CLICON handle
- * @param[in]    msg    Encoded message. Deallocate with free
+ * @param[in]    msg    Encoded message, or NULL
+ * @param[in]    id     Session id, if msg is NULL
+ * @param[in]    cb     Message body, if msg is NULL
  * @param[out]   xret0  Return value from backend as xml tree. Free w xml_free
- * @note xret is populated with yangspec according to standard handle yangspec
- * @note side-effect, a socket created here is cached
- * @see clicon_rpc_msg_persistent
- * @see clicon_rpc_close_session
+ * @see clicon_rpc_msg
+ * @see clicon_rpc_msg_cbuf
  */
-int
-clicon_rpc_msg(clicon_handle      h, 
-	       struct clicon_msg *msg, 
-	       cxobj            **xret0)
+static int
+clicon_rpc_msg1(clicon_handle      h, 
+		struct clicon_msg *msg, 
+		uint32_t           id,
+		cbuf              *cb,
+		cxobj            **xret0)
 {
     int     retval = -1;
     char   *retdata = NULL;
     cxobj  *xret = NULL;
     int     s = -1;
+    char   *body;
 
+    body = msg?msg->op_body:cbuf_get(cb);
 #ifdef RPC_USERNAME_ASSERT
-    assert(strstr(msg->op_body, "username")!=NULL); /* XXX */
+    assert(strstr(body, "username")!=NULL); /* XXX */
 #endif
-    clicon_debug(1, "%s request:%s", __FUNCTION__, msg->op_body);
+    clicon_debug(1, "%s request:%s", __FUNCTION__, body);
     /* Create a socket and connect to it, either UNIX, IPv4 or IPv6 per config options */
     if ((s = clicon_client_socket_get(h)) < 0){
 	if (clicon_rpc_connect(h, &s) < 0)
 	    goto done;
 	clicon_client_socket_set(h, s);
     }
-    if (clicon_rpc(s, msg, &retdata) < 0)
+    if (msg){
+	if (clicon_rpc(s, msg, &retdata) < 0)
+	    goto done;
+    }
+    else if (clicon_rpc_cbuf(s, id, cb, &retdata) < 0)
 	goto done;
 
     clicon_debug(1, "%s retdata:%s", __FUNCTION__, retdata);
@@ -185,6 +193,40 @@ clicon_rpc_msg(clicon_handle      h,
     return retval;
 }
 
+/*! Send internal netconf rpc from client to backend
+ * @param[in]    h      CLICON handle
+ * @param[in]    msg    Encoded message. Deallocate with free
+ * @param[out]   xret0  Return value from backend as xml tree. Free w xml_free
+ * @note xret is populated with yangspec according to standard handle yangspec
+ * @note side-effect, a socket created here is cached
+ * @see clicon_rpc_msg_persistent
+ * @see clicon_rpc_close_session
+ */
+int
+clicon_rpc_msg(clicon_handle      h, 
+	       struct clicon_msg *msg, 
+	       cxobj            **xret0)
+{
+    return clicon_rpc_msg1(h, msg, 0, NULL, xret0);
+}
+
+/*! Send internal netconf rpc from client to backend given as cbuf
+ * As clicon_rpc_msg but the request is sent directly from cb without encoding a message
+ * @param[in]    h      CLICON handle
+ * @param[in]    id     Session id
+ * @param[in]    cb     Request as XML string
+ * @param[out]   xret0  Return value from backend as xml tree. Free w xml_free
+ * @see clicon_rpc_msg
+ */
+int
+clicon_rpc_msg_cbuf(clicon_handle h, 
+		  uint32_t      id,
+		  cbuf         *cb,
+		  cxobj       **xret0)
+{
+    return clicon_rpc_msg1(h, NULL, id, cb, xret0);
+}
+
 /*! Send internal netconf rpc from client to backend and return a persistent socket
  * @param[in]   h      CLICON handle
  * @param[in]   msg    Encoded message. Deallocate with free
@@ -431,7 +473,6 @@ clicon_rpc_get_config(clicon_handle h,
 		      cxobj       **xt)
 {
     int                retval = -1;
-    struct clicon_msg *msg = NULL;
     cbuf              *cb = NULL;
     cxobj             *xret = NULL;
     cxobj             *xerr = NULL;    
@@ -461,9 +502,7 @@ clicon_rpc_get_config(clicon_handle h,
 	cprintf(cb, "/>");
     }
     cprintf(cb, "</get-config></rpc>");
-    if ((msg = clicon_msg_encode(session_id, "%s", cbuf_get(cb))) == NULL)
-	goto done;
-    if (clicon_rpc_msg(h, msg, &xret) < 0)
+    if (clicon_rpc_msg_cbuf(h, session_id, cb, &xret) < 0)
 	goto done;
     /* Send xml error back: first check error, then ok */
     if ((xd = xpath_first(xret, NULL, "/rpc-reply/rpc-error")) != NULL)
@@ -500,8 +539,6 @@ clicon_rpc_get_config(clicon_handle h,
 	xml_free(xerr);
     if (xret)
 	xml_free(xret);
-    if (msg)
-	free(msg);
     return retval;
 }
 
@@ -526,7 +563,6 @@ clicon_rpc_edit_config(clicon_handle       h,
 		       char               *xmlstr)
 {
     int                retval = -1;
-    struct clicon_msg *msg = NULL;
     cbuf              *cb = NULL;
     cxobj             *xret = NULL;
     cxobj             *xerr;
@@ -547,9 +583,7 @@ clicon_rpc_edit_config(clicon_handle       h,
     if (xmlstr)
 	cprintf(cb, "%s", xmlstr);
     cprintf(cb, "</edit-config></rpc>");
-    if ((msg = clicon_msg_encode(session_id, "%s", cbuf_get(cb))) == NULL)
-	goto done;
-    if (clicon_rpc_msg(h, msg, &xret) < 0)
+    if (clicon_rpc_msg_cbuf(h, session_id, cb, &xret) < 0)
 	goto done;
     if ((xerr = xpath_first(xret, NULL, "//rpc-error")) != NULL){
 	clixon_netconf_error(xerr, "Editing configuration", NULL);
@@ -561,8 +595,6 @@ clicon_rpc_edit_config(clicon_handle       h,
 	xml_free(xret);
     if (cb)
 	cbuf_free(cb);
-    if (msg)
-	free(msg);
     return retval;
 }
 
@@ -786,7 +818,6 @@ clicon_rpc_get(clicon_handle   h,
 	       cxobj         **xt)
 {
     int                retval = -1;
-    struct clicon_msg *msg = NULL;
     cbuf              *cb = NULL;
     cxobj             *xret = NULL;
     cxobj             *xerr = NULL;
@@ -822,10 +853,7 @@ clicon_rpc_get(clicon_handle   h,
 	cprintf(cb, "/>");
     }
     cprintf(cb, "</get></rpc>");
-    if ((msg = clicon_msg_encode(session_id,
-				 "%s", cbuf_get(cb))) == NULL)
-	goto done;
-    if (clicon_rpc_msg(h, msg, &xret) < 0)
+    if (clicon_rpc_msg_cbuf(h, session_id, cb, &xret) < 0)
 	goto done;
     /* Send xml error back: first check error, then ok */
     if ((xd = xpath_first(xret, NULL, "/rpc-reply/rpc-error")) != NULL)
@@ -862,8 +890,6 @@ clicon_rpc_get(clicon_handle   h,
 	xml_free(xerr);
     if (xret)
 	xml_free(xret);
-    if (msg)
-	free(msg);
     return retval;
 }
 
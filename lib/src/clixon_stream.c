@@ -85,6 +85,7 @@
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_stream.h"
+#include "clixon_stream_replay.h"
 
 /* Go through and timeout subscription timers [s] */
 #define STREAM_TIMER_TIMEOUT_S 5
@@ -127,9 +128,11 @@ stream_add(clicon_handle   h,
 	   struct timeval *retention) 
 {
     int             retval = -1;
-    event_stream_t *es;
+    event_stream_t *es = NULL;
+    char           *dir;
+    int             size;
 
-    if ((es = stream_find(h, name)) != NULL)
+    if (stream_find(h, name) != NULL)
 	goto ok;
     if ((es = malloc(sizeof(event_stream_t))) == NULL){
 	clicon_err(OE_XML, errno, "malloc");
@@ -147,10 +150,26 @@ stream_add(clicon_handle   h,
     es->es_replay_enabled = replay_enabled;
     if (retention)
 	es->es_retention = *retention;
+    /* Replay buffer on disk */
+    if (replay_enabled &&
+	(dir = clicon_option_str(h, "CLICON_STREAM_REPLAY_DIR")) != NULL){
+	if ((size = clicon_option_int(h, "CLICON_STREAM_REPLAY_SIZE")) < 0)
+	    size = 0;
+	if (stream_replay_log_open(dir, name, size, &es->es_replay_log) < 0)
+	    goto done;
+    }
     clicon_stream_append(h, es);
+    es = NULL;
  ok:
     retval = 0;
  done:
+    if (es){
+	if (es->es_name)
+	    free(es->es_name);
+	if (es->es_description)
+	    free(es->es_description);
+	free(es);
+    }
     return retval;
 }
 
@@ -182,6 +201,8 @@ stream_delete_all(clicon_handle h,
 		xml_free(r->r_xml);
 	    free(r);
 	}
+	if (es->es_replay_log)
+	    stream_replay_log_close(es->es_replay_log);
 	free(es);
     }
     return 0;
@@ -276,7 +297,12 @@ stream_timer_setup(int   fd,
 			ss = NEXTQ(struct stream_subscription *, ss);
 		} while (ss && ss != es->es_subscription);
   /* 2) Go throughreplay buffer and remove entries with passed retention time */
-	    if (timerisset(&es->es_retention) &&
+	    if (timerisset(&es->es_retention) && es->es_replay_log){
+		timersub(&now, &es->es_retention, &tret);
+		if (stream_replay_log_expire(es->es_replay_log, &tret) < 0)
+		    goto done;
+	    }
+	    else if (timerisset(&es->es_retention) &&
 		(r = es->es_replay) != NULL){
 		timersub(&now, &es->es_retention, &tret);
 		do {
@@ -318,6 +344,224 @@ stream_del()
 }
 #endif
 
+/*! Get event element name of a simple path filter, eg "event" in "/ex:event[ex:severity='major']"
+ *
+ * The filter is evaluated with the <notification> as context and root node, so the 
+ * first child step of a relative or absolute location path must match an element 
+ * child of the notification.
+ * @param[in]  xs    Parsed xpath
+ * @retval     name  Name of the first step, matching events must have such a child
+ * @retval     NULL  Not a simple path, all events need to be evaluated
+ */
+static char *
+stream_filter_top(xpath_tree *xs)
+{
+    /* Skip single child expression nodes down to the location path */
+    while (xs && xs->xs_c1 == NULL &&
+	   (xs->xs_type == XP_EXP || xs->xs_type == XP_AND ||
+	    xs->xs_type == XP_RELEX || xs->xs_type == XP_ADD ||
+	    xs->xs_type == XP_UNION || xs->xs_type == XP_PATHEXPR ||
+	    xs->xs_type == XP_LOCPATH))
+	xs = xs->xs_c0;
+    if (xs == NULL)
+	return NULL;
+    if (xs->xs_type == XP_ABSPATH && xs->xs_int == A_ROOT)
+	xs = xs->xs_c0;
+    /* First step is leftmost in the relative location path */
+    while (xs && xs->xs_type == XP_RELLOCPATH && xs->xs_c1 != NULL)
+	xs = xs->xs_c0;
+    if (xs == NULL || xs->xs_type != XP_RELLOCPATH)
+	return NULL;
+    xs = xs->xs_c0;
+    if (xs == NULL || xs->xs_type != XP_STEP || xs->xs_int != A_CHILD)
+	return NULL;
+    xs = xs->xs_c0;
+    if (xs == NULL || xs->xs_type != XP_NODE)
+	return NULL;
+    return xs->xs_s1; /* NULL if wildcard */
+}
+
+/*! Get parsed subscription filter of a stream, create it if not found
+ * @param[in]  es     Event stream
+ * @param[in]  xpath  Filter selector - xpath
+ * @retval     sf     Filter, with reference count incremented
+ * @retval     NULL   Error
+ * @see stream_filter_put
+ */
+static struct stream_filter *
+stream_filter_get(event_stream_t *es,
+		  char           *xpath)
+{
+    struct stream_filter *sf;
+
+    if ((sf = es->es_filters) != NULL)
+	do {
+	    if (strcmp(sf->sf_xpath, xpath) == 0){
+		sf->sf_refcnt++;
+		return sf;
+	    }
+	    sf = NEXTQ(struct stream_filter *, sf);
+	} while (sf && sf != es->es_filters);
+    if ((sf = malloc(sizeof(*sf))) == NULL){
+	clicon_err(OE_CFG, errno, "malloc");
+	return NULL;
+    }
+    memset(sf, 0, sizeof(*sf));
+    if ((sf->sf_xpath = strdup(xpath)) == NULL){
+	clicon_err(OE_CFG, errno, "strdup");
+	free(sf);
+	return NULL;
+    }
+    /* An invalid filter is kept but never matches, as when parsed at every event */
+    if (xpath_parse(xpath, &sf->sf_xptree) < 0)
+	sf->sf_xptree = NULL;
+    else
+	sf->sf_top = stream_filter_top(sf->sf_xptree);
+    sf->sf_refcnt = 1;
+    sf->sf_match = -1;
+    ADDQ(sf, es->es_filters);
+    return sf;
+}
+
+/*! Release subscription filter, free it when no subscription uses it
+ * @param[in]  es     Event stream
+ * @param[in]  sf     Filter
+ * @see stream_filter_get
+ */
+static void
+stream_filter_put(event_stream_t       *es,
+		  struct stream_filter *sf)
+{
+    if (--sf->sf_refcnt > 0)
+	return;
+    DELQ(sf, es->es_filters, struct stream_filter *);
+    if (sf->sf_xptree)
+	xpath_tree_free(sf->sf_xptree); /* sf_top points into the tree */
+    free(sf->sf_xpath);
+    free(sf);
+}
+
+/*! Match event against subscription filter, evaluate once per event and filter
+ * @param[in]  sf     Filter
+ * @param[in]  xevent Notification as xml tree
+ * @retval     1      Match
+ * @retval     0      No match, or evaluation error
+ * @note sf_match must be reset to -1 before each new event
+ */
+static int
+stream_filter_match(struct stream_filter *sf,
+		    cxobj                *xevent)
+{
+    xp_ctx *xr = NULL;
+
+    if (sf->sf_match != -1)
+	return sf->sf_match;
+    sf->sf_match = 0;
+    if (sf->sf_xptree == NULL)
+	return 0;
+    /* Skip evaluation of a simple path if the event has no such element */
+    if (sf->sf_top && xml_find_type(xevent, NULL, sf->sf_top, CX_ELMNT) == NULL)
+	return 0;
+    if (xpath_vec_ctx_tree(xevent, NULL, sf->sf_xptree, 0, &xr) == 0 &&
+	xr && xr->xc_type == XT_NODESET && xr->xc_size)
+	sf->sf_match = 1;
+    if (xr)
+	ctx_free(xr);
+    return sf->sf_match;
+}
+
+static int stream_replay_add1(event_stream_t *es, struct timeval *tv, cxobj *xv, cbuf *cb);
+
+/* Event distributed to subscribers and its serialized form */
+struct stream_event{
+    cxobj *se_xml;    /* Event, valid while it is distributed */
+    cbuf  *se_cb;     /* Event as XML text, created by first subscriber that needs it */
+    int    se_refcnt; /* Number of references, see stream_event_ref */
+};
+
+/*! Create shared event with one reference, for distribution to subscribers
+ * @param[in]  xevent  Event as XML
+ * @retval     se      Shared event. Free with stream_event_free
+ * @retval     NULL    Error
+ */
+static struct stream_event *
+stream_event_new(cxobj *xevent)
+{
+    struct stream_event *se;
+
+    if ((se = malloc(sizeof(*se))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(se, 0, sizeof(*se));
+    se->se_xml = xevent;
+    se->se_refcnt = 1;
+    return se;
+}
+
+/*! Get serialized XML of an event distributed to subscribers
+ *
+ * The event is serialized once on first call and the same text is then given to all
+ * subscribers, instead of every subscriber serializing it again.
+ * @param[in]  se      Shared event given to subscription callback, or NULL
+ * @retval     cb      Event as XML text. Valid while se is referenced, do not free
+ * @retval     NULL    se is NULL or error, serialize the event yourself
+ * @see stream_notify1
+ */
+cbuf *
+stream_event_cbuf(struct stream_event *se)
+{
+    if (se == NULL)
+	return NULL;
+    if (se->se_cb == NULL){
+	if (se->se_xml == NULL)
+	    return NULL;
+	if ((se->se_cb = cbuf_new()) == NULL){
+	    clicon_err(OE_XML, errno, "cbuf_new");
+	    return NULL;
+	}
+	if (clicon_xml2cbuf(se->se_cb, se->se_xml, 0, 0, -1) < 0){
+	    cbuf_free(se->se_cb);
+	    se->se_cb = NULL;
+	    return NULL;
+	}
+    }
+    return se->se_cb;
+}
+
+/*! Keep a shared event after the subscription callback returns
+ *
+ * The event is serialized since its XML is not kept
+ * @param[in]  se      Shared event given to subscription callback
+ * @retval     se      Same event with one more reference. Free with stream_event_free
+ * @retval     NULL    Error
+ */
+struct stream_event *
+stream_event_ref(struct stream_event *se)
+{
+    if (stream_event_cbuf(se) == NULL)
+	return NULL;
+    se->se_refcnt++;
+    return se;
+}
+
+/*! Release a reference of a shared event, free it when there are no references
+ * @param[in]  se      Shared event
+ * @retval     0       OK
+ */
+int
+stream_event_free(struct stream_event *se)
+{
+    if (--se->se_refcnt > 0){
+	se->se_xml = NULL; /* Only valid during distribution */
+	return 0;
+    }
+    if (se->se_cb)
+	cbuf_free(se->se_cb);
+    free(se);
+    return 0;
+}
+
 /*! Add an event notification callback to a stream given a callback function
  * @param[in]  h        Clicon handle
  * @param[in]  stream   Name of stream
@@ -363,13 +607,21 @@ stream_ss_add(clicon_handle     h,
 	clicon_err(OE_CFG, errno, "strdup");
 	goto done;
     }
+    if (xpath && strlen(xpath) &&
+	(ss->ss_filter = stream_filter_get(es, xpath)) == NULL)
+	goto done;
     ss->ss_fn     = fn;
     ss->ss_arg    = arg;
     ADDQ(ss, es->es_subscription);
     return ss;
   done:
-    if (ss)
+    if (ss){
+	if (ss->ss_stream)
+	    free(ss->ss_stream);
+	if (ss->ss_xpath)
+	    free(ss->ss_xpath);
 	free(ss);
+    }
     return NULL;
 }
 
@@ -389,8 +641,12 @@ stream_ss_rm(clicon_handle                h,
 {
     clicon_debug(1, "%s", __FUNCTION__);
     DELQ(ss, es->es_subscription, struct stream_subscription *);
+    if (ss->ss_filter){
+	stream_filter_put(es, ss->ss_filter);
+	ss->ss_filter = NULL;
+    }
     /* Remove from upper layers - close socket etc. */
-    (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
+    (*ss->ss_fn)(h, 1, NULL, NULL, ss->ss_arg);
     if (force){
 	if (ss->ss_stream)
 	    free(ss->ss_stream);
@@ -483,10 +739,11 @@ stream_ss_delete(clicon_handle     h,
 }
 
 /*! Stream notify event and distribute to all registered callbacks
+ * Also add the event to the replay of the stream, if enabled
  * @param[in]  h       Clicon handle
  * @param[in]  stream  Name of event stream. CLICON is predefined as LOG stream
  * @param[in]  tv      Timestamp. Dont notify if subscription has stoptime<tv
- * @param[in]  event   Notification as xml tree
+ * @param[in]  event   Notification as xml tree, consumed on success if replay enabled
  * @retval  0  OK
  * @retval -1  Error with clicon_err called
  * @see stream_notify
@@ -500,8 +757,19 @@ stream_notify1(clicon_handle   h,
 {
     int                         retval = -1;
     struct stream_subscription *ss;
-    
+    struct stream_filter       *sf;
+    struct stream_event        *se;
+
     clicon_debug(2, "%s", __FUNCTION__);
+    /* Event is serialized at most once for all subscribers, see stream_event_cbuf */
+    if ((se = stream_event_new(xevent)) == NULL)
+	goto done;
+    /* Filtersare evaluated at most once per event */
+    if ((sf = es->es_filters) != NULL)
+	do {
+	    sf->sf_match = -1;
+	    sf = NEXTQ(struct stream_filter *, sf);
+	} while (sf && sf != es->es_filters);
     /* Go thru all subscriptions and find matches */
     if ((ss = es->es_subscription) != NULL)
 	do {
@@ -515,16 +783,22 @@ stream_notify1(clicon_handle   h,
 		ss = ss1;
 	    }
 	    else{  /* xpath match */
-		if (ss->ss_xpath == NULL ||
-		    strlen(ss->ss_xpath)==0 ||
-		    xpath_first(xevent, NULL, "%s", ss->ss_xpath) != NULL)
-		    if ((*ss->ss_fn)(h, 0, xevent, ss->ss_arg) < 0)
+		if (ss->ss_filter == NULL ||
+		    stream_filter_match(ss->ss_filter, xevent) == 1)
+		    if ((*ss->ss_fn)(h, 0, xevent, se, ss->ss_arg) < 0)
 			goto done;
 		ss = NEXTQ(struct stream_subscription *, ss);
 	    }
 	} while (es->es_subscription && ss != es->es_subscription);
+    /* Replay log stores the serialized text given to subscribers */
+    if (es->es_replay_enabled &&
+	stream_replay_add1(es, tv, xevent,
+			   es->es_replay_log?stream_event_cbuf(se):NULL) < 0)
+	goto done;
     retval = 0;
   done:
+    if (se)
+	stream_event_free(se);
     return retval;
 }
 
@@ -592,11 +866,8 @@ stream_notify(clicon_handle h,
 	goto done;
     if (stream_notify1(h, es, &tv, xev) < 0)
 	goto done;
-    if (es->es_replay_enabled){
-	if (stream_replay_add(es, &tv, xev) < 0)
-	    goto done;
+    if (es->es_replay_enabled)
 	xev = NULL; /* xml stored in replay_add and should not be freed */
-    }
  ok:
     retval = 0;
   done:
@@ -661,11 +932,8 @@ stream_notify_xml(clicon_handle h,
 	goto done;
     if (stream_notify1(h, es, &tv, xev) < 0)
 	goto done;
-    if (es->es_replay_enabled){
-	if (stream_replay_add(es, &tv, xev) < 0)
-	    goto done;
+    if (es->es_replay_enabled)
 	xev = NULL; /* xml stored in replay_add and should not be freed */
-    }
  ok:
     retval = 0;
   done:
@@ -717,6 +985,13 @@ stream_replay_notify(clicon_handle               h,
 	goto ok;
     if (!es->es_replay_enabled)
 	goto ok;
+    if (es->es_replay_log){
+	if (stream_replay_log_notify(h, es->es_replay_log,
+				     &ss->ss_starttime, &ss->ss_stoptime,
+				     ss->ss_fn, ss->ss_arg) < 0)
+	    goto done;
+	goto ok;
+    }
     /* Get replay linked list */
     if ((r = es->es_replay) == NULL)
 	goto ok;
@@ -733,7 +1008,7 @@ stream_replay_notify(clicon_handle               h,
 	if (timerisset(&ss->ss_stoptime) &&
 	    timercmp(&r->r_tv, &ss->ss_stoptime, >))
 	    break;
-	if ((*ss->ss_fn)(h, 0, r->r_xml, ss->ss_arg) < 0)
+	if ((*ss->ss_fn)(h, 0, r->r_xml, NULL, ss->ss_arg) < 0)
 	    goto done;
 	r = NEXTQ(struct stream_replay *, r);
     } while (r && r!=es->es_replay);
@@ -746,16 +1021,33 @@ stream_replay_notify(clicon_handle               h,
 /*! Add replay sample to stream with timestamp
  * @param[in] es   Stream
  * @param[in] tv   Timestamp
- * @param[in] xv   XML
+ * @param[in] xv   XML, consumed on success
  */
 int
 stream_replay_add(event_stream_t *es,
 		  struct timeval *tv,
 		  cxobj          *xv)
+{
+    return stream_replay_add1(es, tv, xv, NULL);
+}
+
+/*! Add replay sample to stream with timestamp and serialized XML
+ * @param[in] es   Stream
+ * @param[in] tv   Timestamp
+ * @param[in] xv   XML, consumed on success
+ * @param[in] cb   XML as text, or NULL. Used by replay log instead of serializing xv
+ */
+static int
+stream_replay_add1(event_stream_t *es,
+		   struct timeval *tv,
+		   cxobj          *xv,
+		   cbuf           *cb)
 {
     int                   retval = -1;
     struct stream_replay *new;
 
+    if (es->es_replay_log)
+	return stream_replay_log_add(es->es_replay_log, tv, xv, cb);
     if ((new = malloc(sizeof *new)) == NULL){
 	clicon_err(OE_UNIX, errno, "malloc");
 	goto done;
@@ -956,14 +1248,16 @@ url_post(char *url,
  * @param[in]  h     Clicon handle
  * @param[in]  op    Operation: 0 OK, 1 Close
  * @param[in]  event Event as XML
+ * @param[in]  se    Shared event, or NULL
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
  */
-static int 
-stream_publish_cb(clicon_handle h, 
-		  int           op,
-		  cxobj        *event,
-		  void         *arg)
+static int
+stream_publish_cb(clicon_handle        h,
+		  int                  op,
+		  cxobj               *event,
+		  struct stream_event *se,
+		  void                *arg)
 {
     int   retval = -1;
     cbuf *u = NULL; /* stream pub (push) url */
@@ -0,0 +1,693 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Disk-backed stream replay log
+ * Used instead of the in-memory replay list of a stream when CLICON_STREAM_REPLAY_DIR
+ * is set. Notifications are stored serialized as XML in a sequence of segment files
+ * <dir>/<stream>.<nr>, each a sequence of records:
+ *   record  ::= <sec:uint64> <usec:uint32> <len:uint32> <len bytes of XML>
+ * in host byte order. A new segment is started when the current gets larger than the
+ * segment size. Retention (time or total size) drops whole segments from the front.
+ * An in-memory index of timestamp and file offset of every record is kept sorted
+ * on time, so the start of a replay is found with binary search.
+ * Existing segments are read back when a log is opened, so that replay covers
+ * notifications from before a restart.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_queue.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_xml_io.h"
+#include "clixon_stream.h"
+#include "clixon_stream_replay.h"
+
+#define REPLAY_SEGMENT_SIZE (1024*1024) /* Segment size if no max size of log */
+#define REPLAY_SEGMENTS     8           /* Segments of log if max size is set */
+
+/* Record header on disk */
+struct replay_hdr{
+    uint64_t rh_sec;
+    uint32_t rh_usec;
+    uint32_t rh_len;  /* Length of XML following header */
+};
+
+/* Index entry of a record */
+struct replay_rec{
+    struct timeval rr_tv;  /* Timestamp of notification */
+    uint32_t       rr_seg; /* Segment number */
+    uint32_t       rr_len; /* Length of XML */
+    off_t          rr_off; /* Offset of XML in segment file */
+};
+
+/* Segment file */
+struct replay_seg{
+    uint32_t sg_nr;   /* Segment number, file is <path>.<nr> */
+    size_t   sg_size; /* File size */
+};
+
+struct stream_replay_log{
+    char              *rl_path;    /* Segment file prefix: <dir>/<stream> */
+    size_t             rl_maxsize; /* Max total size of segments, 0 is no limit */
+    size_t             rl_segsize; /* Start new segment when larger than this */
+    size_t             rl_size;    /* Total size of segments */
+    struct replay_seg *rl_segs;    /* Segments, oldest first. Last is written to */
+    int                rl_nsegs;   /* Length of rl_segs */
+    int                rl_fd;      /* Open file of last segment, or -1 */
+    struct replay_rec *rl_recs;    /* Index of records, sorted on time */
+    size_t             rl_first;   /* First record not expired */
+    size_t             rl_len;     /* Length of rl_recs */
+    size_t             rl_alloc;   /* Allocated length of rl_recs */
+    int                rl_replays; /* Replays in progress, see replay_rec_compact */
+};
+
+/*! Get file name of a segment
+ */
+static int
+replay_seg_path(struct stream_replay_log *rl,
+		uint32_t                  nr,
+		cbuf                     *cb)
+{
+    cbuf_reset(cb);
+    cprintf(cb, "%s.%u", rl->rl_path, nr);
+    return 0;
+}
+
+/*! Append a record to the index
+ * @note Records are never moved here, only in replay_rec_compact, so that index
+ * positions stay valid while a replay is in progress
+ */
+static int
+replay_rec_add(struct stream_replay_log *rl,
+	       struct replay_rec        *rec)
+{
+    struct replay_rec *recs;
+    size_t             alloc;
+
+    if (rl->rl_len == rl->rl_alloc){
+	alloc = rl->rl_alloc ? 2*rl->rl_alloc : 64;
+	if ((recs = realloc(rl->rl_recs, alloc*sizeof(*recs))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+	rl->rl_recs = recs;
+	rl->rl_alloc = alloc;
+    }
+    rl->rl_recs[rl->rl_len++] = *rec;
+    return 0;
+}
+
+/*! Remove expired records from the front of the index
+ * Not while a replay is in progress, since it iterates over index positions
+ */
+static void
+replay_rec_compact(struct stream_replay_log *rl)
+{
+    if (rl->rl_first == 0 || rl->rl_replays)
+	return;
+    memmove(rl->rl_recs, rl->rl_recs + rl->rl_first,
+	    (rl->rl_len - rl->rl_first)*sizeof(*rl->rl_recs));
+    rl->rl_len -= rl->rl_first;
+    rl->rl_first = 0;
+}
+
+/*! Binary search for first record not earlier than a time
+ * @param[in]  rl   Replay log
+ * @param[in]  tv   Time
+ * @retval     i    Index of first record with timestamp >= tv, or rl_len if none
+ */
+static size_t
+replay_rec_find(struct stream_replay_log *rl,
+		struct timeval           *tv)
+{
+    size_t lo = rl->rl_first;
+    size_t hi = rl->rl_len;
+    size_t mid;
+
+    while (lo < hi){
+	mid = lo + (hi - lo)/2;
+	if (timercmp(&rl->rl_recs[mid].rr_tv, tv, <))
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+/*! Start a new segment and make it the one written to
+ */
+static int
+replay_seg_new(struct stream_replay_log *rl)
+{
+    int                retval = -1;
+    struct replay_seg *segs;
+    uint32_t           nr;
+    cbuf              *cb = NULL;
+    int                fd;
+
+    nr = rl->rl_nsegs ? rl->rl_segs[rl->rl_nsegs-1].sg_nr + 1 : 0;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    replay_seg_path(rl, nr, cb);
+    if ((fd = open(cbuf_get(cb), O_WRONLY|O_CREAT|O_TRUNC|O_APPEND, S_IRUSR|S_IWUSR)) < 0){
+	clicon_err(OE_UNIX, errno, "open(%s)", cbuf_get(cb));
+	goto done;
+    }
+    if ((segs = realloc(rl->rl_segs, (rl->rl_nsegs+1)*sizeof(*segs))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	close(fd);
+	goto done;
+    }
+    rl->rl_segs = segs;
+    rl->rl_segs[rl->rl_nsegs].sg_nr = nr;
+    rl->rl_segs[rl->rl_nsegs].sg_size = 0;
+    rl->rl_nsegs++;
+    if (rl->rl_fd != -1)
+	close(rl->rl_fd);
+    rl->rl_fd = fd;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Remove oldest segment and its records
+ * @note the segment written to (the last) is never removed
+ */
+static int
+replay_seg_drop(struct stream_replay_log *rl)
+{
+    int                retval = -1;
+    struct replay_seg *sg;
+    cbuf              *cb = NULL;
+
+    if (rl->rl_nsegs < 2)
+	goto ok;
+    sg = &rl->rl_segs[0];
+    while (rl->rl_first < rl->rl_len &&
+	   rl->rl_recs[rl->rl_first].rr_seg == sg->sg_nr)
+	rl->rl_first++;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    replay_seg_path(rl, sg->sg_nr, cb);
+    if (unlink(cbuf_get(cb)) < 0 && errno != ENOENT){
+	clicon_err(OE_UNIX, errno, "unlink(%s)", cbuf_get(cb));
+	goto done;
+    }
+    rl->rl_size -= sg->sg_size;
+    rl->rl_nsegs--;
+    memmove(rl->rl_segs, rl->rl_segs + 1, rl->rl_nsegs*sizeof(*rl->rl_segs));
+ ok:
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Read records of an existing segment into the index
+ *
+ * A partially written record at the end of the file, eg after a crash, is truncated.
+ * @param[in]  rl    Replay log
+ * @param[in]  nr    Segment number
+ */
+static int
+replay_seg_read(struct stream_replay_log *rl,
+		uint32_t                  nr)
+{
+    int                retval = -1;
+    struct replay_seg *segs;
+    struct replay_hdr  hdr;
+    struct replay_rec  rec;
+    struct stat        st;
+    cbuf              *cb = NULL;
+    off_t              off = 0;
+    int                fd = -1;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    replay_seg_path(rl, nr, cb);
+    if ((fd = open(cbuf_get(cb), O_RDWR)) < 0){
+	clicon_err(OE_UNIX, errno, "open(%s)", cbuf_get(cb));
+	goto done;
+    }
+    if (fstat(fd, &st) < 0){
+	clicon_err(OE_UNIX, errno, "fstat");
+	goto done;
+    }
+    while (off + sizeof(hdr) <= st.st_size){
+	if (pread(fd, &hdr, sizeof(hdr), off) != sizeof(hdr)){
+	    clicon_err(OE_UNIX, errno, "pread(%s)", cbuf_get(cb));
+	    goto done;
+	}
+	if (off + sizeof(hdr) + hdr.rh_len > st.st_size)
+	    break;
+	memset(&rec, 0, sizeof(rec));
+	rec.rr_tv.tv_sec = hdr.rh_sec;
+	rec.rr_tv.tv_usec = hdr.rh_usec;
+	rec.rr_seg = nr;
+	rec.rr_len = hdr.rh_len;
+	rec.rr_off = off + sizeof(hdr);
+	if (replay_rec_add(rl, &rec) < 0)
+	    goto done;
+	off += sizeof(hdr) + hdr.rh_len;
+    }
+    if (off < st.st_size){
+	clicon_log(LOG_WARNING, "%s: truncating %s at %lu",
+		   __FUNCTION__, cbuf_get(cb), (unsigned long)off);
+	if (ftruncate(fd, off) < 0){
+	    clicon_err(OE_UNIX, errno, "ftruncate(%s)", cbuf_get(cb));
+	    goto done;
+	}
+    }
+    if ((segs = realloc(rl->rl_segs, (rl->rl_nsegs+1)*sizeof(*segs))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	goto done;
+    }
+    rl->rl_segs = segs;
+    rl->rl_segs[rl->rl_nsegs].sg_nr = nr;
+    rl->rl_segs[rl->rl_nsegs].sg_size = off;
+    rl->rl_nsegs++;
+    rl->rl_size += off;
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+static int
+replay_nr_cmp(const void *a,
+	      const void *b)
+{
+    uint32_t na = *(uint32_t*)a;
+    uint32_t nb = *(uint32_t*)b;
+
+    return na < nb ? -1 : na > nb;
+}
+
+/*! Read existing segments of a stream in a directory
+ * @param[in]  rl     Replay log
+ * @param[in]  dir    Directory
+ * @param[in]  stream Name of stream
+ */
+static int
+replay_log_recover(struct stream_replay_log *rl,
+		   const char               *dir,
+		   const char               *stream)
+{
+    int            retval = -1;
+    DIR           *dp = NULL;
+    struct dirent *de;
+    uint32_t      *nrs = NULL;
+    uint32_t      *nrs1;
+    size_t         nlen = 0;
+    size_t         len;
+    size_t         i;
+    char          *p;
+    char          *ep;
+    unsigned long  nr;
+
+    if ((dp = opendir(dir)) == NULL){
+	clicon_err(OE_UNIX, errno, "opendir(%s)", dir);
+	goto done;
+    }
+    len = strlen(stream);
+    while ((de = readdir(dp)) != NULL){
+	if (strncmp(de->d_name, stream, len) != 0 || de->d_name[len] != '.')
+	    continue;
+	p = de->d_name + len + 1;
+	if (*p == '\0')
+	    continue;
+	errno = 0;
+	nr = strtoul(p, &ep, 10);
+	if (*ep != '\0' || errno != 0 || nr > UINT32_MAX)
+	    continue;
+	if ((nrs1 = realloc(nrs, (nlen+1)*sizeof(*nrs))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    goto done;
+	}
+	nrs = nrs1;
+	nrs[nlen++] = nr;
+    }
+    if (nlen)
+	qsort(nrs, nlen, sizeof(*nrs), replay_nr_cmp);
+    for (i=0; i<nlen; i++)
+	if (replay_seg_read(rl, nrs[i]) < 0)
+	    goto done;
+    retval = 0;
+ done:
+    if (nrs)
+	free(nrs);
+    if (dp)
+	closedir(dp);
+    return retval;
+}
+
+/*! Open replay log of a stream, read existing segments and prepare for writing
+ *
+ * The stream name is used as file name in dir, a name that is empty, contains '/' or
+ * begins with '.' is rejected so that segment files cannot be outside of dir.
+ * @param[in]  dir     Directory of segment files
+ * @param[in]  stream  Name of stream
+ * @param[in]  maxsize Max total size of segments in bytes, 0 means no limit
+ * @param[out] rlp     Replay log, free with stream_replay_log_close
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+stream_replay_log_open(const char                *dir,
+		       const char                *stream,
+		       size_t                     maxsize,
+		       struct stream_replay_log **rlp)
+{
+    int                       retval = -1;
+    struct stream_replay_log *rl = NULL;
+    cbuf                     *cb = NULL;
+
+    if (*stream == '\0' || *stream == '.' || strchr(stream, '/') != NULL){
+	clicon_err(OE_CFG, EINVAL, "Invalid stream name for replay file in %s: \"%s\"",
+		   dir, stream);
+	goto done;
+    }
+    if ((rl = malloc(sizeof(*rl))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(rl, 0, sizeof(*rl));
+    rl->rl_fd = -1;
+    rl->rl_maxsize = maxsize;
+    if (maxsize)
+	rl->rl_segsize = maxsize/REPLAY_SEGMENTS;
+    else
+	rl->rl_segsize = REPLAY_SEGMENT_SIZE;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "%s/%s", dir, stream);
+    if ((rl->rl_path = strdup(cbuf_get(cb))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if (replay_log_recover(rl, dir, stream) < 0)
+	goto done;
+    /* Continue writing last segment */
+    if (rl->rl_nsegs){
+	replay_seg_path(rl, rl->rl_segs[rl->rl_nsegs-1].sg_nr, cb);
+	if ((rl->rl_fd = open(cbuf_get(cb), O_WRONLY|O_APPEND)) < 0){
+	    clicon_err(OE_UNIX, errno, "open(%s)", cbuf_get(cb));
+	    goto done;
+	}
+    }
+    else if (replay_seg_new(rl) < 0)
+	goto done;
+    *rlp = rl;
+    rl = NULL;
+    retval = 0;
+ done:
+    if (rl)
+	stream_replay_log_close(rl);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Close replay log, segment files are kept
+ * @param[in]  rl     Replay log
+ */
+int
+stream_replay_log_close(struct stream_replay_log *rl)
+{
+    if (rl->rl_fd != -1)
+	close(rl->rl_fd);
+    if (rl->rl_path)
+	free(rl->rl_path);
+    if (rl->rl_segs)
+	free(rl->rl_segs);
+    if (rl->rl_recs)
+	free(rl->rl_recs);
+    free(rl);
+    return 0;
+}
+
+/*! Append notification to replay log
+ * @param[in]  rl     Replay log
+ * @param[in]  tv     Timestamp, not earlier than the last added
+ * @param[in]  xv     Notification as XML. Freed on success
+ * @param[in]  cbxv   Notification as XML text, or NULL to serialize xv
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+stream_replay_log_add(struct stream_replay_log *rl,
+		      struct timeval           *tv,
+		      cxobj                    *xv,
+		      cbuf                     *cbxv)
+{
+    int                retval = -1;
+    cbuf              *cb;
+    cbuf              *cb1 = NULL;
+    struct replay_hdr  hdr;
+    struct replay_rec  rec;
+    struct replay_seg *sg;
+    struct iovec       iov[2];
+    size_t             len;
+    ssize_t            n;
+
+    /* Use the text of the event serialized for its subscribers, if any */
+    if ((cb = cbxv) == NULL){
+	if ((cb1 = cbuf_new()) == NULL){
+	    clicon_err(OE_UNIX, errno, "cbuf_new");
+	    goto done;
+	}
+	if (clicon_xml2cbuf(cb1, xv, 0, 0, -1) < 0)
+	    goto done;
+	cb = cb1;
+    }
+    sg = &rl->rl_segs[rl->rl_nsegs-1];
+    if (sg->sg_size &&
+	sg->sg_size + sizeof(hdr) + cbuf_len(cb) > rl->rl_segsize){
+	if (replay_seg_new(rl) < 0)
+	    goto done;
+	sg = &rl->rl_segs[rl->rl_nsegs-1];
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.rh_sec = tv->tv_sec;
+    hdr.rh_usec = tv->tv_usec;
+    hdr.rh_len = cbuf_len(cb);
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = cbuf_get(cb);
+    iov[1].iov_len = cbuf_len(cb);
+    len = sizeof(hdr) + cbuf_len(cb);
+    memset(&rec, 0, sizeof(rec));
+    rec.rr_tv = *tv;
+    rec.rr_seg = sg->sg_nr;
+    rec.rr_len = hdr.rh_len;
+    rec.rr_off = sg->sg_size + sizeof(hdr);
+    if (replay_rec_add(rl, &rec) < 0)
+	goto done;
+    if ((n = writev(rl->rl_fd, iov, 2)) < 0 || (size_t)n != len){
+	if (n < 0)
+	    clicon_err(OE_UNIX, errno, "writev %s.%u", rl->rl_path, sg->sg_nr);
+	else
+	    clicon_err(OE_UNIX, 0, "writev %s.%u: short write", rl->rl_path, sg->sg_nr);
+	/* Remove partial record so that offsets of following records are right */
+	rl->rl_len--;
+	if (ftruncate(rl->rl_fd, sg->sg_size) < 0)
+	    clicon_log(LOG_WARNING, "%s: ftruncate %s.%u: %s", __FUNCTION__,
+		       rl->rl_path, sg->sg_nr, strerror(errno));
+	goto done;
+    }
+    sg->sg_size += len;
+    rl->rl_size += len;
+    /* Size retention */
+    while (rl->rl_maxsize && rl->rl_size > rl->rl_maxsize && rl->rl_nsegs > 1)
+	if (replay_seg_drop(rl) < 0)
+	    goto done;
+    replay_rec_compact(rl);
+    xml_free(xv);
+    retval = 0;
+ done:
+    if (cb1)
+	cbuf_free(cb1);
+    return retval;
+}
+
+/*! Expire records of replay log earlier than a time
+ *
+ * Expired records are not replayed, and segments with only expired records are removed
+ * @param[in]  rl     Replay log
+ * @param[in]  tv     Expire records with timestamps earlier than this
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+stream_replay_log_expire(struct stream_replay_log *rl,
+			 struct timeval           *tv)
+{
+    rl->rl_first = replay_rec_find(rl, tv);
+    while (rl->rl_nsegs > 1 &&
+	   (rl->rl_first == rl->rl_len ||
+	    rl->rl_segs[0].sg_nr < rl->rl_recs[rl->rl_first].rr_seg))
+	if (replay_seg_drop(rl) < 0)
+	    return -1;
+    replay_rec_compact(rl);
+    return 0;
+}
+
+/*! Replay notifications of replay log between start and stop time
+ * @param[in]  h      Clicon handle
+ * @param[in]  rl     Replay log
+ * @param[in]  start  Replay from this time
+ * @param[in]  stop   Replay until this time, if set
+ * @param[in]  fn     Subscription callback
+ * @param[in]  arg    Callback argument
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @note Notifications added during the replay, eg from the callback, are not replayed
+ */
+int
+stream_replay_log_notify(clicon_handle             h,
+			 struct stream_replay_log *rl,
+			 struct timeval           *start,
+			 struct timeval           *stop,
+			 stream_fn_t               fn,
+			 void                     *arg)
+{
+    int                retval = -1;
+    struct replay_rec  rec;
+    size_t             i;
+    size_t             n;
+    cbuf              *cb = NULL;
+    char              *buf = NULL;
+    char              *buf1;
+    size_t             buflen = 0;
+    int                fd = -1;
+    uint32_t           nr = 0;
+    cxobj             *xt = NULL;
+
+    rl->rl_replays++;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    n = rl->rl_len;
+    for (i = replay_rec_find(rl, start); i < n; i++){
+	/* Records may be dropped by size retention in the callback */
+	if (i < rl->rl_first && (i = rl->rl_first) >= n)
+	    break;
+	rec = rl->rl_recs[i];
+	if (timerisset(stop) && timercmp(&rec.rr_tv, stop, >))
+	    break;
+	if (fd == -1 || nr != rec.rr_seg){
+	    if (fd != -1)
+		close(fd);
+	    nr = rec.rr_seg;
+	    replay_seg_path(rl, nr, cb);
+	    if ((fd = open(cbuf_get(cb), O_RDONLY)) < 0){
+		clicon_err(OE_UNIX, errno, "open(%s)", cbuf_get(cb));
+		goto done;
+	    }
+	}
+	if (rec.rr_len + 1 > buflen){
+	    if ((buf1 = realloc(buf, rec.rr_len + 1)) == NULL){
+		clicon_err(OE_UNIX, errno, "realloc");
+		goto done;
+	    }
+	    buf = buf1;
+	    buflen = rec.rr_len + 1;
+	}
+	if (pread(fd, buf, rec.rr_len, rec.rr_off) != rec.rr_len){
+	    clicon_err(OE_UNIX, errno, "pread(%s)", cbuf_get(cb));
+	    goto done;
+	}
+	buf[rec.rr_len] = '\0';
+	if (clixon_xml_parse_string(buf, YB_NONE, NULL, &xt, NULL) < 0)
+	    goto done;
+	if (xml_rootchild(xt, 0, &xt) < 0)
+	    goto done;
+	if ((*fn)(h, 0, xt, NULL, arg) < 0)
+	    goto done;
+	xml_free(xt);
+	xt = NULL;
+    }
+    retval = 0;
+ done:
+    if (xt)
+	xml_free(xt);
+    if (fd != -1)
+	close(fd);
+    if (buf)
+	free(buf);
+    if (cb)
+	cbuf_free(cb);
+    rl->rl_replays--;
+    return retval;
+}
@@ -71,15 +71,122 @@
 #include "clixon_xml.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_options.h"
+#include "clixon_data.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_xml_io.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
+#include "clixon_xpath_function.h"
 #include "clixon_yang_module.h"
 #include "clixon_yang_type.h"
 #include "clixon_xml_map.h"
 #include "clixon_validate.h"
 
+/* Index of the target values of a leafref path, see leafref_index_get */
+struct leafref_index{
+    qelem_t     li_qelem;  /* List header */
+    cxobj      *li_xtop;   /* Top of XML tree */
+    yang_stmt  *li_ypath;  /* Leafref path statement */
+    yang_stmt  *li_ymod;   /* Module of referring leaf if path is in typedef, else NULL */
+    char      **li_vec;    /* Sorted target values, pointers into XML tree */
+    size_t      li_len;    /* Length of li_vec */
+};
+
+/* Leafref target indexes of a validation, see xml_yang_validate_all_top */
+static struct leafref_index *_leafref_index = NULL;
+static int                   _leafref_index_on = 0; /* Index is used during validation */
+
+static int
+leafref_index_cmp(const void *a,
+		  const void *b)
+{
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+/*! Free all leafref target indexes
+ */
+static void
+leafref_index_free(void)
+{
+    struct leafref_index *li;
+
+    while ((li = _leafref_index) != NULL){
+	DELQ(li, _leafref_index, struct leafref_index *);
+	if (li->li_vec)
+	    free(li->li_vec);
+	free(li);
+    }
+}
+
+/*! Get index of the target values of a leafref path, build it if not found
+ *
+ * Only a path that evaluates to the same nodes from all context nodes can be indexed, 
+ * ie an absolute path that does not use current(). 
+ * The index is valid during a validation of an unchanged XML tree.
+ * @param[in]  xt    XML leaf node of type leafref
+ * @param[in]  ypath Yang leafref path statement
+ * @param[in]  ymod  Module of leaf if path is in typedef (nsc depends on it), else NULL
+ * @param[in]  nsc   Namespace context of path
+ * @param[in]  xpc   Compiled path
+ * @retval     li    Leafref index
+ * @retval     NULL  Error
+ */
+static struct leafref_index *
+leafref_index_get(cxobj          *xt,
+		  yang_stmt      *ypath,
+		  yang_stmt      *ymod,
+		  cvec           *nsc,
+		  xpath_compiled *xpc)
+{
+    struct leafref_index *li;
+    struct leafref_index *li0 = NULL;
+    cxobj               **xvec = NULL;
+    size_t                xlen = 0;
+    size_t                i;
+    char                 *body;
+    cxobj                *xtop;
+
+    xtop = xml_root(xt);
+    if ((li = _leafref_index) != NULL)
+	do {
+	    if (li->li_ypath == ypath && li->li_ymod == ymod && li->li_xtop == xtop)
+		goto ok;
+	    li = NEXTQ(struct leafref_index *, li);
+	} while (li != _leafref_index);
+    if ((li0 = malloc(sizeof(*li0))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(li0, 0, sizeof(*li0));
+    li0->li_xtop = xtop;
+    li0->li_ypath = ypath;
+    li0->li_ymod = ymod;
+    if (xpath_vec_compiled(xt, nsc, xpc, &xvec, &xlen) < 0)
+	goto done;
+    if (xlen && (li0->li_vec = calloc(xlen, sizeof(char*))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    for (i=0; i<xlen; i++)
+	if ((body = xml_body(xvec[i])) != NULL)
+	    li0->li_vec[li0->li_len++] = body;
+    qsort(li0->li_vec, li0->li_len, sizeof(char*), leafref_index_cmp);
+    INSQ(li0, _leafref_index);
+    li = li0;
+    li0 = NULL;
+ ok:
+ done:
+    if (li0){
+	if (li0->li_vec)
+	    free(li0->li_vec);
+	free(li0);
+	li = NULL;
+    }
+    if (xvec)
+	free(xvec);
+    return li;
+}
+
 /*! Validate xml node of type leafref, ensure the value is one of that path's reference
  * @param[in]  xt    XML leaf node of type leafref
  * @param[in]  ys    Yang spec of leaf
@@ -96,6 +203,8 @@
  *      references the typedef. (ie ys)
  *   o  Otherwise, the context node is the node in the data tree for which
  *      the "path" statement is defined. (ie yc)
+ * During xml_yang_validate_all_top, target values of an absolute path are looked up
+ * in an index built once, instead of evaluating the path for each leaf.
  */
 static int
 validate_leafref(cxobj     *xt,
@@ -113,8 +222,12 @@ validate_leafref(cxobj     *xt,
     char        *leafrefbody;
     char        *leafbody;
     cvec        *nsc = NULL;
+    cvec        *nsc1 = NULL;
     cbuf        *cberr = NULL;
     char        *path;
+    xpath_compiled *xpc;
+    yang_stmt   *ymod = NULL;
+    struct leafref_index *li;
     
     if ((leafrefbody = xml_body(xt)) == NULL)
 	goto ok;
@@ -123,17 +236,26 @@ validate_leafref(cxobj     *xt,
 	    goto done;
 	goto fail;
     }
+    /* Path is compiled with namespace context of ytype */
+    if (yang_xpath_get(ypath, &xpc, &nsc) < 0)
+	goto done;
     /* See comment^: If path is defined in typedef or not */
     if ((yp = yang_parent_get(ytype)) != NULL &&
 	yang_keyword_get(yp) == Y_TYPEDEF){
-	if (xml_nsctx_yang(ys, &nsc) < 0)
+	if (xml_nsctx_yang(ys, &nsc1) < 0)
 	    goto done;
+	nsc = nsc1;
+	ymod = ys_module(ys);
     }
-    else
-	if (xml_nsctx_yang(ytype, &nsc) < 0)
-	    goto done;
     path = yang_argument_get(ypath);
-    if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, path) < 0) 
+    if (_leafref_index_on && path[0] == '/' && strstr(path, "current(") == NULL){
+	if ((li = leafref_index_get(xt, ypath, ymod, nsc, xpc)) == NULL)
+	    goto done;
+	if (bsearch(&leafrefbody, li->li_vec, li->li_len, sizeof(char*), leafref_index_cmp) == NULL)
+	    goto nomatch;
+	goto ok;
+    }
+    if (xpath_vec_compiled(xt, nsc, xpc, &xvec, &xlen) < 0) 
 	goto done;
     for (i = 0; i < xlen; i++) {
 	x = xvec[i];
@@ -143,6 +265,7 @@ validate_leafref(cxobj     *xt,
 	    break;
     }
     if (i==xlen){
+    nomatch:
 	if ((cberr = cbuf_new()) == NULL){
 	    clicon_err(OE_UNIX, errno, "cbuf_new");
 	    goto done;
@@ -157,8 +280,8 @@ validate_leafref(cxobj     *xt,
  done:
     if (cberr)
 	cbuf_free(cberr);
-    if (nsc)
-	xml_nsctx_free(nsc);
+    if (nsc1)
+	xml_nsctx_free(nsc1);
     if (xvec)
 	free(xvec);
     return retval;
@@ -1109,6 +1232,134 @@ xml_yang_validate_list_key_only(cxobj        *xt,
     goto done;
 }
 
+/*! Validate the constraints of a single XML node, not its children
+ *
+ * Leafref, identityref, must and when (also augmented when) of the yang spec of xt
+ * @param[in]  xt    XML node to be validated
+ * @param[in]  ys    Yang spec of xt
+ * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all  which also validates children and list constraints
+ */
+static int
+xml_yang_validate_node(cxobj     *xt,
+		       yang_stmt *ys,
+		       cxobj    **xret)
+{
+    int        retval = -1;
+    yang_stmt *yc;  /* yang child */
+    yang_stmt *ye;  /* yang must error-message */
+    char      *xpath;
+    int        nr;
+    int        ret;
+    cbuf      *cb = NULL;
+    cvec      *nsc = NULL;
+    xpath_compiled *xpc;
+
+    /* Node-specific validation */
+    switch (yang_keyword_get(ys)){
+    case Y_ANYXML:
+    case Y_ANYDATA:
+	goto ok;
+	break;
+    case Y_LEAF:
+	/* fall thru */
+    case Y_LEAF_LIST:
+	/* Special case if leaf is leafref, then first check against
+	   current xml tree
+	*/
+	/* Get base type yc */
+	if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
+	    goto done;
+	if (strcmp(yang_argument_get(yc), "leafref") == 0){
+	    if ((ret = validate_leafref(xt, ys, yc, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	    }
+	else if (strcmp(yang_argument_get(yc), "identityref") == 0){
+	    if ((ret = validate_identityref(xt, ys, yc, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	break;
+    default:
+	break;
+    }
+    /* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
+     * XXX. use yang path instead? */
+    yc = NULL;
+    while ((yc = yn_each(ys, yc)) != NULL) {
+	if (yang_keyword_get(yc) != Y_MUST)
+	    continue;
+	/* "must" has xpath argument, compiled with namespace context of must */
+	if (yang_xpath_get(yc, &xpc, &nsc) < 0)
+	    goto done;
+	if ((nr = xpath_vec_bool_compiled(xt, nsc, xpc)) < 0)
+	    goto done;
+	if (!nr){
+	    ye = yang_find(yc, Y_ERROR_MESSAGE, NULL);
+	    if (netconf_operation_failed_xml(xret, "application", 
+					     ye?yang_argument_get(ye):"must xpath validation failed") < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+    /* "when" sub-node RFC 7950 Sec 7.21.5. Can only be one. */
+    if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL){
+	/* "when" has xpath argument, compiled with namespace context of ys */
+	if (yang_xpath_get(yc, &xpc, &nsc) < 0)
+	    goto done;
+	if ((nr = xpath_vec_bool_compiled(xt, nsc, xpc)) < 0)
+	    goto done;
+	if (nr == 0){
+	    if ((cb = cbuf_new()) == NULL){
+		clicon_err(OE_UNIX, errno, "cbuf_new");
+		goto done;
+	    }
+	    cprintf(cb, "Failed WHEN condition of %s in module %s",
+		    xml_name(xt),
+		    yang_argument_get(ys_module(ys)));
+	    if (netconf_operation_failed_xml(xret, "application", 
+					     cbuf_get(cb)) < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+    /* Augmented when using special struct. */
+    if ((xpath = yang_when_xpath_get(ys)) != NULL){
+	if ((nr = xpath_vec_bool(xml_parent(xt), yang_when_nsc_get(ys),
+				 "%s", xpath)) < 0)
+	    goto done;
+	if (nr == 0){
+	    if ((cb = cbuf_new()) == NULL){
+		clicon_err(OE_UNIX, errno, "cbuf_new");
+		goto done;
+	    }
+	    cprintf(cb, "Failed augmented WHEN condition %s of node %s in module %s",
+		    xpath,
+		    xml_name(xt),
+		    yang_argument_get(ys_module(ys)));
+	    if (netconf_operation_failed_xml(xret, "application", 
+					     cbuf_get(cb)) < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+ ok:
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Validate a single XML node with yang specification for all (not only added) entries
  * 1. Check leafrefs. Eg you delete a leaf and a leafref references it.
  * @param[in]  xt  XML node to be validated
@@ -1136,16 +1387,11 @@ xml_yang_validate_all(clicon_handle h,
 {
     int        retval = -1;
     yang_stmt *ys;  /* yang node */
-    yang_stmt *yc;  /* yang child */
-    yang_stmt *ye;  /* yang must error-message */
-    char      *xpath;
-    int        nr;
     int        ret;
     cxobj     *x;
     cxobj     *xp;
     char      *ns = NULL;
     cbuf      *cb = NULL;
-    cvec      *nsc = NULL;
 
     /* if not given by argument (overide) use default link 
        and !Node has a config sub-statement and it is false */
@@ -1174,105 +1420,14 @@ xml_yang_validate_all(clicon_handle h,
     }
     if (yang_config(ys) != 0){
 	/* Node-specific validation */
-	switch (yang_keyword_get(ys)){
-	case Y_ANYXML:
-	case Y_ANYDATA:
+	if ((ret = xml_yang_validate_node(xt, ys, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	/* Content of anyxml and anydata is not validated */
+	if (yang_keyword_get(ys) == Y_ANYXML ||
+	    yang_keyword_get(ys) == Y_ANYDATA)
 	    goto ok;
-	    break;
-	case Y_LEAF:
-	    /* fall thru */
-	case Y_LEAF_LIST:
-	    /* Special case if leaf is leafref, then first check against
-	       current xml tree
- 	    */
-	    /* Get base type yc */
-	    if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
-		goto done;
-	    if (strcmp(yang_argument_get(yc), "leafref") == 0){
-		if ((ret = validate_leafref(xt, ys, yc, xret)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-		}
-	    else if (strcmp(yang_argument_get(yc), "identityref") == 0){
-		if ((ret = validate_identityref(xt, ys, yc, xret)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-	    }
-	    break;
-	default:
-	    break;
-	}
-	/* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
-	 * XXX. use yang path instead? */
-	yc = NULL;
-	while ((yc = yn_each(ys, yc)) != NULL) {
-	    if (yang_keyword_get(yc) != Y_MUST)
-		continue;
-	    xpath = yang_argument_get(yc); /* "must" has xpath argument */
-	    if (xml_nsctx_yang(yc, &nsc) < 0)
-		goto done;
-	    if ((nr = xpath_vec_bool(xt, nsc, "%s", xpath)) < 0)
-		goto done;
-	    if (!nr){
-		ye = yang_find(yc, Y_ERROR_MESSAGE, NULL);
-		if (netconf_operation_failed_xml(xret, "application", 
-						 ye?yang_argument_get(ye):"must xpath validation failed") < 0)
-		    goto done;
-		goto fail;
-	    }
-	    if (nsc){
-		xml_nsctx_free(nsc);
-		nsc = NULL;
-	    }
-	}
-	/* "when" sub-node RFC 7950 Sec 7.21.5. Can only be one. */
-	if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL){
-	    xpath = yang_argument_get(yc); /* "when" has xpath argument */
-	    /* WHEN xpath needs namespace context */
-	    if (xml_nsctx_yang(ys, &nsc) < 0)
-		goto done;
-	    if ((nr = xpath_vec_bool(xt, nsc, "%s", xpath)) < 0)
-		goto done;
-	    if (nsc){
-		xml_nsctx_free(nsc);
-		nsc = NULL;
-	    }
-	    if (nr == 0){
-		if ((cb = cbuf_new()) == NULL){
-		    clicon_err(OE_UNIX, errno, "cbuf_new");
-		    goto done;
-		}
-		cprintf(cb, "Failed WHEN condition of %s in module %s",
-			xml_name(xt),
-			yang_argument_get(ys_module(ys)));
-		if (netconf_operation_failed_xml(xret, "application", 
-						 cbuf_get(cb)) < 0)
-		    goto done;
-		goto fail;
-	    }
-	}
-	/* Augmented when using special struct. */
-	if ((xpath = yang_when_xpath_get(ys)) != NULL){
-	    if ((nr = xpath_vec_bool(xml_parent(xt), yang_when_nsc_get(ys),
-				     "%s", xpath)) < 0)
-		goto done;
-	    if (nr == 0){
-		if ((cb = cbuf_new()) == NULL){
-		    clicon_err(OE_UNIX, errno, "cbuf_new");
-		    goto done;
-		}
-		cprintf(cb, "Failed augmented WHEN condition %s of node %s in module %s",
-			xpath,
-			xml_name(xt),
-			yang_argument_get(ys_module(ys)));
-		if (netconf_operation_failed_xml(xret, "application", 
-						 cbuf_get(cb)) < 0)
-		    goto done;
-		goto fail;
-	    }
-	}
     }
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
@@ -1294,8 +1449,6 @@ xml_yang_validate_all(clicon_handle h,
  done:
     if (cb)
 	cbuf_free(cb);
-    if (nsc)
-	xml_nsctx_free(nsc);
     return retval;
  fail:
     retval = 0;
@@ -1315,12 +1468,461 @@ xml_yang_validate_all_top(clicon_handle h,
     int    ret;
     cxobj *x;
 
+    /* Leafref target indexes are valid while the tree is validated */
+    _leafref_index_on++;
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
 	if ((ret = xml_yang_validate_all(h, x, xret)) < 1)
-	    return ret;
+	    goto done;
     }
     if ((ret = check_list_unique_minmax(xt, xret)) < 1)
+	goto done;
+    ret = 1;
+ done:
+    if (--_leafref_index_on == 0)
+	leafref_index_free();
+    return ret;
+}
+
+/*! Add names of the nodes an xpath may observe to a hash
+ *
+ * Conservative: wildcards, node type tests, deref() and location paths ending with
+ * an unnamed step (eg "..") may observe any node.
+ * @param[in]  xs     Parsed xpath tree
+ * @param[in]  names  Hash of node names
+ * @param[in]  inner  xs is the initial part of an enclosing location path
+ * @retval     1      Xpath may observe any node
+ * @retval     0      Xpath may only observe nodes with names in names
+ * @retval    -1      Error
+ */
+static int
+xpath_names(xpath_tree    *xs,
+	    clicon_hash_t *names,
+	    int            inner)
+{
+    xpath_tree *xstep;
+    int         ret;
+
+    if (xs == NULL)
+	return 0;
+    switch (xs->xs_type){
+    case XP_NODE: /* wildcard if no name */
+	if (xs->xs_s1 == NULL)
+	    return 1;
+	if (clicon_hash_add(names, xs->xs_s1, NULL, 0) == NULL)
+	    return -1;
+	break;
+    case XP_NODE_FN:
+	return 1;
+	break;
+    case XP_PRIME_FN:
+	if (xs->xs_int == XPATHFN_DEREF)
+	    return 1;
+	break;
+    case XP_ABSPATH:
+	if (xs->xs_c0 == NULL) /* "/" */
+	    return 1;
+	break;
+    case XP_RELLOCPATH:
+	/* Last step is "..", or "." following another step */
+	xstep = xs->xs_c1 ? xs->xs_c1 : xs->xs_c0;
+	if (!inner && xstep->xs_type == XP_STEP && xstep->xs_c0 == NULL &&
+	    (xstep->xs_int != A_SELF || xs->xs_c1 != NULL))
+	    return 1;
+	if ((ret = xpath_names(xs->xs_c0, names, xs->xs_c0->xs_type == XP_RELLOCPATH)) != 0)
+	    return ret;
+	return xpath_names(xs->xs_c1, names, 0);
+	break;
+    default:
+	break;
+    }
+    if ((ret = xpath_names(xs->xs_c0, names, 0)) != 0)
 	return ret;
-    return 1;
+    return xpath_names(xs->xs_c1, names, 0);
+}
+
+/*! Add names of the nodes the xpath of a yang must, when or path statement may observe
+ * @param[in]  ys     Yang must, when or path statement
+ * @param[in]  names  Hash of node names
+ * @retval     1      Xpath may observe any node, or is invalid
+ * @retval     0      Xpath may only observe nodes with names in names
+ * @retval    -1      Error
+ */
+static int
+yang_xpath_names(yang_stmt     *ys,
+		 clicon_hash_t *names)
+{
+    xpath_compiled *xpc = NULL;
+
+    if (yang_xpath_get(ys, &xpc, NULL) < 0 || xpc == NULL){
+	clicon_err_reset(); /* Reported when the xpath is evaluated */
+	return 1;
+    }
+    return xpath_names(xpath_compiled_tree(xpc), names, 0);
+}
+
+/*! Add a yang node to the nodes depending on a node name
+ * @param[in]  deps   Node name -> vector of yang nodes, see yang_validate_deps
+ * @param[in]  name   Node name, or "*" for any node
+ * @param[in]  ys     Yang node whose constraints may observe nodes with that name
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+yang_deps_append(clicon_hash_t *deps,
+		 char          *name,
+		 yang_stmt     *ys)
+{
+    int         retval = -1;
+    yang_stmt **vec;
+    yang_stmt **vec1 = NULL;
+    size_t      vlen = 0;
+
+    vec = clicon_hash_value(deps, name, &vlen);
+    if ((vec1 = malloc(vlen + sizeof(*vec1))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    if (vec)
+	memcpy(vec1, vec, vlen);
+    vec1[vlen/sizeof(*vec1)] = ys;
+    if (clicon_hash_add(deps, name, vec1, vlen + sizeof(*vec1)) == NULL)
+	goto done;
+    retval = 0;
+ done:
+    if (vec1)
+	free(vec1);
+    return retval;
+}
+
+/*! Add a yang data node to the nodes depending on the names its constraints observe
+ *
+ * A node depends on the nodes that a must, when, augmented when or leafref path may
+ * select, and a list or leaf-list on itself (unique, min/max-elements).
+ * yang_apply callback.
+ * @param[in]  ys     Yang node
+ * @param[in]  arg    Node name -> vector of yang nodes (clicon_hash_t*)
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+yang_deps_add(yang_stmt *ys,
+	      void      *arg)
+{
+    int             retval = -1;
+    clicon_hash_t  *deps = (clicon_hash_t *)arg;
+    clicon_hash_t  *names = NULL;
+    enum rfc_6020   keyword;
+    yang_stmt      *yc;
+    yang_stmt      *yp;
+    char           *xpath;
+    xpath_compiled *xpc = NULL;
+    char          **keys = NULL;
+    size_t          nkeys = 0;
+    int             i;
+    int             ret;
+
+    if (!yang_datanode(ys) || yang_config(ys) == 0)
+	goto ok;
+    if ((names = clicon_hash_init()) == NULL)
+	goto done;
+    keyword = yang_keyword_get(ys);
+    if (keyword == Y_LIST || keyword == Y_LEAF_LIST)
+	if (clicon_hash_add(names, yang_argument_get(ys), NULL, 0) == NULL)
+	    goto done;
+    if (keyword == Y_LEAF || keyword == Y_LEAF_LIST){
+	if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
+	    goto done;
+	if (strcmp(yang_argument_get(yc), "leafref") == 0 &&
+	    (yp = yang_find(yc, Y_PATH, NULL)) != NULL){
+	    if ((ret = yang_xpath_names(yp, names)) < 0)
+		goto done;
+	    if (ret == 1)
+		goto any;
+	}
+    }
+    yc = NULL;
+    while ((yc = yn_each(ys, yc)) != NULL) {
+	if (yang_keyword_get(yc) != Y_MUST && yang_keyword_get(yc) != Y_WHEN)
+	    continue;
+	if ((ret = yang_xpath_names(yc, names)) < 0)
+	    goto done;
+	if (ret == 1)
+	    goto any;
+    }
+    /* Augmented when */
+    if ((xpath = yang_when_xpath_get(ys)) != NULL){
+	if (xpath_compile(xpath, &xpc) < 0){
+	    clicon_err_reset();
+	    goto any;
+	}
+	if ((ret = xpath_names(xpath_compiled_tree(xpc), names, 0)) < 0)
+	    goto done;
+	if (ret == 1)
+	    goto any;
+    }
+    if (clicon_hash_keys(names, &keys, &nkeys) < 0)
+	goto done;
+    for (i=0; i<nkeys; i++)
+	if (yang_deps_append(deps, keys[i], ys) < 0)
+	    goto done;
+ ok:
+    retval = 0;
+ done:
+    if (keys)
+	free(keys);
+    if (names)
+	clicon_hash_free(names);
+    if (xpc)
+	xpath_compiled_free(xpc);
+    return retval;
+ any:
+    if (yang_deps_append(deps, "*", ys) < 0)
+	goto done;
+    goto ok;
+}
+
+/*! Build map of the yang data nodes whose constraints depend on each node name
+ *
+ * Done once when the yang spec is loaded, see yang_parse_post, so that incremental
+ * validation only looks up the names of changed nodes, see xml_yang_validate_changed_top.
+ * Nodes whose constraints may observe any node are mapped from "*".
+ * @param[in]  yspec  Yang spec
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+yang_validate_deps(yang_stmt *yspec)
+{
+    int            retval = -1;
+    clicon_hash_t *deps = NULL;
+
+    if ((deps = clicon_hash_init()) == NULL)
+	goto done;
+    if (yang_apply(yspec, -1, yang_deps_add, 0, deps) < 0)
+	goto done;
+    if (yang_deps_set(yspec, deps) < 0)
+	goto done;
+    deps = NULL;
+    retval = 0;
+ done:
+    if (deps)
+	clicon_hash_free(deps);
+    return retval;
+}
+
+/*! Mark or unmark the yang nodes whose constraints depend on a changed node name
+ *
+ * Marks nodes with YANG_FLAG_VALIDATE and their ancestors with YANG_FLAG_VALIDATE_DESC.
+ * @param[in]  deps   Node name -> vector of yang nodes, see yang_validate_deps
+ * @param[in]  name   Name of changed node, or "*"
+ * @param[in]  mark   1: set marks, 0: reset marks
+ */
+static void
+yang_validate_mark(clicon_hash_t *deps,
+		   char          *name,
+		   int            mark)
+{
+    yang_stmt **vec;
+    size_t      vlen = 0;
+    yang_stmt  *yp;
+    int         i;
+
+    if ((vec = clicon_hash_value(deps, name, &vlen)) == NULL)
+	return;
+    for (i=0; i<vlen/sizeof(*vec); i++){
+	yp = vec[i];
+	if (mark){
+	    yang_flag_set(yp, YANG_FLAG_VALIDATE);
+	    while ((yp = yang_parent_get(yp)) != NULL &&
+		   yang_flag_get(yp, YANG_FLAG_VALIDATE_DESC) == 0)
+		yang_flag_set(yp, YANG_FLAG_VALIDATE_DESC);
+	}
+	else{
+	    yang_flag_reset(yp, YANG_FLAG_VALIDATE|YANG_FLAG_VALIDATE_DESC);
+	    while ((yp = yang_parent_get(yp)) != NULL &&
+		   yang_flag_get(yp, YANG_FLAG_VALIDATE_DESC) != 0)
+		yang_flag_reset(yp, YANG_FLAG_VALIDATE_DESC);
+	}
+    }
+}
+
+/*! Add names of changed nodes of an XML tree to a hash
+ *
+ * Only subtrees marked with XML_FLAG_ADD, XML_FLAG_DEL or XML_FLAG_CHANGE are
+ * traversed, ie changed nodes and their ancestors.
+ * @param[in]  xt     XML tree, top of source or target tree of a diff
+ * @param[in]  names  Hash of node names
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+xml_changed_names(cxobj         *xt,
+		  clicon_hash_t *names)
+{
+    int    retval = -1;
+    cxobj *x;
+
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if (xml_flag(x, XML_FLAG_ADD|XML_FLAG_DEL|XML_FLAG_CHANGE) == 0)
+	    continue;
+	if (clicon_hash_add(names, xml_name(x), NULL, 0) == NULL)
+	    goto done;
+	if (xml_changed_names(x, names) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Validate changed XML nodes and unchanged nodes whose constraints may observe them
+ *
+ * Added subtrees are validated as xml_yang_validate_all. Unchanged nodes are 
+ * validated if marked by yang_validate_mark, and traversed only if a descendant
+ * may be marked.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    XML node to be validated
+ * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ */
+static int
+xml_yang_validate_changed(clicon_handle h,
+			  cxobj        *xt, 
+			  cxobj       **xret)
+{
+    int        retval = -1;
+    yang_stmt *ys;
+    yang_stmt *yc;
+    cxobj     *x;
+    int        changed;
+    int        ret;
+
+    ys = xml_spec(xt);
+    if (ys == NULL || xml_flag(xt, XML_FLAG_ADD))
+	return xml_yang_validate_all(h, xt, xret);
+    changed = xml_flag(xt, XML_FLAG_CHANGE);
+    if (yang_config(ys) != 0){
+	if (changed || yang_flag_get(ys, YANG_FLAG_VALIDATE)){
+	    if ((ret = xml_yang_validate_node(xt, ys, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	if (yang_keyword_get(ys) == Y_ANYXML ||
+	    yang_keyword_get(ys) == Y_ANYDATA)
+	    goto ok;
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if (xml_flag(x, XML_FLAG_ADD|XML_FLAG_CHANGE) == 0 &&
+	    (yc = xml_spec(x)) != NULL &&
+	    yang_flag_get(yc, YANG_FLAG_VALIDATE|YANG_FLAG_VALIDATE_DESC) == 0)
+	    continue;
+	if ((ret = xml_yang_validate_changed(h, x, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    /* A list may have changed also if xt is unchanged, eg a list entry is deleted */
+    if (yang_config(ys) != 0 &&
+	(changed || yang_flag_get(ys, YANG_FLAG_VALIDATE_DESC))){
+	if ((ret = check_list_unique_minmax(xt, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+ ok:
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Validate the target of a diff, only changed nodes and the nodes depending on them
+ *
+ * Same result as xml_yang_validate_all_top of x1 given that x0 is valid, but only
+ * must, when, leafref, unique and min/max-elements constraints that may observe a 
+ * changed node are evaluated.
+ * The diff is given by the XML_FLAG_ADD, XML_FLAG_DEL and XML_FLAG_CHANGE flags
+ * set on x0 and x1 from the result of xml_diff.
+ * @param[in]  h     Clicon handle
+ * @param[in]  x0    Source XML tree (or NULL)
+ * @param[in]  x1    Target XML tree
+ * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all_top  for full validation
+ */
+int
+xml_yang_validate_changed_top(clicon_handle h,
+			      cxobj        *x0,
+			      cxobj        *x1,
+			      cxobj       **xret)
+{
+    int            retval = -1;
+    yang_stmt     *yspec;
+    clicon_hash_t *deps;
+    clicon_hash_t *names = NULL;
+    char         **keys = NULL;
+    size_t         nkeys = 0;
+    cxobj         *x;
+    int            i;
+    int            ret;
+
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+	clicon_err(OE_YANG, ENOENT, "No yang spec");
+	goto done;
+    }
+    /* Built when yang is loaded, or here if yang was loaded without the option */
+    if ((deps = yang_deps_get(yspec)) == NULL){
+	if (yang_validate_deps(yspec) < 0)
+	    goto done;
+	deps = yang_deps_get(yspec);
+    }
+    if ((names = clicon_hash_init()) == NULL)
+	goto done;
+    if (x0 && xml_changed_names(x0, names) < 0)
+	goto done;
+    if (xml_changed_names(x1, names) < 0)
+	goto done;
+    if (clicon_hash_keys(names, &keys, &nkeys) < 0)
+	goto done;
+    for (i=0; i<nkeys; i++)
+	yang_validate_mark(deps, keys[i], 1);
+    yang_validate_mark(deps, "*", 1);
+    /* Leafref target indexes are valid while the tree is validated */
+    _leafref_index_on++;
+    ret = 1;
+    x = NULL;
+    while ((x = xml_child_each(x1, x, CX_ELMNT)) != NULL) {
+	if (xml_flag(x, XML_FLAG_ADD|XML_FLAG_CHANGE) == 0 &&
+	    xml_spec(x) != NULL &&
+	    yang_flag_get(xml_spec(x), YANG_FLAG_VALIDATE|YANG_FLAG_VALIDATE_DESC) == 0)
+	    continue;
+	if ((ret = xml_yang_validate_changed(h, x, xret)) < 1)
+	    break;
+    }
+    if (ret == 1)
+	ret = check_list_unique_minmax(x1, xret);
+    if (--_leafref_index_on == 0)
+	leafref_index_free();
+    for (i=0; i<nkeys; i++)
+	yang_validate_mark(deps, keys[i], 0);
+    yang_validate_mark(deps, "*", 0);
+    if (ret < 0)
+	goto done;
+    retval = ret;
+ done:
+    if (keys)
+	free(keys);
+    if (names)
+	clicon_hash_free(names);
+    return retval;
 }
@@ -53,6 +53,9 @@
 #include <string.h>
 #include <limits.h>
 #include <assert.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -87,6 +90,19 @@
 #define XML_CHILDVEC_SIZE_START_ELMNT 16 
 #define XML_CHILDVEC_SIZE_THRESHOLD 65536
 
+/* Body and attribute values shorter than this are stored inline in the node, longer
+ * values are allocated separately
+ */
+#define XML_VALUE_INLINE 16
+
+/* Size of arena chunks. Chunks are also aligned to this size so that the arena of an 
+ * object can be found from its address
+ */
+#define XML_ARENA_CHUNK 65536
+
+/* Align arena allocations */
+#define XML_ARENA_ALIGN(n) (((n)+7) & ~((size_t)7))
+
 /* Intention of these macros is to guard against access of type-specific fields 
  * As debug they can contain an assert.
  */
@@ -123,7 +139,28 @@ struct search_index{
     qelem_t      si_q;    /* Queue header */
     char        *si_name; /* Name of index variable (must be (potential) child of xml node at hand */
     clixon_xvec *si_xvec; /* Sorted vector of xml object pointers (should be of YANG type LIST) */
+    struct search_hash *si_hash; /* Hash table instead of sorted vector, see search_index_hash */
 };
+
+/* Hash variant of a search index, used if the index variable is declared with the
+ * clixon-config:search_index_hash extension.
+ * Only equality lookups are possible, but inserts and removals are O(1) as opposed to the
+ * memmove of the sorted vector, which matters for large lists with frequent updates.
+ * Entries are hashed on the body string of the index variable.
+ */
+struct search_hash_entry{
+    struct search_hash_entry *she_next; /* Next in bucket */
+    uint32_t                  she_hash; /* Full hash value of index variable body */
+    cxobj                    *she_x;    /* List element */
+};
+
+struct search_hash{
+    struct search_hash_entry **sh_bucket; /* Vector of buckets */
+    uint32_t                   sh_size;   /* Number of buckets, power of 2 */
+    uint32_t                   sh_nr;     /* Number of entries */
+};
+
+#define SEARCH_HASH_SIZE_START 16
 #endif
 
 /*! xml tree node, with name, type, parent, children, etc 
@@ -162,44 +199,79 @@ struct search_index{
  */
 struct xml{
     enum cxobj_type   x_type;       /* type of node: element, attribute, body */
-    char             *x_name;       /* name of node */
-    char             *x_prefix;     /* namespace localname N, called prefix */
     uint16_t          x_flags;      /* Flags according to XML_FLAG_* */
+    char             *x_name;       /* name of node, interned, see xml_intern */
+    char             *x_prefix;     /* namespace localname N, called prefix, interned */
     struct xml       *x_up;         /* parent node in hierarchy if any */
     int              _x_vector_i;   /* internal use: xml_child_each */
     int              _x_i;          /* internal use for sorting: 
 				       see xml_enumerate and xml_cmp */
-    /*----- next is body/attribute only */
-    cbuf             *x_value_cb;  /* attribute and body nodes have values (XXX: this consumes 
-				       memory) cv? */
     /*----- up to here is common to all next is element only */
     struct xml      **x_childvec;   /* vector of children nodes (XXX: use clixon_vec ) */
     int               x_childvec_len;/* Number of children */
     int               x_childvec_max;/* Length of allocated vector */
-
-
     cvec             *x_ns_cache;   /* Cached vector of namespaces (set by bind-yang) */
     yang_stmt        *x_spec;       /* Pointer to specification, eg yang, 
 				       by reference, dont free */
     cg_var           *x_cv;         /* Cached value as cligen variable (set by xml_cmp) */
+    cbuf             *x_lazy_cb;    /* Unparsed content, see xml_lazy_set */
 #ifdef XML_EXPLICIT_INDEX
     struct search_index *x_search_index; /* explicit search index vectors */
 #endif
 };
 
+/* Value of body and attribute nodes
+ * Small values are stored inline, larger are allocated
+ */
+struct xmlvalue{
+    uint32_t          xv_len;        /* Length of value excluding NULL */
+    uint32_t          xv_max;        /* 0: no value, <= XML_VALUE_INLINE: inline, 
+					otherwise allocated size of xv_ptr */
+    union {
+	char         *xv_ptr;        /* Allocated value */
+	char          xv_inline[XML_VALUE_INLINE]; /* Inline value */
+    } xv_u;
+};
+
 /* Variant of struct xml for use by non-elements to save space
+ * The fields up to xb_value must be the same as in struct xml
  * @see struct xml  For XML elements
  */
 struct xmlbody{
     enum cxobj_type   xb_type;       /* type of node: element, attribute, body */
-    char             *xb_name;       /* name of node */
-    char             *xb_prefix;     /* namespace localname N, called prefix */
     uint16_t          xb_flags;      /* Flags according to XML_FLAG_* */
+    char             *xb_name;       /* name of node, interned, see xml_intern */
+    char             *xb_prefix;     /* namespace localname N, called prefix, interned */
     struct xml       *xb_up;         /* parent node in hierarchy if any */
     int              _xb_vector_i;   /* internal use: xml_child_each */
     int              _xb_i;          /* internal use for sorting: 
 				       see xml_enumerate and xml_cmp */
-    cbuf             *xb_value_cb;  /* attribute and body nodes have values */
+    struct xmlvalue   xb_value;      /* attribute and body nodes have values */
+};
+
+/* Access value of body or attribute node */
+#define xml_bvalue(x) (&((struct xmlbody*)(x))->xb_value)
+
+/* Arena memory chunk, or large block allocated separately
+ * Chunks are XML_ARENA_CHUNK large and aligned
+ */
+struct xml_chunk{
+    struct xml_chunk *xc_next;       /* Next chunk in arena */
+    struct xml_arena *xc_arena;      /* Arena of chunk */
+    size_t            xc_used;       /* Used bytes of chunk including header */
+};
+
+/* Arena of an XML tree. All objects created under the root of the tree are allocated 
+ * from the arena, and are released as a whole when the root is freed.
+ * @see xml_new_arena
+ */
+struct xml_arena{
+    cxobj            *xa_root;       /* Root object, owner of arena */
+    struct xml_chunk *xa_chunks;     /* List of chunks, first is current */
+    struct xml_chunk *xa_large;      /* List of large blocks */
+    uint64_t          xa_nr;         /* Number of objects in arena not freed */
+    uint64_t          xa_sz;         /* Allocated bytes of arena */
+    int               xa_foreign;    /* Tree has parts not in arena (need sweep on free) */
 };
 
 /*
@@ -228,16 +300,368 @@ xml_type2str(enum cxobj_type type)
 /* Stats */
 uint64_t _stats_nr = 0;
 
+/* Allocated bytes of XML objects: node structs, values and child vectors */
+static uint64_t _stats_sz = 0;
+
+/* Global symbol table of interned names and prefixes, see xml_intern */
+static clicon_hash_t *_xml_symtab = NULL;
+
+/* Allocated bytes of symbol table strings */
+static uint64_t _stats_symsz = 0;
+
+#ifdef HAVE_LIBPTHREAD
+/* Set while XML trees are processed by several threads, see xml_parallel_apply.
+ * Then statistics counters are updated atomically and the symbol table is locked */
+static int _xml_mt = 0;
+static pthread_mutex_t _xml_mt_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define XML_STATS_ADD(v, n) do {if (_xml_mt) __sync_fetch_and_add(&(v), (n)); else (v) += (n);} while (0)
+#define XML_STATS_SUB(v, n) do {if (_xml_mt) __sync_fetch_and_sub(&(v), (n)); else (v) -= (n);} while (0)
+#else
+#define XML_STATS_ADD(v, n) ((v) += (n))
+#define XML_STATS_SUB(v, n) ((v) -= (n))
+#endif /* HAVE_LIBPTHREAD */
+
+/*! Enable or disable multi-threaded mode of XML object allocation and freeing
+ *
+ * In multi-threaded mode, separate XML subtrees may be modified concurrently by different
+ * threads, typically binding or sorting. Objects can be created and freed (not arena objects),
+ * but one subtree must not be accessed by several threads. 
+ * A whole tree, including its arena, may be freed by a thread that owns it.
+ * Calls are nested: multi-threaded mode is on until every enable has been disabled.
+ * @param[in] on  1: enable multi-threaded mode, 0: disable (default)
+ * @see xml_parallel_apply
+ * @see backend_worker_init
+ */
+int
+xml_mt_set(int on)
+{
+#ifdef HAVE_LIBPTHREAD
+    /* Set before threads are created and after they are joined */
+    if (on)
+	_xml_mt++;
+    else if (_xml_mt > 0)
+	_xml_mt--;
+#endif
+    return 0;
+}
+
 /*! Get global statistics about XML objects
+ * @param[out] nr    Number of XML objects
+ * @param[out] sz    Allocated bytes of XML objects including interned names
+ * @code
+ *   xml_stats_global(&nr, &sz);
+ *   printf("bytes/node: %" PRIu64 "\n", nr?sz/nr:0);
+ * @endcode
  */
 int
-xml_stats_global(uint64_t *nr)
+xml_stats_global(uint64_t *nr,
+		 uint64_t *sz)
 {
     if (nr)
 	*nr = _stats_nr;
+    if (sz)
+	*sz = _stats_sz + _stats_symsz;
+    return 0;
+}
+
+/*! Intern a name or prefix in the global symbol table
+ *
+ * Most names and prefixes are YANG identifiers that re-occur in many nodes. Only one
+ * copy of each string is kept, with a reference count.
+ * @param[in]  str  String to intern
+ * @retval     sym  Interned string, do not free, release with xml_intern_release
+ * @retval     NULL Error
+ */
+static char *
+xml_intern(char *str)
+{
+    clicon_hash_t hs;
+    uint32_t      refcnt = 1;
+    char         *sym = NULL;
+
+#ifdef HAVE_LIBPTHREAD
+    if (_xml_mt)
+	pthread_mutex_lock(&_xml_mt_lock);
+#endif
+    if (_xml_symtab == NULL &&
+	(_xml_symtab = clicon_hash_init()) == NULL)
+	goto done;
+    if ((hs = clicon_hash_lookup(_xml_symtab, str)) != NULL)
+	(*(uint32_t*)hs->h_val)++;
+    else {
+	if ((hs = clicon_hash_add(_xml_symtab, str, &refcnt, sizeof(refcnt))) == NULL)
+	    goto done;
+	_stats_symsz += strlen(str) + 1;
+    }
+    sym = hs->h_key;
+ done:
+#ifdef HAVE_LIBPTHREAD
+    if (_xml_mt)
+	pthread_mutex_unlock(&_xml_mt_lock);
+#endif
+    return sym;
+}
+
+/*! Release an interned string, free it when it is not referenced anymore
+ * @param[in]  sym  Interned string, see xml_intern
+ */
+static void
+xml_intern_release(char *sym)
+{
+    clicon_hash_t hs;
+    
+    if (sym == NULL || _xml_symtab == NULL)
+	return;
+#ifdef HAVE_LIBPTHREAD
+    if (_xml_mt)
+	pthread_mutex_lock(&_xml_mt_lock);
+#endif
+    if ((hs = clicon_hash_lookup(_xml_symtab, sym)) != NULL &&
+	--(*(uint32_t*)hs->h_val) == 0){
+	_stats_symsz -= strlen(sym) + 1;
+	clicon_hash_del(_xml_symtab, sym); /* sym is freed */
+    }
+#ifdef HAVE_LIBPTHREAD
+    if (_xml_mt)
+	pthread_mutex_unlock(&_xml_mt_lock);
+#endif
+}
+
+/*! Get arena of an XML object
+ * @param[in]  x    XML object
+ * @retval     xa   Arena of object
+ * @retval     NULL Object is not allocated in an arena
+ */
+static struct xml_arena *
+xml_arena_get(cxobj *x)
+{
+    if ((x->x_flags & XML_FLAG_ARENA) == 0)
+	return NULL;
+    return ((struct xml_chunk*)((uintptr_t)x & ~((uintptr_t)XML_ARENA_CHUNK-1)))->xc_arena;
+}
+
+/*! Allocate memory from an arena
+ * @param[in]  xa   Arena
+ * @param[in]  sz   Number of bytes
+ * @retval     p    Allocated memory, not initialized. Freed when arena is released
+ * @retval     NULL Error
+ * @note XML objects must be allocated in chunks, not in large blocks, see xml_arena_get
+ */
+static void *
+xml_arena_alloc(struct xml_arena *xa,
+		size_t            sz)
+{
+    struct xml_chunk *xc;
+    void             *p;
+    size_t            hdr;
+
+    hdr = XML_ARENA_ALIGN(sizeof(struct xml_chunk));
+    sz = XML_ARENA_ALIGN(sz);
+    if (sz > XML_ARENA_CHUNK/4){ /* Large block, eg long childvec */
+	if ((xc = malloc(hdr + sz)) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    return NULL;
+	}
+	xc->xc_arena = xa;
+	xc->xc_used = hdr + sz;
+	xc->xc_next = xa->xa_large;
+	xa->xa_large = xc;
+	xa->xa_sz += hdr + sz;
+	XML_STATS_ADD(_stats_sz, hdr + sz);
+	return (char*)xc + hdr;
+    }
+    if ((xc = xa->xa_chunks) == NULL ||
+	xc->xc_used + sz > XML_ARENA_CHUNK){
+	if ((errno = posix_memalign(&p, XML_ARENA_CHUNK, XML_ARENA_CHUNK)) != 0){
+	    clicon_err(OE_XML, errno, "posix_memalign");
+	    return NULL;
+	}
+	xc = (struct xml_chunk*)p;
+	xc->xc_arena = xa;
+	xc->xc_used = hdr;
+	xc->xc_next = xa->xa_chunks;
+	xa->xa_chunks = xc;
+	xa->xa_sz += XML_ARENA_CHUNK;
+	XML_STATS_ADD(_stats_sz, XML_ARENA_CHUNK);
+    }
+    p = (char*)xc + xc->xc_used;
+    xc->xc_used += sz;
+    return p;
+}
+
+/*! Copy a string into an arena
+ * @param[in]  xa   Arena
+ * @param[in]  str  String to copy
+ * @retval     p    Copied string
+ * @retval     NULL Error
+ */
+static char *
+xml_arena_strdup(struct xml_arena *xa,
+		 char             *str)
+{
+    size_t len = strlen(str) + 1;
+    char  *p;
+
+    if ((p = xml_arena_alloc(xa, len)) == NULL)
+	return NULL;
+    memcpy(p, str, len);
+    return p;
+}
+
+/*! Release all memory of an arena, including the arena itself
+ * @param[in]  xa   Arena
+ */
+static void
+xml_arena_release(struct xml_arena *xa)
+{
+    struct xml_chunk *xc;
+
+    while ((xc = xa->xa_chunks) != NULL){
+	xa->xa_chunks = xc->xc_next;
+	free(xc);
+    }
+    while ((xc = xa->xa_large) != NULL){
+	xa->xa_large = xc->xc_next;
+	free(xc);
+    }
+    XML_STATS_SUB(_stats_sz, xa->xa_sz);
+    XML_STATS_SUB(_stats_nr, xa->xa_nr);
+    free(xa);
+}
+
+/*! Mark that the arena of an XML object has parts that need to be freed individually
+ * @param[in]  x    XML object
+ */
+static void
+xml_arena_foreign(cxobj *x)
+{
+    struct xml_arena *xa;
+
+    if ((xa = xml_arena_get(x)) != NULL)
+	xa->xa_foreign = 1;
+}
+
+/*! Check that a child may be added to a parent with respect to arenas
+ *
+ * An arena object may only be added to a parent in the same arena. An object not
+ * in an arena may be added to an arena parent, but then needs to be freed separately.
+ * @param[in]  xp   Parent
+ * @param[in]  xc   Child
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_arena_check(cxobj *xp,
+		cxobj *xc)
+{
+    struct xml_arena *xa;
+
+    xa = xml_arena_get(xp);
+    if (xml_flag(xc, XML_FLAG_ARENA)){
+	if (xml_arena_get(xc) != xa){
+	    clicon_err(OE_XML, EINVAL, "Arena object %s cannot be moved to another tree",
+		       xml_name(xc));
+	    return -1;
+	}
+    }
+    else if (xa)
+	xa->xa_foreign = 1;
+    return 0;
+}
+
+/*! Get string of a body/attr value
+ * @param[in]  xv   Value
+ * @retval     str  Value as NULL-terminated string
+ * @retval     NULL No value set
+ */
+static char *
+xmlvalue_get(struct xmlvalue *xv)
+{
+    if (xv->xv_max == 0)
+	return NULL;
+    if (xv->xv_max <= XML_VALUE_INLINE)
+	return xv->xv_u.xv_inline;
+    return xv->xv_u.xv_ptr;
+}
+
+/*! Append to a body/attr value, value is inline if it fits, otherwise allocated
+ * @param[in]  xv   Value
+ * @param[in]  str  String to append
+ * @param[in]  len  Length of str
+ * @param[in]  xa   Arena to allocate from, or NULL
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xmlvalue_append(struct xmlvalue  *xv,
+		char             *str,
+		size_t            len,
+		struct xml_arena *xa)
+{
+    size_t need;
+    size_t max;
+    char  *p;
+    
+    need = xv->xv_len + len + 1;
+    if (need > UINT32_MAX){
+	clicon_err(OE_XML, EINVAL, "Value too long");
+	return -1;
+    }
+    if (need <= XML_VALUE_INLINE){
+	if (xv->xv_max == 0)
+	    xv->xv_max = XML_VALUE_INLINE;
+    }
+    else if (need > xv->xv_max){
+	max = xv->xv_max > XML_VALUE_INLINE ? 2*xv->xv_max : 0;
+	if (max < need)
+	    max = need;
+	if (xa != NULL){ /* Old value remains in arena */
+	    if ((p = xml_arena_alloc(xa, max)) == NULL)
+		return -1;
+	    if (xv->xv_max)
+		memcpy(p, xmlvalue_get(xv), xv->xv_len);
+	}
+	else if (xv->xv_max > XML_VALUE_INLINE){
+	    if ((p = realloc(xv->xv_u.xv_ptr, max)) == NULL){
+		clicon_err(OE_XML, errno, "realloc");
+		return -1;
+	    }
+	    XML_STATS_ADD(_stats_sz, max - xv->xv_max);
+	}
+	else {
+	    if ((p = malloc(max)) == NULL){
+		clicon_err(OE_XML, errno, "malloc");
+		return -1;
+	    }
+	    if (xv->xv_max)
+		memcpy(p, xv->xv_u.xv_inline, xv->xv_len);
+	    XML_STATS_ADD(_stats_sz, max);
+	}
+	xv->xv_u.xv_ptr = p;
+	xv->xv_max = max;
+    }
+    p = xmlvalue_get(xv);
+    memcpy(p + xv->xv_len, str, len);
+    xv->xv_len += len;
+    p[xv->xv_len] = '\0';
     return 0;
 }
 
+/*! Free allocated body/attr value
+ * @param[in]  xv   Value
+ */
+static void
+xmlvalue_free(struct xmlvalue *xv)
+{
+    if (xv->xv_max > XML_VALUE_INLINE){
+	free(xv->xv_u.xv_ptr);
+	XML_STATS_SUB(_stats_sz, xv->xv_max);
+    }
+    xv->xv_max = 0;
+    xv->xv_len = 0;
+}
+
 
 /*! Return the alloced memory of a single XML obj 
  * @param[in]   x    XML object
@@ -251,10 +675,7 @@ xml_stats_one(cxobj    *x,
 {
     size_t sz = 0;
 
-    if (x->x_name)
-	sz += strlen(x->x_name) + 1;
-    if (x->x_prefix)
-	sz += strlen(x->x_prefix) + 1;
+    /* Names and prefixes are interned, see xml_stats_global */
     switch (xml_type(x)){
     case CX_ELMNT:
 	sz += sizeof(struct xml);
@@ -263,6 +684,8 @@ xml_stats_one(cxobj    *x,
 	    sz += cvec_size(x->x_ns_cache);
 	if (x->x_cv)
 	    sz += cv_size(x->x_cv);
+	if (x->x_lazy_cb)
+	    sz += cbuf_buflen(x->x_lazy_cb);
 #ifdef XML_EXPLICIT_INDEX
 	if (x->x_search_index){
 	    /* XXX: only one */
@@ -271,14 +694,18 @@ xml_stats_one(cxobj    *x,
 		sz += strlen(x->x_search_index->si_name)+1;
 	    if (x->x_search_index->si_xvec)
 		sz += clixon_xvec_len(x->x_search_index->si_xvec)*sizeof(struct cxobj*);
+	    if (x->x_search_index->si_hash)
+		sz += sizeof(struct search_hash) +
+		    x->x_search_index->si_hash->sh_size*sizeof(struct search_hash_entry*) +
+		    x->x_search_index->si_hash->sh_nr*sizeof(struct search_hash_entry);
 	}
 #endif
 	break;
     case CX_BODY:
     case CX_ATTR:
 	sz += sizeof(struct xmlbody);
-	if (x->x_value_cb)
-	    sz += cbuf_buflen(x->x_value_cb);
+	if (xml_bvalue(x)->xv_max > XML_VALUE_INLINE)
+	    sz += xml_bvalue(x)->xv_max;
 	break;
     default:
 	break;
@@ -321,8 +748,8 @@ xml_print_stats_one(FILE   *f,
 		    (unsigned int)(strlen(x->x_search_index->si_name) + 1 + clixon_xvec_len(x->x_search_index->si_xvec)*sizeof(struct cxobj*)));
     }
     else{
-	if (x->x_value_cb)
-	    fprintf(f, "  value-cb: \t%u\n", cbuf_buflen(x->x_value_cb));
+	if (xml_bvalue(x)->xv_max > XML_VALUE_INLINE)
+	    fprintf(f, "  value: \t%u\n", xml_bvalue(x)->xv_max);
     }
     return 0;
 }
@@ -383,7 +810,7 @@ xml_name(cxobj *xn)
 
 /*! Set name of xnode, name is copied
  * @param[in]  xn    xml node
- * @param[in]  name  new name, null-terminated string, copied by function
+ * @param[in]  name  new name, null-terminated string, copied (interned) by function
  * @retval     -1    on error with clicon-err set
  * @retval     0     OK
  */
@@ -391,16 +818,21 @@ int
 xml_name_set(cxobj *xn, 
 	     char  *name)
 {
-    if (xn->x_name){
-	free(xn->x_name);
+    char             *old = xn->x_name;
+    struct xml_arena *xa;
+
+    if ((xa = xml_arena_get(xn)) != NULL){ /* Not interned, old name remains in arena */
 	xn->x_name = NULL;
-    }
-    if (name){
-	if ((xn->x_name = strdup(name)) == NULL){
-	    clicon_err(OE_XML, errno, "strdup");
+	if (name && (xn->x_name = xml_arena_strdup(xa, name)) == NULL)
 	    return -1;
-	}
+	return 0;
+    }
+    xn->x_name = NULL;
+    if (name && (xn->x_name = xml_intern(name)) == NULL){
+	xml_intern_release(old);
+	return -1;
     }
+    xml_intern_release(old); /* After intern since name may be the old name */
     return 0;
 }
 
@@ -416,7 +848,7 @@ xml_prefix(cxobj *xn)
 
 /*! Set prefix of xnode, prefix is copied
  * @param[in]  xn      XML node
- * @param[in]  prefix  New prefix, null-terminated string, copied by function
+ * @param[in]  prefix  New prefix, null-terminated string, copied (interned) by function
  * @retval     -1      Error with clicon-err set
  * @retval     0       OK
  */
@@ -424,16 +856,21 @@ int
 xml_prefix_set(cxobj *xn, 
 	       char  *prefix)
 {
-    if (xn->x_prefix){
-	free(xn->x_prefix);
+    char             *old = xn->x_prefix;
+    struct xml_arena *xa;
+
+    if ((xa = xml_arena_get(xn)) != NULL){
 	xn->x_prefix = NULL;
-    }
-    if (prefix){
-	if ((xn->x_prefix = strdup(prefix)) == NULL){
-	    clicon_err(OE_XML, errno, "strdup");
+	if (prefix && (xn->x_prefix = xml_arena_strdup(xa, prefix)) == NULL)
 	    return -1;
-	}
+	return 0;
+    }
+    xn->x_prefix = NULL;
+    if (prefix && (xn->x_prefix = xml_intern(prefix)) == NULL){
+	xml_intern_release(old);
+	return -1;
     }
+    xml_intern_release(old);
     return 0;
 }
 
@@ -508,6 +945,7 @@ nscache_set(cxobj *x,
     if (x->x_ns_cache == NULL){
 	if ((x->x_ns_cache = xml_nsctx_init(prefix, namespace)) == NULL)
 	    goto done;
+	xml_arena_foreign(x);
     }
     else 
 	return xml_nsctx_add(x->x_ns_cache, prefix, namespace);
@@ -536,6 +974,8 @@ nscache_replace(cxobj *x,
 	x->x_ns_cache = NULL;
     }
     x->x_ns_cache = nsc;
+    if (nsc)
+	xml_arena_foreign(x);
     retval = 0;
     // done:
     return retval;
@@ -631,7 +1071,7 @@ xml_value(cxobj *xn)
 {
     if (!is_bodyattr(xn))
 	return NULL;
-    return xn->x_value_cb?cbuf_get(xn->x_value_cb):NULL;
+    return xmlvalue_get(xml_bvalue(xn));
 }
 
 /*! Set value of xml node, value is copied
@@ -644,8 +1084,8 @@ int
 xml_value_set(cxobj *xn, 
 	      char  *val)
 {
-    int    retval = -1;
-    size_t sz;
+    int              retval = -1;
+    struct xmlvalue *xv;
 
     if (!is_bodyattr(xn))
 	return 0;
@@ -653,16 +1093,10 @@ xml_value_set(cxobj *xn,
 	clicon_err(OE_XML, EINVAL, "value is NULL");
 	goto done;
     }
-    sz = strlen(val)+1;
-    if (xn->x_value_cb == NULL){
-	if ((xn->x_value_cb = cbuf_new_alloc(sz)) == NULL){
-	    clicon_err(OE_XML, errno, "cbuf_new");
-	    goto done;
-	}
-    }
-    else
-	cbuf_reset(xn->x_value_cb);
-    cbuf_append_str(xn->x_value_cb, val);
+    xv = xml_bvalue(xn);
+    xv->xv_len = 0;
+    if (xmlvalue_append(xv, val, strlen(val), xml_arena_get(xn)) < 0)
+	goto done;
     retval = 0;
  done:
     return retval;
@@ -679,7 +1113,6 @@ xml_value_append(cxobj *xn,
 		 char  *val)
 {
     int    retval = -1;
-    size_t sz;
 
     if (!is_bodyattr(xn))
 	return 0;
@@ -687,22 +1120,89 @@ xml_value_append(cxobj *xn,
 	clicon_err(OE_XML, EINVAL, "value is NULL");
 	goto done;
     }
-    sz = strlen(val)+1;
-    if (xn->x_value_cb == NULL){
-	if ((xn->x_value_cb = cbuf_new_alloc(sz)) == NULL){
+    if (xmlvalue_append(xml_bvalue(xn), val, strlen(val), xml_arena_get(xn)) < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Set unparsed content of an element to be materialized when accessed
+ *
+ * The content is opaque to this module and is copied. The element is marked with
+ * XML_FLAG_LAZY until the content is cleared.
+ * @param[in]  xn   XML element, should not have children
+ * @param[in]  buf  Unparsed content, eg binary datastore encoding
+ * @param[in]  len  Length of buf
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see clixon_binary_materialize
+ */
+int
+xml_lazy_set(cxobj  *xn, 
+	     void   *buf,
+	     size_t  len)
+{
+    int retval = -1;
+
+    if (xml_type(xn) != CX_ELMNT){
+	clicon_err(OE_XML, EINVAL, "Not an element");
+	goto done;
+    }
+    if (xn->x_lazy_cb == NULL){
+	if ((xn->x_lazy_cb = cbuf_new_alloc(len+1)) == NULL){
 	    clicon_err(OE_XML, errno, "cbuf_new");
 	    goto done;
 	}
     }
-    if (cbuf_append_str(xn->x_value_cb, val) < 0){
-	clicon_err(OE_XML, errno, "cprintf");
+    else
+	cbuf_reset(xn->x_lazy_cb);
+    if (cbuf_append_buf(xn->x_lazy_cb, buf, len) < 0){
+	clicon_err(OE_XML, errno, "cbuf_append_buf");
 	goto done;
     }
+    xml_arena_foreign(xn);
+    xml_flag_set(xn, XML_FLAG_LAZY);
     retval = 0;
  done:
     return retval;
 }
 
+/*! Get unparsed content of an element
+ * @param[in]  xn   XML element
+ * @param[out] len  Length of content
+ * @retval     buf  Unparsed content, not copied
+ * @retval     NULL Element is not lazy
+ */
+char*
+xml_lazy_get(cxobj  *xn,
+	     size_t *len)
+{
+    if (xml_type(xn) != CX_ELMNT ||
+	xml_flag(xn, XML_FLAG_LAZY) == 0 ||
+	xn->x_lazy_cb == NULL)
+	return NULL;
+    if (len)
+	*len = cbuf_len(xn->x_lazy_cb);
+    return cbuf_get(xn->x_lazy_cb);
+}
+
+/*! Free unparsed content of an element, typically after it has been materialized
+ * @param[in]  xn   XML element
+ */
+int
+xml_lazy_clear(cxobj *xn)
+{
+    if (xml_type(xn) != CX_ELMNT)
+	return 0;
+    if (xn->x_lazy_cb){
+	cbuf_free(xn->x_lazy_cb);
+	xn->x_lazy_cb = NULL;
+    }
+    xml_flag_reset(xn, XML_FLAG_LAZY);
+    return 0;
+}
+
 /*! Get type of xnode
  * @param[in]  xn    xml node
  * @retval     type of xml node
@@ -851,6 +1351,8 @@ xml_child_i_set(cxobj *xt,
 {
     if (!is_element(xt))
 	return NULL;
+    if (xc && !xml_flag(xc, XML_FLAG_ARENA))
+	xml_arena_foreign(xt);
     if (i < xt->x_childvec_len)
 	xt->x_childvec[i] = xc;
     return 0;
@@ -942,6 +1444,38 @@ xml_child_each(cxobj           *xparent,
 }
 
 
+/*! Reallocate child vector of an element to a larger size
+ * @param[in]  xp   XML element
+ * @param[in]  max  New size of vector
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @note Vector of arena objects is copied and the old vector remains in the arena
+ */
+static int
+xml_childvec_realloc(cxobj *xp,
+		     int    max)
+{
+    struct xml_arena *xa;
+    struct xml      **vec;
+
+    if ((xa = xml_arena_get(xp)) != NULL){
+	if ((vec = xml_arena_alloc(xa, max*sizeof(cxobj*))) == NULL)
+	    return -1;
+	if (xp->x_childvec_max)
+	    memcpy(vec, xp->x_childvec, xp->x_childvec_max*sizeof(cxobj*));
+    }
+    else {
+	if ((vec = realloc(xp->x_childvec, max*sizeof(cxobj*))) == NULL){
+	    clicon_err(OE_XML, errno, "realloc");
+	    return -1;
+	}
+	XML_STATS_ADD(_stats_sz, (max - xp->x_childvec_max)*sizeof(cxobj*));
+    }
+    xp->x_childvec = vec;
+    xp->x_childvec_max = max;
+    return 0;
+}
+
 /*! Extend child vector with one and insert xml node there
  * @note does not do anything with child, you may need to set its parent, etc
  * @see xml_child_insert_pos
@@ -952,9 +1486,12 @@ xml_child_append(cxobj *xp,
 		 cxobj *xc)
 {
     size_t start;
+    int    max;
 
     if (!is_element(xp))
 	return 0;
+    if (xml_arena_check(xp, xc) < 0)
+	return -1;
     start = XML_CHILDVEC_SIZE_START;
     /* Heurestics: if child is body only single child is expected, but element children may
      * have siblings
@@ -963,13 +1500,13 @@ xml_child_append(cxobj *xp,
 	start = XML_CHILDVEC_SIZE_START_ELMNT;
     xp->x_childvec_len++;
     if (xp->x_childvec_len > xp->x_childvec_max){
+	max = xp->x_childvec_max;
 	if (xp->x_childvec_len < XML_CHILDVEC_SIZE_THRESHOLD)
-	    xp->x_childvec_max = xp->x_childvec_max?2*xp->x_childvec_max:start;
+	    max = max?2*max:start;
 	else
-	    xp->x_childvec_max += XML_CHILDVEC_SIZE_THRESHOLD;
-	xp->x_childvec = realloc(xp->x_childvec, xp->x_childvec_max*sizeof(cxobj*));
-	if (xp->x_childvec == NULL){
-	    clicon_err(OE_XML, errno, "realloc");
+	    max += XML_CHILDVEC_SIZE_THRESHOLD;
+	if (xml_childvec_realloc(xp, max) < 0){
+	    xp->x_childvec_len--;
 	    return -1;
 	}
     }
@@ -988,18 +1525,21 @@ xml_child_insert_pos(cxobj *xp,
 		     int    i)
 {
     size_t size;
+    int    max;
    
     if (!is_element(xp))
 	return 0;
+    if (xml_arena_check(xp, xc) < 0)
+	return -1;
     xp->x_childvec_len++;
     if (xp->x_childvec_len > xp->x_childvec_max){
+	max = xp->x_childvec_max;
 	if (xp->x_childvec_len < XML_CHILDVEC_SIZE_THRESHOLD)
-	    xp->x_childvec_max = xp->x_childvec_max?2*xp->x_childvec_max:XML_CHILDVEC_SIZE_START;
+	    max = max?2*max:XML_CHILDVEC_SIZE_START;
 	else
-	    xp->x_childvec_max += XML_CHILDVEC_SIZE_THRESHOLD;
-	xp->x_childvec = realloc(xp->x_childvec, xp->x_childvec_max*sizeof(cxobj*));
-	if (xp->x_childvec == NULL){
-	    clicon_err(OE_XML, errno, "realloc");
+	    max += XML_CHILDVEC_SIZE_THRESHOLD;
+	if (xml_childvec_realloc(xp, max) < 0){
+	    xp->x_childvec_len--;
 	    return -1;
 	}
     }
@@ -1020,8 +1560,19 @@ int
 xml_childvec_set(cxobj *x, 
 		 int    len)
 {
+    struct xml_arena *xa;
+
     if (!is_element(x))
 	return 0;
+    if ((xa = xml_arena_get(x)) != NULL){
+	if ((x->x_childvec = xml_arena_alloc(xa, len*sizeof(cxobj*))) == NULL)
+	    return -1;
+	memset(x->x_childvec, 0, len*sizeof(cxobj*));
+	x->x_childvec_len = len;
+	x->x_childvec_max = len;
+	return 0;
+    }
+    XML_STATS_SUB(_stats_sz, x->x_childvec_max*sizeof(cxobj*));
     x->x_childvec_len = len;
     x->x_childvec_max = len;
     if (x->x_childvec)
@@ -1030,6 +1581,7 @@ xml_childvec_set(cxobj *x,
 	clicon_err(OE_XML, errno, "calloc");
 	return -1;
     }
+    XML_STATS_ADD(_stats_sz, len*sizeof(cxobj*));
     return 0;
 }
 
@@ -1043,6 +1595,37 @@ xml_childvec_get(cxobj *x)
     return x->x_childvec;
 }
 
+/*! Allocate and clear memory of an XML object
+ * @param[in]  sz   Size of object
+ * @param[in]  xa   Arena to allocate from, or NULL for malloc
+ * @retval     x    New object
+ * @retval     NULL Error
+ */
+static struct xml *
+xml_alloc(size_t            sz,
+	  struct xml_arena *xa)
+{
+    struct xml *x;
+    
+    if (xa){
+	if ((x = xml_arena_alloc(xa, sz)) == NULL)
+	    return NULL;
+	memset(x, 0, sz);
+	x->x_flags = XML_FLAG_ARENA;
+	xa->xa_nr++;
+    }
+    else{
+	if ((x = malloc(sz)) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    return NULL;
+	}
+	memset(x, 0, sz);
+	XML_STATS_ADD(_stats_sz, sz);
+    }
+    XML_STATS_ADD(_stats_nr, 1);
+    return x;
+}
+
 /*! Create new xml node given a name and parent. Free with xml_free().
  *
  * @param[in]  name      Name of XML node
@@ -1081,11 +1664,8 @@ xml_new(char           *name,
 	return NULL;
 	break;
     }
-    if ((x = malloc(sz)) == NULL){
-	clicon_err(OE_XML, errno, "malloc");
+    if ((x = xml_alloc(sz, xp?xml_arena_get(xp):NULL)) == NULL)
 	return NULL;
-    }
-    memset(x, 0, sz);
     xml_type_set(x, type);
     if (name && (xml_name_set(x, name)) < 0)
 	return NULL;
@@ -1095,7 +1675,51 @@ xml_new(char           *name,
 	    return NULL;
 	x->_x_i = xml_child_nr(xp)-1;
     }
-    _stats_nr++;
+    return x;
+}
+
+/*! Create a new XML element that is the root of a tree allocated in an arena
+ *
+ * All objects created under the root, eg with xml_new, xml_copy or by parsing into it,
+ * are allocated from the arena. When the root is freed, the arena is released as a
+ * whole without freeing each object.
+ * @param[in]  name  Name of root element
+ * @retval     xt    Root element, free with xml_free
+ * @retval     NULL  Error
+ * @code
+ *   cxobj *xt;
+ *   if ((xt = xml_new_arena("top")) == NULL)
+ *     err;
+ *   if (clixon_xml_parse_string(str, YB_NONE, NULL, &xt, NULL) < 0)
+ *     err;
+ *   ...
+ *   xml_free(xt);
+ * @endcode
+ * @note Objects of an arena tree must not be moved to another tree or be used after the
+ *       root is freed. Objects not in the arena may be added to the tree.
+ * @see xml_new
+ */
+cxobj *
+xml_new_arena(char *name)
+{
+    struct xml_arena *xa;
+    struct xml       *x;
+
+    if ((xa = malloc(sizeof(*xa))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return NULL;
+    }
+    memset(xa, 0, sizeof(*xa));
+    if ((x = xml_alloc(sizeof(struct xml), xa)) == NULL){
+	xml_arena_release(xa);
+	return NULL;
+    }
+    xa->xa_root = x;
+    xml_type_set(x, CX_ELMNT);
+    if (name && xml_name_set(x, name) < 0){
+	xml_arena_release(xa);
+	return NULL;
+    }
     return x;
 }
 
@@ -1190,6 +1814,8 @@ xml_cv_set(cxobj  *x,
     if (x->x_cv)
 	cv_free(x->x_cv);
     x->x_cv = cv;
+    if (cv)
+	xml_arena_foreign(x);
     return 0;
 }
 
@@ -1248,6 +1874,8 @@ xml_addsub(cxobj *xp,
     char  *cns = NULL; /* child namespace */
     cxobj *xa;
 
+    if (xp && xml_arena_check(xp, xc) < 0)
+	goto done;
     if ((oldp = xml_parent(xc)) != NULL){
 	/* Find child order i in old parent*/
 	for (i=0; i<xml_child_nr(oldp); i++)
@@ -1280,8 +1908,12 @@ xml_addsub(cxobj *xp,
 	/* clear namespace context cache of child */
 	nscache_clear(xc);
 #ifdef XML_EXPLICIT_INDEX
-    if (xml_search_index_p(xc))
-	    xml_search_child_insert(xp, xc);
+	if (xml_search_index_p(xc)){
+	    if (xml_search_child_insert(xp, xc) < 0)
+		goto done;
+	}
+	else if (xml_search_list_insert(xc) < 0)
+	    goto done;
 #endif
     }
     retval = 0;
@@ -1399,18 +2031,24 @@ xml_child_rm(cxobj *xp,
 	clicon_err(OE_XML, 0, "Child not found");
 	goto done;
     }
+#ifdef XML_EXPLICIT_INDEX
+    /* Remove from search indexes while the parent links are still intact */
+    if (xml_type(xc) == CX_ELMNT){
+	if (xml_search_index_p(xc)){
+	    if (xml_search_child_rm(xp, xc) < 0)
+		goto done;
+	}
+	else if (xp->x_search_index){
+	    if (xml_search_list_rm(xc) < 0)
+		goto done;
+	}
+    }
+#endif
     xml_parent_set(xc, NULL);
     xp->x_childvec[i] = NULL;
     xp->x_childvec_len--;
     if (i<xp->x_childvec_len)
 	memmove(&xp->x_childvec[i], &xp->x_childvec[i+1], (xp->x_childvec_len-i)*sizeof(cxobj*));
-#ifdef XML_EXPLICIT_INDEX
-    if (xml_type(xc) == CX_ELMNT){
-	if (xml_search_index_p(xc))
-	    xml_search_child_rm(xp, xc);
-
-    }
-#endif
     retval = 0;
  done:
     return retval;
@@ -1517,6 +2155,10 @@ xml_rootchild(cxobj  *xp,
 	clicon_err(OE_XML, 0, "Parent is not root");
 	goto done;
     }
+    if (xml_flag(xp, XML_FLAG_ARENA)){
+	clicon_err(OE_XML, EINVAL, "Root of arena tree cannot be removed");
+	goto done;
+    }
     if ((xc = xml_child_i(xp, i)) == NULL){
 	clicon_err(OE_XML, ENOENT, "Child %d of parent %s not found", i, xml_name(xp));
 	goto done;
@@ -1556,6 +2198,10 @@ xml_rootchild_node(cxobj  *xp,
 	clicon_err(OE_XML, 0, "Parent is not root");
 	goto done;
     }
+    if (xml_flag(xp, XML_FLAG_ARENA)){
+	clicon_err(OE_XML, EINVAL, "Root of arena tree cannot be removed");
+	goto done;
+    }
     x = NULL; i = 0;
     while ((x = xml_child_each(xp, x, -1)) != NULL) {
 	if (x == xc)
@@ -1822,6 +2468,52 @@ xml_find_body_obj(cxobj      *xt,
     return x;
 }
 
+/*! Free parts of an arena sub-tree that are not allocated in the arena
+ *
+ * The memory of arena objects themselves is not freed, that is done when the arena is
+ * released.
+ * @param[in]  xa  Arena
+ * @param[in]  x   Arena object
+ * @see xml_free
+ */
+static void
+xml_arena_sweep(struct xml_arena *xa,
+		cxobj            *x)
+{
+    int    i;
+    cxobj *xc;
+
+    if (xml_type(x) == CX_ELMNT){
+	for (i=0; i<x->x_childvec_len; i++){
+	    if ((xc = x->x_childvec[i]) == NULL)
+		continue;
+	    if (xml_flag(xc, XML_FLAG_ARENA))
+		xml_arena_sweep(xa, xc);
+	    else
+		xml_free(xc);
+	    x->x_childvec[i] = NULL;
+	}
+	x->x_childvec_len = 0;
+	if (x->x_cv){
+	    cv_free(x->x_cv);
+	    x->x_cv = NULL;
+	}
+	if (x->x_ns_cache){
+	    xml_nsctx_free(x->x_ns_cache);
+	    x->x_ns_cache = NULL;
+	}
+#ifdef XML_EXPLICIT_INDEX
+	xml_search_index_free(x);
+#endif
+	if (x->x_lazy_cb){
+	    cbuf_free(x->x_lazy_cb);
+	    x->x_lazy_cb = NULL;
+	}
+    }
+    xa->xa_nr--;
+    XML_STATS_SUB(_stats_nr, 1);
+}
+
 /*! Free an xl sub-tree recursively, but do not remove it from parent
  * @param[in]  x  the xml tree to be freed.
  * @see xml_purge where x is also removed from parent
@@ -1829,16 +2521,25 @@ xml_find_body_obj(cxobj      *xt,
 int
 xml_free(cxobj *x)
 {
-    int    i;
-    cxobj *xc;
+    int               i;
+    cxobj            *xc;
+    struct xml_arena *xa;
 
     if (x == NULL){
 	return 0;
     }
-    if (x->x_name)
-	free(x->x_name);
-    if (x->x_prefix)
-	free(x->x_prefix);
+    if ((xa = xml_arena_get(x)) != NULL){
+	if (x != xa->xa_root)
+	    xml_arena_sweep(xa, x);
+	else {
+	    if (xa->xa_foreign)
+		xml_arena_sweep(xa, x);
+	    xml_arena_release(xa);
+	}
+	return 0;
+    }
+    xml_intern_release(x->x_name);
+    xml_intern_release(x->x_prefix);
     switch (xml_type(x)){
     case CX_ELMNT:
 	for (i=0; i<x->x_childvec_len; i++){
@@ -1856,17 +2557,22 @@ xml_free(cxobj *x)
 #ifdef XML_EXPLICIT_INDEX
 	xml_search_index_free(x);
 #endif
+	if (x->x_lazy_cb)
+	    cbuf_free(x->x_lazy_cb);
+	if (x->x_childvec_max)
+	    XML_STATS_SUB(_stats_sz, x->x_childvec_max*sizeof(struct xml*));
+	XML_STATS_SUB(_stats_sz, sizeof(struct xml));
 	break;
     case CX_BODY:
     case CX_ATTR:
-	if (x->x_value_cb)
-	    cbuf_free(x->x_value_cb);  
+	xmlvalue_free(xml_bvalue(x));
+	XML_STATS_SUB(_stats_sz, sizeof(struct xmlbody));
 	break;
     default:
 	break;
     }
     free(x);
-    _stats_nr--;
+    XML_STATS_SUB(_stats_nr, 1);
     return 0;
 }
 
@@ -1880,8 +2586,9 @@ int
 xml_copy_one(cxobj *x0, 
 	     cxobj *x1)
 {
-    int   retval = -1;
-    char *s;
+    int    retval = -1;
+    char  *s;
+    size_t len;
     
     xml_type_set(x1, xml_type(x0));
     if ((s = xml_name(x0))) /* malloced string */
@@ -1893,6 +2600,9 @@ xml_copy_one(cxobj *x0,
     switch (xml_type(x0)){
     case CX_ELMNT:
 	xml_spec_set(x1, xml_spec(x0));
+	if ((s = xml_lazy_get(x0, &len)) != NULL)
+	    if (xml_lazy_set(x1, s, len) < 0)
+		goto done;
 	break;
     case CX_BODY:
     case CX_ATTR:
@@ -1905,7 +2615,7 @@ xml_copy_one(cxobj *x0,
     default:
 	break;
     }
-    xml_flag_set(x1, xml_flag(x0, XML_FLAG_DEFAULT | XML_FLAG_TOP)); /* Maybe more flags */
+    xml_flag_set(x1, xml_flag(x0, XML_FLAG_DEFAULT | XML_FLAG_TOP | XML_FLAG_DIRTY)); /* Maybe more flags */
     retval = 0;
  done:
     return retval;
@@ -2426,6 +3136,162 @@ xml_search_index_p(cxobj *x)
 }
 	
 
+/*! Hash function of search index variable body, FNV-1a
+ * @param[in]  str  Body string of index variable, or NULL
+ * @retval     h    Hash value
+ */
+static uint32_t
+search_hash_fn(char *str)
+{
+    uint32_t h = 2166136261U;
+
+    if (str)
+	while (*str){
+	    h ^= (unsigned char)*str++;
+	    h *= 16777619U;
+	}
+    return h;
+}
+
+/*! Create new empty hash search index
+ * @retval  sh    Hash index
+ * @retval  NULL  Error
+ */
+static struct search_hash *
+search_hash_new(void)
+{
+    struct search_hash *sh;
+
+    if ((sh = malloc(sizeof(*sh))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return NULL;
+    }
+    memset(sh, 0, sizeof(*sh));
+    sh->sh_size = SEARCH_HASH_SIZE_START;
+    if ((sh->sh_bucket = calloc(sh->sh_size, sizeof(struct search_hash_entry *))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	free(sh);
+	return NULL;
+    }
+    return sh;
+}
+
+/*! Free hash search index, not the XML objects
+ * @param[in]  sh   Hash index
+ */
+static int
+search_hash_free(struct search_hash *sh)
+{
+    struct search_hash_entry *she;
+    uint32_t                  i;
+
+    for (i=0; i<sh->sh_size; i++)
+	while ((she = sh->sh_bucket[i]) != NULL){
+	    sh->sh_bucket[i] = she->she_next;
+	    free(she);
+	}
+    free(sh->sh_bucket);
+    free(sh);
+    return 0;
+}
+
+/*! Double number of buckets of hash search index and rehash
+ * @param[in]  sh   Hash index
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+search_hash_grow(struct search_hash *sh)
+{
+    struct search_hash_entry **bucket;
+    struct search_hash_entry  *she;
+    uint32_t                   size;
+    uint32_t                   i;
+
+    size = sh->sh_size*2;
+    if ((bucket = calloc(size, sizeof(struct search_hash_entry *))) == NULL){
+	clicon_err(OE_XML, errno, "calloc");
+	return -1;
+    }
+    for (i=0; i<sh->sh_size; i++)
+	while ((she = sh->sh_bucket[i]) != NULL){
+	    sh->sh_bucket[i] = she->she_next;
+	    she->she_next = bucket[she->she_hash & (size-1)];
+	    bucket[she->she_hash & (size-1)] = she;
+	}
+    free(sh->sh_bucket);
+    sh->sh_bucket = bucket;
+    sh->sh_size = size;
+    return 0;
+}
+
+/*! Add list element to hash search index
+ * @param[in]  sh   Hash index
+ * @param[in]  xp   XML list element
+ * @param[in]  xi   XML index variable, child of xp
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+search_hash_add(struct search_hash *sh,
+		cxobj              *xp,
+		cxobj              *xi)
+{
+    struct search_hash_entry *she;
+    uint32_t                  h;
+
+    h = search_hash_fn(xml_body(xi));
+    /* Already added, eg bound twice */
+    for (she = sh->sh_bucket[h & (sh->sh_size-1)]; she; she = she->she_next)
+	if (she->she_x == xp)
+	    return 0;
+    if (sh->sh_nr >= sh->sh_size && search_hash_grow(sh) < 0)
+	return -1;
+    if ((she = malloc(sizeof(*she))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return -1;
+    }
+    she->she_hash = h;
+    she->she_x = xp;
+    she->she_next = sh->sh_bucket[h & (sh->sh_size-1)];
+    sh->sh_bucket[h & (sh->sh_size-1)] = she;
+    sh->sh_nr++;
+    return 0;
+}
+
+/*! Remove list element from hash search index
+ * First look in the bucket of the current value of the index variable. If the value has been
+ * changed since the element was added, fall back to scanning all buckets.
+ * @param[in]  sh   Hash index
+ * @param[in]  xp   XML list element
+ * @param[in]  xi   XML index variable, child of xp
+ */
+static int
+search_hash_rm(struct search_hash *sh,
+	       cxobj              *xp,
+	       cxobj              *xi)
+{
+    struct search_hash_entry **shep;
+    struct search_hash_entry  *she;
+    uint32_t                   h;
+    uint32_t                   i;
+
+    h = search_hash_fn(xml_body(xi));
+    for (shep = &sh->sh_bucket[h & (sh->sh_size-1)]; (she = *shep) != NULL; shep = &she->she_next)
+	if (she->she_x == xp)
+	    goto found;
+    for (i=0; i<sh->sh_size; i++)
+	for (shep = &sh->sh_bucket[i]; (she = *shep) != NULL; shep = &she->she_next)
+	    if (she->she_x == xp)
+		goto found;
+    return 0;
+ found:
+    *shep = she->she_next;
+    free(she);
+    sh->sh_nr--;
+    return 0;
+}
+
 /*! Free all search vector pairs of this XML node
  * @param[in]  x    XML object
  * @retval     0    OK
@@ -2442,6 +3308,8 @@ xml_search_index_free(cxobj *x)
 	    free(si->si_name);
 	if (si->si_xvec)
 	    clixon_xvec_free(si->si_xvec);
+	if (si->si_hash)
+	    search_hash_free(si->si_hash);
 	free(si);
     }
     return 0;
@@ -2450,12 +3318,14 @@ xml_search_index_free(cxobj *x)
 /*! Add single search vector pair to this XML node
  * @param[in]  x     XML object
  * @param[in]  name  Name of index variable
- * @retval     0     OK
- * @retval    -1     Error
+ * @param[in]  hash  If set, create a hash index, otherwise a sorted vector
+ * @retval     si    Search index
+ * @retval     NULL  Error
  */
 static struct search_index *
 xml_search_index_add(cxobj *x,
-		     char  *name)
+		     char  *name,
+		     int    hash)
 {
     struct search_index *si = NULL;
 
@@ -2470,13 +3340,18 @@ xml_search_index_add(cxobj *x,
 	si = NULL;
 	goto done;
     }
-    if ((si->si_xvec = clixon_xvec_new()) == NULL){
+    if (hash)
+	si->si_hash = search_hash_new();
+    else
+	si->si_xvec = clixon_xvec_new();
+    if (si->si_hash == NULL && si->si_xvec == NULL){
 	free(si->si_name);
 	free(si);
 	si = NULL;
 	goto done;
     }
     ADDQ(si, x->x_search_index);
+    xml_arena_foreign(x);
  done:
     return si;
 }
@@ -2511,8 +3386,9 @@ xml_search_index_get(cxobj *x,
 /*! Get sorted index vector for list for variable "name"
  * @param[in]  xp    XML parent object
  * @param[in]  name  Name of index variable
- * @param[out] xvec  XML object search vector
+ * @param[out] xvec  XML object search vector, NULL if not found or if it is a hash index
  * @retval     0     OK
+ * @see xml_search_hash_get  for hash indexes
  */
 int
 xml_search_vector_get(cxobj        *xp,
@@ -2534,9 +3410,61 @@ xml_search_vector_get(cxobj        *xp,
     return 0;
 }
 
+/*! Check if XML node has a search index for variable "name"
+ * @param[in]  xp    XML parent object (parent of list elements)
+ * @param[in]  name  Name of index variable
+ * @retval     1     Yes, sorted vector or hash index exists
+ * @retval     0     No
+ */
+int
+xml_search_index_has(cxobj *xp,
+		     char  *name)
+{
+    return xml_search_index_get(xp, name) != NULL;
+}
+
+/*! Get list elements using hash search index with exact match of index variable
+ * @param[in]  xp    XML parent object (parent of list elements)
+ * @param[in]  name  Name of index variable
+ * @param[in]  value Value of index variable to match
+ * @param[out] xvec  Matching list elements are appended to this vector
+ * @retval     1     Hash index found, see xvec (may be empty)
+ * @retval     0     No hash index for this variable, xvec unchanged
+ * @retval    -1     Error
+ * @note Match is made on the string representation of the body, not typed comparison
+ */
+int
+xml_search_hash_get(cxobj       *xp,
+		    char        *name,
+		    char        *value,
+		    clixon_xvec *xvec)
+{
+    struct search_index      *si;
+    struct search_hash_entry *she;
+    uint32_t                  h;
+    char                     *body;
+
+    if ((si = xml_search_index_get(xp, name)) == NULL || si->si_hash == NULL)
+	return 0;
+    h = search_hash_fn(value);
+    for (she = si->si_hash->sh_bucket[h & (si->si_hash->sh_size-1)]; she; she = she->she_next){
+	if (she->she_hash != h)
+	    continue;
+	if ((body = xml_find_body(she->she_x, name)) == NULL)
+	    body = "";
+	if (strcmp(body, value?value:"") != 0)
+	    continue;
+	if (clixon_xvec_append(xvec, she->she_x) < 0)
+	    return -1;
+    }
+    return 1;
+}
+
 /*! Insert a new cxobj into search index vector for list for variable "name"
  * @param[in] xp XML parent object (the list element)
  * @param[in] xi XML index object (that should be added)
+ * @retval    0  OK
+ * @retval   -1  Error
  */
 int
 xml_search_child_insert(cxobj *xp,
@@ -2548,6 +3476,7 @@ xml_search_child_insert(cxobj *xp,
     cxobj               *xpp;
     int                  i;
     int                  len;
+    yang_stmt           *y;
     
     indexvar = xml_name(xi);
     if ((xpp = xml_parent(xp)) == NULL)
@@ -2555,8 +3484,15 @@ xml_search_child_insert(cxobj *xp,
     /* Find base vector in grandparent */
     if ((si = xml_search_index_get(xpp, indexvar)) == NULL){
 	/* If not found add base vector in grand-parent */	      
-	if ((si = xml_search_index_add(xpp, indexvar)) == NULL)
+	y = xml_spec(xi);
+	if ((si = xml_search_index_add(xpp, indexvar,
+				       y && yang_flag_get(y, YANG_FLAG_INDEX_HASH))) == NULL)
+	    goto done;
+    }
+    if (si->si_hash){
+	if (search_hash_add(si->si_hash, xp, xi) < 0)
 	    goto done;
+	goto ok;
     }
     /* Find element position using binary search and then remove */
     len = clixon_xvec_len(si->si_xvec);
@@ -2572,8 +3508,13 @@ xml_search_child_insert(cxobj *xp,
 }
 
 /*! Remove a single cxobj from search vector 
+ * The binary search finds an element with an equal index value, but there may be several
+ * such elements, so the neighbours are searched for the exact object. If the value has been
+ * changed since the object was inserted, fall back to a linear search.
  * @param[in] xp  XML parent object (the list element)
- * @param[in] xi  XML index object (that should be added)
+ * @param[in] xi  XML index object (that should be removed)
+ * @retval    0   OK
+ * @retval   -1   Error
  */
 int
 xml_search_child_rm(cxobj *xp,
@@ -2583,6 +3524,7 @@ xml_search_child_rm(cxobj *xp,
     cxobj              *xpp;
     char               *indexvar;
     int                 i;
+    int                 j;
     int                 len;
     struct search_index *si;
     int                  eq = 0;
@@ -2593,21 +3535,94 @@ xml_search_child_rm(cxobj *xp,
     /* Find base vector in grandparent */
     if ((si = xml_search_index_get(xpp, indexvar)) == NULL)
 	goto ok;
-    
+    if (si->si_hash){
+	if (search_hash_rm(si->si_hash, xp, xi) < 0)
+	    goto done;
+	goto ok;
+    }
     /* Find element using binary search and then remove */
     len = clixon_xvec_len(si->si_xvec);
+    if (len == 0)
+	goto ok;
     if ((i = xml_search_indexvar_binary_pos(xp, indexvar, si->si_xvec, 0, len, len, &eq)) < 0)
 	goto done;
-	//    if (clixon_xvec_i(si->si_xvec, i) == xp)
-    if (eq)
-	if (clixon_xvec_rm_pos(si->si_xvec, i) < 0)
-	    goto done;		
+    if (eq){
+	for (j=i; j>=0; j--){
+	    if (clixon_xvec_i(si->si_xvec, j) == xp)
+		goto found;
+	    if (xml_cmp(xp, clixon_xvec_i(si->si_xvec, j), 0, 0, indexvar) != 0)
+		break;
+	}
+	for (j=i+1; j<len; j++){
+	    if (clixon_xvec_i(si->si_xvec, j) == xp)
+		goto found;
+	    if (xml_cmp(xp, clixon_xvec_i(si->si_xvec, j), 0, 0, indexvar) != 0)
+		break;
+	}
+    }
+    for (j=0; j<len; j++)
+	if (clixon_xvec_i(si->si_xvec, j) == xp)
+	    goto found;
+    goto ok;
+ found:
+    if (clixon_xvec_rm_pos(si->si_xvec, j) < 0)
+	goto done;		
  ok:
     retval = 0;
  done:
     return retval;
 }
 
+/*! Insert all index variables of a list element into the search indexes of its parent
+ * @param[in] xe  XML list element, with parent
+ * @retval    0   OK
+ * @retval   -1   Error
+ * @see xml_search_child_insert  for a single index variable
+ */
+int
+xml_search_list_insert(cxobj *xe)
+{
+    cxobj     *xi = NULL;
+    yang_stmt *y;
+
+    if ((y = xml_spec(xe)) == NULL ||
+	yang_keyword_get(y) != Y_LIST ||
+	xml_parent(xe) == NULL)
+	return 0;
+    while ((xi = xml_child_each(xe, xi, CX_ELMNT)) != NULL) {
+	if ((y = xml_spec(xi)) == NULL || yang_flag_get(y, YANG_FLAG_INDEX) == 0)
+	    continue;
+	if (xml_search_child_insert(xe, xi) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Remove all index variables of a list element from the search indexes of its parent
+ * @param[in] xe  XML list element, with parent
+ * @retval    0   OK
+ * @retval   -1   Error
+ * @see xml_search_child_rm  for a single index variable
+ */
+int
+xml_search_list_rm(cxobj *xe)
+{
+    cxobj     *xi = NULL;
+    yang_stmt *y;
+
+    if ((y = xml_spec(xe)) == NULL ||
+	yang_keyword_get(y) != Y_LIST ||
+	xml_parent(xe) == NULL)
+	return 0;
+    while ((xi = xml_child_each(xe, xi, CX_ELMNT)) != NULL) {
+	if ((y = xml_spec(xi)) == NULL || yang_flag_get(y, YANG_FLAG_INDEX) == 0)
+	    continue;
+	if (xml_search_child_rm(xe, xi) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
 /*! Iterator over xml children objects using (explicit) index variable
  *
  * @param[in] xparent xml tree node whose children should be iterated
@@ -0,0 +1,876 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Binary datastore format
+ * A compact pre-order encoding of a (yang-bound and sorted) XML tree, used when
+ * CLICON_XMLDB_FORMAT is "binary". The file is mmap:ed on load and the tree is built
+ * without text parsing, and yang bindings are resolved once per distinct yang node
+ * instead of once per XML node.
+ *
+ * All integers are unsigned LEB128 varints. The file has the form:
+ *   file    ::= "CLXB" <version> <fingerprint> root
+ *   root    ::= CX_ELMNT strref(name) strref(prefix) yangref <nr> (<len> node)*
+ *   node    ::= CX_ELMNT strref(name) strref(prefix) yangref <nr> node*
+ *             | CX_ATTR strref(name) strref(prefix) value
+ *             | CX_BODY value
+ *   strref  ::= 0                  # NULL
+ *             | 1 <len> <bytes>    # New string, appended to string table
+ *             | <n+2>              # Index n in string table
+ *   yangref ::= 0                  # Not bound to yang
+ *             | 1 strref(ns)       # New yang node, appended to yang table
+ *             | <n+2>              # Index n in yang table
+ *   value   ::= 0 | <len+1> <bytes>
+ * Each top-level node (child of root) is prefixed with its length and has its own string
+ * and yang tables. It can therefore be skipped on load and kept unparsed as a lazy
+ * node, see xml_lazy_set, and written back as-is.
+ * The fingerprint is a hash of the names and revisions of all modules of the yang spec
+ * that was used when writing. Yang bindings of the file are only used if it matches the
+ * yang spec used when loading.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_queue.h"
+#include "clixon_string.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_yang_module.h"
+#include "clixon_xml_bind.h"
+#include "clixon_xml_sort.h"
+#include "clixon_xml_binary.h"
+
+#define BINARY_MAGIC   "CLXB"
+#define BINARY_VERSION 1
+
+/* Encoder state: interned strings and yang nodes seen so far
+ */
+struct binary_enc {
+    FILE          *be_f;
+    clicon_hash_t *be_strs;   /* string -> index in string table */
+    int            be_nstrs;
+    clicon_hash_t *be_ys;     /* yang pointer -> index in yang table */
+    int            be_nys;
+};
+
+/* Decoder state, string and yang tables are built as they appear in the file
+ */
+struct binary_dec {
+    const uint8_t *bd_p;      /* Current position in mapped file */
+    const uint8_t *bd_end;    /* End of mapped file */
+    char         **bd_strs;   /* String table */
+    size_t         bd_nstrs;
+    size_t         bd_slen;   /* Allocated length of string table */
+    yang_stmt    **bd_ys;     /* Yang table, NULL entries are unresolved */
+    size_t         bd_nys;
+    size_t         bd_ylen;   /* Allocated length of yang table */
+    yang_stmt     *bd_yspec;  /* Resolve yang bindings if set */
+    char          *bd_buf;    /* Value buffer (file strings are not null-terminated) */
+    size_t         bd_buflen;
+    int            bd_bound;  /* Cleared if any node below top-level is unresolved */
+    int            bd_lazy;   /* Keep top-level nodes unparsed */
+};
+
+/*! Compute a fingerprint of a yang spec from module names and revisions
+ * @param[in]  yspec  Yang spec
+ * @retval     fp     32-bit FNV-1a hash
+ */
+static uint32_t
+binary_yspec_fingerprint(yang_stmt *yspec)
+{
+    uint32_t   fp = 2166136261U;
+    yang_stmt *ym = NULL;
+    yang_stmt *yrev;
+    char      *str;
+    uint32_t   rev;
+    int        i;
+
+    while ((ym = yn_each(yspec, ym)) != NULL) {
+	if (yang_keyword_get(ym) != Y_MODULE && yang_keyword_get(ym) != Y_SUBMODULE)
+	    continue;
+	for (str = yang_argument_get(ym); *str; str++)
+	    fp = (fp ^ (uint8_t)*str) * 16777619U;
+	rev = 0;
+	if ((yrev = yang_find(ym, Y_REVISION, NULL)) != NULL)
+	    rev = cv_uint32_get(yang_cv_get(yrev));
+	for (i=0; i<4; i++)
+	    fp = (fp ^ ((rev >> (8*i)) & 0xff)) * 16777619U;
+    }
+    return fp;
+}
+
+static int
+binary_put_varint(FILE    *f,
+		  uint64_t v)
+{
+    while (v >= 0x80){
+	if (fputc((int)(v & 0x7f) | 0x80, f) == EOF)
+	    goto err;
+	v >>= 7;
+    }
+    if (fputc((int)v, f) == EOF)
+	goto err;
+    return 0;
+ err:
+    clicon_err(OE_UNIX, errno, "fputc");
+    return -1;
+}
+
+static int
+binary_put_value(FILE *f,
+		 char *val)
+{
+    size_t len;
+
+    if (val == NULL)
+	return binary_put_varint(f, 0);
+    len = strlen(val);
+    if (binary_put_varint(f, len+1) < 0)
+	return -1;
+    if (len && fwrite(val, 1, len, f) != len){
+	clicon_err(OE_UNIX, errno, "fwrite");
+	return -1;
+    }
+    return 0;
+}
+
+static int
+binary_put_strref(struct binary_enc *be,
+		  char              *str)
+{
+    int *idx;
+
+    if (str == NULL)
+	return binary_put_varint(be->be_f, 0);
+    if ((idx = clicon_hash_value(be->be_strs, str, NULL)) != NULL)
+	return binary_put_varint(be->be_f, *idx+2);
+    if (clicon_hash_add(be->be_strs, str, &be->be_nstrs, sizeof(be->be_nstrs)) == NULL)
+	return -1;
+    be->be_nstrs++;
+    if (binary_put_varint(be->be_f, 1) < 0)
+	return -1;
+    /* Same encoding as value, except that value 0 is not used */
+    return binary_put_value(be->be_f, str) < 0 ? -1 : 0;
+}
+
+static int
+binary_put_yangref(struct binary_enc *be,
+		   yang_stmt         *y)
+{
+    char  key[32];
+    int  *idx;
+
+    if (y == NULL)
+	return binary_put_varint(be->be_f, 0);
+    snprintf(key, sizeof(key), "%p", y);
+    if ((idx = clicon_hash_value(be->be_ys, key, NULL)) != NULL)
+	return binary_put_varint(be->be_f, *idx+2);
+    if (clicon_hash_add(be->be_ys, key, &be->be_nys, sizeof(be->be_nys)) == NULL)
+	return -1;
+    be->be_nys++;
+    if (binary_put_varint(be->be_f, 1) < 0)
+	return -1;
+    return binary_put_strref(be, yang_find_mynamespace(y));
+}
+
+static int xml2binary_top(FILE *f, cxobj *x);
+
+/*! Encode a node and its children recursively
+ * @param[in]  be    Encoder state
+ * @param[in]  x     XML node
+ * @param[in]  root  x is root, its children are top-level nodes
+ */
+static int
+xml2binary1(struct binary_enc *be,
+	    cxobj             *x,
+	    int                root)
+{
+    int    retval = -1;
+    cxobj *xc;
+
+    if (binary_put_varint(be->be_f, xml_type(x)) < 0)
+	goto done;
+    switch (xml_type(x)){
+    case CX_ELMNT:
+	if (binary_put_strref(be, xml_name(x)) < 0)
+	    goto done;
+	if (binary_put_strref(be, xml_prefix(x)) < 0)
+	    goto done;
+	if (binary_put_yangref(be, xml_spec(x)) < 0)
+	    goto done;
+	if (binary_put_varint(be->be_f, xml_child_nr(x)) < 0)
+	    goto done;
+	xc = NULL;
+	while ((xc = xml_child_each(x, xc, -1)) != NULL)
+	    if ((root ? xml2binary_top(be->be_f, xc) : xml2binary1(be, xc, 0)) < 0)
+		goto done;
+	break;
+    case CX_ATTR:
+	if (binary_put_strref(be, xml_name(x)) < 0)
+	    goto done;
+	if (binary_put_strref(be, xml_prefix(x)) < 0)
+	    goto done;
+	if (binary_put_value(be->be_f, xml_value(x)) < 0)
+	    goto done;
+	break;
+    case CX_BODY:
+	if (binary_put_value(be->be_f, xml_value(x)) < 0)
+	    goto done;
+	break;
+    default:
+	clicon_err(OE_XML, EINVAL, "Unexpected XML type: %d", xml_type(x));
+	goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Encode a top-level node with its own tables, prefixed with its length
+ * @param[in]  f     Output file
+ * @param[in]  x     Top-level XML node
+ */
+static int
+xml2binary_top(FILE  *f,
+	       cxobj *x)
+{
+    int               retval = -1;
+    struct binary_enc be = {0,};
+    char             *lazy;
+    char             *buf = NULL;
+    size_t            len = 0;
+
+    /* Not materialized: the content is already in this encoding */
+    if ((lazy = xml_lazy_get(x, &len)) == NULL){
+	if ((be.be_strs = clicon_hash_init()) == NULL)
+	    goto done;
+	if ((be.be_ys = clicon_hash_init()) == NULL)
+	    goto done;
+	if ((be.be_f = open_memstream(&buf, &len)) == NULL){
+	    clicon_err(OE_UNIX, errno, "open_memstream");
+	    goto done;
+	}
+	if (xml2binary1(&be, x, 0) < 0)
+	    goto done;
+	if (fclose(be.be_f) != 0){
+	    be.be_f = NULL;
+	    clicon_err(OE_UNIX, errno, "fclose");
+	    goto done;
+	}
+	be.be_f = NULL;
+    }
+    if (binary_put_varint(f, len) < 0)
+	goto done;
+    if (len && fwrite(lazy?lazy:buf, 1, len, f) != len){
+	clicon_err(OE_UNIX, errno, "fwrite");
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (be.be_f)
+	fclose(be.be_f);
+    if (buf)
+	free(buf);
+    if (be.be_strs)
+	clicon_hash_free(be.be_strs);
+    if (be.be_ys)
+	clicon_hash_free(be.be_ys);
+    return retval;
+}
+
+/*! Write an XML tree to file in binary format
+ *
+ * @param[in]  f      Output file
+ * @param[in]  x      XML tree, including x itself
+ * @param[in]  yspec  Yang spec the tree is bound to, used for fingerprint, or NULL
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @note The tree should be sorted, since sorting is skipped when loading a bound tree
+ * @note Lazy (not materialized) top-level nodes are written as-is
+ * @see clixon_binary_parse_file
+ */
+int
+xml2binary(FILE      *f,
+	   cxobj     *x,
+	   yang_stmt *yspec)
+{
+    int               retval = -1;
+    struct binary_enc be = {0,};
+
+    be.be_f = f;
+    if ((be.be_strs = clicon_hash_init()) == NULL)
+	goto done;
+    if ((be.be_ys = clicon_hash_init()) == NULL)
+	goto done;
+    if (fwrite(BINARY_MAGIC, 1, strlen(BINARY_MAGIC), f) != strlen(BINARY_MAGIC)){
+	clicon_err(OE_UNIX, errno, "fwrite");
+	goto done;
+    }
+    if (binary_put_varint(f, BINARY_VERSION) < 0)
+	goto done;
+    if (binary_put_varint(f, yspec?binary_yspec_fingerprint(yspec):0) < 0)
+	goto done;
+    if (xml2binary1(&be, x, 1) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (be.be_strs)
+	clicon_hash_free(be.be_strs);
+    if (be.be_ys)
+	clicon_hash_free(be.be_ys);
+    return retval;
+}
+
+/*! Free string and yang tables and buffer of decoder state
+ */
+static void
+binary_dec_free(struct binary_dec *bd)
+{
+    size_t i;
+
+    for (i=0; i<bd->bd_nstrs; i++)
+	free(bd->bd_strs[i]);
+    if (bd->bd_strs)
+	free(bd->bd_strs);
+    if (bd->bd_ys)
+	free(bd->bd_ys);
+    if (bd->bd_buf)
+	free(bd->bd_buf);
+    bd->bd_strs = NULL;
+    bd->bd_nstrs = bd->bd_slen = 0;
+    bd->bd_ys = NULL;
+    bd->bd_nys = bd->bd_ylen = 0;
+    bd->bd_buf = NULL;
+    bd->bd_buflen = 0;
+}
+
+static int
+binary_get_varint(struct binary_dec *bd,
+		  uint64_t          *vp)
+{
+    uint64_t v = 0;
+    int      shift = 0;
+    uint8_t  b;
+
+    do {
+	if (bd->bd_p >= bd->bd_end || shift > 63){
+	    clicon_err(OE_XML, 0, "Truncated or malformed binary datastore");
+	    return -1;
+	}
+	b = *bd->bd_p++;
+	v |= (uint64_t)(b & 0x7f) << shift;
+	shift += 7;
+    } while (b & 0x80);
+    *vp = v;
+    return 0;
+}
+
+/*! Get a value from file into a null-terminated buffer
+ * @param[in]  bd   Decoder state
+ * @param[out] vp   Value (pointer to decoder buffer) or NULL
+ */
+static int
+binary_get_value(struct binary_dec *bd,
+		 char             **vp)
+{
+    uint64_t len;
+
+    if (binary_get_varint(bd, &len) < 0)
+	return -1;
+    if (len == 0){
+	*vp = NULL;
+	return 0;
+    }
+    len--;
+    if (len > (uint64_t)(bd->bd_end - bd->bd_p)){
+	clicon_err(OE_XML, 0, "Truncated binary datastore");
+	return -1;
+    }
+    if (len+1 > bd->bd_buflen){
+	bd->bd_buflen = len+1;
+	if ((bd->bd_buf = realloc(bd->bd_buf, bd->bd_buflen)) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+    }
+    memcpy(bd->bd_buf, bd->bd_p, len);
+    bd->bd_buf[len] = '\0';
+    bd->bd_p += len;
+    *vp = bd->bd_buf;
+    return 0;
+}
+
+static int
+binary_get_strref(struct binary_dec *bd,
+		  char             **sp)
+{
+    uint64_t ref;
+    char    *str;
+
+    if (binary_get_varint(bd, &ref) < 0)
+	return -1;
+    if (ref == 0){
+	*sp = NULL;
+	return 0;
+    }
+    if (ref == 1){
+	if (binary_get_value(bd, &str) < 0)
+	    return -1;
+	if (bd->bd_nstrs == bd->bd_slen){
+	    bd->bd_slen = bd->bd_slen ? 2*bd->bd_slen : 64;
+	    if ((bd->bd_strs = realloc(bd->bd_strs, bd->bd_slen*sizeof(char*))) == NULL){
+		clicon_err(OE_UNIX, errno, "realloc");
+		return -1;
+	    }
+	}
+	if ((bd->bd_strs[bd->bd_nstrs] = strdup(str?str:"")) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    return -1;
+	}
+	*sp = bd->bd_strs[bd->bd_nstrs++];
+	return 0;
+    }
+    if (ref-2 >= bd->bd_nstrs){
+	clicon_err(OE_XML, 0, "Malformed binary datastore: string reference %llu",
+		   (unsigned long long)ref);
+	return -1;
+    }
+    *sp = bd->bd_strs[ref-2];
+    return 0;
+}
+
+/*! Resolve yang binding of a new yang table entry
+ * Done once per distinct yang node, subsequent nodes with the same binding are
+ * looked up in the yang table.
+ * @param[in]  bd    Decoder state
+ * @param[in]  xp    XML parent
+ * @param[in]  name  Name of XML node
+ * @param[in]  ns    Namespace of the yang node that was written
+ * @param[in]  top   XML parent is top-level
+ * @retval     y     Yang node, or NULL if not found
+ */
+static yang_stmt *
+binary_yang_resolve(struct binary_dec *bd,
+		    cxobj             *xp,
+		    char              *name,
+		    char              *ns,
+		    int                top)
+{
+    yang_stmt *yp;
+    yang_stmt *ymod;
+    yang_stmt *y = NULL;
+    char      *ns1;
+
+    if (bd->bd_yspec == NULL || ns == NULL)
+	return NULL;
+    if ((yp = xml_spec(xp)) != NULL)
+	y = yang_find_datanode(yp, name);
+    else if (top &&
+	     (ymod = yang_find_module_by_namespace(bd->bd_yspec, ns)) != NULL)
+	y = yang_find_schemanode(ymod, name);
+    if (y && ((ns1 = yang_find_mynamespace(y)) == NULL || strcmp(ns, ns1) != 0))
+	y = NULL;
+    return y;
+}
+
+static int
+binary_get_yangref(struct binary_dec *bd,
+		   cxobj             *xp,
+		   char              *name,
+		   int                top,
+		   yang_stmt        **yp)
+{
+    uint64_t   ref;
+    char      *ns;
+
+    if (binary_get_varint(bd, &ref) < 0)
+	return -1;
+    if (ref == 0){
+	*yp = NULL;
+	return 0;
+    }
+    if (ref == 1){
+	if (binary_get_strref(bd, &ns) < 0)
+	    return -1;
+	if (bd->bd_nys == bd->bd_ylen){
+	    bd->bd_ylen = bd->bd_ylen ? 2*bd->bd_ylen : 64;
+	    if ((bd->bd_ys = realloc(bd->bd_ys, bd->bd_ylen*sizeof(yang_stmt*))) == NULL){
+		clicon_err(OE_UNIX, errno, "realloc");
+		return -1;
+	    }
+	}
+	bd->bd_ys[bd->bd_nys] = binary_yang_resolve(bd, xp, name, ns, top);
+	*yp = bd->bd_ys[bd->bd_nys++];
+	return 0;
+    }
+    if (ref-2 >= bd->bd_nys){
+	clicon_err(OE_XML, 0, "Malformed binary datastore: yang reference %llu",
+		   (unsigned long long)ref);
+	return -1;
+    }
+    *yp = bd->bd_ys[ref-2];
+    return 0;
+}
+
+static int binary_parse_top(struct binary_dec *bd, cxobj *xp);
+
+/*! Decode a node and its children recursively
+ * @param[in]  bd     Decoder state
+ * @param[in]  xp     XML parent
+ * @param[in]  depth  Depth of xp, 0 is the top-level (eg config) element, -1 its parent
+ * @param[in]  anyx   xp is in anydata/anyxml, children are not bound
+ */
+static int
+binary_parse1(struct binary_dec *bd,
+	      cxobj             *xp,
+	      int                depth,
+	      int                anyx)
+{
+    int        retval = -1;
+    uint64_t   type;
+    uint64_t   nr;
+    uint64_t   i;
+    char      *name;
+    char      *prefix;
+    char      *val;
+    yang_stmt *y;
+    cxobj     *x;
+
+    if (binary_get_varint(bd, &type) < 0)
+	goto done;
+    switch (type){
+    case CX_ELMNT:
+	if (binary_get_strref(bd, &name) < 0 ||
+	    binary_get_strref(bd, &prefix) < 0)
+	    goto done;
+	if (name == NULL){
+	    clicon_err(OE_XML, 0, "Malformed binary datastore: no element name");
+	    goto done;
+	}
+	if ((x = xml_new(name, xp, CX_ELMNT)) == NULL)
+	    goto done;
+	if (prefix && xml_prefix_set(x, prefix) < 0)
+	    goto done;
+	if (binary_get_yangref(bd, xp, name, depth == 0, &y) < 0)
+	    goto done;
+	if (y != NULL)
+	    xml_spec_set(x, y);
+	else if (depth > 0 && !anyx) /* top-level checked by caller */
+	    bd->bd_bound = 0;
+	if (binary_get_varint(bd, &nr) < 0)
+	    goto done;
+	for (i=0; i<nr; i++){
+	    if (depth == -1){ /* x is root */
+		if (binary_parse_top(bd, x) < 0)
+		    goto done;
+	    }
+	    else if (binary_parse1(bd, x, depth+1,
+				   anyx || (y && (yang_keyword_get(y) == Y_ANYDATA ||
+						  yang_keyword_get(y) == Y_ANYXML))) < 0)
+		goto done;
+	}
+#ifdef XML_EXPLICIT_INDEX
+	if (xp && y && xml_search_index_p(x))
+	    xml_search_child_insert(xp, x);
+#endif
+	break;
+    case CX_ATTR:
+	if (binary_get_strref(bd, &name) < 0 ||
+	    binary_get_strref(bd, &prefix) < 0)
+	    goto done;
+	if (name == NULL || xp == NULL){
+	    clicon_err(OE_XML, 0, "Malformed binary datastore: misplaced attribute");
+	    goto done;
+	}
+	if ((x = xml_new(name, xp, CX_ATTR)) == NULL)
+	    goto done;
+	if (prefix && xml_prefix_set(x, prefix) < 0)
+	    goto done;
+	if (binary_get_value(bd, &val) < 0)
+	    goto done;
+	if (val && xml_value_set(x, val) < 0)
+	    goto done;
+	break;
+    case CX_BODY:
+	if (xp == NULL){
+	    clicon_err(OE_XML, 0, "Malformed binary datastore: misplaced body");
+	    goto done;
+	}
+	if ((x = xml_new("body", xp, CX_BODY)) == NULL)
+	    goto done;
+	if (binary_get_value(bd, &val) < 0)
+	    goto done;
+	if (val && xml_value_set(x, val) < 0)
+	    goto done;
+	break;
+    default:
+	clicon_err(OE_XML, 0, "Malformed binary datastore: node type %llu",
+		   (unsigned long long)type);
+	goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Decode a top-level node, or keep it unparsed as a lazy node
+ * @param[in]  bd     Decoder state
+ * @param[in]  xp     XML root
+ */
+static int
+binary_parse_top(struct binary_dec *bd,
+		 cxobj             *xp)
+{
+    int               retval = -1;
+    struct binary_dec bd1 = {0,};
+    uint64_t          len;
+    uint64_t          type;
+    char             *name = NULL;
+    char             *prefix = NULL;
+    yang_stmt        *y = NULL;
+    cxobj            *x;
+
+    if (binary_get_varint(bd, &len) < 0)
+	goto done;
+    if (len > (uint64_t)(bd->bd_end - bd->bd_p)){
+	clicon_err(OE_XML, 0, "Truncated binary datastore");
+	goto done;
+    }
+    /* Own string and yang tables */
+    bd1.bd_p = bd->bd_p;
+    bd1.bd_end = bd->bd_p + len;
+    bd1.bd_yspec = bd->bd_yspec;
+    bd1.bd_bound = bd->bd_bound;
+    if (bd->bd_lazy && bd->bd_yspec){
+	/* Peek at element header: only bound elements can be lazy */
+	if (binary_get_varint(&bd1, &type) < 0)
+	    goto done;
+	if (type == CX_ELMNT){
+	    if (binary_get_strref(&bd1, &name) < 0 ||
+		binary_get_strref(&bd1, &prefix) < 0)
+		goto done;
+	    if (name && binary_get_yangref(&bd1, xp, name, 1, &y) < 0)
+		goto done;
+	}
+	if (y != NULL){
+	    if ((x = xml_new(name, xp, CX_ELMNT)) == NULL)
+		goto done;
+	    if (prefix && xml_prefix_set(x, prefix) < 0)
+		goto done;
+	    xml_spec_set(x, y);
+	    if (xml_lazy_set(x, (void*)bd->bd_p, len) < 0)
+		goto done;
+	    bd->bd_p += len;
+	    goto ok;
+	}
+	binary_dec_free(&bd1);
+	bd1.bd_p = bd->bd_p;
+    }
+    if (binary_parse1(&bd1, xp, 0, 0) < 0)
+	goto done;
+    bd->bd_bound = bd1.bd_bound;
+    bd->bd_p += len;
+ ok:
+    retval = 0;
+ done:
+    binary_dec_free(&bd1);
+    return retval;
+}
+
+/*! Materialize a lazy node by decoding its content
+ *
+ * The node is bound to yang and sorted as if it was loaded directly.
+ * @param[in]  x    XML node, if not lazy, do nothing
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see clixon_binary_parse_file  with lazy set
+ */
+int
+clixon_binary_materialize(cxobj *x)
+{
+    int               retval = -1;
+    struct binary_dec bd = {0,};
+    char             *buf;
+    size_t            len;
+    uint64_t          type;
+    uint64_t          nr;
+    uint64_t          i;
+    char             *name;
+    char             *prefix;
+    yang_stmt        *y;
+    int               anyx;
+    int               ret;
+
+    if ((buf = xml_lazy_get(x, &len)) == NULL)
+	return 0;
+    bd.bd_p = (const uint8_t*)buf;
+    bd.bd_end = (const uint8_t*)buf + len;
+    bd.bd_yspec = ys_spec(xml_spec(x));
+    bd.bd_bound = 1;
+    /* Element header, already decoded when made lazy */
+    if (binary_get_varint(&bd, &type) < 0)
+	goto done;
+    if (type != CX_ELMNT){
+	clicon_err(OE_XML, 0, "Malformed binary datastore: lazy node is not element");
+	goto done;
+    }
+    if (binary_get_strref(&bd, &name) < 0 ||
+	binary_get_strref(&bd, &prefix) < 0 ||
+	binary_get_yangref(&bd, xml_parent(x), name, 1, &y) < 0 ||
+	binary_get_varint(&bd, &nr) < 0)
+	goto done;
+    y = xml_spec(x);
+    anyx = (yang_keyword_get(y) == Y_ANYDATA || yang_keyword_get(y) == Y_ANYXML);
+    for (i=0; i<nr; i++)
+	if (binary_parse1(&bd, x, 1, anyx) < 0)
+	    goto done;
+    if (xml_lazy_clear(x) < 0)
+	goto done;
+    if (!bd.bd_bound){
+	if ((ret = xml_bind_yang(x, YB_PARENT, NULL, NULL)) < 0)
+	    goto done;
+	if (ret == 0)
+	    clicon_log(LOG_WARNING, "%s: Failed to bind yang of %s", __FUNCTION__, xml_name(x));
+	if (xml_sort_recurse(x) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    binary_dec_free(&bd);
+    return retval;
+}
+
+/*! Read an XML tree from a file in binary format
+ *
+ * The file is mapped into memory and decoded in one pass. If yspec is given and the
+ * fingerprint of the file matches, yang bindings are set on the nodes.
+ * @param[in]     fp     Open file, the file position is not used or changed
+ * @param[in]     yspec  Yang spec, if NULL do not bind yang
+ * @param[in]     lazy   Keep bound top-level nodes unparsed until clixon_binary_materialize
+ * @param[in,out] xt     Pointer to parse tree. If empty, create a top-level "top".
+ * @param[out]    bound  Set to 1 if all nodes below the top-level children were bound
+ * @retval        1      OK
+ * @retval        0      File is not in binary format (eg empty or XML)
+ * @retval       -1      Error
+ * @note Top-level children (eg <config><x>) may be unbound also if bound is 1, the
+ *       caller needs to check them, eg after stripping module-state
+ * @note lazy is only used if the yang spec fingerprint matches
+ * @see xml2binary
+ */
+int
+clixon_binary_parse_file(FILE       *fp,
+			 yang_stmt  *yspec,
+			 int         lazy,
+			 cxobj     **xt,
+			 int        *bound)
+{
+    int               retval = -1;
+    struct stat       st;
+    void             *map = MAP_FAILED;
+    struct binary_dec bd = {0,};
+    uint64_t          version;
+    uint64_t          fp0;
+    cxobj            *xtop = NULL;
+
+    if (fstat(fileno(fp), &st) < 0){
+	clicon_err(OE_UNIX, errno, "fstat");
+	goto done;
+    }
+    if (st.st_size < (off_t)strlen(BINARY_MAGIC))
+	goto fail;
+    if ((map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0)) == MAP_FAILED){
+	clicon_err(OE_UNIX, errno, "mmap");
+	goto done;
+    }
+    if (memcmp(map, BINARY_MAGIC, strlen(BINARY_MAGIC)) != 0)
+	goto fail;
+    bd.bd_p = (const uint8_t*)map + strlen(BINARY_MAGIC);
+    bd.bd_end = (const uint8_t*)map + st.st_size;
+    if (binary_get_varint(&bd, &version) < 0)
+	goto done;
+    if (version != BINARY_VERSION){
+	clicon_err(OE_XML, 0, "Binary datastore version %llu not supported",
+		   (unsigned long long)version);
+	goto done;
+    }
+    if (binary_get_varint(&bd, &fp0) < 0)
+	goto done;
+    if (yspec && fp0 == binary_yspec_fingerprint(yspec))
+	bd.bd_yspec = yspec;
+    bd.bd_bound = bd.bd_yspec != NULL;
+    bd.bd_lazy = lazy;
+    if (*xt == NULL){
+	if ((xtop = xml_new("top", NULL, CX_ELMNT)) == NULL)
+	    goto done;
+    }
+    if (binary_parse1(&bd, *xt?*xt:xtop, -1, 0) < 0)
+	goto done;
+    if (xtop){
+	*xt = xtop;
+	xtop = NULL;
+    }
+    if (bound)
+	*bound = bd.bd_bound;
+    retval = 1;
+ done:
+    if (xtop)
+	xml_free(xtop);
+    binary_dec_free(&bd);
+    if (map != MAP_FAILED)
+	munmap(map, st.st_size);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
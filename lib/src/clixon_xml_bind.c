@@ -77,6 +77,8 @@
 #include "clixon_netconf_lib.h"
 #include "clixon_xml_sort.h"
 #include "clixon_yang_type.h"
+#include "clixon_xml_vec.h"
+#include "clixon_xml_parallel.h"
 #include "clixon_xml_bind.h"
 
 /*
@@ -84,6 +86,12 @@
  */
 static int _yang_unknown_anydata = 0;
 
+/*
+ * Forward declarations
+ */
+static int xml_bind_yang0_opt(cxobj *xt, yang_bind yb, cxobj *xsibling, cxobj **xerr);
+static int xml_bind_yang_parallel(cxobj *xt, yang_bind yb, yang_stmt *yspec, cxobj **xerr);
+
 /*! Kludge to equate unknown XML with anydata
  * The problem with this is that its global and should be bound to a handle
  */
@@ -356,6 +364,12 @@ xml_bind_yang(cxobj     *xt,
     cxobj *xc;         /* xml child */
     int    ret;
 
+    /* Unknown nodes as anydata modifies yang, and arena trees cannot be modified by threads */
+    if (xml_parallel_threads() > 1 &&
+	(yb == YB_MODULE || yb == YB_PARENT) &&
+	!_yang_unknown_anydata &&
+	!xml_flag(xt, XML_FLAG_ARENA))
+	return xml_bind_yang_parallel(xt, yb, yspec, xerr);
     strip_whitespace(xt);
     xc = NULL;     /* Apply on children */
     while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL) {
@@ -372,11 +386,19 @@ xml_bind_yang(cxobj     *xt,
     goto done;
 }
 
+
+/*! Find yang spec association of children of an XML node already bound to yang
+ * @param[in]   xt       XML tree node, its children are bound
+ * @param[in]   xsibling Previous sibling of xt with same name, its children are used as cache
+ * @param[out]  xerr     Reason for failure, or NULL
+ * @retval      1        OK yang assignment made
+ * @retval      0        Partial or no yang assigment made (at least one failed) and xerr set
+ * @retval     -1        Error
+ */
 static int
-xml_bind_yang0_opt(cxobj     *xt, 
-		   yang_bind  yb,
-		   cxobj     *xsibling,
-		   cxobj    **xerr)
+xml_bind_yang_children(cxobj     *xt, 
+		       cxobj     *xsibling,
+		       cxobj    **xerr)
 {
     int        retval = -1;
     cxobj     *xc;           /* xml child */
@@ -389,21 +411,6 @@ xml_bind_yang0_opt(cxobj     *xt,
     char      *name;
     char      *prefix;
 
-    switch (yb){
-    case YB_PARENT:
-	if ((ret = populate_self_parent(xt, xsibling, xerr)) < 0)
-	    goto done;
-	break;
-    default:
-	clicon_err(OE_XML, EINVAL, "Invalid yang binding: %d", yb);
-	goto done;
-	break;
-    }
-    if (ret == 0)
-	goto fail;
-    else if (ret == 2)     /* ret=2 for anyxml from parent^ */
-    	goto ok;
-    strip_whitespace(xt);
     xc = NULL;     /* Apply on children */
     while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL) {
 	/* It is xml2ns in populate_self_parent that needs improvement */
@@ -430,6 +437,42 @@ xml_bind_yang0_opt(cxobj     *xt,
 	name0 = xml_name(xc);
 	prefix0 = xml_prefix(xc);
     }
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+static int
+xml_bind_yang0_opt(cxobj     *xt, 
+		   yang_bind  yb,
+		   cxobj     *xsibling,
+		   cxobj    **xerr)
+{
+    int        retval = -1;
+    int        ret;
+
+    switch (yb){
+    case YB_PARENT:
+	if ((ret = populate_self_parent(xt, xsibling, xerr)) < 0)
+	    goto done;
+	break;
+    default:
+	clicon_err(OE_XML, EINVAL, "Invalid yang binding: %d", yb);
+	goto done;
+	break;
+    }
+    if (ret == 0)
+	goto fail;
+    else if (ret == 2)     /* ret=2 for anyxml from parent^ */
+    	goto ok;
+    strip_whitespace(xt);
+    if ((ret = xml_bind_yang_children(xt, xsibling, xerr)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
  ok:
     retval = 1;
  done:
@@ -439,6 +482,169 @@ xml_bind_yang0_opt(cxobj     *xt,
     goto done;
 }
 
+/*! Parallel job function binding the children of one subtree, see xml_parallel_apply
+ */
+static int
+xml_bind_yang_fn(cxobj  *x,
+		 void   *arg,
+		 cxobj **xerr)
+{
+    return xml_bind_yang_children(x, NULL, xerr);
+}
+
+/*! Ensure namespace cache of a node contains all namespaces in its context
+ * After this, namespace lookups from its descendants do not update the caches of this node 
+ * or its ancestors, which are therefore not modified when its subtrees are bound in parallel
+ * @param[in]  xp   XML node
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_bind_yang_nsc(cxobj *xp)
+{
+    int     retval = -1;
+    cvec   *nsc = NULL;
+    cg_var *cv = NULL;
+    char   *ns;
+
+    if (xml_nsctx_node(xp, &nsc) < 0)
+	goto done;
+    while ((cv = cvec_each(nsc, cv)) != NULL)
+	if (nscache_get(xp, cv_name_get(cv)) == NULL &&
+	    nscache_set(xp, cv_name_get(cv), cv_string_get(cv)) < 0)
+	    goto done;
+    /* Default namespace may also be implicit */
+    if (xml2ns(xp, NULL, &ns) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+}
+
+/*! Add a bound subtree to parallel job, or bind it here if it cannot be done in parallel
+ * Children of a list with explicit search index variables update the search index of the
+ * parent of the list, which is shared with the siblings.
+ * @param[in]   x      XML subtree, bound to yang but not its children
+ * @param[in]   xv     Parallel job vector
+ * @param[out]  xerr   Reason for failure, or NULL
+ * @retval      1      OK
+ * @retval      0      Failed and xerr set
+ * @retval     -1      Error
+ */
+static int
+xml_bind_yang_job_add(cxobj       *x,
+		      clixon_xvec *xv,
+		      cxobj      **xerr)
+{
+#ifdef XML_EXPLICIT_INDEX
+    yang_stmt *y;
+    yang_stmt *yc = NULL;
+    
+    if ((y = xml_spec(x)) != NULL && yang_keyword_get(y) == Y_LIST)
+	while ((yc = yn_each(y, yc)) != NULL)
+	    if (yang_flag_get(yc, YANG_FLAG_INDEX))
+		return xml_bind_yang_children(x, NULL, xerr);
+#endif
+    return clixon_xvec_append(xv, x) < 0 ? -1 : 1;
+}
+
+/*! Bind children of xt in this thread and collect their subtrees to be bound in parallel
+ * @param[in]   xt     XML tree node, bound to yang (except top-level)
+ * @param[in]   yb     How to bind children of xt, YB_MODULE or YB_PARENT
+ * @param[in]   yspec  Yang spec
+ * @param[in]   xv     Vector of subtrees to be bound in parallel
+ * @param[out]  xerr   Reason for failure, or NULL
+ * @retval      1      OK
+ * @retval      0      Failed and xerr set
+ * @retval     -1      Error
+ * @see xml_parallel_split
+ */
+static int
+xml_bind_yang_split(cxobj       *xt, 
+		    yang_bind    yb,
+		    yang_stmt   *yspec,
+		    clixon_xvec *xv,
+		    cxobj      **xerr)
+{
+    int    retval = -1;
+    cxobj *xc;
+    cxobj *xc0 = NULL;
+    int    ret;
+
+    if (xml_bind_yang_nsc(xt) < 0)
+	goto done;
+    xc = NULL;
+    while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL) {
+	if (xc0 &&
+	    (clicon_strcmp(xml_name(xc0), xml_name(xc)) != 0 ||
+	     clicon_strcmp(xml_prefix(xc0), xml_prefix(xc)) != 0))
+	    xc0 = NULL;
+	if (yb == YB_MODULE)
+	    ret = populate_self_top(xc, yspec, xerr);
+	else
+	    ret = populate_self_parent(xc, xc0, xerr);
+	if (ret < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	if (ret == 2) /* anyxml */
+	    continue;
+	strip_whitespace(xc);
+	if (xml_parallel_split(xt, xc))
+	    ret = xml_bind_yang_split(xc, YB_PARENT, yspec, xv, xerr);
+	else
+	    ret = xml_bind_yang_job_add(xc, xv, xerr);
+	if (ret < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	xc0 = xc;
+    }
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Find yang spec association of children of xt using several threads
+ * The top of the tree is bound in this thread and its subtrees are bound in parallel
+ * @see xml_bind_yang
+ */
+static int
+xml_bind_yang_parallel(cxobj     *xt, 
+		       yang_bind  yb,
+		       yang_stmt *yspec,
+		       cxobj    **xerr)
+{
+    int          retval = -1;
+    int          ret;
+    clixon_xvec *xv = NULL;
+
+    if ((xv = clixon_xvec_new()) == NULL)
+	goto done;
+    strip_whitespace(xt);
+    if ((ret = xml_bind_yang_split(xt, yb, yspec, xv, xerr)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    if ((ret = xml_parallel_apply(xv, xml_bind_yang_fn, NULL, xerr)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    retval = 1;
+ done:
+    if (xv)
+	clixon_xvec_free(xv);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Find yang spec association of tree of XML nodes
  *
  * @param[in]   xt     XML tree node
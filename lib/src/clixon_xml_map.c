@@ -65,6 +65,7 @@
 #include "clixon_string.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_xml_vec.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_yang_module.h"
@@ -89,6 +90,7 @@ typedef struct  {
     cxobj     *mt_x0c;
     cxobj     *mt_x1c;
     yang_stmt *mt_yc;
+    cvec      *mt_nsc; /* Namespace context of new x1c moved to x0 in bulk */
 } merge_twophase;
 
 /*! Is attribute and is either of form xmlns="", or xmlns:x="" */
@@ -531,6 +533,8 @@ cvec2xml_1(cvec   *cvv,
  * @param[out] changed_x0 Pointervector to XML nodes changed orig value
  * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
  * @param[out] changedlen Length of changed vector
+ * @param[in]  dirty      If set, skip equal nodes not marked with XML_FLAG_DIRTY or
+ *                        XML_FLAG_DEFAULT in x1
  * Algorithm to compare two sorted lists A, B:
  *   A 0 1 2 3 5 6
  *   B 0 2 4 5 6
@@ -554,7 +558,8 @@ xml_diff1(cxobj     *x0,
 	  int       *x1veclen,
 	  cxobj   ***changed_x0,
 	  cxobj   ***changed_x1,
-	  int       *changedlen)
+	  int       *changedlen,
+	  int        dirty)
 {
     int        retval = -1;
     cxobj     *x0c = NULL; /* x0 child */
@@ -602,7 +607,11 @@ xml_diff1(cxobj     *x0,
 	     * if so, continute compare children but without yang
 	     */
 	    yc = xml_spec(x0c);
-	    if (yc && yang_keyword_get(yc) == Y_LEAF){
+	    /* A default value is added after an edit without dirty mark, eg when an
+	     * explicit value is deleted */
+	    if (dirty && xml_flag(x1c, XML_FLAG_DIRTY|XML_FLAG_DEFAULT) == 0)
+		; /* Not modified */
+	    else if (yc && yang_keyword_get(yc) == Y_LEAF){
 		/* if x0c and x1c are leafs w bodies, then they may be changed */
 		b1 = xml_body(x0c);
 		b2 = xml_body(x1c);
@@ -619,7 +628,7 @@ xml_diff1(cxobj     *x0,
 	    else if (xml_diff1(x0c, x1c,   
 			       x0vec, x0veclen, 
 			       x1vec, x1veclen, 
-			       changed_x0, changed_x1, changedlen)< 0)
+			       changed_x0, changed_x1, changedlen, dirty)< 0)
 		goto done;
 	}
 	x0c = xml_child_each(x0, x0c, CX_ELMNT);
@@ -676,7 +685,7 @@ xml_diff(yang_stmt *yspec,
     if (xml_diff1(x0, x1,
 		  first, firstlen, 
 		  second, secondlen, 
-		  changed_x0, changed_x1, changedlen) < 0)
+		  changed_x0, changed_x1, changedlen, 0) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -684,6 +693,60 @@ xml_diff(yang_stmt *yspec,
     return retval;
 }
 
+/*! Compute differences between two xml trees where only dirty subtrees of x1 differ
+ *
+ * Same as xml_diff but x1 is assumed to be equal to x0 except in subtrees marked
+ * with XML_FLAG_DIRTY, such as a candidate datastore modified by xmldb_put since it
+ * was equal to running. Unmarked subtrees are not traversed.
+ * Removed nodes are found since their parents are marked.
+ * Default values in marked subtrees are compared since they are not marked.
+ * @param[in]  yspec      Yang specification
+ * @param[in]  x0         First XML tree
+ * @param[in]  x1         Second XML tree, modified version of x0 in dirty subtrees
+ * @param[out] first      Pointervector to XML nodes existing in only first tree
+ * @param[out] firstlen   Length of first vector
+ * @param[out] second     Pointervector to XML nodes existing in only second tree
+ * @param[out] secondlen  Length of second vector
+ * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changedlen Length of changed vector
+ * All xml vectors should be freed after use.
+ * @see xml_diff
+ * @see xmldb_dirty_tracked  to check if dirty marks of two datastores can be used
+ * @see yang_default_when    Defaults in unmodified subtrees may depend on modified nodes
+ */
+int
+xml_diff_dirty(yang_stmt *yspec, 
+	       cxobj     *x0, 
+	       cxobj     *x1,
+	       cxobj   ***first,
+	       int       *firstlen,
+	       cxobj   ***second,
+	       int       *secondlen,
+	       cxobj   ***changed_x0,
+	       cxobj   ***changed_x1,
+	       int       *changedlen)
+{
+    int retval = -1;
+
+    if (x0 == NULL || x1 == NULL)
+	return xml_diff(yspec, x0, x1, first, firstlen, second, secondlen,
+			changed_x0, changed_x1, changedlen);
+    *firstlen = 0;
+    *secondlen = 0;    
+    *changedlen = 0;
+    if (x0 == x1) /* Same tree */
+	return 0;
+    if (xml_diff1(x0, x1,
+		  first, firstlen, 
+		  second, secondlen, 
+		  changed_x0, changed_x1, changedlen, 1) < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Prune everything that does not pass test or have at least a child* does not
  * @param[in]   xt      XML tree with some node marked
  * @param[in]   flag    Which flag to test for
@@ -1246,6 +1309,10 @@ xml_default_recurse(cxobj *xn,
     cxobj     *x;
     yang_stmt *y;
     
+    if (xml_flag(xn, XML_FLAG_LAZY)){ /* Content not known until materialized */
+	retval = 0;
+	goto done;
+    }
     if (xml_default(xn, state) < 0)
 	goto done;
     x = NULL;
@@ -1385,6 +1452,8 @@ xml_nopresence_default(cxobj *xt)
 
     if ((yt = xml_spec(xt)) == NULL)
 	return 0;
+    if (xml_flag(xt, XML_FLAG_LAZY)) /* Content not known */
+	return 0;
     switch (yang_keyword_get(yt)){
     case Y_CONTAINER:
 	if (yang_find(yt, Y_PRESENCE, NULL))
@@ -1832,6 +1901,31 @@ assign_namespace_body(cxobj *x0, /* source */
     return retval;
 }
 
+/*! Add namespace bindings of x1 in its original tree, after x1 has been moved to a new tree
+ * @param[in]  x1  XML node moved from modification tree to base tree
+ * @param[in]  nsc Namespace context of x1 before it was moved
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+xml_merge_nsc(cxobj *x1,
+	      cvec  *nsc)
+{
+    cg_var *cv = NULL;
+    char   *px;
+    char   *ns;
+
+    while ((cv = cvec_each(nsc, cv)) != NULL){
+	px = cv_name_get(cv);
+	ns = cv_string_get(cv);
+	/* Check if it exists */
+	if (xml2prefix(x1, ns, NULL) == 0)
+	    if (xmlns_set(x1, px, ns) < 0)
+		return -1;
+    }
+    return 0;
+}
+
 /*! Merge a base tree x0 with x1 with yang spec y
  * @param[in]  x0  Base xml tree (can be NULL in add scenarios)
  * @param[in]  y0  Yang spec corresponding to xml-node x0. NULL if x0 is NULL
@@ -1861,16 +1955,15 @@ xml_merge1(cxobj              *x0,  /* the target */
     int        ret;
     int        i;
     merge_twophase *twophase = NULL;
-    int twophase_len;
+    int twophase_len = 0;
+    clixon_xvec    *xbulk = NULL;
     
     assert(x1 && xml_type(x1) == CX_ELMNT);
     assert(y0);
 
     if (x0 == NULL){
 	cvec   *nsc = NULL;
-	cg_var *cv;
-	char   *ns;
-	char   *px;
+
 	nsc = cvec_dup(nscache_get_all(x1));
 	if (xml_rm(x1) < 0)
 	    goto done;
@@ -1882,15 +1975,8 @@ xml_merge1(cxobj              *x0,  /* the target */
         else
 	    if (xml_insert(x0p, x1, INS_LAST, NULL, NULL) < 0)
 		goto done;
-	cv = NULL;
-	while ((cv = cvec_each(nsc, cv)) != NULL){
-	    px = cv_name_get(cv);
-	    ns = cv_string_get(cv);
-	    /* Check if it exists */
-	    if (xml2prefix(x1, ns, NULL) == 0)
-		if (xmlns_set(x1, px, ns) < 0)
-		    goto done;
-	}
+	if (xml_merge_nsc(x1, nsc) < 0)
+	    goto done;
 	if (nsc)
 	    cvec_free(nsc);
 	goto ok;
@@ -1956,18 +2042,42 @@ xml_merge1(cxobj              *x0,  /* the target */
 	} /* while */
 	twophase_len = i; /* Inital length included non-elements */
 	/* Second run where actual merging is done 
-	 * Loop through children of the modification tree */
+	 * Loop through children of the modification tree 
+	 * New children are moved from x1 and then inserted into x0 in bulk */
 	for (i=0; i<twophase_len; i++){
-	    assert(twophase[i].mt_x1c);
+	    x1c = twophase[i].mt_x1c;
+	    assert(x1c);
+	    if (twophase[i].mt_x0c == NULL && xml_spec(x1c) != NULL){
+		if (xbulk == NULL && (xbulk = clixon_xvec_new()) == NULL)
+		    goto done;
+		twophase[i].mt_nsc = cvec_dup(nscache_get_all(x1c));
+		if (xml_rm(x1c) < 0)
+		    goto done;
+		if (clixon_xvec_append(xbulk, x1c) < 0){
+		    xml_free(x1c);
+		    goto done;
+		}
+		continue;
+	    }
 	    if ((ret = xml_merge1(twophase[i].mt_x0c,
 			   twophase[i].mt_yc,
 			   x0,
-			   twophase[i].mt_x1c,
+			   x1c,
 				  reason)) < 0)
 		goto done;
 	    if (ret == 0)
 		goto fail;
 	}
+	if (xbulk){
+	    if (xml_insert_bulk(x0, xbulk) < 0)
+		goto done;
+	    clixon_xvec_free(xbulk);
+	    xbulk = NULL;
+	    for (i=0; i<twophase_len; i++)
+		if (twophase[i].mt_nsc &&
+		    xml_merge_nsc(twophase[i].mt_x1c, twophase[i].mt_nsc) < 0)
+		    goto done;
+	}
 	if (xml_parent(x0) == NULL &&
 	    xml_insert(x0p, x0, INS_LAST, NULL, NULL) < 0) 
 	    goto done;
@@ -1975,8 +2085,18 @@ xml_merge1(cxobj              *x0,  /* the target */
  ok:
     retval = 1;
  done:
-    if (twophase)
+    if (xbulk){ /* Moved from x1 but not inserted in x0 */
+	for (i=0; i<clixon_xvec_len(xbulk); i++)
+	    if (xml_parent(clixon_xvec_i(xbulk, i)) == NULL) /* else owned by x0 */
+		xml_free(clixon_xvec_i(xbulk, i));
+	clixon_xvec_free(xbulk);
+    }
+    if (twophase){
+	for (i=0; i<twophase_len; i++)
+	    if (twophase[i].mt_nsc)
+		cvec_free(twophase[i].mt_nsc);
 	free(twophase);
+    }
     if (cbr)
 	cbuf_free(cbr);
     return retval;
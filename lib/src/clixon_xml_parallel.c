@@ -0,0 +1,281 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+
+ * Parallel processing of XML trees
+ * Independent sibling subtrees of a large XML tree, such as top-level containers and the
+ * entries of large lists, can be yang-bound and sorted by several threads. Threads take
+ * subtrees from a shared work vector until it is empty, so that uneven subtree sizes are
+ * balanced. The calling thread takes part in the work.
+ * Enabled by setting CLICON_XML_THREADS to a value larger than 1.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_xml_vec.h"
+#include "clixon_options.h"
+#include "clixon_xml_parallel.h"
+
+/* Number of threads used for binding and sorting, 1 means no threads are started */
+static int _xml_threads = 1;
+
+#ifdef HAVE_LIBPTHREAD
+/* A parallel job: apply fn on all subtrees in a vector */
+struct xml_parallel_job{
+    clixon_xvec     *xj_vec;  /* Subtrees to process */
+    xml_parallel_fn *xj_fn;   /* Function to apply on each subtree */
+    void            *xj_arg;  /* Argument to fn */
+    int              xj_next; /* Next subtree to take, updated atomically */
+    volatile int     xj_stop; /* Set when a subtree failed, stop taking new ones */
+    int             *xj_ret;  /* Return value per subtree */
+    cxobj          **xj_err;  /* Error tree per subtree */
+    void           **xj_errs; /* clicon_err state per subtree if it failed, owned by thread */
+};
+
+/* A thread taking part in a parallel job */
+struct xml_parallel_thread{
+    struct xml_parallel_job *xt_job;
+    void                    *xt_errs; /* clicon_err state of thread */
+};
+
+/*! Thread worker: take subtrees from job and apply function until done
+ * Errors are recorded per thread and reported by the calling thread after the join,
+ * since clicon_err is not thread-safe.
+ * @param[in]  arg   Thread, struct xml_parallel_thread
+ */
+static void *
+xml_parallel_worker(void *arg)
+{
+    struct xml_parallel_thread *xt = (struct xml_parallel_thread *)arg;
+    struct xml_parallel_job    *xj = xt->xt_job;
+    int                         len;
+    int                         i;
+
+    clicon_err_thread_set(xt->xt_errs);
+    len = clixon_xvec_len(xj->xj_vec);
+    while (!xj->xj_stop &&
+	   (i = __sync_fetch_and_add(&xj->xj_next, 1)) < len){
+	xj->xj_ret[i] = xj->xj_fn(clixon_xvec_i(xj->xj_vec, i), xj->xj_arg, &xj->xj_err[i]);
+	if (xj->xj_ret[i] < 1){
+	    /* A thread fails at most once since no more subtrees are taken */
+	    xj->xj_errs[i] = xt->xt_errs;
+	    xj->xj_stop = 1;
+	}
+    }
+    clicon_err_thread_set(NULL);
+    return NULL;
+}
+#endif /* HAVE_LIBPTHREAD */
+
+/*! Set number of threads from the CLICON_XML_THREADS option
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ */
+int
+xml_parallel_init(clicon_handle h)
+{
+    int nr;
+
+    nr = clicon_option_int(h, "CLICON_XML_THREADS");
+    if (nr < 1)
+	nr = 1;
+#ifndef HAVE_LIBPTHREAD
+    if (nr > 1){
+	clicon_log(LOG_WARNING, "CLICON_XML_THREADS is %d but clixon is built without pthreads", nr);
+	nr = 1;
+    }
+#endif
+    _xml_threads = nr;
+    return 0;
+}
+
+/*! Get number of threads used for parallel XML processing
+ * @retval  nr   Number of threads, 1 if parallel processing is disabled
+ */
+int
+xml_parallel_threads(void)
+{
+    return _xml_threads;
+}
+
+/*! Check if a subtree should be split into its children instead of processed as a whole
+ * A subtree is split if it is large, such as a list with many entries, or if its parent 
+ * has too few children to give work to all threads, such as a single top-level container.
+ * @param[in]  xp   Parent of x, already split
+ * @param[in]  x    XML subtree
+ * @retval     1    Split x: process x in calling thread and its children in parallel
+ * @retval     0    Process x as a whole in parallel
+ */
+int
+xml_parallel_split(cxobj *xp,
+		   cxobj *x)
+{
+    int nr;
+
+    if ((nr = xml_child_nr_type(x, CX_ELMNT)) == 0)
+	return 0;
+    return nr >= XML_PARALLEL_SPLIT || xml_child_nr_type(xp, CX_ELMNT) < _xml_threads;
+}
+
+/*! Apply a function on a vector of disjoint XML subtrees using several threads
+ *
+ * The function is called once for every subtree, by any of the threads. It must only access
+ * its own subtree (reading yang specs is OK) and not modify any of its ancestors.
+ * If a function call returns -1 or 0, no more subtrees are started, and the result is that
+ * of the first failed subtree in vector order.
+ * @param[in]  xv    Vector of disjoint XML subtrees
+ * @param[in]  fn    Function to apply on each subtree
+ * @param[in]  arg   Argument to fn
+ * @param[out] xerr  Error tree of first failed subtree if retval is 0 (if not NULL)
+ * @retval     1     OK
+ * @retval     0     Failed, xerr may be set
+ * @retval    -1     Error
+ * @note clicon_err of a failed subtree is reported by the calling thread after all threads
+ *       are joined, errors of other subtrees are dropped
+ */
+int
+xml_parallel_apply(clixon_xvec     *xv,
+		   xml_parallel_fn *fn,
+		   void            *arg,
+		   cxobj          **xerr)
+{
+    int                      retval = -1;
+    int                      len;
+    int                      i;
+#ifdef HAVE_LIBPTHREAD
+    struct xml_parallel_job     xj = {0,};
+    struct xml_parallel_thread *xts = NULL;
+    pthread_t                  *tids = NULL;
+    int                         nt = 0;
+    int                         nr = 0;
+#endif
+
+    len = clixon_xvec_len(xv);
+#ifdef HAVE_LIBPTHREAD
+    nr = _xml_threads < len ? _xml_threads : len;
+    if (nr > 1){
+	xj.xj_vec = xv;
+	xj.xj_fn = fn;
+	xj.xj_arg = arg;
+	if ((xj.xj_ret = malloc(len*sizeof(int))) == NULL ||
+	    (xj.xj_err = calloc(len, sizeof(cxobj *))) == NULL ||
+	    (xj.xj_errs = calloc(len, sizeof(void *))) == NULL ||
+	    (xts = calloc(nr, sizeof(*xts))) == NULL ||
+	    (tids = calloc(nr-1, sizeof(pthread_t))) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    goto done;
+	}
+	for (i=0; i<len; i++)
+	    xj.xj_ret[i] = 1;
+	for (i=0; i<nr; i++){
+	    xts[i].xt_job = &xj;
+	    if ((xts[i].xt_errs = clicon_err_thread_new()) == NULL)
+		goto done;
+	}
+	xml_mt_set(1);
+	/* The calling thread is xts[0] */
+	for (nt=0; nt<nr-1; nt++)
+	    if (pthread_create(&tids[nt], NULL, xml_parallel_worker, &xts[nt+1]) != 0)
+		break; /* Continue with the threads started */
+	xml_parallel_worker(&xts[0]);
+	for (i=0; i<nt; i++)
+	    pthread_join(tids[i], NULL);
+	xml_mt_set(0);
+	retval = 1;
+	for (i=0; i<len; i++)
+	    if (xj.xj_ret[i] < 1){
+		retval = xj.xj_ret[i];
+		/* Report error of the failed subtree now that only this thread runs */
+		if (retval < 0)
+		    clicon_err_thread_raise(xj.xj_errs[i]);
+		if (retval == 0 && xerr && *xerr == NULL){
+		    *xerr = xj.xj_err[i];
+		    xj.xj_err[i] = NULL;
+		}
+		break;
+	    }
+	goto done;
+    }
+#endif /* HAVE_LIBPTHREAD */
+    for (i=0; i<len; i++)
+	if ((retval = fn(clixon_xvec_i(xv, i), arg, xerr)) < 1)
+	    goto done;
+    retval = 1;
+ done:
+#ifdef HAVE_LIBPTHREAD
+    if (xj.xj_err){
+	for (i=0; i<len; i++)
+	    if (xj.xj_err[i])
+		xml_free(xj.xj_err[i]);
+	free(xj.xj_err);
+    }
+    if (xj.xj_ret)
+	free(xj.xj_ret);
+    if (xj.xj_errs)
+	free(xj.xj_errs);
+    if (xts){
+	for (i=0; i<nr; i++)
+	    if (xts[i].xt_errs)
+		free(xts[i].xt_errs);
+	free(xts);
+    }
+    if (tids)
+	free(tids);
+#endif
+    return retval;
+}
@@ -71,6 +71,7 @@
 #include "clixon_yang_type.h"
 #include "clixon_yang_module.h"
 #include "clixon_xml_vec.h"
+#include "clixon_xml_parallel.h"
 #include "clixon_xml_sort.h"
 
 /*! Get xml body value as cligen variable
@@ -421,30 +422,47 @@ xml_sort(cxobj *x)
     return 0;
 }
 
-/*! Recursively sort a tree 
- * Alt to use xml_apply
+/*! Sort a single node as part of recursive sort and clear value cache of its children
+ * @param[in]  xn   XML node
+ * @retval     0    OK, children should be sorted
+ * @retval     1    OK, node is not sortable, skip children
+ * @retval    -1    Error
  */
-int
-xml_sort_recurse(cxobj *xn)
+static int
+xml_sort_recurse_self(cxobj *xn)
 {
-    int    retval = -1;
-    cxobj *x;
-    int    ret;
-    
+    int ret;
+
     ret = xml_sort_verify(xn, NULL);
     if (ret == 1) /* This node is not sortable */
-	goto ok;
+	return 1;
     if (ret == -1){ /* not sorted */
 	if ((ret = xml_sort(xn)) < 0)
-	    goto done;
+	    return -1;
 	if (ret == 1) /* This node is not sortable */
-	    goto ok;
+	    return 1;
     }
     if (xml_cv_cache_clear(xn) < 0)
+	return -1;
+    return 0;
+}
+
+/*! Recursively sort a tree in calling thread
+ */
+static int
+xml_sort_recurse1(cxobj *xn)
+{
+    int    retval = -1;
+    cxobj *x;
+    int    ret;
+    
+    if ((ret = xml_sort_recurse_self(xn)) < 0)
 	goto done;
+    if (ret == 1)
+	goto ok;
     x = NULL;
     while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-	if (xml_sort_recurse(x) < 0)
+	if (xml_sort_recurse1(x) < 0)
 	    goto done;
     }
  ok:
@@ -453,6 +471,80 @@ xml_sort_recurse(cxobj *xn)
     return retval;
 }
 
+/*! Parallel job function sorting one subtree, see xml_parallel_apply
+ */
+static int
+xml_sort_recurse_fn(cxobj  *x,
+		    void   *arg,
+		    cxobj **xerr)
+{
+    return xml_sort_recurse1(x) < 0 ? -1 : 1;
+}
+
+/*! Sort xn in this thread and collect its disjoint subtrees to be sorted in parallel
+ * @param[in]  xn   XML node, sorted here
+ * @param[in]  xv   Vector of subtrees to be sorted in parallel
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see xml_parallel_split
+ */
+static int
+xml_sort_recurse_split(cxobj       *xn,
+		       clixon_xvec *xv)
+{
+    int    retval = -1;
+    cxobj *x;
+    int    ret;
+    
+    if ((ret = xml_sort_recurse_self(xn)) < 0)
+	goto done;
+    if (ret == 1)
+	goto ok;
+    x = NULL;
+    while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
+	if (xml_parallel_split(xn, x)){
+	    if (xml_sort_recurse_split(x, xv) < 0)
+		goto done;
+	}
+	else if (clixon_xvec_append(xv, x) < 0)
+	    goto done;
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Recursively sort a tree 
+ * Alt to use xml_apply
+ * If CLICON_XML_THREADS is larger than 1, the top of the tree is sorted in this thread and
+ * its subtrees are sorted by several threads.
+ * @param[in]  xn   XML tree
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see xml_parallel_apply
+ */
+int
+xml_sort_recurse(cxobj *xn)
+{
+    int          retval = -1;
+    clixon_xvec *xv = NULL;
+    
+    if (xml_parallel_threads() < 2 || xml_flag(xn, XML_FLAG_ARENA))
+	return xml_sort_recurse1(xn);
+    if ((xv = clixon_xvec_new()) == NULL)
+	goto done;
+    if (xml_sort_recurse_split(xn, xv) < 0)
+	goto done;
+    if (xml_parallel_apply(xv, xml_sort_recurse_fn, NULL, NULL) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (xv)
+	clixon_xvec_free(xv);
+    return retval;
+}
+
 /*! Special case search for ordered-by user or state data where linear sort is used
  *
  * @param[in]  xp    Parent XML node (go through its childre)
@@ -679,7 +771,13 @@ xml_search_indexvar(cxobj   *xp,
     int          pos;
     int          eq = 0;
     cxobj       *xc;
+    int          ret;
 
+    /* Hash index: exact match on body of index variable */
+    if ((ret = xml_search_hash_get(xp, indexvar, xml_find_body(x1, indexvar), xvec)) < 0)
+	goto done;
+    if (ret == 1)
+	goto ok;
     /* Check if (exactly one) explicit indexes in cvk */
     if (xml_search_vector_get(xp, indexvar, &ivec) < 0)
 	goto done;
@@ -699,6 +797,7 @@ xml_search_indexvar(cxobj   *xp,
 		goto done;
 	}
     }
+ ok:
     retval = 0;
  done:
     return retval;
@@ -1082,9 +1181,111 @@ xml_insert(cxobj           *xp,
     xml_parent_set(xi, xp);
     /* clear namespace context cache of child */
     nscache_clear(xi);
+#ifdef XML_EXPLICIT_INDEX
+    if (xml_search_index_p(xi)){
+	if (xml_search_child_insert(xp, xi) < 0)
+	    goto done;
+    }
+    else if (xml_search_list_insert(xi) < 0)
+	goto done;
+#endif
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Insert a vector of children to xp in sorted place, as xml_insert with INS_LAST
+ * Instead of one binary search and memmove per child, the new children are appended, sorted
+ * once and merged with the (sorted) existing children in a single linear pass.
+ * Use this when adding many children to the same parent, eg when merging large lists.
+ * @param[in] xp      Parent xml node.
+ * @param[in] xvec    Children to insert under xp. Should not have parents and be yang bound
+ * @retval    0       OK
+ * @retval   -1       Error
+ * @see xml_insert  for single children and insert operations (ordered-by user)
+ * @note It is assumed that the existing children of xp are sorted
+ * @note On error, children that have xp as parent have been inserted and are owned by xp, 
+ *       the caller should only free children without parent
+ */
+int
+xml_insert_bulk(cxobj       *xp,
+		clixon_xvec *xvec)
+{
+    int     retval = -1;
+    cxobj **vec;
+    cxobj **tmp = NULL;
+    cxobj  *xi;
+    int     m;
+    int     n;
+    int     i;
+    int     j;
+    int     k;
 
+    if ((n = clixon_xvec_len(xvec)) == 0)
+	goto ok;
+    for (j=0; j<n; j++){
+	xi = clixon_xvec_i(xvec, j);
+	if (xml_parent(xi) != NULL){
+	    clicon_err(OE_XML, 0, "XML node %s should not have parent", xml_name(xi));
+	    goto done;
+	}
+	if (xml_spec(xi) == NULL){
+	    clicon_err(OE_XML, 0, "No spec found %s", xml_name(xi));
+	    goto done;
+	}
+    }
+    if ((tmp = malloc(n*sizeof(cxobj *))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	goto done;
+    }
+    /* Append new children last, enumerate so that existing children and the given order of
+     * the new children act as tie-breakers (ordered-by user and state data) */
+    m = xml_child_nr(xp);
+    for (j=0; j<n; j++)
+	if (xml_child_insert_pos(xp, clixon_xvec_i(xvec, j), m+j) < 0){
+	    /* Remove the ones appended so far, they have no parent and are not indexed */
+	    while (j--)
+		if (xml_child_rm(xp, m+j) < 0)
+		    break;
+	    goto done;
+	}
+    xml_enumerate_children(xp);
+    vec = xml_childvec_get(xp);
+    qsort(&vec[m], n, sizeof(cxobj *), xml_cmp_qsort);
+    /* Merge from the end: existing children precede equal new children */
+    memcpy(tmp, &vec[m], n*sizeof(cxobj *));
+    i = m-1;
+    j = n-1;
+    k = m+n-1;
+    while (j >= 0){
+	if (i >= 0 && xml_cmp(vec[i], tmp[j], 1, 0, NULL) > 0)
+	    vec[k--] = vec[i--];
+	else
+	    vec[k--] = tmp[j--];
+    }
+    /* Here the children are owned by xp */
+    for (j=0; j<n; j++){
+	xi = tmp[j];
+	xml_parent_set(xi, xp);
+	/* clear namespace context cache of child */
+	nscache_clear(xi);
+    }
+#ifdef XML_EXPLICIT_INDEX
+    for (j=0; j<n; j++){
+	xi = tmp[j];
+	if (xml_search_index_p(xi)){
+	    if (xml_search_child_insert(xp, xi) < 0)
+		goto done;
+	}
+	else if (xml_search_list_insert(xi) < 0)
+	    goto done;
+    }
+#endif
+ ok:
     retval = 0;
  done:
+    if (tmp)
+	free(tmp);
     return retval;
 }
 
@@ -63,11 +63,15 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <stdarg.h>
 #include <limits.h>
 #include <stdint.h>
 #include <syslog.h>
 #include <fcntl.h>
 #include <assert.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -81,6 +85,7 @@
 #include "clixon_handle.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_options.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_yang_module.h"
 #include "clixon_xpath_ctx.h"
@@ -88,9 +93,40 @@
 #include "clixon_xpath_parse.h"
 #include "clixon_xpath_eval.h"
 
+/*
+ * Constants
+ */
+/* Default max number of parsed xpaths in cache, see CLICON_XPATH_CACHE_SIZE */
+#define XPATH_CACHE_SIZE_DEFAULT 1024
+
+/*
+ * Types
+ */
+/*! Parsed xpath, shared by all users of the same xpath string via the xpath cache
+ * @see xpath_compile
+ */
+struct xpath_compiled{
+    qelem_t     xpc_qelem;   /* LRU list, most recently used first */
+    char       *xpc_str;     /* XPath string, cache key */
+    xpath_tree *xpc_tree;    /* Parsed xpath */
+    int         xpc_refcnt;  /* Number of users, not counting the cache */
+    int         xpc_cached;  /* Entry is in cache */
+};
+
 /*
  * Variables
  */
+/* Process-wide LRU cache of parsed xpaths. The parse tree does not depend on namespace 
+ * context (it is given at evaluation), so the xpath string is the key */
+static clicon_hash_t  *_xpath_cache_hash = NULL; /* xpath string -> xpath_compiled* */
+static xpath_compiled *_xpath_cache_lru = NULL;  /* Most recently used first */
+static int             _xpath_cache_nr = 0;
+static int             _xpath_cache_size = XPATH_CACHE_SIZE_DEFAULT;
+static uint64_t        _xpath_cache_hits = 0;
+static uint64_t        _xpath_cache_misses = 0;
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t _xpath_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /* Mapping between xpath_tree node name string <--> int  
  * @see xpath_tree_int2str
@@ -527,9 +563,210 @@ xpath_parse(const char  *xpath,
     return retval;
 }
 
+static void
+xpath_cache_lock(void)
+{
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&_xpath_cache_lock);
+#endif
+}
+
+static void
+xpath_cache_unlock(void)
+{
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&_xpath_cache_lock);
+#endif
+}
+
+static void
+xpath_compiled_free1(xpath_compiled *xpc)
+{
+    if (xpc->xpc_str)
+	free(xpc->xpc_str);
+    if (xpc->xpc_tree)
+	xpath_tree_free(xpc->xpc_tree);
+    free(xpc);
+}
+
+/*! Remove entry from xpath cache, free it if it has no users. Cache lock held
+ * @param[in]  xpc  Cached entry
+ */
+static void
+xpath_cache_evict(xpath_compiled *xpc)
+{
+    DELQ(xpc, _xpath_cache_lru, xpath_compiled *);
+    clicon_hash_del(_xpath_cache_hash, xpc->xpc_str);
+    xpc->xpc_cached = 0;
+    _xpath_cache_nr--;
+    if (xpc->xpc_refcnt == 0)
+	xpath_compiled_free1(xpc);
+}
+
+/*! Evict least recently used entries until the cache has at most max entries. Lock held
+ */
+static void
+xpath_cache_shrink(int max)
+{
+    while (_xpath_cache_lru && _xpath_cache_nr > max)
+	xpath_cache_evict(PREVQ(xpath_compiled *, _xpath_cache_lru));
+}
+
+/*! Compile an xpath: get its parse tree from the xpath cache, or parse and cache it
+ *
+ * The compiled xpath can be evaluated any number of times, with any namespace context, 
+ * and stays valid until freed even if it is evicted from the cache.
+ * @param[in]  xpath  String with XPATH 1.0 syntax
+ * @param[out] xpcp   Compiled xpath, free with xpath_compiled_free
+ * @retval     0      OK
+ * @retval    -1      Error, eg syntax error
+ * @code
+ *   xpath_compiled *xpc = NULL;
+ *   if (xpath_compile("/a/b[c=current()]", &xpc) < 0)
+ *     err;
+ *   for (i=0; i<nr; i++)
+ *     if ((ret = xpath_vec_bool_compiled(x[i], nsc, xpc)) < 0)
+ *       err;
+ *   xpath_compiled_free(xpc);
+ * @endcode
+ * @see xpath_parse  for a private, uncached parse tree
+ */
+int
+xpath_compile(const char      *xpath,
+	      xpath_compiled **xpcp)
+{
+    int             retval = -1;
+    clicon_hash_t   hs;
+    xpath_compiled *xpc = NULL;
+    
+    xpath_cache_lock();
+    if (_xpath_cache_hash &&
+	(hs = clicon_hash_lookup(_xpath_cache_hash, xpath)) != NULL){
+	_xpath_cache_hits++;
+	xpc = *(xpath_compiled **)hs->h_val;
+	/* Move to front of LRU list */
+	if (xpc != _xpath_cache_lru){
+	    DELQ(xpc, _xpath_cache_lru, xpath_compiled *);
+	    INSQ(xpc, _xpath_cache_lru);
+	}
+	goto ok;
+    }
+    _xpath_cache_misses++;
+    if ((xpc = malloc(sizeof(*xpc))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(xpc, 0, sizeof(*xpc));
+    if ((xpc->xpc_str = strdup(xpath)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if (xpath_parse(xpath, &xpc->xpc_tree) < 0)
+	goto done;
+    if (_xpath_cache_size > 0){
+	if (_xpath_cache_hash == NULL &&
+	    (_xpath_cache_hash = clicon_hash_init()) == NULL)
+	    goto done;
+	xpath_cache_shrink(_xpath_cache_size - 1);
+	if (clicon_hash_add(_xpath_cache_hash, xpath, &xpc, sizeof(xpc)) == NULL)
+	    goto done;
+	INSQ(xpc, _xpath_cache_lru);
+	xpc->xpc_cached = 1;
+	_xpath_cache_nr++;
+    }
+ ok:
+    xpc->xpc_refcnt++;
+    *xpcp = xpc;
+    xpc = NULL;
+    retval = 0;
+ done:
+    if (xpc)
+	xpath_compiled_free1(xpc);
+    xpath_cache_unlock();
+    return retval;
+}
+
+/*! Free a compiled xpath
+ * @param[in]  xpc  Compiled xpath
+ * @see xpath_compile
+ */
+int
+xpath_compiled_free(xpath_compiled *xpc)
+{
+    xpath_cache_lock();
+    if (--xpc->xpc_refcnt == 0 && !xpc->xpc_cached)
+	xpath_compiled_free1(xpc);
+    xpath_cache_unlock();
+    return 0;
+}
+
+/*! Get parse tree of a compiled xpath
+ * @param[in]  xpc     Compiled xpath
+ * @retval     xptree  Parse tree, read-only, valid until xpc is freed
+ */
+xpath_tree *
+xpath_compiled_tree(xpath_compiled *xpc)
+{
+    return xpc->xpc_tree;
+}
+
+/*! Set max number of parsed xpaths in cache according to CLICON_XPATH_CACHE_SIZE
+ * @param[in]  h   Clicon handle
+ * @note Cant use option in xpath functions since there is no handle, therefore set it here
+ */
+int
+xpath_cache_init(clicon_handle h)
+{
+    int size;
+    
+    if ((size = clicon_option_int(h, "CLICON_XPATH_CACHE_SIZE")) < 0)
+	size = XPATH_CACHE_SIZE_DEFAULT;
+    xpath_cache_lock();
+    _xpath_cache_size = size;
+    xpath_cache_shrink(size);
+    xpath_cache_unlock();
+    return 0;
+}
+
+/*! Empty xpath cache. Compiled xpaths still in use are freed by their users
+ */
+void
+xpath_cache_exit(void)
+{
+    xpath_cache_lock();
+    xpath_cache_shrink(0);
+    if (_xpath_cache_hash){
+	clicon_hash_free(_xpath_cache_hash);
+	_xpath_cache_hash = NULL;
+    }
+    xpath_cache_unlock();
+}
+
+/*! Get xpath cache statistics
+ * @param[out] hits    Number of xpaths found in cache
+ * @param[out] misses  Number of xpaths parsed
+ * @param[out] nr      Number of parsed xpaths in cache
+ */
+int
+xpath_cache_stats(uint64_t *hits,
+		  uint64_t *misses,
+		  uint64_t *nr)
+{
+    xpath_cache_lock();
+    if (hits)
+	*hits = _xpath_cache_hits;
+    if (misses)
+	*misses = _xpath_cache_misses;
+    if (nr)
+	*nr = _xpath_cache_nr;
+    xpath_cache_unlock();
+    return 0;
+}
+
 /*! Given XML tree and xpath, parse xpath, eval it and return xpath context, 
  * This is a raw form of xpath where you can do type conversion of the return
  * value, etc, not just a nodeset.
+ * The parsed xpath is taken from the xpath cache, see xpath_compile
  * @param[in]  xcur   XML-tree where to search
  * @param[in]  nsc    External XML namespace context, or NULL
  * @param[in]  xpath  String with XPATH 1.0 syntax
@@ -551,13 +788,44 @@ xpath_vec_ctx(cxobj      *xcur,
 	      const char *xpath,
 	      int         localonly,
 	      xp_ctx    **xrp)
+{
+    int             retval = -1;
+    xpath_compiled *xpc = NULL;
+    
+    if (xpath_compile(xpath, &xpc) < 0)
+	goto done;
+    if (xpath_vec_ctx_tree(xcur, nsc, xpc->xpc_tree, localonly, xrp) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (xpc)
+	xpath_compiled_free(xpc);
+    return retval;
+}
+
+/*! Given XML tree and a parsed xpath, eval it and return xpath context
+ *
+ * Same as xpath_vec_ctx but with an already parsed xpath, so that an xpath that is
+ * evaluated many times need only be parsed once.
+ * @param[in]  xcur   XML-tree where to search
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xptree Parsed xpath, see xpath_parse
+ * @param[in]  localonly Skip prefix and namespace tests (non-standard)
+ * @param[out] xrp    Return XPATH context
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xpath_vec_ctx
+ */
+int
+xpath_vec_ctx_tree(cxobj      *xcur, 
+		   cvec       *nsc,
+		   xpath_tree *xptree,
+		   int         localonly,
+		   xp_ctx    **xrp)
 {
     int         retval = -1;
-    xpath_tree *xptree = NULL;
     xp_ctx      xc = {0,};
     
-    if (xpath_parse(xpath, &xptree) < 0)
-	goto done;
     xc.xc_type = XT_NODESET;
     xc.xc_node = xcur;
     xc.xc_initial = xcur;
@@ -565,17 +833,47 @@ xpath_vec_ctx(cxobj      *xcur,
 	goto done;
     if (xp_eval(&xc, xptree, nsc, localonly, xrp) < 0)
 	goto done;
-    if (xc.xc_nodeset){
-	free(xc.xc_nodeset);
-	xc.xc_nodeset = NULL;
-    }
     retval = 0;
  done:
-    if (xptree)
-	xpath_tree_free(xptree);
+    if (xc.xc_nodeset)
+	free(xc.xc_nodeset);
     return retval;
 }
 
+/*! Produce xpath string from format string and arguments
+ * A format string without directives, the common case, is used as is
+ * @param[in]  xpformat  Format string for XPATH syntax
+ * @param[in]  ap        Format arguments
+ * @retval     xpath     XPath string, free with free() if not equal to xpformat
+ * @retval     NULL      Error
+ */
+static char *
+xpath_vformat(const char *xpformat,
+	      va_list     ap)
+{
+    va_list ap1;
+    size_t  len;
+    char   *xpath;
+
+    if (strchr(xpformat, '%') == NULL)
+	return (char*)xpformat;
+    va_copy(ap1, ap);
+    len = vsnprintf(NULL, 0, xpformat, ap1);
+    va_end(ap1);
+    /* allocate an xpath string exactly fitting the length */
+    if ((xpath = malloc(len+1)) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    /* second round: actually compute xpath string content */
+    if (vsnprintf(xpath, len+1, xpformat, ap) < 0){
+	clicon_err(OE_UNIX, errno, "vsnprintf");
+	free(xpath);
+	return NULL;
+    }
+    return xpath;
+}
+
 /*! XPath nodeset function where only the first matching entry is returned
  *
  * @param[in]  xcur      XML tree where to search
@@ -605,26 +903,14 @@ xpath_first(cxobj      *xcur,
 {
     cxobj     *cx = NULL;
     va_list    ap;
-    size_t     len;
     char      *xpath = NULL;
     xp_ctx    *xr = NULL;
     
-    va_start(ap, xpformat);    
-    len = vsnprintf(NULL, 0, xpformat, ap);
+    va_start(ap, xpformat);
+    xpath = xpath_vformat(xpformat, ap);
     va_end(ap);
-    /* allocate a message string exactly fitting the message length */
-    if ((xpath = malloc(len+1)) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if (xpath == NULL)
 	goto done;
-    }
-    /* second round: compute write message from reason and args */
-    va_start(ap, xpformat);    
-    if (vsnprintf(xpath, len+1, xpformat, ap) < 0){
-	clicon_err(OE_UNIX, errno, "vsnprintf");
-	va_end(ap);
-	goto done;
-    }
-    va_end(ap);
     if (xpath_vec_ctx(xcur, nsc, xpath, 0, &xr) < 0)
 	goto done;
     if (xr && xr->xc_type == XT_NODESET && xr->xc_size)
@@ -632,7 +918,7 @@ xpath_first(cxobj      *xcur,
  done:
     if (xr)
 	ctx_free(xr);
-    if (xpath)
+    if (xpath && xpath != xpformat)
 	free(xpath);
     return cx;
 }
@@ -664,26 +950,14 @@ xpath_first_localonly(cxobj      *xcur,
 {
     cxobj     *cx = NULL;
     va_list    ap;
-    size_t     len;
     char      *xpath = NULL;
     xp_ctx    *xr = NULL;
     
-    va_start(ap, xpformat);    
-    len = vsnprintf(NULL, 0, xpformat, ap);
+    va_start(ap, xpformat);
+    xpath = xpath_vformat(xpformat, ap);
     va_end(ap);
-    /* allocate a message string exactly fitting the message length */
-    if ((xpath = malloc(len+1)) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if (xpath == NULL)
 	goto done;
-    }
-    /* second round: compute write message from reason and args */
-    va_start(ap, xpformat);    
-    if (vsnprintf(xpath, len+1, xpformat, ap) < 0){
-	clicon_err(OE_UNIX, errno, "vsnprintf");
-	va_end(ap);
-	goto done;
-    }
-    va_end(ap);
     if (xpath_vec_ctx(xcur, NULL, xpath, 1, &xr) < 0)
 	goto done;
     if (xr && xr->xc_type == XT_NODESET && xr->xc_size)
@@ -691,7 +965,7 @@ xpath_first_localonly(cxobj      *xcur,
  done:
     if (xr)
 	ctx_free(xr);
-    if (xpath)
+    if (xpath && xpath != xpformat)
 	free(xpath);
     return cx;
 }
@@ -728,26 +1002,14 @@ xpath_vec(cxobj      *xcur,
 {
     int        retval = -1;
     va_list    ap;
-    size_t     len;
     char      *xpath = NULL;
     xp_ctx    *xr = NULL; 
 	
-    va_start(ap, veclen);    
-    len = vsnprintf(NULL, 0, xpformat, ap);
+    va_start(ap, veclen);
+    xpath = xpath_vformat(xpformat, ap);
     va_end(ap);
-    /* allocate an xpath string exactly fitting the length */
-    if ((xpath = malloc(len+1)) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
-	goto done;
-    }
-    /* second round: actually compute xpath string content */
-    va_start(ap, veclen);    
-    if (vsnprintf(xpath, len+1, xpformat, ap) < 0){
-	clicon_err(OE_UNIX, errno, "vsnprintf");
-	va_end(ap);
+    if (xpath == NULL)
 	goto done;
-    }
-    va_end(ap);
     *vec=NULL;
     *veclen = 0;
     if (xpath_vec_ctx(xcur, nsc, xpath, 0, &xr) < 0)
@@ -761,7 +1023,7 @@ xpath_vec(cxobj      *xcur,
  done:
     if (xr)
 	ctx_free(xr);
-    if (xpath)
+    if (xpath && xpath != xpformat)
 	free(xpath);
     return retval;
 }
@@ -801,28 +1063,16 @@ xpath_vec_flag(cxobj      *xcur,
 {
     int        retval = -1;
     va_list    ap;
-    size_t     len;
     char      *xpath = NULL;
     xp_ctx    *xr = NULL;
     int        i;
     cxobj     *x;
     
-    va_start(ap, veclen);    
-    len = vsnprintf(NULL, 0, xpformat, ap);
+    va_start(ap, veclen);
+    xpath = xpath_vformat(xpformat, ap);
     va_end(ap);
-    /* allocate a message string exactly fitting the message length */
-    if ((xpath = malloc(len+1)) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if (xpath == NULL)
 	goto done;
-    }
-    /* second round: compute write message from reason and args */
-    va_start(ap, veclen);    
-    if (vsnprintf(xpath, len+1, xpformat, ap) < 0){
-	clicon_err(OE_UNIX, errno, "vsnprintf");
-	va_end(ap);
-	goto done;
-    }
-    va_end(ap);
     *vec=NULL;
     *veclen = 0;
     if (xpath_vec_ctx(xcur, nsc, xpath, 0, &xr) < 0)
@@ -839,7 +1089,7 @@ xpath_vec_flag(cxobj      *xcur,
  done:
     if (xr)
 	ctx_free(xr);
-    if (xpath)
+    if (xpath && xpath != xpformat)
 	free(xpath);
     return retval;
 }
@@ -861,26 +1111,14 @@ xpath_vec_bool(cxobj      *xcur,
 {
     int        retval = -1;
     va_list    ap;
-    size_t     len;
     char      *xpath = NULL;
     xp_ctx    *xr = NULL;
     
-    va_start(ap, xpformat);    
-    len = vsnprintf(NULL, 0, xpformat, ap);
+    va_start(ap, xpformat);
+    xpath = xpath_vformat(xpformat, ap);
     va_end(ap);
-    /* allocate a message string exactly fitting the message length */
-    if ((xpath = malloc(len+1)) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
+    if (xpath == NULL)
 	goto done;
-    }
-    /* second round: compute write message from reason and args */
-    va_start(ap, xpformat);    
-    if (vsnprintf(xpath, len+1, xpformat, ap) < 0){
-	clicon_err(OE_UNIX, errno, "vsnprintf");
-	va_end(ap);
-	goto done;
-    }
-    va_end(ap);
     if (xpath_vec_ctx(xcur, nsc, xpath, 0, &xr) < 0)
 	goto done;
     if (xr)
@@ -888,11 +1126,75 @@ xpath_vec_bool(cxobj      *xcur,
  done:
     if (xr)
 	ctx_free(xr);
-    if (xpath)
+    if (xpath && xpath != xpformat)
 	free(xpath);
     return retval;
 }
 
+/*! Given XML tree and compiled xpath, returns nodeset as xml node vector
+ * If result is not nodeset, return empty nodeset
+ * @param[in]  xcur     xml-tree where to search
+ * @param[in]  nsc      External XML namespace context, or NULL
+ * @param[in]  xpc      Compiled xpath, see xpath_compile
+ * @param[out] vec      vector of xml-trees. Vector must be free():d after use
+ * @param[out] veclen   returns length of vector in return value
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see xpath_vec
+ */
+int
+xpath_vec_compiled(cxobj          *xcur, 
+		   cvec           *nsc,
+		   xpath_compiled *xpc,
+		   cxobj        ***vec, 
+		   size_t         *veclen)
+{
+    int     retval = -1;
+    xp_ctx *xr = NULL;
+
+    *vec=NULL;
+    *veclen = 0;
+    if (xpath_vec_ctx_tree(xcur, nsc, xpc->xpc_tree, 0, &xr) < 0)
+	goto done;
+    if (xr && xr->xc_type == XT_NODESET){
+	*vec    = xr->xc_nodeset;
+	xr->xc_nodeset = NULL;
+	*veclen = xr->xc_size;
+    }
+    retval = 0;
+ done:
+    if (xr)
+	ctx_free(xr);
+    return retval;
+}
+
+/*! Given XML tree and compiled xpath, returns boolean
+ * @param[in]  xcur     xml-tree where to search
+ * @param[in]  nsc      External XML namespace context, or NULL
+ * @param[in]  xpc      Compiled xpath, see xpath_compile
+ * @retval     1        True
+ * @retval     0        False
+ * @retval    -1        Error
+ * @see xpath_vec_bool
+ */
+int
+xpath_vec_bool_compiled(cxobj          *xcur, 
+			cvec           *nsc,
+			xpath_compiled *xpc)
+{
+    int     retval = -1;
+    xp_ctx *xr = NULL;
+
+    if (xpath_vec_ctx_tree(xcur, nsc, xpc->xpc_tree, 0, &xr) < 0)
+	goto done;
+    if (xr)
+	retval = ctx2boolean(xr);
+ done:
+    if (xr)
+	ctx_free(xr);
+    return retval;
+}
+
 static int
 traverse_canonical(xpath_tree *xs,
 		   yang_stmt  *yspec,
@@ -245,6 +245,9 @@ xpath_list_optimize_fn(xpath_tree  *xt,
     cvec        *cvk = NULL; /* vector of index keys */
     cg_var      *cvi;
     int          i;
+#ifdef XML_EXPLICIT_INDEX
+    yang_stmt   *yi;
+#endif
     
     /* revert to non-optimized if no yang */
     if ((yp = xml_spec(xv)) == NULL)
@@ -285,6 +288,18 @@ xpath_list_optimize_fn(xpath_tree  *xt,
     if (ret == 0)
 	goto ok;
 
+#ifdef XML_EXPLICIT_INDEX
+    /* A single predicate on an explicit search index (sorted or hash) of an existing index */
+    if (cvec_len(cvk) == 1 &&
+	(cvi = cvec_i(cvk, 0)) != NULL &&
+	(yi = yang_find_datanode(yc, cv_name_get(cvi))) != NULL &&
+	yang_flag_get(yi, YANG_FLAG_INDEX) &&
+	xml_search_index_has(xv, cv_name_get(cvi))){
+	if (clixon_xml_find_index(xv, yp, NULL, name, cvk, xvec) < 0)
+	    goto done;
+	goto match;
+    }
+#endif
     if (cvec_len(cvv) != cvec_len(cvk))
 	goto ok;
     i = 0;
@@ -297,6 +312,7 @@ xpath_list_optimize_fn(xpath_tree  *xt,
     /* Use 2a form since yc allready given to compute cvk */
     if (clixon_xml_find_index(xv, yp, NULL, name, cvk, xvec) < 0)
 	goto done;
+ match:
     retval = 1; /* match */
  done:
     if (vec)
@@ -76,6 +76,8 @@
 #include "clixon_hash.h"
 #include "clixon_xml.h"
 #include "clixon_xml_nsctx.h"
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
 #include "clixon_yang_module.h"
 #include "clixon_plugin.h"
 #include "clixon_data.h"
@@ -398,6 +400,114 @@ yang_when_nsc_set(yang_stmt *ys,
     return retval;
 }
 
+/*! Compile xpath argument of a must, when or path statement and its namespace context
+ *
+ * The namespace context is the one of the must statement, and of the parent of a
+ * when statement or of the type of a path statement. A path in a typedef has no 
+ * namespace context of its own, it is the one of the leaf using the typedef.
+ * @param[in]  ys     Yang must, when or path statement
+ * @retval     0      OK
+ * @retval     -1     Error
+ */
+static int
+ys_xpath_compile(yang_stmt *ys)
+{
+    int        retval = -1;
+    yang_stmt *yn = ys;
+    yang_stmt *yp;
+    cvec      *nsc = NULL;
+
+    switch (ys->ys_keyword){
+    case Y_MUST:
+	break;
+    case Y_WHEN:
+	yn = ys->ys_parent;
+	break;
+    case Y_PATH:
+	yn = ys->ys_parent;
+	if ((yp = yang_parent_get(yn)) != NULL && yang_keyword_get(yp) == Y_TYPEDEF)
+	    yn = NULL;
+	break;
+    default:
+	clicon_err(OE_YANG, EINVAL, "%s is not a must, when or path statement",
+		   yang_key2str(ys->ys_keyword));
+	goto done;
+    }
+    if (yn && xml_nsctx_yang(yn, &nsc) < 0)
+	goto done;
+    if (xpath_compile(ys->ys_argument, &ys->ys_xpath) < 0)
+	goto done;
+    ys->ys_xpath_nsc = nsc;
+    nsc = NULL;
+    retval = 0;
+ done:
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+}
+
+/*! Get compiled xpath argument and namespace context of a must, when or path statement
+ *
+ * Compiled once when the yang spec is loaded, see ys_populate2, so that an xpath
+ * evaluated for every instance of a node is not parsed or given a namespace 
+ * context each time. Compiled here if not done already, eg a copied statement.
+ * @param[in]  ys     Yang must, when or path statement
+ * @param[out] xpcp   Compiled xpath, direct pointer, do not free (if not NULL)
+ * @param[out] nscp   Namespace context, direct pointer, do not free (if not NULL)
+ * @retval     0      OK
+ * @retval     -1     Error, eg xpath syntax error
+ * @code
+ *   xpath_compiled *xpc;
+ *   cvec           *nsc;
+ *   if (yang_xpath_get(ymust, &xpc, &nsc) < 0)
+ *      err;
+ *   if ((ret = xpath_vec_bool_compiled(x, nsc, xpc)) < 0)
+ *      err;
+ * @endcode
+ */
+int
+yang_xpath_get(yang_stmt              *ys,
+	       struct xpath_compiled **xpcp,
+	       cvec                  **nscp)
+{
+    if (ys->ys_xpath == NULL &&
+	ys_xpath_compile(ys) < 0)
+	return -1;
+    if (xpcp)
+	*xpcp = ys->ys_xpath;
+    if (nscp)
+	*nscp = ys->ys_xpath_nsc;
+    return 0;
+}
+
+/*! Get map of nodes whose constraints depend on each node name
+ * @param[in]  yspec  Yang spec
+ * @retval     deps   Node name -> vector of yang nodes, direct pointer, do not free
+ * @retval     NULL   Not built
+ * @see yang_validate_deps
+ */
+clicon_hash_t *
+yang_deps_get(yang_stmt *yspec)
+{
+    return yspec->ys_deps;
+}
+
+/*! Set map of nodes whose constraints depend on each node name, free previous
+ * @param[in]  yspec  Yang spec
+ * @param[in]  deps   Node name -> vector of yang nodes, consumed
+ * @retval     0      OK
+ * @see yang_validate_deps
+ */
+int
+yang_deps_set(yang_stmt     *yspec,
+	      clicon_hash_t *deps)
+{
+    if (yspec->ys_deps)
+	clicon_hash_free(yspec->ys_deps);
+    yspec->ys_deps = deps;
+    return 0;
+}
+
 /* End access functions */
 
 /*! Create new yang specification
@@ -476,6 +586,12 @@ ys_free1(yang_stmt *ys,
 	free(ys->ys_when_xpath);
     if (ys->ys_when_nsc)
 	cvec_free(ys->ys_when_nsc);
+    if (ys->ys_xpath)
+	xpath_compiled_free(ys->ys_xpath);
+    if (ys->ys_xpath_nsc)
+	xml_nsctx_free(ys->ys_xpath_nsc);
+    if (ys->ys_deps)
+	clicon_hash_free(ys->ys_deps);
     if (ys->ys_stmt)
 	free(ys->ys_stmt);
     if (self)
@@ -604,6 +720,10 @@ ys_cp(yang_stmt *ynew,
 
     memcpy(ynew, yold, sizeof(*yold)); 
     ynew->ys_parent = NULL;
+    /* Compiled xpath depends on position in yang tree, compiled again on use */
+    ynew->ys_xpath = NULL;
+    ynew->ys_xpath_nsc = NULL;
+    ynew->ys_deps = NULL;
     if (yold->ys_stmt)
 	if ((ynew->ys_stmt = calloc(yold->ys_len, sizeof(yang_stmt *))) == NULL){
 	    clicon_err(OE_YANG, errno, "calloc");
@@ -2456,6 +2576,16 @@ ys_populate2(yang_stmt    *ys,
 	if (ys_parse(ys, CGV_BOOL) == NULL) 
 	    goto done;
 	break;
+    case Y_MUST:
+    case Y_WHEN:
+    case Y_PATH:
+	/* An invalid xpath is reported when it is evaluated, see yang_xpath_get */
+	if (ys->ys_xpath == NULL && ys_xpath_compile(ys) < 0){
+	    clicon_debug(1, "%s: %s %s: %s", __FUNCTION__, yang_key2str(ys->ys_keyword),
+			 ys->ys_argument, clicon_err_reason);
+	    clicon_err_reset();
+	}
+	break;
     default:
 	break;
     }
@@ -3093,6 +3223,51 @@ yang_config_ancestor(yang_stmt *ys)
     return 1;
 }
 
+/*! Check if a default value of a data node may depend on a when condition
+ *
+ * A leaf with a default value has a when statement, or one of its ancestors has one,
+ * including when of augment and uses.
+ * @param[in] yn    Yang node, eg yang spec or module
+ * @param[in] when  Set if an ancestor of yn has a when condition
+ * @retval    1     A leaf with default value under yn depends on a when condition
+ * @retval    0     No such leaf
+ * @note Checked for the yang spec when it is loaded, see YANG_FLAG_DEFAULT_WHEN
+ * @see xml_diff_dirty  Defaults of unmodified subtrees are not compared
+ */
+int
+yang_default_when(yang_stmt *yn,
+		  int        when)
+{
+    yang_stmt *yc;
+
+    if (yang_find(yn, Y_WHEN, NULL) != NULL || yang_when_xpath_get(yn) != NULL)
+	when = 1;
+    yc = NULL;
+    while ((yc = yn_each(yn, yc)) != NULL) {
+	switch (yang_keyword_get(yc)){
+	case Y_LEAF:
+	    if (!cv_flag(yang_cv_get(yc), V_UNSET) && /* Default value exists */
+		(when ||
+		 yang_find(yc, Y_WHEN, NULL) != NULL ||
+		 yang_when_xpath_get(yc) != NULL))
+		return 1;
+	    break;
+	case Y_MODULE:
+	case Y_SUBMODULE:
+	case Y_CONTAINER:
+	case Y_LIST:
+	case Y_CHOICE:
+	case Y_CASE:
+	    if (yang_default_when(yc, when) == 1)
+		return 1;
+	    break;
+	default:
+	    break;
+	}
+    }
+    return 0;
+}
+
 /*! Given a yang node, translate the argument string to a cv vector
  *
  * @param[in]  ys         Yang statement 
@@ -3519,11 +3694,14 @@ yang_extension_value(yang_stmt *ys,
 
 #ifdef XML_EXPLICIT_INDEX
 /*! Mark element as search_index in list
+ * @param[in]  ys   Yang node of list child
+ * @param[in]  hash If set, the index is a hash index (search_index_hash)
  * @retval     0   OK
  * @retval    -1   Error
  */
 int
-yang_list_index_add(yang_stmt *ys)
+yang_list_index_add(yang_stmt *ys,
+		    int        hash)
 {
     int        retval = -1;
     yang_stmt *yp;
@@ -3534,6 +3712,8 @@ yang_list_index_add(yang_stmt *ys)
 	goto ok;
     }
     yang_flag_set(ys, YANG_FLAG_INDEX);
+    if (hash)
+	yang_flag_set(ys, YANG_FLAG_INDEX_HASH);
  ok:
     retval = 0;
    // done:
@@ -3558,15 +3738,22 @@ yang_search_index_extension(clicon_handle h,
     char      *modname;
     yang_stmt *ymod;
     yang_stmt *yp;
+    int        hash;
     
     ymod = ys_module(yext);
     modname = yang_argument_get(ymod);
     extname = yang_argument_get(yext);
-    if (strcmp(modname, "clixon-config") != 0 || strcmp(extname, "search_index") != 0)
+    if (strcmp(modname, "clixon-config") != 0)
+	goto ok;
+    if (strcmp(extname, "search_index") == 0)
+	hash = 0;
+    else if (strcmp(extname, "search_index_hash") == 0)
+	hash = 1;
+    else
 	goto ok;
     clicon_debug(1, "%s Enabled extension:%s:%s", __FUNCTION__, modname, extname);
     yp = yang_parent_get(ys);
-    if (yang_list_index_add(yp) < 0)
+    if (yang_list_index_add(yp, hash) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -92,6 +92,10 @@ struct yang_stmt{
     yang_type_cache   *ys_typecache; /* If ys_keyword==Y_TYPE, cache all typedef data except unions */
     char              *ys_when_xpath; /* Special conditional for a "when"-associated augment xpath */
     cvec              *ys_when_nsc;   /* Special conditional for a "when"-associated augment namespace ctx */
+    struct xpath_compiled *ys_xpath;  /* If Y_MUST, Y_WHEN or Y_PATH: compiled argument, see yang_xpath_get */
+    cvec              *ys_xpath_nsc;  /* Namespace context of ys_xpath, NULL if path in typedef */
+    clicon_hash_t     *ys_deps;       /* If Y_SPEC: node name -> nodes whose constraints
+					 depend on it, see yang_validate_deps */
     int               _ys_vector_i;   /* internal use: yn_each */
 
 };
@@ -98,6 +98,7 @@
 #include "clixon_options.h"
 #include "clixon_yang_type.h"
 #include "clixon_yang_parse.h"
+#include "clixon_validate.h"
 #include "clixon_yang_cardinality.h"
 #include "clixon_yang_parse_lib.h"
 
@@ -1385,6 +1386,15 @@ yang_parse_post(clicon_handle h,
     for (i=0; i<ylen; i++)
 	if (yang_cardinality(h, ylist[i], yang_argument_get(ylist[i])) < 0)
 	    goto done;
+    /* 12. Map of constraint dependencies of all modules for incremental validation */
+    if (clicon_option_bool(h, "CLICON_VALIDATE_INCREMENTAL") &&
+	yang_validate_deps(yspec) < 0)
+	goto done;
+    /* 13. Check once if defaults of all modules depend on when, see xml_diff_dirty */
+    if (yang_default_when(yspec, 0) == 1)
+	yang_flag_set(yspec, YANG_FLAG_DEFAULT_WHEN);
+    else
+	yang_flag_reset(yspec, YANG_FLAG_DEFAULT_WHEN);
     retval = 0;
  done:
     if (ylist)
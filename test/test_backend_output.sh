@@ -0,0 +1,125 @@
+#!/usr/bin/env bash
+# Max pending output to a backend client: CLICON_BACKEND_OUTPUT_MAX
+# A netconf session subscribes with replay of a large stream replay log, but its
+# output is not read (stalled reader). The notifications pending to it exceed the
+# max, and the backend drops them and closes the session, while other sessions
+# continue to work.
+# @see test_stream_replay.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/stream.yang
+replaydir=$dir/replay
+flog=$dir/backend.log
+touch $flog
+
+# Number of notifications in replay log
+: ${perfnr:=20000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_RETENTION>3600</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_REPLAY_DIR>$replaydir</CLICON_STREAM_REPLAY_DIR>
+  <CLICON_BACKEND_OUTPUT_MAX>100000</CLICON_BACKEND_OUTPUT_MAX>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+  namespace "urn:example:clixon";
+  prefix ex;
+  notification event {
+    leaf event-class {
+      type string;
+    }
+    container reportingEntity {
+      leaf card {
+        type string;
+      }
+    }
+    leaf severity {
+      type string;
+    }
+  }
+}
+EOF
+
+# Replay log segment with $perfnr notifications from one minute ago
+# Record: <sec:uint64> <usec:uint32> <len:uint32> <XML>, see clixon_stream_replay.c
+mkdir -p $replaydir
+perl -e '
+my $t = time() - 60;
+for (my $i = 0; $i < $ARGV[0]; $i++){
+    my $x = "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\">" .
+	"<eventTime>2021-01-01T00:00:00.000000Z</eventTime>" .
+	"<event xmlns=\"urn:example:clixon\"><event-class>fault</event-class>" .
+	"<reportingEntity><card>Ethernet$i</card></reportingEntity>" .
+	"<severity>major</severity></event></notification>";
+    print pack("QLL", $t, $i, length($x)), $x;
+}' $perfnr > $replaydir/EXAMPLE.0
+
+# Replay from one hour ago
+START=$(date -u -d "-1 hour" +"%Y-%m-%dT%H:%M:%SZ")
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg -l f$flog"
+    start_backend -s init -f $cfg -l f$flog
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf EXAMPLE subscription with replay, stalled reader"
+(echo "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$START</startTime></create-subscription></rpc>]]>]]>"; sleep 5) | timeout 10 $clixon_netconf -qf $cfg | (sleep 5; cat > /dev/null) &
+spid=$!
+
+sleep 2
+
+new "backend closed stalled session"
+ret=$(grep "exceeds CLICON_BACKEND_OUTPUT_MAX" $flog)
+if [ -z "$ret" ]; then
+    err "exceeds CLICON_BACKEND_OUTPUT_MAX" "$(cat $flog)"
+fi
+
+new "netconf other session ok"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+wait $spid
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+# unset conditional parameters
+unset perfnr
+
+new "endtest"
+endtest
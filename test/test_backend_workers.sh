@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+# Backend worker threads: CLICON_BACKEND_WORKERS
+# get-config replies are serialized by worker threads. Check that replies are correct and
+# in request order when mixed with edits, errors and commits in one pipelined request
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+
+# Number of edit-config + get-config rpc pairs
+nr=10
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MODULE_MAIN>clixon-example</CLICON_YANG_MODULE_MAIN>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NETCONF_PIPELINE>4</CLICON_NETCONF_PIPELINE>
+  <CLICON_BACKEND_WORKERS>2</CLICON_BACKEND_WORKERS>
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+# Bring your own backend
+if [ $BE -ne 0 ]; then
+    # kill old backend (if any)
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend  -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+new "get-config empty candidate"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+# Build request and expected reply: each get-config sees the preceding edit
+req="$DEFAULTHELLO"
+reply=""
+data=""
+for (( i=1; i<=$nr; i++ )); do
+    req+="<rpc $DEFAULTNS message-id=\"$i\"><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:clixon\"><parameter><name>$i</name><value>$i</value></parameter></table></config></edit-config></rpc>]]>]]>"
+    reply+="<rpc-reply $DEFAULTNS message-id=\"$i\"><ok/></rpc-reply>]]>]]>"
+    data+="<parameter><name>$i</name><value>$i</value></parameter>"
+    req+="<rpc $DEFAULTNS message-id=\"$((i+100))\"><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:table\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>"
+    reply+="<rpc-reply $DEFAULTNS message-id=\"$((i+100))\"><data><table xmlns=\"urn:example:clixon\">$data</table></data></rpc-reply>]]>]]>"
+done
+# Running is empty before commit and has the edits after commit
+req+="<rpc $DEFAULTNS message-id=\"200\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='1']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"200\"><data/></rpc-reply>]]>]]>"
+req+="<rpc $DEFAULTNS message-id=\"201\"><commit/></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"201\"><ok/></rpc-reply>]]>]]>"
+req+="<rpc $DEFAULTNS message-id=\"202\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='1']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"202\"><data><table xmlns=\"urn:example:clixon\"><parameter><name>1</name><value>1</value></parameter></table></data></rpc-reply>]]>]]>"
+
+new "Netconf $nr pipelined edit-config and get-config serialized by worker threads"
+expecteof "$clixon_netconf -qf $cfg" 0 "$req" "^$reply$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,174 @@
+#!/usr/bin/env bash
+# Binary datastore format: CLICON_XMLDB_FORMAT=binary
+# 1. A datastore file in XML is loaded also in binary format
+# 2. Datastore files are written in binary format
+# 3. Binary datastore files are loaded at restart
+# 4. Lazy datastore cache: CLICON_XMLDB_LAZY
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+cfglazy=$dir/conf_lazy.xml
+fyang=$dir/binary.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_FORMAT>binary</CLICON_XMLDB_FORMAT>
+</clixon-config>
+EOF
+
+cat <<EOF > $cfglazy
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfglazy</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_FORMAT>binary</CLICON_XMLDB_FORMAT>
+  <CLICON_XMLDB_LAZY>true</CLICON_XMLDB_LAZY>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module binary{
+  yang-version 1.1;
+  namespace "urn:example:binary";
+  prefix bn;
+  container c {
+    list y {
+      key a;
+      leaf a {
+        type string;
+      }
+      leaf b {
+        type string;
+      }
+    }
+    leaf-list z {
+      type int32;
+    }
+  }
+  container d {
+    leaf e {
+      type string;
+    }
+  }
+}
+EOF
+
+# Running datastore file in XML
+cat <<EOF > $dir/running_db
+<${DATASTORE_TOP}>
+  <c xmlns="urn:example:binary">
+    <y><a>2</a><b>xml</b></y>
+    <y><a>1</a><b>xml</b></y>
+  </c>
+</${DATASTORE_TOP}>
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s running -f $cfg"
+    start_backend -s running -f $cfg
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "get-config running: XML file loaded"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:binary\"><y><a>1</a><b>xml</b></y><y><a>2</a><b>xml</b></y></c></data></rpc-reply>]]>]]>$"
+
+new "edit-config candidate"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:binary\"><y><a>3</a><b>bin&amp;ary</b></y><z>17</z><z>4</z></c><d xmlns=\"urn:example:binary\"><e>lazy</e></d></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "running datastore file is binary"
+if [ "$(sudo head -c 4 $dir/running_db)" != "CLXB" ]; then
+    err "CLXB" "$(sudo head -c 4 $dir/running_db)"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+
+    new "restart backend -s running -f $cfg"
+    start_backend -s running -f $cfg
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "get-config running: binary file loaded"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:binary\"><y><a>1</a><b>xml</b></y><y><a>2</a><b>xml</b></y><y><a>3</a><b>bin&amp;ary</b></y><z>4</z><z>17</z></c><d xmlns=\"urn:example:binary\"><e>lazy</e></d></data></rpc-reply>]]>]]>$"
+
+new "get-config running: list entry in loaded binary file"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/bn:c/bn:y[bn:a='2']\" xmlns:bn=\"urn:example:binary\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:binary\"><y><a>2</a><b>xml</b></y></c></data></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+
+    new "start backend with lazy cache -s running -f $cfglazy"
+    start_backend -s running -f $cfglazy
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "lazy: get-config running of one subtree"
+expecteof "$clixon_netconf -qf $cfglazy" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/bn:d\" xmlns:bn=\"urn:example:binary\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><d xmlns=\"urn:example:binary\"><e>lazy</e></d></data></rpc-reply>]]>]]>$"
+
+new "lazy: edit-config candidate of other subtree"
+expecteof "$clixon_netconf -qf $cfglazy" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:binary\"><y><a>4</a><b>lazy</b></y></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "lazy: netconf commit"
+expecteof "$clixon_netconf -qf $cfglazy" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "lazy: get-config running"
+expecteof "$clixon_netconf -qf $cfglazy" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:binary\"><y><a>1</a><b>xml</b></y><y><a>2</a><b>xml</b></y><y><a>3</a><b>bin&amp;ary</b></y><y><a>4</a><b>lazy</b></y><z>4</z><z>17</z></c><d xmlns=\"urn:example:binary\"><e>lazy</e></d></data></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfglazy
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,138 @@
+#!/usr/bin/env bash
+# Datastore journal: CLICON_XMLDB_JOURNAL
+# 1. Replay of a journal on top of a datastore file at startup, with a truncated last
+#    record, which is ignored and removed from the journal
+# 2. Edits are appended to the journal instead of rewriting the datastore file
+# 3. Journal is compacted into the datastore file when the backend terminates
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/journal.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_JOURNAL>true</CLICON_XMLDB_JOURNAL>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module journal{
+  yang-version 1.1;
+  namespace "urn:example:journal";
+  prefix jn;
+  container c {
+    list y {
+      key a;
+      leaf a {
+        type string;
+      }
+      leaf b {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+# Running datastore file with a base content padded so that journal fits
+cat <<EOF > $dir/running_db
+<${DATASTORE_TOP}>
+  <c xmlns="urn:example:journal">
+    <y><a>1</a><b>base</b></y>
+    <y><a>2</a><b>base</b></y>
+    <y><a>3</a><b>base</b></y>
+    <y><a>4</a><b>base</b></y>
+    <y><a>5</a><b>base</b></y>
+  </c>
+</${DATASTORE_TOP}>
+EOF
+
+# Journal with two records: merge of an entry and delete of another entry
+rec1="<delta op=\"merge\"><config><c xmlns=\"urn:example:journal\"><y><a>1</a><b>journal</b></y></c></config></delta>"
+rec2="<delta op=\"merge\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><config><c xmlns=\"urn:example:journal\"><y nc:operation=\"delete\"><a>5</a></y></c></config></delta>"
+echo "${#rec1}" > $dir/running_db.journal
+echo "$rec1" >> $dir/running_db.journal
+echo "${#rec2}" >> $dir/running_db.journal
+echo "$rec2" >> $dir/running_db.journal
+# Truncated record, as after a crash during append
+rec3="<delta op=\"merge\"><config><c xmlns=\"urn:example:journal\"><y><a>7</a><b>journal</b></y></c></config></delta>"
+echo "${#rec3}" >> $dir/running_db.journal
+echo -n "${rec3:0:40}" >> $dir/running_db.journal
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s running -f $cfg"
+    start_backend -s running -f $cfg
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "get-config running: journal replayed on datastore file"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:journal\"><y><a>1</a><b>journal</b></y><y><a>2</a><b>base</b></y><y><a>3</a><b>base</b></y><y><a>4</a><b>base</b></y></c></data></rpc-reply>]]>]]>$"
+
+new "truncated record removed from journal"
+if sudo grep -qxF "${rec3:0:40}" $dir/running_db.journal 2> /dev/null; then
+    err "no truncated record in $dir/running_db.journal"
+fi
+
+new "edit-config candidate"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:journal\"><y><a>6</a><b>edit</b></y></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "candidate edit is journaled"
+if ! sudo grep -q "<a>6</a>" $dir/candidate_db.journal; then
+    err "<a>6</a> in $dir/candidate_db.journal"
+fi
+
+new "candidate datastore file not rewritten"
+if sudo grep -q "<a>6</a>" $dir/candidate_db; then
+    err "no <a>6</a> in $dir/candidate_db"
+fi
+
+new "get-config candidate"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/jn:c/jn:y[jn:a='6']\" xmlns:jn=\"urn:example:journal\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:journal\"><y><a>6</a><b>edit</b></y></c></data></rpc-reply>]]>]]>$"
+
+new "netconf commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+
+    new "running journal compacted on exit"
+    if sudo test -f $dir/running_db.journal; then
+	err "no $dir/running_db.journal"
+    fi
+
+    new "running datastore file has all edits"
+    if ! sudo grep -q "<a>6</a>" $dir/running_db; then
+	err "<a>6</a> in $dir/running_db"
+    fi
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,275 @@
+#!/usr/bin/env bash
+# Transaction diff of modified subtrees only, see xml_diff_dirty
+# Incremental validation is used since it only validates nodes found by the diff:
+# if a modification is missed by the diff, an invalid candidate is validated OK.
+# Run with the three datastore cache modes, and read running between edits, which
+# unshares the running cache in zerocopy mode
+# Also a default value in an unmodified subtree with a when condition on a modified
+# node, where the full diff is used, see yang_default_when
+# And a deleted leaf whose default value differs from the deleted value
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/dirty.yang
+fyangw=$dir/dirtyw.yang
+fyangd=$dir/dirtyd.yang
+
+cat <<EOF > $fyang
+module dirty{
+  yang-version 1.1;
+  namespace "urn:example:dirty";
+  prefix dy;
+  container c {
+    list y {
+      key a;
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type int32{
+          range "0..100";
+        }
+      }
+    }
+    leaf ref {
+      type leafref {
+        path "/dy:c/dy:y/dy:a";
+      }
+    }
+  }
+  container d {
+    leaf e {
+      type string;
+    }
+  }
+}
+EOF
+
+cat <<EOF > $fyangw
+module dirtyw{
+  yang-version 1.1;
+  namespace "urn:example:dirtyw";
+  prefix dw;
+  container d {
+    leaf e {
+      type string;
+    }
+  }
+  container g {
+    leaf f {
+      when "/dw:d/dw:e != 'off'";
+      type string;
+      default "on";
+    }
+  }
+}
+EOF
+
+cat <<EOF > $fyangd
+module dirtyd{
+  yang-version 1.1;
+  namespace "urn:example:dirtyd";
+  prefix dd;
+  container h {
+    leaf v {
+      type int32;
+      default 5;
+    }
+  }
+  container k {
+    leaf w {
+      type int32;
+      must "/dd:h/dd:v != 5" {
+        error-message "v is default";
+      }
+    }
+  }
+}
+EOF
+
+# Args:
+# 1: dbcache: cache, nocache, cache-zerocopy
+# 2: yang file
+function startrun()
+{
+    dbcache=$1
+    yang=$2
+    new "test params: -f $cfg  # dbcache: $dbcache"
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$yang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_DATASTORE_CACHE>$dbcache</CLICON_DATASTORE_CACHE>
+  <CLICON_VALIDATE_INCREMENTAL>true</CLICON_VALIDATE_INCREMENTAL>
+</clixon-config>
+EOF
+
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+
+	new "wait backend"
+	wait_backend
+    fi
+}
+
+function stoprun()
+{
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+}
+
+# Args:
+# 1: dbcache: cache, nocache, cache-zerocopy
+function testrun()
+{
+    startrun $1 $fyang
+
+    new "edit-config base"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:dirty\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y><ref>2</ref></c><d xmlns=\"urn:example:dirty\"><e>base</e></d></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit base"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "get-config running"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:dirty\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y><ref>2</ref></c><d xmlns=\"urn:example:dirty\"><e>base</e></d></data></rpc-reply>]]>]]>$"
+
+    new "change leaf in list entry to invalid value"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:dirty\"><y><a>2</a><b>200</b></y></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate changed leaf fail"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>b</bad-element></error-info><error-severity>error</error-severity><error-message>Number 200 out of range: 0 - 100</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "change other subtree"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><d xmlns=\"urn:example:dirty\"><e>other</e></d></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit other subtree"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "get-config running"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:dirty\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y><ref>2</ref></c><d xmlns=\"urn:example:dirty\"><e>other</e></d></data></rpc-reply>]]>]]>$"
+
+    new "delete leafref target"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:dirty\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><y nc:operation=\"delete\"><a>2</a></y></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate deleted leafref target fail"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>2</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf 2 matching path /dy:c/dy:y/dy:a</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+    new "add new list entry with invalid value"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:dirty\"><y><a>2</a><b>300</b></y></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate added entry fail"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>b</bad-element></error-info><error-severity>error</error-severity><error-message>Number 300 out of range: 0 - 100</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate ok"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    stoprun
+}
+
+# Default value with when condition on other subtree
+# Args:
+# 1: dbcache: cache, nocache, cache-zerocopy
+function testwhen()
+{
+    startrun $1 $fyangw
+
+    new "edit-config base"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><d xmlns=\"urn:example:dirtyw\"><e>base</e></d></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit base"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "change when condition of default in other subtree"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><d xmlns=\"urn:example:dirtyw\"><e>off</e></d></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate default when fail"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-failed</error-tag><error-severity>error</error-severity><error-message>Failed WHEN condition of f in module dirtyw</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate ok"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    stoprun
+}
+
+# Deleted leaf is replaced by default value
+# Args:
+# 1: dbcache: cache, nocache, cache-zerocopy
+function testdefault()
+{
+    startrun $1 $fyangd
+
+    new "edit-config base"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><h xmlns=\"urn:example:dirtyd\"><v>6</v></h><k xmlns=\"urn:example:dirtyd\"><w>1</w></k></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit base"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "delete leaf with other value than default"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><h xmlns=\"urn:example:dirtyd\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><v nc:operation=\"delete\">6</v></h></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate changed default fail"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-failed</error-tag><error-severity>error</error-severity><error-message>v is default</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate ok"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    stoprun
+}
+
+testrun nocache
+
+testrun cache
+
+testrun cache-zerocopy
+
+testwhen nocache
+
+testwhen cache
+
+testwhen cache-zerocopy
+
+testdefault nocache
+
+testdefault cache
+
+testdefault cache-zerocopy
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+# Event loop using epoll and select, see clixon_util_event
+# Input and output callbacks, timeout order, and deregistration in a forked child
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+: ${clixon_util_event:=clixon_util_event}
+
+new "event loop epoll"
+expectpart "$($clixon_util_event -D $DBG)" 0 "read: ok" "write: ok" "timeout: 123" "fork: ok" "all: ok"
+
+new "event loop select"
+expectpart "$($clixon_util_event -s -D $DBG)" 0 "read: ok" "write: ok" "timeout: 123" "fork: ok" "all: ok"
+
+rm -rf $dir
+
+# unset conditional parameters
+unset clixon_util_event
+
+new "endtest"
+endtest
@@ -0,0 +1,137 @@
+#!/usr/bin/env bash
+# Bulk insert of new children in edit-config and merge, see xml_insert_bulk
+# New list entries are given in reverse order and interleaved with existing entries.
+# Check that the result is sorted and that overlapping entries are not duplicated.
+# 1. xml_merge using clixon_util_xml_mod
+# 2. edit-config merge of a large list into candidate
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+: ${clixon_util_xml_mod:=clixon_util_xml_mod}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/bulk.yang
+
+# Number of list entries in base and modification trees
+: ${perfnr:=1000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module bulk{
+  yang-version 1.1;
+  namespace "urn:example:bulk";
+  prefix bk;
+  container c {
+    leaf d {
+      type int32;
+    }
+    list a {
+      key x;
+      leaf x {
+        type int32;
+      }
+      leaf y {
+        type string;
+      }
+    }
+    leaf-list b {
+      type int32;
+    }
+  }
+}
+EOF
+
+# Base tree: odd entries 1,3,..
+base=""
+for (( i=1; i<2*$perfnr; i+=2 )); do
+    base="$base<a><x>$i</x><y>base</y></a>"
+done
+# Modification tree: even entries in reverse order, and every 10th odd entry (overlap)
+mod="<d>42</d>"
+for (( i=2*$perfnr; i>0; i-=2 )); do
+    mod="$mod<a><x>$i</x><y>mod</y></a><b>$i</b>"
+done
+for (( i=1; i<2*$perfnr; i+=20 )); do
+    mod="$mod<a><x>$i</x></a>"
+done
+# Expected result: all entries sorted
+res="<d>42</d>"
+for (( i=1; i<=2*$perfnr; i++ )); do
+    if [ $((i%2)) -eq 1 ]; then
+	res="$res<a><x>$i</x><y>base</y></a>"
+    else
+	res="$res<a><x>$i</x><y>mod</y></a>"
+    fi
+done
+for (( i=2; i<=2*$perfnr; i+=2 )); do
+    res="$res<b>$i</b>"
+done
+
+new "test params: -f $cfg -y $fyang"
+
+new "merge large list into base, check sorted"
+expectpart "$($clixon_util_xml_mod -o merge -y $fyang -b "<c xmlns=\"urn:example:bulk\">$base</c>" -x "<c xmlns=\"urn:example:bulk\">$mod</c>" -p . -D $DBG)" 0 "^<c xmlns=\"urn:example:bulk\">$res</c>$"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "edit-config base"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:bulk\">$base</c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "edit-config merge large list"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><default-operation>merge</default-operation><config><c xmlns=\"urn:example:bulk\">$mod</c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "get-config candidate sorted"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:bulk\">$res</c></data></rpc-reply>]]>]]>$"
+
+new "validate"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "edit-config fails after new entry is added in bulk, candidate unchanged"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:bulk\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><a><x>0</x></a><a nc:operation=\"create\"><x>3</x></a></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>data-exists</error-tag><error-severity>error</error-severity><error-message>Data already exists; cannot create new resource</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "get-config candidate after failed edit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:bulk\">$res</c></data></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+# unset conditional parameters
+unset clixon_util_xml_mod
+unset perfnr
+
+new "endtest"
+endtest
@@ -0,0 +1,194 @@
+#!/usr/bin/env bash
+# Leafref validation with the index of target values, see leafref_index_get
+# The index is only used for absolute paths without current(). Check that paths whose
+# targets depend on the context node are evaluated for each leaf:
+# - an absolute path using current(), from several list entries
+# - a relative path, from several list entries
+# - a path in a typedef used from two modules, where the path prefix is resolved in
+#   the module of the referring leaf
+# Also check that a dangling reference fails with the index
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyanga=$dir/lra.yang
+fyangb=$dir/lrb.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyangb</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyanga
+module lra{
+  yang-version 1.1;
+  namespace "urn:example:lra";
+  prefix a;
+  typedef tref {
+    type leafref {
+      path "/a:targets/a:name";
+    }
+  }
+  list targets {
+    key name;
+    leaf name {
+      type string;
+    }
+  }
+  leaf ref {
+    type tref;
+  }
+  container c {
+    list y {
+      key a;
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type int32;
+      }
+    }
+    list z {
+      key id;
+      leaf id {
+        type int32;
+      }
+      leaf k {
+        type int32;
+      }
+      leaf cref {
+        type leafref {
+          path "/a:c/a:y[a:a = current()/../a:k]/a:b";
+        }
+      }
+    }
+  }
+  list grp {
+    key n;
+    leaf n {
+      type string;
+    }
+    list m {
+      key id;
+      leaf id {
+        type int32;
+      }
+    }
+    leaf sel {
+      type leafref {
+        path "../a:m/a:id";
+      }
+    }
+  }
+}
+EOF
+
+# Same prefix as lra, the typedef path refers to lrb:targets from lrb:ref
+cat <<EOF > $fyangb
+module lrb{
+  yang-version 1.1;
+  namespace "urn:example:lrb";
+  prefix a;
+  import lra {
+    prefix ra;
+  }
+  list targets {
+    key name;
+    leaf name {
+      type string;
+    }
+  }
+  leaf ref {
+    type ra:tref;
+  }
+}
+EOF
+
+# Escape regex characters of path in error message
+cpath="/a:c/a:y\[a:a = current()/\.\./a:k\]/a:b"
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "edit-config base"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><targets xmlns=\"urn:example:lra\"><name>x1</name></targets><targets xmlns=\"urn:example:lra\"><name>x2</name></targets><ref xmlns=\"urn:example:lra\">x1</ref><c xmlns=\"urn:example:lra\"><y><a>1</a><b>10</b></y><y><a>2</a><b>20</b></y><z><id>1</id><k>1</k><cref>10</cref></z><z><id>2</id><k>2</k><cref>20</cref></z></c><grp xmlns=\"urn:example:lra\"><n>g1</n><m><id>1</id></m><sel>1</sel></grp><grp xmlns=\"urn:example:lra\"><n>g2</n><m><id>2</id></m><sel>2</sel></grp><targets xmlns=\"urn:example:lrb\"><name>y1</name></targets><ref xmlns=\"urn:example:lrb\">y1</ref></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "validate base ok"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "dangling absolute reference"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><ref xmlns=\"urn:example:lra\">x3</ref></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "validate dangling absolute reference fail"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>x3</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf x3 matching path /a:targets/a:name</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "current() path refers to target of other entry"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:lra\"><z><id>2</id><cref>10</cref></z></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "validate current() path fail"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>10</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf 10 matching path $cpath</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "relative path refers to target of other entry"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><grp xmlns=\"urn:example:lra\"><n>g2</n><sel>1</sel></grp></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "validate relative path fail"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>1</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf 1 matching path \.\./a:m/a:id</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "typedef path from other module refers to target of first module"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><ref xmlns=\"urn:example:lrb\">x1</ref></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "validate typedef path from other module fail"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>x1</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf x1 matching path /a:targets/a:name</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
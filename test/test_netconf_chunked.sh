@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+# Netconf framing, see RFC 6242 Sec 4
+# 1. End-of-message framing with several messages in one write
+# 2. Chunked framing with CLICON_NETCONF_CHUNKED
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MODULE_MAIN>clixon-example</CLICON_YANG_MODULE_MAIN>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NETCONF_CHUNKED>true</CLICON_NETCONF_CHUNKED>
+</clixon-config>
+EOF
+
+# Hello with base 1.0 only
+HELLO10="<hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.0</capability></capabilities></hello>]]>]]>"
+
+new "test params: -f $cfg"
+# Bring your own backend
+if [ $BE -ne 0 ]; then
+    # kill old backend (if any)
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend  -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+rpc="<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>"
+reply="<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "Netconf end-of-message framing: base 1.0 hello"
+expecteof "$clixon_netconf -qf $cfg" 0 "$HELLO10$rpc]]>]]>$rpc]]>]]>" "^$reply]]>]]>$reply]]>]]>$"
+
+new "Netconf chunked framing: one chunk"
+ret=$(printf "%s\n#%d\n%s\n##\n" "$DEFAULTHELLO" ${#rpc} "$rpc" | $clixon_netconf -qf $cfg)
+expect=$(printf "\n#%d\n%s\n##\n" ${#reply} "$reply")
+if [ "$ret" != "$expect" ]; then
+    err "$expect" "$ret"
+fi
+
+new "Netconf chunked framing: several chunks and messages"
+ret=$(printf "%s\n#10\n%s\n#%d\n%s\n##\n\n#%d\n%s\n##\n" "$DEFAULTHELLO" "${rpc:0:10}" $((${#rpc}-10)) "${rpc:10}" ${#rpc} "$rpc" | $clixon_netconf -qf $cfg)
+expect=$(printf "\n#%d\n%s\n##\n\n#%d\n%s\n##\n" ${#reply} "$reply" ${#reply} "$reply")
+if [ "$ret" != "$expect" ]; then
+    err "$expect" "$ret"
+fi
+
+new "Netconf chunked framing: invalid chunk-size"
+ret=$(printf "%s\n#0\n\n##\n" "$DEFAULTHELLO" | $clixon_netconf -qf $cfg 2> /dev/null)
+if [ -n "$ret" ]; then
+    err "" "$ret"
+fi
+
+new "Netconf chunked framing disabled: end-of-message framing with base 1.1 hello"
+expecteof "$clixon_netconf -qf $cfg -o CLICON_NETCONF_CHUNKED=false" 0 "$DEFAULTHELLO$rpc]]>]]>" "^$reply]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
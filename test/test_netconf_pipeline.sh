@@ -0,0 +1,84 @@
+#!/usr/bin/env bash
+# Netconf rpc pipelining: CLICON_NETCONF_PIPELINE
+# Several rpcs are sent in one write, replies are checked to be in request order also
+# when pipelined rpcs are mixed with local rpcs, errors and subtree filters
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+
+# Number of edit-config rpcs
+nr=20
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MODULE_MAIN>clixon-example</CLICON_YANG_MODULE_MAIN>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NETCONF_PIPELINE>4</CLICON_NETCONF_PIPELINE>
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+# Bring your own backend
+if [ $BE -ne 0 ]; then
+    # kill old backend (if any)
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend  -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+# Build request and expected reply
+req="$DEFAULTHELLO"
+reply=""
+for (( i=1; i<=$nr; i++ )); do
+    req+="<rpc $DEFAULTNS message-id=\"$i\"><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:clixon\"><parameter><name>$i</name><value>$i</value></parameter></table></config></edit-config></rpc>]]>]]>"
+    reply+="<rpc-reply $DEFAULTNS message-id=\"$i\"><ok/></rpc-reply>]]>]]>"
+done
+# Invalid rpc, error is generated locally
+req+="<rpc $DEFAULTNS message-id=\"100\"><edit-config><target><candidate/></target><extra/><config/></edit-config></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"100\"><rpc-error><error-type>application</error-type><error-tag>unknown-element</error-tag><error-info><bad-element>extra</bad-element></error-info><error-severity>error</error-severity><error-message>Failed to find YANG spec of XML node: extra with parent: edit-config in namespace: urn:ietf:params:xml:ns:netconf:base:1.0</error-message></rpc-error></rpc-reply>]]>]]>"
+# Pipelined xpath get-config
+req+="<rpc $DEFAULTNS message-id=\"101\"><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='1']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"101\"><data><table xmlns=\"urn:example:clixon\"><parameter><name>1</name><value>1</value></parameter></table></data></rpc-reply>]]>]]>"
+# Synchronous subtree get-config
+req+="<rpc $DEFAULTNS message-id=\"102\"><get-config><source><candidate/></source><filter type=\"subtree\"><table xmlns=\"urn:example:clixon\"><parameter><name>2</name></parameter></table></filter></get-config></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"102\"><data><table xmlns=\"urn:example:clixon\"><parameter><name>2</name><value>2</value></parameter></table></data></rpc-reply>]]>]]>"
+req+="<rpc $DEFAULTNS message-id=\"103\"><discard-changes/></rpc>]]>]]>"
+reply+="<rpc-reply $DEFAULTNS message-id=\"103\"><ok/></rpc-reply>]]>]]>"
+
+new "Netconf $nr pipelined edit-config mixed with other rpcs"
+expecteof "$clixon_netconf -qf $cfg" 0 "$req" "^$reply$"
+
+new "Netconf same rpcs without pipelining"
+expecteof "$clixon_netconf -qf $cfg -o CLICON_NETCONF_PIPELINE=1" 0 "$req" "^$reply$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
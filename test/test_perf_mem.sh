@@ -100,8 +100,14 @@ function testrun(){
     fi
     objects=$(echo "$res" | $clixon_util_xpath -p "/rpc-reply/global/xmlnr" | awk -F ">" '{print $2}' | awk -F "<" '{print $1}')
 
+    xmlsize=$(echo "$res" | $clixon_util_xpath -p "/rpc-reply/global/xmlsize" | awk -F ">" '{print $2}' | awk -F "<" '{print $1}')
+
     echo "Total"
     echo "   objects: $objects"
+    echo "   size: $xmlsize"
+    if [ -n "$objects" -a "$objects" != "0" ]; then
+	echo "   bytes/node: $((xmlsize/objects))"
+    fi
 
 #
     if [ -f /proc/$pid/statm ]; then     # This ony works on Linux 
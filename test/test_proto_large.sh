@@ -0,0 +1,96 @@
+#!/usr/bin/env bash
+# Internal IPC messages larger than the socket buffers
+# Requests are written by the client with writev, possibly in several partial writes,
+# and reassembled by the backend. Replies are written by the backend without blocking
+# and buffered until the client reads them.
+# Also pipelined requests of different lengths, so that messages are not aligned in the
+# receive buffer of the backend.
+# @see test_netconf_pipeline.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+
+# Number of list entries, each about 100 bytes
+: ${perfnr:=20000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MODULE_MAIN>clixon-example</CLICON_YANG_MODULE_MAIN>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NETCONF_PIPELINE>4</CLICON_NETCONF_PIPELINE>
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+# Bring your own backend
+if [ $BE -ne 0 ]; then
+    # kill old backend (if any)
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend  -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+# Large config, values of different lengths. Names are padded to be sorted as created
+data="<table xmlns=\"urn:example:clixon\">"
+for (( i=1; i<=$perfnr; i++ )); do
+    printf -v n "%06d" $i
+    data+="<parameter><name>$n</name><value>value$i-abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz</value></parameter>"
+done
+data+="</table>"
+
+new "netconf large edit-config"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$data</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf large get-config"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data>$data</data></rpc-reply>]]>]]>$"
+
+# Pipelined: small requests of different lengths mixed with large replies
+req="$DEFAULTHELLO"
+reply=""
+for (( i=1; i<=3; i++ )); do
+    req+="<rpc $DEFAULTNS message-id=\"$i\"><get-config><source><candidate/></source></get-config></rpc>]]>]]>"
+    reply+="<rpc-reply $DEFAULTNS message-id=\"$i\"><data>$data</data></rpc-reply>]]>]]>"
+    req+="<rpc $DEFAULTNS message-id=\"x$i$i\"><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='00000$i']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>"
+    reply+="<rpc-reply $DEFAULTNS message-id=\"x$i$i\"><data><table xmlns=\"urn:example:clixon\"><parameter><name>00000$i</name><value>value$i-abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz</value></parameter></table></data></rpc-reply>]]>]]>"
+done
+
+new "netconf pipelined large and small get-config"
+expecteof "$clixon_netconf -qf $cfg" 0 "$req" "^$reply$"
+
+new "netconf discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+# unset conditional parameters
+unset perfnr
+
+new "endtest"
+endtest
@@ -0,0 +1,104 @@
+#!/usr/bin/env bash
+# Restconf pooled per-user backend sessions: CLICON_RESTCONF_BACKEND_POOL
+# Three users take turns with a pool of two sessions, so that sessions are closed and reopened
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/pool.yang
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config user false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_RESTCONF_BACKEND_POOL>2</CLICON_RESTCONF_BACKEND_POOL>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module pool{
+  yang-version 1.1;
+  namespace "urn:example:pool";
+  prefix p;
+  leaf x{
+    type int32;
+  }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+for i in 1 2 3; do
+    for user in andy wilma guest; do
+	new "restconf PUT x as $user"
+	expectpart "$(curl -u $user:bar $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" -d "{\"pool:x\": $i}" $RCPROTO://localhost/restconf/data/pool:x)" 0 "HTTP/1.1 20[14]"
+
+	new "restconf GET x as $user"
+	expectpart "$(curl -u $user:bar $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/pool:x)" 0 "HTTP/1.1 200 OK" "{\"pool:x\":$i}"
+    done
+done
+
+new "restconf unknown user"
+expectpart "$(curl -u nobody:bar $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/pool:x)" 0 "HTTP/1.1 401 Unauthorized"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+# Set by restconf_config
+unset RESTCONFIG
+
+new "endtest"
+endtest
@@ -6,6 +6,7 @@
 #   - not a key int
 #   - key in an ordered-by user
 #   - key in state data
+#   - hash index (search_index_hash) on a non-key string
 # Use instance-id for tests, since api-path can only handle keys, and xpath is too complex.
 
 # Magic line must be first in script (see README.md)
@@ -56,6 +57,11 @@ module moda{
         description "non-index variable";
         type int32;
       }
+      leaf h{
+        description "explicit hash index variable";
+        type string;
+	cc:search_index_hash;
+      }
     }
   }
 }
@@ -67,7 +73,7 @@ new "generate list with $nr single string key to $xml1"
 echo -n '<x1 xmlns="urn:example:a">' > $xml1
 for (( i=0; i<$nr; i++ )); do  
     let ii=$nr-$i-1
-    echo -n "<y><k1>a$i</k1><z>foo$i</z><i>$ii</i><j>$ii</j></y>" >> $xml1
+    echo -n "<y><k1>a$i</k1><z>foo$i</z><i>$ii</i><j>$ii</j><h>h$ii</h></y>" >> $xml1
 done
 echo -n '</x1>' >> $xml1
 
@@ -78,7 +84,10 @@ for (( ii=0; ii<10; ii++ )); do
     # Let key index rndi be reverse of rnd
     rndi=$(( $nr - $rnd - 1 ))
     new "instance-id single string key i=$rndi (rnd:$rnd)"
-    expectpart "$($clixon_util_path -f $xml1 -y $ydir -p /a:x1/a:y[a:i=\"$rndi\"])" 0 "^0: <y><k1>a$rnd</k1><z>foo$rnd</z><i>$rndi</i><j>$rndi</j></y>$"
+    expectpart "$($clixon_util_path -f $xml1 -y $ydir -p /a:x1/a:y[a:i=\"$rndi\"])" 0 "^0: <y><k1>a$rnd</k1><z>foo$rnd</z><i>$rndi</i><j>$rndi</j><h>h$rndi</h></y>$"
+
+    new "instance-id hash index h=h$rndi (rnd:$rnd)"
+    expectpart "$($clixon_util_path -f $xml1 -y $ydir -p /a:x1/a:y[a:h=\"h$rndi\"])" 0 "^0: <y><k1>a$rnd</k1><z>foo$rnd</z><i>$rndi</i><j>$rndi</j><h>h$rndi</h></y>$"
 done
 
 # Then measure time for index and non-index, assume correct
@@ -88,6 +97,9 @@ done
 new "index search latency i=$rndi"
 { time -p $clixon_util_path -f $xml1 -y $ydir -p /a:x1/a:y[a:i=\"$rndi\"] -n 10 > /dev/null; }  2>&1 | awk '/real/ {print $2}'
 
+new "hash index search latency h=h$rndi"
+{ time -p $clixon_util_path -f $xml1 -y $ydir -p /a:x1/a:y[a:h=\"h$rndi\"] -n 10 > /dev/null; }  2>&1 | awk '/real/ {print $2}'
+
 new "non-index search latency j=$rndi"
 { time -p $clixon_util_path -f $xml1 -y $ydir -p /a:x1/a:y[a:j=\"$rndi\"] > /dev/null; }  2>&1 | awk '/real/ {print $2}'
 
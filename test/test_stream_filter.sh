@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# Shared subscription filters of a notification stream, see stream_filter_get
+# Subscribers A and B have the same filter, C another filter and D no filter.
+# Check that each subscriber gets the matching events, that A and B share one filter,
+# and that a filter is released when its last subscription is removed.
+# Also that each event is serialized once for all its subscribers, and that the text
+# of an event kept by a subscriber is valid after distribution.
+# @see test_stream.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+: ${clixon_util_notify:=clixon_util_notify}
+
+major="event\[severity='major'\]"
+minor="event\[severity='minor'\]"
+
+new "stream filters shared, events matched, filters released"
+expectpart "$($clixon_util_notify -D $DBG)" 0 "^filters: $major=2 $minor=1$" "^events: A=2 B=2 C=1 D=4$" "^filters: $major=1 $minor=1$" "^events: A=2 B=3 C=1 D=5$" "^filters:$" "^events: A=2 B=3 C=1 D=6$" "^serialize: ok$" "^kept: ok$"
+
+rm -rf $dir
+
+# unset conditional parameters
+unset clixon_util_notify
+
+new "endtest"
+endtest
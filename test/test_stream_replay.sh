@@ -0,0 +1,115 @@
+#!/usr/bin/env bash
+# Stream replay buffer on disk: CLICON_STREAM_REPLAY_DIR
+# 1. Notifications of the EXAMPLE stream are written to segment files
+# 2. A subscription with startTime replays them
+# 3. The replay buffer is read back at backend restart
+# @see test_netconf_notifications.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/stream.yang
+replaydir=$dir/replay
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_RETENTION>3600</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_REPLAY_DIR>$replaydir</CLICON_STREAM_REPLAY_DIR>
+  <CLICON_STREAM_REPLAY_SIZE>100000</CLICON_STREAM_REPLAY_SIZE>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+  namespace "urn:example:clixon";
+  prefix ex;
+  notification event {
+    leaf event-class {
+      type string;
+    }
+    container reportingEntity {
+      leaf card {
+        type string;
+      }
+    }
+    leaf severity {
+      type string;
+    }
+  }
+}
+EOF
+
+mkdir -p $replaydir
+
+# Replay from one hour ago
+START=$(date -u -d "-1 hour" +"%Y-%m-%dT%H:%M:%SZ")
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+# Example backend sends an EXAMPLE notification every 5s
+sleep 6
+
+new "replay segment file exists"
+if [ ! -s $replaydir/EXAMPLE.0 ]; then
+    err "$replaydir/EXAMPLE.0" "$(ls $replaydir)"
+fi
+
+new "netconf EXAMPLE subscription with replay"
+expectwait "$clixon_netconf -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$START</startTime></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20[^<]*</eventTime><event xmlns=\"urn:example:clixon\"><event-class>fault</event-class>" 1
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    stop_backend -f $cfg
+
+    new "restart backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "wait backend"
+    wait_backend
+
+    new "netconf EXAMPLE replay of notifications before restart"
+    expectwait "$clixon_netconf -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$START</startTime></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20[^<]*</eventTime><event xmlns=\"urn:example:clixon\"><event-class>fault</event-class>" 1
+
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,125 @@
+#!/usr/bin/env bash
+# Parallel yang binding and sorting of large XML trees: CLICON_XML_THREADS
+# Load an unsorted startup datastore using several threads and check that it is bound and
+# sorted as when loaded by a single thread.
+# Also check that an invalid subtree fails also if it is bound in parallel.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Number of list entries
+: ${perfnr:=2000}
+
+# Number of threads
+: ${threads:=4}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/parallel.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_PRETTY>false</CLICON_XMLDB_PRETTY>
+  <CLICON_XML_THREADS>$threads</CLICON_XML_THREADS>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module parallel{
+  yang-version 1.1;
+  namespace "urn:example:parallel";
+  prefix p;
+  container x0 {
+    container x1 {
+      list y {
+        key a;
+        leaf a {
+          type int32;
+        }
+        leaf b {
+          type string;
+        }
+        leaf-list c {
+          type int32;
+        }
+      }
+    }
+  }
+  container d {
+    leaf e {
+      type string;
+    }
+  }
+}
+EOF
+
+# Generate list entries in reverse order in startup datastore
+new "generate startup with $perfnr entries in reverse order"
+echo -n "<${DATASTORE_TOP}><x0 xmlns=\"urn:example:parallel\"><x1>" > $dir/startup_db
+for (( i=$perfnr; i>0; i-- )); do  
+    echo -n "<y><a>$i</a><b>b$i</b><c>2</c><c>1</c></y>" >> $dir/startup_db
+done
+echo -n "</x1></x0><d xmlns=\"urn:example:parallel\"><e>ok</e></d></${DATASTORE_TOP}>" >> $dir/startup_db
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s startup -f $cfg"
+    start_backend -s startup -f $cfg
+
+    new "wait backend"
+    wait_backend
+fi
+
+new "get-config first list entry is sorted"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/p:x0/p:x1/p:y[p:a='1']\" xmlns:p=\"urn:example:parallel\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x0 xmlns=\"urn:example:parallel\"><x1><y><a>1</a><b>b1</b><c>1</c><c>2</c></y></x1></x0></data></rpc-reply>]]>]]>$"
+
+new "get-config last list entry"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/p:x0/p:x1/p:y[p:a='$perfnr']\" xmlns:p=\"urn:example:parallel\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x0 xmlns=\"urn:example:parallel\"><x1><y><a>$perfnr</a><b>b$perfnr</b><c>1</c><c>2</c></y></x1></x0></data></rpc-reply>]]>]]>$"
+
+new "get-config other top-level subtree"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/p:d\" xmlns:p=\"urn:example:parallel\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><d xmlns=\"urn:example:parallel\"><e>ok</e></d></data></rpc-reply>]]>]]>$"
+
+new "edit-config with unknown element in one of many list entries"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x0 xmlns=\"urn:example:parallel\"><x1>"
+for (( i=1; i<=300; i++ )); do  
+    if [ $i -eq 200 ]; then
+	rpc+="<y><a>$i</a><xxx>bad</xxx></y>"
+    else
+	rpc+="<y><a>$i</a></y>"
+    fi
+done
+rpc+="</x1></x0></config></edit-config></rpc>]]>]]>"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO$rpc" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>unknown-element</error-tag><error-info><bad-element>xxx</bad-element></error-info><error-severity>error</error-severity>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+# unset conditional parameters 
+unset perfnr
+unset threads
+
+new "endtest"
+endtest
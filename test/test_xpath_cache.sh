@@ -0,0 +1,126 @@
+#!/usr/bin/env bash
+# Cache of parsed xpaths: CLICON_XPATH_CACHE_SIZE
+# A must expression evaluated for each list entry is parsed once, check validation
+# result and the xpath cache counters of the stats rpc, with and without cache
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/xpcache.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module xpcache{
+  yang-version 1.1;
+  namespace "urn:example:xpcache";
+  prefix xc;
+  container c {
+    list y {
+      key a;
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type int32;
+      }
+      must "b > a" {
+        error-message "b must be larger than a";
+      }
+    }
+  }
+}
+EOF
+
+# Get xpath cache hits from stats rpc
+# Args: 1: config file
+function xpathhits()
+{
+    echo "$DEFAULTHELLO<rpc $DEFAULTNS><stats $LIBNS/></rpc>]]>]]>" | $clixon_netconf -qf $1 | sed -n 's/.*<xpathcachehits>\([0-9]*\)<\/xpathcachehits>.*/\1/p'
+}
+
+# Edit entries, validate, and check a failing entry is detected
+# Args: 1: extra backend options
+function testrun()
+{
+    opts=$1
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg $opts"
+	start_backend -s init -f $cfg $opts
+
+	new "wait backend"
+	wait_backend
+    fi
+
+    new "edit-config candidate with 10 entries"
+    data=""
+    for (( i=1; i<=10; i++ )); do
+	data+="<y><a>$i</a><b>$((i+1))</b></y>"
+    done
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:xpcache\">$data</c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate ok"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "edit-config candidate with invalid entry"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:xpcache\"><y><a>11</a><b>11</b></y></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate fail"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-failed</error-tag><error-severity>error</error-severity><error-message>b must be larger than a</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+}
+
+new "test params: -f $cfg"
+
+testrun ""
+
+if [ $BE -ne 0 ]; then
+    new "xpath cache hits"
+    hits=$(xpathhits $cfg)
+    if [ -z "$hits" ] || [ $hits -eq 0 ]; then
+	err "xpath cache hits > 0" "$hits"
+    fi
+fi
+
+testrun "-o CLICON_XPATH_CACHE_SIZE=0"
+
+if [ $BE -ne 0 ]; then
+    new "no xpath cache hits when disabled"
+    hits=$(xpathhits $cfg)
+    if [ "$hits" != "0" ]; then
+	err "0" "$hits"
+    fi
+
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -78,7 +78,7 @@ usage(char *argv0)
 		"\t-D\t\tDebug\n"
 		"\t-d <db>\t\tDatabase name. Default: running. Alt: candidate,startup\n"
 		"\t-b <dir>\tDatabase directory. Mandatory\n"
-	        "\t-f <fmt>\tDatabase format: xml or json\n"
+	        "\t-f <fmt>\tDatabase format: xml, json or binary\n"
 		"\t-x <xml>\tXML file. Alternative to put <xml> argument\n"
 		"\t-y <file>\tYang file. Mandatory\n"
 		"and command is either:\n"
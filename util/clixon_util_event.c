@@ -0,0 +1,293 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC (Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+
+  * Unit test of the event loop, using epoll (if available) or select (-s)
+  * Each check prints a line on stdout:
+  *  read:    input callbacks on several pipes, each deregistering itself
+  *  write:   output callback registered on a pipe
+  *  timeout: timeouts registered out of order are called in time order
+  *  fork:    a child deregistering an inherited file descriptor does not affect
+  *           the parent's registration
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon/clixon.h"
+
+/* Number of pipes in read check */
+#define UTIL_EVENT_PIPES 3
+
+/* Number of checks left until event loop exits */
+static int _checks = 4;
+
+static int _reads = 0;
+static char _timeouts[8] = {0,};
+
+static int
+usage(char *argv0)
+{
+    fprintf(stderr, "usage:%s [options]\n"
+	    "where options are\n"
+            "\t-h \t\tHelp\n"
+    	    "\t-D <level> \tDebug\n"
+	    "\t-s \t\tUse select instead of epoll\n"
+	    ,
+	    argv0);
+    exit(0);
+}
+
+static int
+check_done(void)
+{
+    if (--_checks == 0)
+	clicon_exit_set();
+    return 0;
+}
+
+static int
+read_cb(int   fd,
+	void *arg)
+{
+    char c;
+
+    if (read(fd, &c, 1) != 1){
+	clicon_err(OE_UNIX, errno, "read");
+	return -1;
+    }
+    if (clixon_event_unreg_fd(fd, read_cb) < 0)
+	return -1;
+    if (++_reads == UTIL_EVENT_PIPES){
+	fprintf(stdout, "read: ok\n");
+	check_done();
+    }
+    return 0;
+}
+
+static int
+write_cb(int   fd,
+	 void *arg)
+{
+    if (write(fd, "w", 1) != 1){
+	clicon_err(OE_UNIX, errno, "write");
+	return -1;
+    }
+    if (clixon_event_unreg_fd_out(fd, write_cb) < 0)
+	return -1;
+    fprintf(stdout, "write: ok\n");
+    return check_done();
+}
+
+static int
+timeout_cb(int   fd,
+	   void *arg)
+{
+    char *c = (char*)arg;
+
+    strncat(_timeouts, c, sizeof(_timeouts)-strlen(_timeouts)-1);
+    if (strlen(_timeouts) == 3){
+	fprintf(stdout, "timeout: %s\n", _timeouts);
+	check_done();
+    }
+    return 0;
+}
+
+static int
+fork_cb(int   fd,
+	void *arg)
+{
+    char c;
+
+    if (read(fd, &c, 1) != 1){
+	clicon_err(OE_UNIX, errno, "read");
+	return -1;
+    }
+    if (clixon_event_unreg_fd(fd, fork_cb) < 0)
+	return -1;
+    fprintf(stdout, "fork: ok\n");
+    return check_done();
+}
+
+/*! Guard against a check that never completes
+ */
+static int
+guard_cb(int   fd,
+	 void *arg)
+{
+    fprintf(stdout, "guard: %d checks not done\n", _checks);
+    clicon_exit_set();
+    return 0;
+}
+
+/*! Register timeout at msec from now
+ */
+static int
+timeout_reg(int  msec,
+	    int (*fn)(int, void*),
+	    char *arg)
+{
+    struct timeval t;
+    struct timeval td;
+
+    gettimeofday(&t, NULL);
+    td.tv_sec = msec/1000;
+    td.tv_usec = (msec%1000)*1000;
+    timeradd(&t, &td, &t);
+    return clixon_event_reg_timeout(t, fn, arg, "util event timeout");
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    int           retval = -1;
+    int           c;
+    clicon_handle h;
+    int           dbg = 0;
+    int           sel = 0;
+    int           p[UTIL_EVENT_PIPES][2];
+    int           pw[2];
+    int           pf[2];
+    int           i;
+    pid_t         pid;
+    int           status;
+
+    /* In the startup, logs to stderr & debug flag set later */
+    clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
+
+    if ((h = clicon_handle_init()) == NULL)
+	goto done;
+
+    optind = 1;
+    opterr = 0;
+    while ((c = getopt(argc, argv, "hD:s")) != -1)
+	switch (c) {
+	case 'h':
+	    usage(argv[0]);
+	    break;
+    	case 'D':
+	    if (sscanf(optarg, "%d", &dbg) != 1)
+		usage(argv[0]);
+	    break;
+	case 's':
+	    sel++;
+	    break;
+	default:
+	    usage(argv[0]);
+	    break;
+	}
+    clicon_log_init(__FILE__, dbg?LOG_DEBUG:LOG_INFO, CLICON_LOG_STDERR);
+    clicon_debug_init(dbg, NULL);
+
+    if (sel && clixon_event_select() < 0)
+	goto done;
+    /* Read: data is available on all pipes before the loop is entered */
+    for (i=0; i<UTIL_EVENT_PIPES; i++){
+	if (pipe(p[i]) < 0){
+	    clicon_err(OE_UNIX, errno, "pipe");
+	    goto done;
+	}
+	if (clixon_event_reg_fd(p[i][0], read_cb, NULL, "util event read") < 0)
+	    goto done;
+	if (write(p[i][1], "r", 1) != 1){
+	    clicon_err(OE_UNIX, errno, "write");
+	    goto done;
+	}
+    }
+    /* Write */
+    if (pipe(pw) < 0){
+	clicon_err(OE_UNIX, errno, "pipe");
+	goto done;
+    }
+    if (clixon_event_reg_fd_out(pw[1], write_cb, NULL, "util event write") < 0)
+	goto done;
+    /* Timeouts registered out of order */
+    if (timeout_reg(30, timeout_cb, "3") < 0 ||
+	timeout_reg(10, timeout_cb, "1") < 0 ||
+	timeout_reg(20, timeout_cb, "2") < 0)
+	goto done;
+    /* Fork: child deregisters inherited fd, parent writes when child has exited */
+    if (pipe(pf) < 0){
+	clicon_err(OE_UNIX, errno, "pipe");
+	goto done;
+    }
+    if (clixon_event_reg_fd(pf[0], fork_cb, NULL, "util event fork") < 0)
+	goto done;
+    if ((pid = fork()) < 0){
+	clicon_err(OE_UNIX, errno, "fork");
+	goto done;
+    }
+    if (pid == 0){ /* child */
+	clixon_event_unreg_fd(pf[0], fork_cb);
+	_exit(0);
+    }
+    if (waitpid(pid, &status, 0) < 0){
+	clicon_err(OE_UNIX, errno, "waitpid");
+	goto done;
+    }
+    if (write(pf[1], "f", 1) != 1){
+	clicon_err(OE_UNIX, errno, "write");
+	goto done;
+    }
+    if (timeout_reg(2000, guard_cb, NULL) < 0)
+	goto done;
+    clixon_event_loop(h);
+    if (_checks == 0)
+	fprintf(stdout, "all: ok\n");
+    retval = 0;
+ done:
+    clixon_event_exit();
+    if (h)
+	clicon_handle_exit(h);
+    return retval;
+}
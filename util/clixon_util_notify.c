@@ -0,0 +1,284 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC (Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+
+  * Unit test of notification stream subscriptions, without backend
+  * Subscribers A and B have the same filter, C another filter and D no filter.
+  * Events are notified and the number of events received by each subscriber and the
+  * shared filters of the stream are printed on stdout.
+  * Also check that an event is serialized once and the same text given to all its
+  * subscribers, and that a subscriber may keep the text of an event, see stream_event_cbuf
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <sys/time.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon/clixon.h"
+
+#define UTIL_NOTIFY_STREAM "TEST"
+#define UTIL_NOTIFY_NS     "urn:example:clixon"
+
+/* Subscriber */
+struct util_sub{
+    char *us_name;   /* Subscriber name */
+    char *us_xpath;  /* Filter, or NULL */
+    int   us_events; /* Number of events received */
+};
+
+/* Serialized text of current event given to first subscriber */
+static cbuf *_event_cb = NULL;
+
+/* Number of subscribers given no or other text of an event */
+static int _event_cb_err = 0;
+
+/* Last event kept by subscriber without filter */
+static struct stream_event *_event_kept = NULL;
+
+static struct util_sub _subs[] = {
+    {"A", "event[severity='major']", 0},
+    {"B", "event[severity='major']", 0},
+    {"C", "event[severity='minor']", 0},
+    {"D", NULL, 0},
+    {NULL, NULL, 0}
+};
+
+static int
+usage(char *argv0)
+{
+    fprintf(stderr, "usage:%s [options]\n"
+	    "where options are\n"
+            "\t-h \t\tHelp\n"
+    	    "\t-D <level> \tDebug\n"
+	    ,
+	    argv0);
+    exit(0);
+}
+
+/*! Subscription callback, count events
+ */
+static int
+util_notify_cb(clicon_handle        h,
+	       int                  op,
+	       cxobj               *event,
+	       struct stream_event *se,
+	       void                *arg)
+{
+    struct util_sub *us = (struct util_sub *)arg;
+    cbuf            *cb;
+
+    if (op != 0)
+	return 0;
+    us->us_events++;
+    if ((cb = stream_event_cbuf(se)) == NULL ||
+	strstr(cbuf_get(cb), "<severity>") == NULL)
+	_event_cb_err++;
+    else if (_event_cb == NULL)
+	_event_cb = cb;
+    else if (cb != _event_cb)
+	_event_cb_err++;
+    if (us->us_xpath == NULL){
+	if (_event_kept)
+	    stream_event_free(_event_kept);
+	if ((_event_kept = stream_event_ref(se)) == NULL)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Print events received by each subscriber
+ */
+static int
+util_print_events(void)
+{
+    struct util_sub *us;
+
+    fprintf(stdout, "events:");
+    for (us = _subs; us->us_name; us++)
+	fprintf(stdout, " %s=%d", us->us_name, us->us_events);
+    fprintf(stdout, "\n");
+    return 0;
+}
+
+/*! Print shared filters of stream and number of subscriptions using them
+ */
+static int
+util_print_filters(event_stream_t *es)
+{
+    struct stream_filter *sf;
+
+    fprintf(stdout, "filters:");
+    if ((sf = es->es_filters) != NULL)
+	do {
+	    fprintf(stdout, " %s=%d", sf->sf_xpath, sf->sf_refcnt);
+	    sf = NEXTQ(struct stream_filter *, sf);
+	} while (sf && sf != es->es_filters);
+    fprintf(stdout, "\n");
+    return 0;
+}
+
+/*! Notify event with severity
+ */
+static int
+util_notify(clicon_handle h,
+	    char         *severity)
+{
+    _event_cb = NULL;
+    return stream_notify(h, UTIL_NOTIFY_STREAM,
+			 "<event xmlns=\"%s\"><event-class>fault</event-class><severity>%s</severity></event>",
+			 UTIL_NOTIFY_NS, severity);
+}
+
+/*! Remove subscription of subscriber
+ */
+static int
+util_unsubscribe(clicon_handle h,
+		 char         *name)
+{
+    struct util_sub *us;
+
+    for (us = _subs; us->us_name; us++)
+	if (strcmp(us->us_name, name) == 0)
+	    return stream_ss_delete_all(h, util_notify_cb, us);
+    return 0;
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    int              retval = -1;
+    int              c;
+    clicon_handle    h;
+    int              dbg = 0;
+    yang_stmt       *yspec = NULL;
+    event_stream_t  *es;
+    struct util_sub *us;
+
+    /* In the startup, logs to stderr & debug flag set later */
+    clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
+
+    if ((h = clicon_handle_init()) == NULL)
+	goto done;
+
+    optind = 1;
+    opterr = 0;
+    while ((c = getopt(argc, argv, "hD:")) != -1)
+	switch (c) {
+	case 'h':
+	    usage(argv[0]);
+	    break;
+    	case 'D':
+	    if (sscanf(optarg, "%d", &dbg) != 1)
+		usage(argv[0]);
+	    break;
+	default:
+	    usage(argv[0]);
+	    break;
+	}
+    clicon_log_init(__FILE__, dbg?LOG_DEBUG:LOG_INFO, CLICON_LOG_STDERR);
+    clicon_debug_init(dbg, NULL);
+
+    /* Events are parsed with an empty yang spec */
+    if ((yspec = yspec_new()) == NULL)
+	goto done;
+    clicon_dbspec_yang_set(h, yspec);
+    /* Replay enabled, events are added to replay after distribution */
+    if (stream_add(h, UTIL_NOTIFY_STREAM, "Test stream", 1, NULL) < 0)
+	goto done;
+    if ((es = stream_find(h, UTIL_NOTIFY_STREAM)) == NULL){
+	clicon_err(OE_CFG, ENOENT, "stream %s not found", UTIL_NOTIFY_STREAM);
+	goto done;
+    }
+    for (us = _subs; us->us_name; us++)
+	if (stream_ss_add(h, UTIL_NOTIFY_STREAM, us->us_xpath, NULL, NULL,
+			  util_notify_cb, us) == NULL)
+	    goto done;
+    util_print_filters(es);
+    if (util_notify(h, "major") < 0 ||
+	util_notify(h, "minor") < 0 ||
+	util_notify(h, "major") < 0 ||
+	util_notify(h, "warning") < 0)
+	goto done;
+    util_print_events();
+    /* Filter is kept as long as a subscription uses it */
+    if (util_unsubscribe(h, "A") < 0)
+	goto done;
+    util_print_filters(es);
+    if (util_notify(h, "major") < 0)
+	goto done;
+    util_print_events();
+    if (util_unsubscribe(h, "B") < 0 ||
+	util_unsubscribe(h, "C") < 0)
+	goto done;
+    util_print_filters(es);
+    if (util_notify(h, "minor") < 0)
+	goto done;
+    util_print_events();
+    if (_event_cb_err)
+	fprintf(stdout, "serialize: %d subscribers not given event text\n", _event_cb_err);
+    else
+	fprintf(stdout, "serialize: ok\n");
+    /* Text of last event is valid after distribution */
+    if (_event_kept &&
+	strstr(cbuf_get(stream_event_cbuf(_event_kept)), "<severity>minor</severity>") != NULL)
+	fprintf(stdout, "kept: ok\n");
+    else
+	fprintf(stdout, "kept: no event text\n");
+    retval = 0;
+ done:
+    if (_event_kept)
+	stream_event_free(_event_kept);
+    if (h){
+	stream_delete_all(h, 1);
+	if (yspec)
+	    ys_free(yspec);
+	clicon_handle_exit(h);
+    }
+    return retval;
+}